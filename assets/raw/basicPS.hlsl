@@ -6,6 +6,21 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 //--------------------------------------------------------------------------------------
 
+//--------------------------------------------------------------------------------------
+// Variants - each keyword is defined to 1 or 0, see ShaderPermutation.h
+//   DIFFUSE_TEXTURE    sample g_txDiffuse, rather than using g_vObjectColor
+//   LIGHTING           N.L with an ambient floor, rather than unlit
+//--------------------------------------------------------------------------------------
+// @keywords DIFFUSE_TEXTURE LIGHTING
+
+#ifndef DIFFUSE_TEXTURE
+#define DIFFUSE_TEXTURE 1
+#endif
+
+#ifndef LIGHTING
+#define LIGHTING 1
+#endif
+
 //--------------------------------------------------------------------------------------
 // Globals
 //--------------------------------------------------------------------------------------
@@ -40,10 +55,18 @@ struct PS_INPUT
 //--------------------------------------------------------------------------------------
 float4 PSMain( PS_INPUT Input ) : SV_TARGET
 {
+#if DIFFUSE_TEXTURE
     float4 vDiffuse = g_txDiffuse.Sample( g_samLinear, Input.vTexcoord );
+#else
+    float4 vDiffuse = g_vObjectColor;
+#endif
 
+#if LIGHTING
     float fLighting = saturate( dot( g_vLightDir, Input.vNormal ) );
     fLighting = max( fLighting, g_fAmbient );
+#else
+    float fLighting = 1.0f;
+#endif
 
     return vDiffuse * fLighting;
 }
@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// File: instancedVS.hlsl
+//
+// Instanced version of basicVS.hlsl. The world matrix comes from a per-instance
+// vertex stream (slot 1) so many copies of a mesh can go out in a single draw.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// Globals
+//--------------------------------------------------------------------------------------
+cbuffer PerApplication : register( b0 )
+{
+    matrix        g_mProjection;
+};
+
+cbuffer PerFrame : register( b1 )
+{
+    matrix        g_mView;
+};
+
+cbuffer PerObject : register( b2 )
+{
+    matrix        g_mWorld;
+};
+
+//--------------------------------------------------------------------------------------
+// Input / Output structures
+//--------------------------------------------------------------------------------------
+struct VS_INPUT
+{
+    float4 vPosition                : POSITION;
+    float3 vNormal                  : NORMAL;
+    float2 vTexcoord                : TEXCOORD;
+    row_major float4x4 mInstance    : WORLD;
+};
+
+struct VS_OUTPUT
+{
+    float3 vNormal      : NORMAL;
+    float2 vTexcoord    : TEXCOORD0;
+    float4 vPosition    : SV_POSITION;
+};
+
+//--------------------------------------------------------------------------------------
+// Vertex Shader
+//--------------------------------------------------------------------------------------
+VS_OUTPUT VSMain( VS_INPUT Input )
+{
+    VS_OUTPUT Output;
+
+    float4x4 mWorld = mul( Input.mInstance, g_mWorld );
+
+    Output.vPosition = mul( Input.vPosition, mWorld );
+    Output.vPosition = mul( Output.vPosition, g_mView );
+    Output.vPosition = mul( Output.vPosition, g_mProjection );
+    Output.vNormal = mul( Input.vNormal, (float3x3)mWorld );
+    Output.vTexcoord = Input.vTexcoord;
+
+    return Output;
+}
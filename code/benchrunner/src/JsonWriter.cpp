@@ -0,0 +1,140 @@
+///
+/// JsonWriter.cpp - Just enough of a streaming JSON writer for the benchmark report.
+///
+
+#include "JsonWriter.h"
+
+#include "utils\assert.h"
+
+#include <math.h>
+
+JsonWriter::JsonWriter(FILE* file)
+    : mFile(file)
+{
+    ASSERT(file != nullptr);
+}
+
+JsonWriter::~JsonWriter()
+{
+    ASSERTD(mFirst.empty(), "JsonWriter closed with an object or array still open");
+}
+
+void JsonWriter::BeginObject(const char* name)
+{
+    BeginValue(name);
+    fputc('{', mFile);
+    mFirst.push_back(true);
+}
+
+void JsonWriter::EndObject()
+{
+    ASSERT(!mFirst.empty());
+
+    bool empty = mFirst.back();
+    mFirst.pop_back();
+    if (!empty)
+    {
+        fputc('\n', mFile);
+        Indent();
+    }
+    fputc('}', mFile);
+
+    if (mFirst.empty())
+        fputc('\n', mFile);
+}
+
+void JsonWriter::BeginArray(const char* name)
+{
+    BeginValue(name);
+    fputc('[', mFile);
+    mFirst.push_back(true);
+}
+
+void JsonWriter::EndArray()
+{
+    ASSERT(!mFirst.empty());
+
+    bool empty = mFirst.back();
+    mFirst.pop_back();
+    if (!empty)
+    {
+        fputc('\n', mFile);
+        Indent();
+    }
+    fputc(']', mFile);
+}
+
+void JsonWriter::Write(const char* name, const char* value)
+{
+    BeginValue(name);
+    WriteString(value);
+}
+
+void JsonWriter::Write(const char* name, double value)
+{
+    BeginValue(name);
+
+    // JSON has no NaN or infinity
+    if (value != value || fabs(value) > 1e300)
+        fputs("null", mFile);
+    else
+        fprintf(mFile, "%.6g", value);
+}
+
+void JsonWriter::Write(const char* name, unsigned long long value)
+{
+    BeginValue(name);
+    fprintf(mFile, "%llu", value);
+}
+
+void JsonWriter::Write(const char* name, bool value)
+{
+    BeginValue(name);
+    fputs(value ? "true" : "false", mFile);
+}
+
+void JsonWriter::BeginValue(const char* name)
+{
+    if (!mFirst.empty())
+    {
+        if (!mFirst.back())
+            fputc(',', mFile);
+        fputc('\n', mFile);
+        mFirst.back() = false;
+        Indent();
+    }
+
+    if (name != nullptr)
+    {
+        WriteString(name);
+        fputs(": ", mFile);
+    }
+}
+
+void JsonWriter::WriteString(const char* value)
+{
+    fputc('"', mFile);
+    for (const char* character = value; *character != 0; character++)
+    {
+        switch (*character)
+        {
+        case '"':  fputs("\\\"", mFile); break;
+        case '\\': fputs("\\\\", mFile); break;
+        case '\n': fputs("\\n", mFile); break;
+        case '\t': fputs("\\t", mFile); break;
+        default:
+            if ((unsigned char)*character < 0x20)
+                fprintf(mFile, "\\u%04x", (unsigned char)*character);
+            else
+                fputc(*character, mFile);
+            break;
+        }
+    }
+    fputc('"', mFile);
+}
+
+void JsonWriter::Indent()
+{
+    for (size_t depth = 0; depth < mFirst.size(); depth++)
+        fputs("  ", mFile);
+}
@@ -0,0 +1,36 @@
+///
+/// JsonWriter.h - Just enough of a streaming JSON writer for the benchmark report.
+///
+#pragma once
+
+#include <stdio.h>
+
+#include <vector>
+
+class JsonWriter
+{
+public:
+    JsonWriter(FILE* file);
+    ~JsonWriter();
+
+    // A null name is for values inside arrays and the outermost object
+    void BeginObject(const char* name = nullptr);
+    void EndObject();
+    void BeginArray(const char* name = nullptr);
+    void EndArray();
+
+    void Write(const char* name, const char* value);
+    void Write(const char* name, double value);
+    void Write(const char* name, unsigned long long value);
+    void Write(const char* name, unsigned int value) { Write(name, (unsigned long long)value); }
+    void Write(const char* name, bool value);
+
+private:
+    void BeginValue(const char* name);
+    void WriteString(const char* value);
+    void Indent();
+
+private:
+    FILE*               mFile;
+    std::vector<bool>   mFirst;     // one per open object or array - nothing written in it yet
+};
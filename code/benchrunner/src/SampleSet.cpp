@@ -0,0 +1,59 @@
+///
+/// SampleSet.cpp - Timings for one benchmark stage, and the percentiles we report from them.
+///
+
+#include "SampleSet.h"
+#include "JsonWriter.h"
+
+#include <algorithm>
+#include <math.h>
+
+double SampleSet::Percentile(double percent) const
+{
+    if (mSamples.empty())
+        return 0.0;
+
+    std::vector<double> sorted(mSamples);
+    std::sort(sorted.begin(), sorted.end());
+
+    size_t rank = (size_t)ceil((percent / 100.0) * sorted.size());
+    if (rank == 0)
+        rank = 1;
+    if (rank > sorted.size())
+        rank = sorted.size();
+
+    return sorted[rank - 1];
+}
+
+double SampleSet::Mean() const
+{
+    if (mSamples.empty())
+        return 0.0;
+
+    double total = 0.0;
+    for (auto sample : mSamples)
+        total += sample;
+
+    return total / mSamples.size();
+}
+
+double SampleSet::Max() const
+{
+    double largest = 0.0;
+    for (auto sample : mSamples)
+        largest = (sample > largest) ? sample : largest;
+
+    return largest;
+}
+
+void SampleSet::Write(JsonWriter& writer, const char* name) const
+{
+    writer.BeginObject(name);
+    writer.Write("samples", GetCount());
+    writer.Write("p50_ms", Percentile(50.0));
+    writer.Write("p95_ms", Percentile(95.0));
+    writer.Write("p99_ms", Percentile(99.0));
+    writer.Write("mean_ms", Mean());
+    writer.Write("max_ms", Max());
+    writer.EndObject();
+}
@@ -0,0 +1,28 @@
+///
+/// SampleSet.h - Timings for one benchmark stage, and the percentiles we report from them.
+///
+#pragma once
+
+#include <vector>
+
+class JsonWriter;
+
+class SampleSet
+{
+public:
+    void Reserve(unsigned int count) { mSamples.reserve(count); }
+    void Add(double milliseconds) { mSamples.push_back(milliseconds); }
+
+    unsigned int GetCount() const { return (unsigned int)mSamples.size(); }
+
+    // Nearest rank, so the result is always a sample that actually happened
+    double Percentile(double percent) const;
+    double Mean() const;
+    double Max() const;
+
+    // { "p50_ms": ..., "p95_ms": ..., "p99_ms": ..., "mean_ms": ..., "max_ms": ... }
+    void Write(JsonWriter& writer, const char* name) const;
+
+private:
+    std::vector<double> mSamples;
+};
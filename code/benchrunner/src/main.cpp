@@ -0,0 +1,894 @@
+///
+/// main.cpp - Headless benchmark runner.
+/// Builds a scene from intro01's code, runs it for a number of frames without a window and
+/// writes a JSON report: per-stage percentiles, allocation counts, draw and state counters,
+/// plus the frame pipeline, frame graph, job system, SIMD math, CPU shader and block
+/// compression and atlas packing microbenchmarks and a headless texture streaming
+/// simulation.
+///
+/// Usage: benchrunner [--frames N] [--warmup N] [--nodes N] [--backend warp|null]
+///                    [--scene synthetic|<model file>] [--out report.json] [--no-micro]
+///                    [--trace trace.json]
+///
+/// --trace writes a Chrome trace of the whole run, when the profiler is compiled in.
+///
+
+#include "stdafx.h"
+#include "d3d11.h"
+#include "DirectXMath.h"
+
+#include "AssetManagement\AssetManager.h"
+#include "Graphics\RenderDevice.h"
+#include "Graphics\FrameRingBuffer.h"
+#include "Graphics\AtlasPackerBenchmark.h"
+#include "Graphics\BlockCompressorBenchmark.h"
+#include "Graphics\ColorShader.h"
+#include "Graphics\CpuShaderBenchmark.h"
+#include "Graphics\DrawBatcher.h"
+#include "Graphics\FrameGraph.h"
+#include "Graphics\Mesh.h"
+#include "Graphics\Model.h"
+#include "Graphics\TextureStreamingSimulation.h"
+#include "Scene\Scene.h"
+#include "Scene\SceneNode.h"
+#include "FramePipeline.h"
+#include "utils\JobSystemBenchmark.h"
+#include "utils\SimdMath.h"
+#include "utils\SimdMathBenchmark.h"
+#include "utils\Profiler.h"
+#include "utils\MemoryTracker.h"
+
+#include "JsonWriter.h"
+#include "SampleSet.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock RunnerClock;
+
+// Children per group in the synthetic scene, and the gap between groups
+const unsigned int kGroupSize       = 8;
+const float        kGroupSpacing    = 6.0f;
+
+const unsigned int kPipelineFrames  = 200;
+const unsigned int kGraphIterations = 2000;
+
+struct RunnerOptions
+{
+    unsigned int    Frames;
+    unsigned int    Warmup;
+    unsigned int    Nodes;
+    bool            NullBackend;
+    bool            Micro;
+    std::string     SceneName;
+    std::string     Output;
+    std::string     Trace;
+};
+
+// What the frame loop needs, whichever backend is in use
+struct RunnerContext
+{
+    RenderDevice*           Device;         // null for the null backend
+    ColorShader*            Shader;         // null when the shaders couldn't be loaded
+    DrawBatcher*            Batcher;
+    Scene*                  World;
+    std::vector<SceneNode*> Groups;         // the animated group roots
+    std::vector<SceneNode*> Visible;
+
+    DirectX::XMMATRIX       View;
+    DirectX::XMMATRIX       Projection;
+    float                   Time;
+};
+
+struct FrameCounters
+{
+    unsigned long long  DrawCalls;
+    unsigned long long  MaterialChanges;
+    unsigned long long  Instances;
+    unsigned long long  VisibleNodes;
+    unsigned long long  ConstantUploads;
+    unsigned long long  ConstantBytes;
+    unsigned long long  ConstantFieldWrites;
+    unsigned long long  RedundantConstantWrites;
+    unsigned long long  RingStalls;
+};
+
+static double MillisecondsBetween(RunnerClock::time_point start, RunnerClock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static ID3D11DeviceContext* GetContext(RunnerContext& context)
+{
+    return (context.Device != nullptr) ? context.Device->GetDeviceContext() : nullptr;
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+        "usage: benchrunner [--frames N] [--warmup N] [--nodes N] [--backend warp|null]\n"
+        "                   [--scene synthetic|<model file>] [--out report.json] [--no-micro]\n"
+        "                   [--trace trace.json]\n");
+}
+
+static bool ParseArguments(int argc, char* argv[], RunnerOptions& options)
+{
+    options.Frames = 500;
+    options.Warmup = 50;
+    options.Nodes = 2048;
+    options.NullBackend = false;
+    options.Micro = true;
+    options.SceneName = "synthetic";
+
+    for (int index = 1; index < argc; index++)
+    {
+        const char* argument = argv[index];
+        const char* value = (index + 1 < argc) ? argv[index + 1] : nullptr;
+
+        if (strcmp(argument, "--no-micro") == 0)
+        {
+            options.Micro = false;
+            continue;
+        }
+
+        if (value == nullptr)
+            return false;
+        index++;
+
+        if (strcmp(argument, "--frames") == 0)
+            options.Frames = (unsigned int)atoi(value);
+        else if (strcmp(argument, "--warmup") == 0)
+            options.Warmup = (unsigned int)atoi(value);
+        else if (strcmp(argument, "--nodes") == 0)
+            options.Nodes = (unsigned int)atoi(value);
+        else if (strcmp(argument, "--scene") == 0)
+            options.SceneName = value;
+        else if (strcmp(argument, "--out") == 0)
+            options.Output = value;
+        else if (strcmp(argument, "--trace") == 0)
+            options.Trace = value;
+        else if (strcmp(argument, "--backend") == 0)
+        {
+            if (strcmp(value, "null") == 0)
+                options.NullBackend = true;
+            else if (strcmp(value, "warp") != 0)
+                return false;
+        }
+        else
+            return false;
+    }
+
+    return (options.Frames > 0) && (options.Nodes > 0);
+}
+
+// Stand in for the imported model when there's no device or no assets. The meshes are only
+// loaded onto the GPU when there's a device to load them onto.
+static Model* CreateCubeModel(ID3D11Device* device)
+{
+    static const float kCorners[8][3] =
+    {
+        { -1, -1, -1 }, { -1,  1, -1 }, {  1,  1, -1 }, {  1, -1, -1 },
+        { -1, -1,  1 }, { -1,  1,  1 }, {  1,  1,  1 }, {  1, -1,  1 },
+    };
+    static const unsigned int kIndices[36] =
+    {
+        0, 1, 2, 0, 2, 3,   4, 6, 5, 4, 7, 6,   4, 5, 1, 4, 1, 0,
+        3, 2, 6, 3, 6, 7,   1, 5, 6, 1, 6, 2,   4, 0, 3, 4, 3, 7,
+    };
+
+    Model* model = new Model();
+    model->Initialize(1, 8, 36);
+    model->SetBounds(0.0f, 0.0f, 0.0f, sqrtf(3.0f));
+
+    Mesh* mesh = model->CreateMesh();
+    if (device != nullptr)
+    {
+        // Both arrays live in the model's block
+        PositionNormalUVLayout* vertices = model->GetVertexStorage();
+        for (unsigned int index = 0; index < 8; index++)
+        {
+            vertices[index].Position = DirectX::XMFLOAT3(kCorners[index][0], kCorners[index][1], kCorners[index][2]);
+            DirectX::XMStoreFloat3(&vertices[index].Normal, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&vertices[index].Position)));
+            vertices[index].UV = DirectX::XMFLOAT2(0.0f, 0.0f);
+        }
+
+        unsigned int* indices = model->GetIndexStorage();
+        memcpy(indices, kIndices, sizeof(kIndices));
+        mesh->Load(device, vertices, 8, indices, 36, false);
+    }
+
+    return model;
+}
+
+// Groups of kGroupSize nodes laid out on a square grid - one parent that spins and children
+// orbiting it. The grid is wider than the view, so culling has something to do.
+static void BuildSyntheticScene(RunnerContext& context, Model* model, unsigned int nodeCount)
+{
+    unsigned int groupCount = (nodeCount + kGroupSize - 1) / kGroupSize;
+    unsigned int side = 1;
+    while (side * side < groupCount)
+        side++;
+
+    float offset = (side - 1) * kGroupSpacing * 0.5f;
+    unsigned int created = 0;
+
+    for (unsigned int group = 0; (group < groupCount) && (created < nodeCount); group++)
+    {
+        float x = (group % side) * kGroupSpacing - offset;
+        float z = (group / side) * kGroupSpacing - offset;
+
+        SceneNode* parent = context.World->CreateNode(nullptr, model, DirectX::XMMatrixTranslation(x, 0.0f, z));
+        context.Groups.push_back(parent);
+        created++;
+
+        for (unsigned int child = 1; (child < kGroupSize) && (created < nodeCount); child++)
+        {
+            float angle = DirectX::XM_2PI * child / (kGroupSize - 1);
+            DirectX::XMMATRIX local = DirectX::XMMatrixScaling(0.4f, 0.4f, 0.4f)
+                                    * DirectX::XMMatrixTranslation(2.0f * cosf(angle), 0.5f, 2.0f * sinf(angle));
+            context.World->CreateNode(parent, model, local);
+            created++;
+        }
+    }
+}
+
+// ======================================================================================
+// Frame stages
+// ======================================================================================
+static void UpdateStage(RunnerContext& context)
+{
+    PROFILE_FUNCTION();
+
+    context.Time += 1.0f / 60.0f;
+
+    for (unsigned int index = 0; index < context.Groups.size(); index++)
+    {
+        SceneNode* group = context.Groups[index];
+        DirectX::XMMATRIX local = group->GetLocalTransform();
+
+        DirectX::XMVECTOR position = local.r[3];
+        DirectX::XMMATRIX spin = DirectX::XMMatrixRotationY(context.Time + index * 0.1f);
+        spin.r[3] = position;
+        group->SetLocalTransform(spin);
+    }
+
+    context.World->Update();
+}
+
+static void CullStage(RunnerContext& context)
+{
+    PROFILE_FUNCTION();
+    context.World->Cull(DirectX::XMMatrixMultiply(context.View, context.Projection), context.Visible);
+}
+
+static void SubmitStage(RunnerContext& context)
+{
+    PROFILE_FUNCTION();
+    Scene::Submit(context.Visible, *context.Batcher);
+}
+
+static void RenderStage(RunnerContext& context)
+{
+    PROFILE_FUNCTION();
+
+    ID3D11DeviceContext* deviceContext = GetContext(context);
+
+    if ((deviceContext != nullptr) && (context.Shader != nullptr))
+    {
+        DirectX::XMMATRIX world = DirectX::XMMatrixIdentity();
+        context.Shader->Render(deviceContext, world, context.View, context.Projection);
+    }
+
+    context.Batcher->Flush(deviceContext);
+}
+
+static void PresentStage(RunnerContext& context)
+{
+    PROFILE_FUNCTION();
+    if (context.Device != nullptr)
+        context.Device->Present();
+}
+
+static void GatherCounters(RunnerContext& context, FrameCounters& counters)
+{
+    counters.DrawCalls += context.Batcher->GetDrawCallCount();
+    counters.MaterialChanges += context.Batcher->GetMaterialChangeCount();
+    counters.Instances += context.Batcher->GetInstanceCount();
+    counters.VisibleNodes += context.Visible.size();
+
+    if (context.Shader != nullptr)
+    {
+        const ConstantBlockSet::Stats& constants = context.Shader->GetConstantStats();
+        counters.ConstantUploads += constants.Uploads;
+        counters.ConstantBytes += constants.BytesUploaded;
+        counters.ConstantFieldWrites += constants.FieldWrites;
+        counters.RedundantConstantWrites += constants.RedundantWrites;
+    }
+
+    if ((context.Device != nullptr) && (context.Device->GetVertexRing() != nullptr))
+        counters.RingStalls += context.Device->GetVertexRing()->GetStallCount();
+}
+
+// ======================================================================================
+// Frame pipeline - the same stages, serial and overlapped
+// ======================================================================================
+static void RunPipeline(RunnerContext& context, bool pipelined, JsonWriter& writer, const char* name)
+{
+    FramePipeline pipeline;
+
+    pipeline.Start([&](const RenderSnapshot& snapshot)
+    {
+        DirectX::XMMATRIX view = DirectX::XMLoadFloat4x4(&snapshot.View);
+        DirectX::XMMATRIX projection = DirectX::XMLoadFloat4x4(&snapshot.Projection);
+        ID3D11DeviceContext* deviceContext = GetContext(context);
+
+        if ((deviceContext != nullptr) && (context.Shader != nullptr))
+        {
+            DirectX::XMMATRIX world = DirectX::XMMatrixIdentity();
+            context.Shader->Render(deviceContext, world, view, projection);
+        }
+
+        for (auto& item : snapshot.Items)
+            context.Batcher->Submit(item.model, DirectX::XMLoadFloat4x4(&item.world));
+        context.Batcher->Flush(deviceContext);
+
+        PresentStage(context);
+    }, pipelined);
+
+    for (unsigned int frame = 0; frame < kPipelineFrames; frame++)
+    {
+        PROFILE_SCOPE("SimulateFrame");
+        RenderSnapshot* snapshot = pipeline.BeginFrame();
+
+        UpdateStage(context);
+        CullStage(context);
+
+        snapshot->SetCamera(context.View, context.Projection);
+        for (auto node : context.Visible)
+            snapshot->Add(node->GetModel(), node->GetWorldTransform());
+
+        pipeline.EndFrame(snapshot);
+    }
+
+    pipeline.Stop();
+
+    FramePipeline::Stats stats = pipeline.GetStats();
+    writer.BeginObject(name);
+    writer.Write("frames", stats.FrameCount);
+    writer.Write("frames_per_second", stats.FramesPerSecond());
+    writer.Write("simulation_mean_ms", stats.AverageSimulation() * 1000.0);
+    writer.Write("render_mean_ms", stats.AverageRender() * 1000.0);
+    writer.Write("latency_mean_ms", stats.AverageLatency() * 1000.0);
+    writer.Write("latency_max_ms", stats.MaxLatencySeconds * 1000.0);
+    writer.EndObject();
+}
+
+// ======================================================================================
+// Frame graph - compile and execute cost of a deferred-looking frame
+// ======================================================================================
+class NullFrameGraphAllocator : public IFrameGraphAllocator
+{
+public:
+    NullFrameGraphAllocator() : mNext(0) {}
+
+    virtual void* Acquire(const FrameGraphTextureDesc&) override { return &mTextures[mNext++ % kTextureCount]; }
+    virtual void Release(void*) override {}
+
+private:
+    static const unsigned int kTextureCount = 64;
+    int             mTextures[kTextureCount];
+    unsigned int    mNext;
+};
+
+static void RunFrameGraphBenchmark(JsonWriter& writer)
+{
+    const unsigned int kBloomLevels = 5;
+
+    FrameGraph graph;
+    NullFrameGraphAllocator allocator;
+    SampleSet samples;
+    samples.Reserve(kGraphIterations);
+
+    static int backBufferTexture = 0;
+    FrameGraphTextureDesc fullScreen = { 1920, 1080, DXGI_FORMAT_R8G8B8A8_UNORM, 4, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE };
+    FrameGraphTextureDesc hdr = { 1920, 1080, DXGI_FORMAT_R16G16B16A16_FLOAT, 8, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE };
+    FrameGraphTextureDesc depth = { 1920, 1080, DXGI_FORMAT_R32_TYPELESS, 4, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE };
+
+    // The first build warms up the graph's arena and vectors - count from the second
+    MemoryTracker::Stats allocationsBefore = MemoryTracker::GetTotals();
+
+    for (unsigned int iteration = 0; iteration < kGraphIterations; iteration++)
+    {
+        if (iteration == 1)
+            allocationsBefore = MemoryTracker::GetTotals();
+
+        RunnerClock::time_point start = RunnerClock::now();
+
+        graph.Reset();
+        FrameGraphResource backBuffer = graph.Import("BackBuffer", fullScreen, &backBufferTexture);
+        FrameGraphResource albedo, normals, depthBuffer, lit, unused;
+
+        graph.AddPass("GBuffer", [&](FrameGraphBuilder& builder)
+        {
+            albedo = builder.Create("Albedo", fullScreen);
+            normals = builder.Create("Normals", fullScreen);
+            depthBuffer = builder.Create("Depth", depth);
+        }, [](const FrameGraphResources&) {});
+
+        graph.AddPass("Lighting", [&](FrameGraphBuilder& builder)
+        {
+            builder.Read(albedo);
+            builder.Read(normals);
+            builder.Read(depthBuffer);
+            lit = builder.Create("Lit", hdr);
+        }, [](const FrameGraphResources&) {});
+
+        // Each bloom level halves the one before it
+        FrameGraphResource bloom = lit;
+        for (unsigned int level = 0; level < kBloomLevels; level++)
+        {
+            graph.AddPass("Bloom", [&](FrameGraphBuilder& builder)
+            {
+                FrameGraphTextureDesc desc = hdr;
+                desc.Width >>= (level + 1);
+                desc.Height >>= (level + 1);
+                builder.Read(bloom);
+                bloom = builder.Create("BloomLevel", desc);
+            }, [](const FrameGraphResources&) {});
+        }
+
+        graph.AddPass("Tonemap", [&](FrameGraphBuilder& builder)
+        {
+            builder.Read(lit);
+            builder.Read(bloom);
+            builder.Write(backBuffer);
+        }, [](const FrameGraphResources&) {});
+
+        // Nobody reads this, so it should be culled every time
+        graph.AddPass("DebugView", [&](FrameGraphBuilder& builder)
+        {
+            builder.Read(normals);
+            unused = builder.Create("DebugOutput", fullScreen);
+        }, [](const FrameGraphResources&) {});
+
+        if (graph.Compile())
+            graph.Execute(&allocator);
+
+        samples.Add(MillisecondsBetween(start, RunnerClock::now()));
+    }
+
+    MemoryTracker::Stats allocationsAfter = MemoryTracker::GetTotals();
+
+    const FrameGraph::Stats& stats = graph.GetStats();
+    writer.BeginObject("frame_graph");
+    samples.Write(writer, "build_compile_execute");
+    writer.Write("allocations_per_build", (double)(allocationsAfter.Allocations - allocationsBefore.Allocations) / (kGraphIterations - 1));
+    writer.Write("passes", stats.PassCount);
+    writer.Write("culled_passes", stats.CulledPassCount);
+    writer.Write("transients", stats.TransientCount);
+    writer.Write("physical_textures", stats.PhysicalCount);
+    writer.Write("transient_bytes", stats.TransientBytes);
+    writer.Write("physical_bytes", stats.PhysicalBytes);
+
+    // A feeds both B and D. B is culled, which frees one of A's outputs - A still has to
+    // survive for D
+    graph.Reset();
+    FrameGraphResource first, second;
+    unsigned int producer = graph.AddPass("A", [&](FrameGraphBuilder& builder)
+    {
+        first = builder.Create("First", fullScreen);
+        second = builder.Create("Second", fullScreen);
+    }, [](const FrameGraphResources&) {});
+    unsigned int unusedConsumer = graph.AddPass("B", [&](FrameGraphBuilder& builder)
+    {
+        builder.Read(first);
+    }, [](const FrameGraphResources&) {});
+    unsigned int sideEffectConsumer = graph.AddPass("D", [&](FrameGraphBuilder& builder)
+    {
+        builder.Read(second);
+        builder.SideEffect();
+    }, [](const FrameGraphResources&) {});
+
+    bool cullingCorrect = graph.Compile() && !graph.IsCulled(producer) && graph.IsCulled(unusedConsumer) && !graph.IsCulled(sideEffectConsumer);
+    writer.Write("culling_correct", cullingCorrect);
+    writer.EndObject();
+}
+
+static void RunJobSystemBenchmark(JsonWriter& writer)
+{
+    std::vector<JobSystemBenchmarkResult> results;
+    RunJobSystemBenchmarks(0, results);
+
+    writer.BeginArray("job_system");
+    for (auto& result : results)
+    {
+        writer.BeginObject();
+        writer.Write("threads", result.ThreadCount);
+        writer.Write("spawn_ns", result.SpawnNanoseconds);
+        writer.Write("steal_latency_ns", result.StealNanoseconds);
+        writer.Write("jobs_per_second", result.JobsPerSecond);
+        writer.Write("parallel_for_items_per_second", result.ItemsPerSecond);
+        writer.Write("parallel_for_speedup", result.ParallelForSpeedup);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+static void RunSimdMathBenchmark(JsonWriter& writer)
+{
+    std::vector<SimdMathBenchmarkResult> results;
+    RunSimdMathBenchmarks(results);
+
+    writer.BeginObject("simd_math");
+    writer.Write("backend", Math::GetBackendName());
+    for (auto& result : results)
+    {
+        writer.BeginObject(result.Name);
+        writer.Write("count", result.Count);
+        writer.Write("scalar_ns", result.ScalarNanoseconds);
+        writer.Write("simd_ns", result.SimdNanoseconds);
+        writer.Write("speedup", result.Speedup);
+        writer.Write("max_error", result.MaxError);
+        writer.EndObject();
+    }
+    writer.EndObject();
+}
+
+static void RunCpuShaderBenchmark(JsonWriter& writer)
+{
+    std::vector<CpuShaderBenchmarkResult> results;
+    std::string errors;
+    bool compiled = RunCpuShaderBenchmarks("assets\\raw", results, errors);
+    if (!compiled)
+        fprintf(stderr, "benchrunner: CPU shader benchmark: %s", errors.c_str());
+
+    writer.BeginObject("cpu_shader");
+    writer.Write("compiled", compiled);
+    for (auto& result : results)
+    {
+        writer.BeginObject(result.Name);
+        writer.Write("count", result.Count);
+        writer.Write("instructions", result.Instructions);
+        writer.Write("ns", result.Nanoseconds);
+        writer.Write("max_error", result.MaxError);
+        writer.EndObject();
+    }
+    writer.EndObject();
+}
+
+static void RunBlockCompressorBenchmark(JsonWriter& writer)
+{
+    std::vector<BlockCompressorBenchmarkResult> results;
+    RunBlockCompressorBenchmarks(0, results);
+
+    writer.BeginArray("block_compression");
+    for (auto& result : results)
+    {
+        writer.BeginObject();
+        writer.Write("format", result.Format);
+        writer.Write("quality", result.Quality);
+        writer.Write("threads", result.ThreadCount);
+        writer.Write("ms", result.Milliseconds);
+        writer.Write("megatexels_per_second", result.MegatexelsPerSecond);
+        writer.Write("psnr", result.Psnr);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+static void RunAtlasPackerBenchmark(JsonWriter& writer)
+{
+    std::vector<AtlasPackerBenchmarkResult> results;
+    RunAtlasPackerBenchmarks(results);
+
+    writer.BeginArray("atlas_packing");
+    for (auto& result : results)
+    {
+        writer.BeginObject();
+        writer.Write("heuristic", result.Heuristic);
+        writer.Write("sorted", result.Sorted);
+        writer.Write("rectangles", result.RectangleCount);
+        writer.Write("pages", result.PageCount);
+        writer.Write("occupancy", result.Occupancy);
+        writer.Write("full_page_occupancy", result.FullPageOccupancy);
+        writer.Write("ms", result.Milliseconds);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+static void RunTextureStreamingBenchmark(JsonWriter& writer)
+{
+    // A tight budget and a loose one - the first has to evict, the second shows the cost of
+    // the reads alone
+    static const unsigned int kBudgetMegabytes[] = { 32, 256 };
+
+    writer.BeginArray("texture_streaming");
+    for (unsigned int budget : kBudgetMegabytes)
+    {
+        TextureStreamingSimulationSettings settings;
+        settings.Streamer.BudgetBytes = (unsigned long long)budget << 20;
+
+        TextureStreamingSimulationResult result;
+        bool valid = RunTextureStreamingSimulation(settings, result);
+
+        writer.BeginObject();
+        writer.Write("budget_mb", budget);
+        writer.Write("full_mb", (double)result.FullBytes / (1 << 20));
+        writer.Write("peak_resident_mb", (double)result.PeakResidentBytes / (1 << 20));
+        writer.Write("peak_committed_mb", (double)result.PeakCommittedBytes / (1 << 20));
+        writer.Write("read_mb", (double)result.BytesRead / (1 << 20));
+        writer.Write("loads", result.LoadsCompleted);
+        writer.Write("evictions", result.Evictions);
+        writer.Write("visible_textures", result.AverageVisibleTextures);
+        writer.Write("missing_mips", result.AverageMissingMips);
+        writer.Write("sharp_frames", result.SharpFrames);
+        writer.Write("update_us", result.UpdateMicroseconds);
+        writer.Write("valid", valid);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+int main(int argc, char* argv[])
+{
+    RunnerOptions options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    PROFILE_THREAD_NAME("Main");
+
+    RenderDevice* device = nullptr;
+    if (!options.NullBackend)
+    {
+        device = new RenderDevice();
+        if (!device->InitHeadless(1280, 720))
+        {
+            fprintf(stderr, "benchrunner: couldn't create the WARP device - try --backend null\n");
+            delete device;
+            return 1;
+        }
+    }
+
+    ID3D11Device* d3dDevice = (device != nullptr) ? device->GetDevice() : nullptr;
+
+    // Assets come through the AssetManager, same as the samples
+    AssetManager* assets = nullptr;
+    ColorShader* shader = nullptr;
+    Model* model = nullptr;
+    if (d3dDevice != nullptr)
+    {
+        assets = new AssetManager();
+        assets->Initialize(d3dDevice);
+        if (assets->AddPath("assets\\raw"))
+        {
+            const char* modelName = (options.SceneName == "synthetic") ? "lte-orb.fbx" : options.SceneName.c_str();
+            if (assets->LoadModel(modelName))
+                model = assets->GetModel(modelName);
+
+            assets->LoadShaderPack("shaders.pack");
+            if (assets->LoadShader("basicPS.hlsl", "ps_5_0", "PSMain", BPS_Default)
+                && assets->LoadShader("instancedVS.hlsl", "vs_5_0", "VSMain"))
+            {
+                shader = new ColorShader();
+                if (!shader->InitShader(d3dDevice, NULL, device->GetShaderLayouts(), assets->GetShader("instancedVS.hlsl"), assets->GetShader("basicPS.hlsl", BPS_Default)))
+                {
+                    delete shader;
+                    shader = nullptr;
+                }
+            }
+        }
+    }
+
+    Model* fallbackModel = nullptr;
+    if (model == nullptr)
+    {
+        fallbackModel = CreateCubeModel(d3dDevice);
+        model = fallbackModel;
+    }
+
+    RunnerContext context;
+    context.Device = device;
+    context.Shader = shader;
+    context.Batcher = new DrawBatcher();
+    context.World = new Scene();
+    context.Time = 0.0f;
+    context.View = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.0f, 30.0f, -80.0f, 1.0f),
+                                             DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+                                             DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    context.Projection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(45.0f), 1280.0f / 720.0f, 0.1f, 500.0f);
+
+    context.Batcher->Initialize(d3dDevice, options.Nodes * model->GetMeshCount());
+    if (device != nullptr)
+        context.Batcher->SetInstanceRing(device->GetVertexRing());
+    if (assets != nullptr)
+        context.Batcher->SetMaterials(assets->GetMaterialLibrary());
+
+    BuildSyntheticScene(context, model, options.Nodes);
+    context.Visible.reserve(options.Nodes);
+
+    // The frame loop
+    SampleSet update, cull, submit, render, present, frame;
+    SampleSet* stages[] = { &update, &cull, &submit, &render, &present, &frame };
+    for (auto stage : stages)
+        stage->Reserve(options.Frames);
+
+    FrameCounters counters;
+    memset(&counters, 0, sizeof(counters));
+
+    unsigned long long frameAllocationsMax = 0;
+    unsigned long long tagAllocations[MT_Count] = {};
+    MemoryTracker::Stats allocationsBefore = MemoryTracker::GetTotals();
+
+    for (unsigned int index = 0; index < options.Warmup + options.Frames; index++)
+    {
+        bool measured = (index >= options.Warmup);
+        if (index == options.Warmup)
+            allocationsBefore = MemoryTracker::GetTotals();
+
+        // Start this frame's allocation counts from zero
+        MemoryTracker::EndFrame();
+        PROFILE_SCOPE("Frame");
+
+        RunnerClock::time_point start = RunnerClock::now();
+        UpdateStage(context);
+        RunnerClock::time_point updated = RunnerClock::now();
+        CullStage(context);
+        RunnerClock::time_point culled = RunnerClock::now();
+        SubmitStage(context);
+        RunnerClock::time_point submitted = RunnerClock::now();
+        RenderStage(context);
+        RunnerClock::time_point rendered = RunnerClock::now();
+        PresentStage(context);
+        RunnerClock::time_point presented = RunnerClock::now();
+        MemoryTracker::EndFrame();
+
+        if (!measured)
+            continue;
+
+        update.Add(MillisecondsBetween(start, updated));
+        cull.Add(MillisecondsBetween(updated, culled));
+        submit.Add(MillisecondsBetween(culled, submitted));
+        render.Add(MillisecondsBetween(submitted, rendered));
+        present.Add(MillisecondsBetween(rendered, presented));
+        frame.Add(MillisecondsBetween(start, presented));
+
+        GatherCounters(context, counters);
+
+        unsigned long long frameAllocations = MemoryTracker::GetTotals().FrameAllocations;
+        frameAllocationsMax = (frameAllocations > frameAllocationsMax) ? frameAllocations : frameAllocationsMax;
+        for (unsigned int tag = 0; tag < MT_Count; tag++)
+            tagAllocations[tag] += MemoryTracker::GetStats((MemoryTag)tag).FrameAllocations;
+    }
+
+    MemoryTracker::Stats allocationsAfter = MemoryTracker::GetTotals();
+
+    // Report
+    FILE* file = stdout;
+    if (!options.Output.empty())
+    {
+        file = fopen(options.Output.c_str(), "w");
+        if (file == nullptr)
+        {
+            fprintf(stderr, "benchrunner: couldn't open %s\n", options.Output.c_str());
+            return 1;
+        }
+    }
+
+    {
+        JsonWriter writer(file);
+        writer.BeginObject();
+
+        writer.BeginObject("config");
+        writer.Write("backend", options.NullBackend ? "null" : "warp");
+        writer.Write("scene", options.SceneName.c_str());
+        writer.Write("imported_model", fallbackModel == nullptr);
+        writer.Write("shaders", shader != nullptr);
+        writer.Write("frames", options.Frames);
+        writer.Write("warmup", options.Warmup);
+        writer.Write("nodes", context.World->GetNodeCount());
+#if defined(_DEBUG)
+        writer.Write("configuration", "debug");
+#else
+        writer.Write("configuration", "release");
+#endif
+        writer.EndObject();
+
+        writer.BeginObject("stages");
+        update.Write(writer, "update");
+        cull.Write(writer, "cull");
+        submit.Write(writer, "submit");
+        render.Write(writer, "render");
+        present.Write(writer, "present");
+        frame.Write(writer, "frame");
+        writer.EndObject();
+
+        double frames = (double)options.Frames;
+        writer.BeginObject("allocations");
+        writer.Write("total", allocationsAfter.Allocations - allocationsBefore.Allocations);
+        writer.Write("frees", allocationsAfter.Frees - allocationsBefore.Frees);
+        writer.Write("bytes", allocationsAfter.AllocatedBytes - allocationsBefore.AllocatedBytes);
+        writer.Write("per_frame_mean", (allocationsAfter.Allocations - allocationsBefore.Allocations) / frames);
+        writer.Write("per_frame_max", frameAllocationsMax);
+        writer.Write("live_bytes", allocationsAfter.LiveBytes);
+        writer.Write("peak_bytes", allocationsAfter.PeakBytes);
+
+        writer.BeginObject("tags");
+        for (unsigned int tag = 0; tag < MT_Count; tag++)
+        {
+            MemoryTracker::Stats stats = MemoryTracker::GetStats((MemoryTag)tag);
+            writer.BeginObject(MemoryTracker::GetTagName((MemoryTag)tag));
+            writer.Write("per_frame_mean", tagAllocations[tag] / frames);
+            writer.Write("live_bytes", stats.LiveBytes);
+            writer.Write("peak_bytes", stats.PeakBytes);
+            writer.EndObject();
+        }
+        writer.EndObject();
+        writer.EndObject();
+
+        // Per frame averages
+        writer.BeginObject("counters");
+        writer.Write("draw_calls", counters.DrawCalls / frames);
+        writer.Write("material_changes", counters.MaterialChanges / frames);
+        writer.Write("instances", counters.Instances / frames);
+        writer.Write("visible_nodes", counters.VisibleNodes / frames);
+        writer.Write("constant_uploads", counters.ConstantUploads / frames);
+        writer.Write("constant_bytes", counters.ConstantBytes / frames);
+        writer.Write("constant_field_writes", counters.ConstantFieldWrites / frames);
+        writer.Write("redundant_constant_writes", counters.RedundantConstantWrites / frames);
+        writer.Write("ring_stalls", counters.RingStalls / frames);
+        writer.EndObject();
+
+        writer.BeginObject("pipeline");
+        RunPipeline(context, false, writer, "serial");
+        RunPipeline(context, true, writer, "pipelined");
+        writer.EndObject();
+
+        if (options.Micro)
+        {
+            RunFrameGraphBenchmark(writer);
+            RunJobSystemBenchmark(writer);
+            RunSimdMathBenchmark(writer);
+            RunCpuShaderBenchmark(writer);
+            RunBlockCompressorBenchmark(writer);
+            RunAtlasPackerBenchmark(writer);
+            RunTextureStreamingBenchmark(writer);
+        }
+
+        writer.EndObject();
+    }
+
+    if (file != stdout)
+        fclose(file);
+
+#if USING(ENABLE_PROFILER)
+    if (!options.Trace.empty())
+    {
+        if (!Profiler::WriteChromeTrace(options.Trace.c_str()))
+            fprintf(stderr, "benchrunner: couldn't write %s\n", options.Trace.c_str());
+        else if (Profiler::GetDroppedEventCount() > 0)
+            fprintf(stderr, "benchrunner: the trace is missing %llu events\n", Profiler::GetDroppedEventCount());
+    }
+#else
+    if (!options.Trace.empty())
+        fprintf(stderr, "benchrunner: --trace needs ENABLE_PROFILER\n");
+#endif
+
+    delete context.World;
+    delete context.Batcher;
+    delete fallbackModel;
+    if (shader != nullptr)
+        shader->Shutdown();
+    delete shader;
+    delete assets;
+    delete device;
+
+    return 0;
+}
@@ -12,16 +12,41 @@
 #include "assimp\scene.h"
 
 #include "MeshResourceLoader.h"
+#include "TextureResourceLoader.h"
 
+#include "Graphics\MaterialLibrary.h"
+#include "Graphics\Mesh.h"
 #include "Graphics\Model.h"
 #include "Graphics\ShaderResource.h"
+#include "Graphics\ShaderCache.h"
+#include "Graphics\D3DShaderCompiler.h"
+#include "Graphics\D3DTextureStreamBackend.h"
+#include "Graphics\ShaderPermutation.h"
+#include "Graphics\Texture2D.h"
+#include "Graphics\TextureAtlas.h"
+#include "Graphics\TextureCache.h"
+#include "Graphics\TextureStreamer.h"
+#include "Graphics\WicImageDecoder.h"
 
 #include "utils\utils.h"
+#include "utils\Profiler.h"
 #include "utils\memory.h"
 
 #include <sstream>
 
 AssetManager::AssetManager()
+    : mDevice(nullptr)
+    , mShaderCompiler(nullptr)
+    , mShaderCache(nullptr)
+    , mShaderPack(nullptr)
+    , mImageDecoder(nullptr)
+    , mTextureCache(nullptr)
+    , mTextureAtlas(nullptr)
+    , mJobs(nullptr)
+    , mStreamBackend(nullptr)
+    , mTextureStreamer(nullptr)
+    , mMaterials(new MaterialLibrary())
+    , mRebindMaterials(false)
 {
 }
 
@@ -30,13 +55,62 @@ AssetManager::~AssetManager()
     for (auto model : mModels)
         delete model.second;
 
+    delete mMaterials;
+
     for (auto shader : mShaders)
         delete shader.second;
+
+    for (auto texture : mTextures)
+        delete texture.second;
+
+    for (auto texture : mRetiredTextures)
+        delete texture;
+
+    // The backend waits out its reads and owns the streamed textures
+    delete mStreamBackend;
+    delete mTextureStreamer;
+
+    delete mTextureAtlas;
+    delete mTextureCache;
+    delete mImageDecoder;
+
+    delete mShaderPack;
+    delete mShaderCache;
+    delete mShaderCompiler;
 }
 
-void AssetManager::Initialize()
+void AssetManager::Initialize(ID3D11Device* device)
 {
+    ASSERT(device != nullptr);
+
+    mDevice = device;
     mBasePath = Pwd();
+
+    // Compiled shaders are kept next to the executable and reused until their source changes
+    std::string cachePath = mBasePath + "\\shadercache";
+    mShaderCompiler = new D3DShaderCompiler();
+    mShaderCache = new ShaderCache(mShaderCompiler, cachePath.c_str());
+
+    // Imported textures likewise, until the image or its import settings change
+    std::string textureCachePath = mBasePath + "\\texturecache";
+    mImageDecoder = new WicImageDecoder();
+    mTextureCache = new TextureCache(mImageDecoder, textureCachePath.c_str());
+
+    // The backend has a fixed number of reads to give out
+    TextureStreamerSettings streamerSettings;
+    if (streamerSettings.MaxLoads > D3DTextureStreamBackend::kMaxReads)
+        streamerSettings.MaxLoads = D3DTextureStreamBackend::kMaxReads;
+
+    mStreamBackend = new D3DTextureStreamBackend(device);
+    mTextureStreamer = new TextureStreamer(mStreamBackend, streamerSettings);
+    mStreamBackend->SetStreamer(mTextureStreamer);
+}
+
+void AssetManager::SetJobSystem(JobSystem* jobs)
+{
+    mJobs = jobs;
+    if (mStreamBackend != nullptr)
+        mStreamBackend->SetJobSystem(jobs);
 }
 
 bool AssetManager::AddPath(const char* pathname)
@@ -57,6 +131,8 @@ bool AssetManager::AddPath(const char* pathname)
 
 bool AssetManager::LoadModel(const char* filename)
 {
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Assets);
     ASSERT(filename != nullptr);
 
     bool result = false;
@@ -67,7 +143,11 @@ bool AssetManager::LoadModel(const char* filename)
     // Build the asset, since the file exists
     if (result)
     {
-        const aiScene* scene = aiImportFile(filepath, 0);
+        const aiScene* scene = nullptr;
+        {
+            PROFILE_SCOPE("aiImportFile");
+            scene = aiImportFile(filepath, 0);
+        }
         
         // Construct away!
         if ((scene != nullptr)
@@ -75,8 +155,22 @@ bool AssetManager::LoadModel(const char* filename)
             && scene->HasMaterials())
         {            
             MeshResourceLoader meshLoader;
-            Model* model = meshLoader.Load(scene);
+            unsigned int firstMaterial = mMaterials->GetMaterialCount();
+            MaterialLibrary::Stats before = mMaterials->GetStats();
+            Model* model = meshLoader.Load(mDevice, scene, mMaterials, mTextureAtlas);
             mModels[filename] = model;
+
+            LoadMaterialTextures(firstMaterial);
+            {
+                std::lock_guard<std::mutex> lock(mTextureLock);
+                BindMaterialTextures(firstMaterial);
+            }
+
+            const MaterialLibrary::Stats& after = mMaterials->GetStats();
+            char summary[256];
+            snprintf(summary, sizeof(summary), "%s: %u new materials, %u shared with what was already loaded\n", filename,
+                     after.Materials - before.Materials, (after.Requests - before.Requests) - (after.Materials - before.Materials));
+            OutputDebugStringA(summary);
         }
         else
         {
@@ -94,26 +188,68 @@ Model* AssetManager::GetModel(const char* filename)
 {
     ASSERT(filename != nullptr);
 
-    Model* result = nullptr;
-    if (mModels.find(filename) != mModels.end())
-        result = mModels[filename];
+    // One lookup - find and then operator[] hashed the name (and built a string) twice
+    auto found = mModels.find(filename);
+    return (found != mModels.end()) ? found->second : nullptr;
+}
+
+Texture2D* AssetManager::GetTexture(const char* filename)
+{
+    ASSERT(filename != nullptr);
+
+    auto found = mTextures.find(filename);
+    if (found != mTextures.end())
+        return found->second;
 
-    return result;
+    auto streamed = mStreamedTextures.find(filename);
+    return (streamed != mStreamedTextures.end()) ? mStreamBackend->GetTexture(streamed->second) : nullptr;
+}
+
+StreamedTextureId AssetManager::GetStreamedTexture(const char* filename) const
+{
+    ASSERT(filename != nullptr);
+
+    auto found = mStreamedTextures.find(filename);
+    return (found != mStreamedTextures.end()) ? found->second : kInvalidStreamedTexture;
 }
 
-ShaderResource* AssetManager::GetShader(const char* filename)
+ShaderResource* AssetManager::GetShader(const char* filename, unsigned int variant)
 {
     ASSERT(filename != nullptr);
 
-    ShaderResource* result = nullptr;
-    if (mShaders.find(filename) != mShaders.end())
-        result = mShaders[filename];
+    auto found = mShaders.find(GetShaderKey(filename, variant));
+    return (found != mShaders.end()) ? found->second : nullptr;
+}
+
+bool AssetManager::LoadShaderPack(const char* filename)
+{
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Assets);
+    ASSERT(filename != nullptr);
+
+    char filepath[1024];
+    bool result = GetPathToResource(filename, filepath);
+
+    if (result)
+    {
+        ShaderPack* pack = new ShaderPack();
+        result = pack->Load(filepath);
+        if (result)
+        {
+            delete mShaderPack;
+            mShaderPack = pack;
+        }
+        else
+            delete pack;
+    }
 
     return result;
 }
 
-bool AssetManager::LoadShader(const char* filename, const char* shadermodel, const char* entrypoint)
+bool AssetManager::LoadShader(const char* filename, const char* shadermodel, const char* entrypoint, unsigned int variant)
 {
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Assets);
     ASSERT(filename != nullptr);
 
     bool result = false;
@@ -125,16 +261,214 @@ bool AssetManager::LoadShader(const char* filename, const char* shadermodel, con
     if (result)
     {
         ShaderResource* shader = new ShaderResource();
-        if (shader->LoadShader(filepath, shadermodel, entrypoint))
+
+        const void* bytecode = nullptr;
+        size_t size = 0;
+        ShaderReflection reflection;
+        int packed = (mShaderPack != nullptr) ? mShaderPack->FindShader(filename, entrypoint) : ShaderPack::kInvalidShader;
+        if ((packed != ShaderPack::kInvalidShader) && mShaderPack->FindVariant(packed, variant, &bytecode, &size, &reflection))
+            result = shader->LoadBytecode(bytecode, size, reflection);
+        else
         {
-            mShaders[filename] = shader;
-            result = true;
+            if (mShaderPack != nullptr)
+                OutputDebugStringA("Shader variant isn't in the shader pack - compiling it. Rebuild the pack with shadertool.\n");
+            result = shader->LoadShader(mShaderCache, filepath, shadermodel, entrypoint, variant);
         }
+
+        if (result)
+            mShaders[GetShaderKey(filename, variant)] = shader;
+        else
+            delete shader;
+    }
+
+    return result;
+}
+
+bool AssetManager::LoadTexture(const char* filename)
+{
+    return LoadTexture(filename, TextureImportSettings());
+}
+
+bool AssetManager::LoadTexture(const char* filename, const TextureImportSettings& settings)
+{
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Assets);
+    ASSERT(filename != nullptr);
+
+    char filepath[1024];
+    bool result = GetPathToResource(filename, filepath);
+
+    if (result)
+    {
+        TextureResourceLoader textureLoader;
+        Texture2D* texture = textureLoader.Load(mDevice, mTextureCache, filepath, settings, mJobs);
+        result = (texture != nullptr);
+        if (result)
+            ReplaceTexture(filename, texture);
     }
 
     return result;
 }
 
+bool AssetManager::BuildTextureAtlas(const char* name, const char* const* filenames, unsigned int count)
+{
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Assets);
+    ASSERT(name != nullptr);
+    ASSERT(filenames != nullptr);
+
+    // The sources come through the cache as plain RGBA8 - the atlas makes its own mips and
+    // compresses the pages
+    TextureImportSettings importSettings;
+    importSettings.Mips.MipCount = 1;
+    importSettings.Compression.Format = BF_None;
+
+    std::vector<TextureData> textures(count);
+    std::vector<AtlasSource> sources;
+    std::string errors;
+    for (unsigned int index = 0; index < count; index++)
+    {
+        char filepath[1024];
+        if (!GetPathToResource(filenames[index], filepath) || !mTextureCache->Load(filepath, importSettings, mJobs, textures[index], errors))
+        {
+            OutputDebugStringA((std::string("Leaving ") + filenames[index] + " out of the atlas - " + errors + "\n").c_str());
+            continue;
+        }
+
+        AtlasSource source = { filenames[index], &textures[index] };
+        sources.push_back(source);
+    }
+
+    TextureAtlas* atlas = new TextureAtlas();
+    atlas->SetName(name);
+    if (!atlas->Build(sources.data(), (unsigned int)sources.size(), TextureAtlasSettings(), mJobs, errors))
+    {
+        OutputDebugStringA((errors + "\n").c_str());
+        delete atlas;
+        return false;
+    }
+
+    for (unsigned int page = 0; page < atlas->GetPageCount(); page++)
+    {
+        Texture2D* texture = new Texture2D();
+        if (!texture->Create(mDevice, atlas->GetPage(page)))
+        {
+            delete texture;
+            delete atlas;
+            return false;
+        }
+
+        ReplaceTexture(atlas->GetPageName(page), texture);
+    }
+
+    std::string tablePath = mBasePath + "\\texturecache\\" + name + ".atlas";
+    if (!atlas->WriteLookupTable(tablePath.c_str()))
+        OutputDebugStringA(("Unable to write " + tablePath + "\n").c_str());
+
+    char summary[256];
+    snprintf(summary, sizeof(summary), "%s: %u textures on %u pages, %.0f%% full, %u left out\n", name, atlas->GetStats().Packed,
+             atlas->GetPageCount(), atlas->GetStats().Occupancy * 100.0, atlas->GetStats().Skipped + (count - (unsigned int)sources.size()));
+    OutputDebugStringA(summary);
+
+    delete mTextureAtlas;
+    mTextureAtlas = atlas;
+    return true;
+}
+
+bool AssetManager::StreamTexture(const char* filename)
+{
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Assets);
+    ASSERT(filename != nullptr);
+
+    char filepath[1024];
+    if (!GetPathToResource(filename, filepath))
+        return false;
+
+    std::unique_lock<std::mutex> lock(mTextureLock);
+
+    std::string errors;
+    StreamedTextureId texture = mStreamBackend->Add(filepath, errors);
+    if (texture == kInvalidStreamedTexture)
+    {
+        lock.unlock();
+        OutputDebugStringA((errors + "\n").c_str());
+        return LoadTexture(filename);
+    }
+
+    // Streaming the same file again starts it over. The old one goes once materials
+    // have moved off it.
+    auto found = mStreamedTextures.find(filename);
+    if (found != mStreamedTextures.end())
+    {
+        mRetiredStreams.push_back(found->second);
+        found->second = texture;
+    }
+    else
+        mStreamedTextures[filename] = texture;
+
+    // Only one of the two may hold it
+    auto loaded = mTextures.find(filename);
+    if (loaded != mTextures.end())
+    {
+        mRetiredTextures.push_back(loaded->second);
+        mTextures.erase(loaded);
+    }
+
+    mRebindMaterials = true;
+    return true;
+}
+
+void AssetManager::ApplyTextureChanges()
+{
+    PROFILE_FUNCTION();
+
+    std::lock_guard<std::mutex> lock(mTextureLock);
+    if (!mRebindMaterials)
+        return;
+
+    BindMaterialTextures(0);
+
+    for (auto texture : mRetiredTextures)
+        delete texture;
+    mRetiredTextures.clear();
+
+    for (auto texture : mRetiredStreams)
+        mStreamBackend->Remove(texture);
+    mRetiredStreams.clear();
+
+    mRebindMaterials = false;
+}
+
+void AssetManager::ReportScreenSize(const Model* model, float pixels)
+{
+    ASSERT(model != nullptr);
+
+    std::lock_guard<std::mutex> lock(mTextureLock);
+    for (unsigned int index = 0; index < model->GetMeshCount(); index++)
+    {
+        MaterialId material = model->GetMesh(index)->GetMaterial();
+        if ((material == kInvalidMaterial) || ((size_t)material * MTS_Count >= mMaterialStreams.size()))
+            continue;
+
+        for (unsigned int slot = 0; slot < MTS_Count; slot++)
+        {
+            StreamedTextureId texture = mMaterialStreams[material * MTS_Count + slot];
+            if (texture != kInvalidStreamedTexture)
+                mTextureStreamer->ReportScreenSize(texture, pixels);
+        }
+    }
+}
+
+void AssetManager::UpdateStreaming()
+{
+    PROFILE_FUNCTION();
+
+    std::lock_guard<std::mutex> lock(mTextureLock);
+    mStreamBackend->Pump();
+    mTextureStreamer->Update();
+}
+
 bool AssetManager::GetPathToResource(const char* resource, char* dest)
 {
     ASSERT(resource != nullptr);
@@ -156,4 +490,76 @@ bool AssetManager::GetPathToResource(const char* resource, char* dest)
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+std::string AssetManager::GetShaderKey(const char* filename, unsigned int variant)
+{
+    // The default variant goes under the plain name
+    std::string key(filename);
+    if (variant != 0)
+    {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "#%x", variant);
+        key += suffix;
+    }
+    return key;
+}
+
+void AssetManager::ReplaceTexture(const std::string& name, Texture2D* texture)
+{
+    std::lock_guard<std::mutex> lock(mTextureLock);
+
+    // A material may have been waiting on a texture that's new, too
+    Texture2D*& slot = mTextures[name];
+    if (slot != nullptr)
+        mRetiredTextures.push_back(slot);
+    slot = texture;
+    mRebindMaterials = true;
+}
+
+void AssetManager::LoadMaterialTextures(unsigned int first)
+{
+    PROFILE_FUNCTION();
+
+    for (unsigned int id = first; id < mMaterials->GetMaterialCount(); id++)
+    {
+        const MaterialParameters& parameters = mMaterials->GetMaterial(id)->GetParameters();
+        for (unsigned int slot = 0; slot < MTS_Count; slot++)
+        {
+            if (parameters.Textures[slot] == MaterialParameters::kNoTexture)
+                continue;
+
+            // Atlas pages are already in, and a texture shared with an earlier material
+            // is only loaded the once. Baked ones stream their mips in as they're seen.
+            const char* name = mMaterials->GetTextureName(parameters.Textures[slot]);
+            if (GetTexture(name) != nullptr)
+                continue;
+
+            bool loaded = TextureResourceLoader::IsContainer(name) ? StreamTexture(name) : LoadTexture(name);
+            if (!loaded)
+                OutputDebugStringA((std::string("Unable to load ") + name + " - the material draws without it\n").c_str());
+        }
+    }
+}
+
+void AssetManager::BindMaterialTextures(unsigned int first)
+{
+    PROFILE_FUNCTION();
+
+    mMaterialStreams.resize(mMaterials->GetMaterialCount() * MTS_Count, kInvalidStreamedTexture);
+    for (unsigned int id = first; id < mMaterials->GetMaterialCount(); id++)
+    {
+        Material* material = mMaterials->GetMaterial(id);
+        for (unsigned int slot = 0; slot < MTS_Count; slot++)
+        {
+            unsigned int texture = material->GetParameters().Textures[slot];
+            mMaterialStreams[id * MTS_Count + slot] = kInvalidStreamedTexture;
+            if (texture == MaterialParameters::kNoTexture)
+                continue;
+
+            const char* name = mMaterials->GetTextureName(texture);
+            material->SetTexture((MaterialTextureSlot)slot, GetTexture(name));
+            mMaterialStreams[id * MTS_Count + slot] = GetStreamedTexture(name);
+        }
+    }
+}
@@ -4,15 +4,32 @@
 /// 
 #pragma once
 
+#include <mutex>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 // ======================================================================================
 // Forward Declarations - so the header file doesn't have to #include anything
 // ======================================================================================
+struct ID3D11Device;
 class IResourceLoader;
 class Model;
+class MaterialLibrary;
 class ShaderResource;
+class ShaderCache;
+class ShaderPack;
+class IShaderCompiler;
+class Texture2D;
+class TextureCache;
+class TextureAtlas;
+class D3DTextureStreamBackend;
+class IImageDecoder;
+class JobSystem;
+class TextureStreamer;
+struct TextureImportSettings;
+
+typedef unsigned int StreamedTextureId;     // as in TextureStreamer.h
 
 class AssetManager
 {
@@ -21,22 +38,115 @@ public:
     AssetManager();
     ~AssetManager();
 
-    void Initialize();
+    void Initialize(ID3D11Device* device);
+
+    // Texture imports build their mips on these threads, and streamed textures read on them.
+    // Without one it's all done on the caller's.
+    void SetJobSystem(JobSystem* jobs);
 
     bool AddPath(const char* pathname);
+
+    // Meshes using a texture in the atlas (see BuildTextureAtlas) are moved onto its page.
+    // The model's materials go into the material library - one copy of each, whichever
+    // model it came from - and their textures are loaded if they aren't already, baked ones
+    // through StreamTexture. Models load before frames are being rendered - the library
+    // isn't safe to grow under a draw.
     bool LoadModel(const char* filename);
-    bool LoadShader(const char* filename, const char* shadermodel, const char* entrypoint);
+
+    // Precompiled variants (see ShaderPermutation.h). Once a pack is loaded, LoadShader takes
+    // shaders from it and only compiles the ones it doesn't have.
+    bool LoadShaderPack(const char* filename);
+
+    // variant is a mask over the shader's @keywords
+    bool LoadShader(const char* filename, const char* shadermodel, const char* entrypoint, unsigned int variant = 0);
+
+    // Decoded, mipped and compressed the first time, then straight from the texture cache.
+    // Baked .dds and .ktx2 files are used as they are. Loading the same file again replaces
+    // the texture, so a change of settings takes effect - materials move to the new one at
+    // the next ApplyTextureChanges.
+    bool LoadTexture(const char* filename);
+    bool LoadTexture(const char* filename, const TextureImportSettings& settings);
+
+    // Packs the textures into atlas pages, which load as "name#0", "name#1" and so on, and
+    // writes the lookup table to name.atlas in the texture cache. Models loaded after this
+    // take their UVs onto the pages. Textures too big for an atlas are left out.
+    bool BuildTextureAtlas(const char* name, const char* const* filenames, unsigned int count);
+    const TextureAtlas* GetTextureAtlas() const { return mTextureAtlas; }
+
+    // A baked .dds or .ktx2 that starts with just its smallest mips and gets the rest as it's
+    // seen (see TextureStreamer.h). One that isn't worth streaming is loaded whole instead.
+    // GetTexture finds either - a streamed texture's view changes as its mips come and go.
+    bool StreamTexture(const char* filename);
+
+    // Culling reports screen sizes against this id - kInvalidStreamedTexture if the texture
+    // isn't streamed
+    StreamedTextureId GetStreamedTexture(const char* filename) const;
+    TextureStreamer* GetTextureStreamer() const { return mTextureStreamer; }
+
+    // Once a frame, before anything draws - on the render thread, once there is one. Moves
+    // materials onto textures that were reloaded or streamed since the last call, then
+    // frees the ones they replaced, so nothing is freed while a draw might bind it.
+    void ApplyTextureChanges();
+
+    // How many pixels across the model is this frame, for every streamed texture its
+    // materials use. The biggest report of the frame wins.
+    void ReportScreenSize(const Model* model, float pixels);
+
+    // Once a frame, after the screen sizes are in, and where nothing is drawing with the
+    // streamed textures - it can recreate them. Once frames are being rendered, this and
+    // ReportScreenSize belong to the render thread.
+    void UpdateStreaming();
+
+    MaterialLibrary* GetMaterialLibrary() const { return mMaterials; }
 
     Model* GetModel(const char* filename);
-    ShaderResource* GetShader(const char* filename);
+    Texture2D* GetTexture(const char* filename);
+    ShaderResource* GetShader(const char* filename, unsigned int variant = 0);
 
 private:
     bool GetPathToResource(const char* resource, char* dest);
+    static std::string GetShaderKey(const char* filename, unsigned int variant);
+
+    // Loads the textures of materials from first on that aren't loaded yet
+    void LoadMaterialTextures(unsigned int first);
+
+    // Points materials from first on at their textures and notes which of them are streamed.
+    // With mTextureLock held.
+    void BindMaterialTextures(unsigned int first);
+
+    // Puts texture under name. One it replaces is kept until ApplyTextureChanges.
+    // Takes mTextureLock.
+    void ReplaceTexture(const std::string& name, Texture2D* texture);
 
 private:
+    ID3D11Device*               mDevice;
     std::string                 mBasePath;
     std::vector<std::string>    mPaths;
 
+    IShaderCompiler*            mShaderCompiler;
+    ShaderCache*                mShaderCache;
+    ShaderPack*                 mShaderPack;
+
+    IImageDecoder*              mImageDecoder;
+    TextureCache*               mTextureCache;
+    TextureAtlas*               mTextureAtlas;
+    JobSystem*                  mJobs;
+
+    D3DTextureStreamBackend*    mStreamBackend;
+    TextureStreamer*            mTextureStreamer;
+
+    MaterialLibrary*            mMaterials;
+    std::vector<StreamedTextureId> mMaterialStreams;    // MTS_Count a material - kInvalidStreamedTexture if not streamed
+
+    // The texture tables only change on the loading thread, which can read them freely. The
+    // render thread reads them, and the streamer, under the lock.
+    std::mutex                  mTextureLock;
+    std::vector<Texture2D*>     mRetiredTextures;
+    std::vector<StreamedTextureId> mRetiredStreams;
+    bool                        mRebindMaterials;
+
     std::unordered_map<std::string, Model*> mModels;
     std::unordered_map<std::string, ShaderResource*> mShaders;
+    std::unordered_map<std::string, Texture2D*> mTextures;
+    std::unordered_map<std::string, StreamedTextureId> mStreamedTextures;
 };
@@ -4,3 +4,91 @@
 
 #include "stdafx.h"
 #include "MaterialResourceLoader.h"
+
+#include "assimp\material.h"
+
+#include "Graphics\ColorShader.h"
+#include "Graphics\Material.h"
+#include "Graphics\MaterialLibrary.h"
+#include "Graphics\TextureAtlas.h"
+
+#include "utils\assert.h"
+#include "utils\memory.h"
+
+namespace
+{
+    struct TextureSlotType
+    {
+        MaterialTextureSlot     Slot;
+        aiTextureType           Type;
+    };
+
+    const TextureSlotType kTextureSlots[] =
+    {
+        { MTS_Diffuse,  aiTextureType_DIFFUSE },
+        { MTS_Normal,   aiTextureType_NORMALS },
+        { MTS_Specular, aiTextureType_SPECULAR },
+        { MTS_Emissive, aiTextureType_EMISSIVE },
+    };
+
+    void ReadColor(const aiMaterial* material, const char* key, unsigned int type, unsigned int index, float* color)
+    {
+        aiColor4D value;
+        if (aiGetMaterialColor(material, key, type, index, &value) == AI_SUCCESS)
+        {
+            color[0] = value.r;
+            color[1] = value.g;
+            color[2] = value.b;
+            color[3] = value.a;
+        }
+    }
+
+    void ReadScalar(const aiMaterial* material, const char* key, unsigned int type, unsigned int index, float* scalar)
+    {
+        ai_real value;
+        if (aiGetMaterialFloat(material, key, type, index, &value) == AI_SUCCESS)
+            *scalar = (float)value;
+    }
+}
+
+MaterialResourceLoader::MaterialResourceLoader()
+{
+}
+
+MaterialResourceLoader::~MaterialResourceLoader()
+{
+}
+
+void MaterialResourceLoader::Read(const aiMaterial* material, MaterialLibrary& library, MaterialParameters& parameters)
+{
+    ASSERT(material != nullptr);
+
+    // What a material assimp knows nothing about looks like - plain white, lit
+    parameters.Reset();
+    for (unsigned int channel = 0; channel < 4; channel++)
+        parameters.Colors[MC_Diffuse][channel] = 1.0f;
+    parameters.Colors[MC_Specular][3] = 1.0f;
+    parameters.Colors[MC_Emissive][3] = 1.0f;
+    parameters.Scalars[MS_Opacity] = 1.0f;
+
+    ReadColor(material, AI_MATKEY_COLOR_DIFFUSE, parameters.Colors[MC_Diffuse]);
+    ReadColor(material, AI_MATKEY_COLOR_SPECULAR, parameters.Colors[MC_Specular]);
+    ReadColor(material, AI_MATKEY_COLOR_EMISSIVE, parameters.Colors[MC_Emissive]);
+    ReadScalar(material, AI_MATKEY_SHININESS, &parameters.Scalars[MS_Shininess]);
+    ReadScalar(material, AI_MATKEY_OPACITY, &parameters.Scalars[MS_Opacity]);
+
+    for (const TextureSlotType& slot : kTextureSlots)
+    {
+        aiString path;
+        if ((aiGetMaterialTexture(material, slot.Type, 0, &path) != AI_SUCCESS) || (path.C_Str()[0] == '*'))
+            continue;
+
+        std::string name = TextureAtlas::GetKey(path.C_Str());
+        if (!name.empty())
+            parameters.Textures[slot.Slot] = library.InternTexture(name.c_str());
+    }
+
+    parameters.ShaderVariant = BPS_Lighting;
+    if (parameters.Textures[MTS_Diffuse] != MaterialParameters::kNoTexture)
+        parameters.ShaderVariant |= BPS_DiffuseTexture;
+}
@@ -1,4 +1,25 @@
 ///
 /// MaterialResourceLoader.h - Declaration of the system for loading and interfacing with Materials
-///
+/// 
 #pragma once
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct aiMaterial;
+struct MaterialParameters;
+class MaterialLibrary;
+
+class MaterialResourceLoader
+{
+public:
+    MaterialResourceLoader();
+    ~MaterialResourceLoader();
+
+    // The colours, scalars and textures assimp found, and the shader variant they need.
+    // Texture names come down to the file name in lower case, as TextureAtlas keys them -
+    // FBX files keep whatever path the artist's machine had - and the asset manager looks
+    // for them on its paths.
+    // Embedded textures aren't supported and are left out.
+    void Read(const aiMaterial* material, MaterialLibrary& library, MaterialParameters& parameters);
+};
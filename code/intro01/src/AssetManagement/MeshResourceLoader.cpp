@@ -4,17 +4,23 @@
 
 #include "stdafx.h"
 #include "MeshResourceLoader.h"
+#include "MaterialResourceLoader.h"
+#include "Graphics\MaterialLibrary.h"
 #include "Graphics\Model.h"
 #include "Graphics\Mesh.h"
+#include "Graphics\TextureAtlas.h"
 
 #include "assimp\cimport.h"
 #include "assimp\scene.h"
 
 #include "utils\utils.h"
+#include "utils\Profiler.h"
 #include "utils\memory.h"
 
 
 #include <d3d11.h>
+#include <float.h>
+#include <vector>
 
 MeshResourceLoader::MeshResourceLoader()
 {
@@ -24,12 +30,40 @@ MeshResourceLoader::~MeshResourceLoader()
 {
 }
 
-Model* MeshResourceLoader::Load(const aiScene* scene)
+Model* MeshResourceLoader::Load(ID3D11Device* device, const aiScene* scene, MaterialLibrary* materials, const TextureAtlas* atlas)
 {
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Meshes);
+
+    // Size everything up front so the meshes and all their vertices and indices go into
+    // the model's one block
+    unsigned int totalVertexCount = 0;
+    unsigned int totalIndexCount = 0;
+    for (unsigned int index = 0; index < scene->mNumMeshes; index++)
+    {
+        totalVertexCount += scene->mMeshes[index]->mNumVertices;
+        totalIndexCount += scene->mMeshes[index]->mNumFaces * 3;
+    }
+
+    // Read once a material, however many meshes use it - the atlas may still change a copy
+    MaterialResourceLoader materialLoader;
+    std::vector<MaterialParameters> sceneMaterials((materials != nullptr) ? scene->mNumMaterials : 0);
+    for (unsigned int index = 0; index < sceneMaterials.size(); index++)
+    {
+        materialLoader.Read(scene->mMaterials[index], *materials, sceneMaterials[index]);
+    }
+
     // From the scene, load up the Meshs in the hierarchy
     int meshIndex = 0;
     Model* model = new Model();
-    model->Initialize(scene->mNumMeshes);
+    model->Initialize(scene->mNumMeshes, totalVertexCount, totalIndexCount);
+
+    PositionNormalUVLayout* vertexStorage = model->GetVertexStorage();
+    unsigned int* indexStorage = model->GetIndexStorage();
+
+    // Box around every vertex, turned into the model's bounding sphere at the end
+    XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+    XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
 
     while (meshIndex < scene->mNumMeshes)
     {
@@ -38,7 +72,8 @@ Model* MeshResourceLoader::Load(const aiScene* scene)
         unsigned int vertexCount = currentMesh->mNumVertices;
         unsigned int indexCount = currentMesh->mNumFaces * 3;
         
-        PositionNormalUVLayout* vertexData = new PositionNormalUVLayout[vertexCount];
+        PositionNormalUVLayout* vertexData = vertexStorage;
+        vertexStorage += vertexCount;
 
         for (int vertexIndex = 0; vertexIndex < vertexCount; vertexIndex++)
         {
@@ -50,25 +85,56 @@ Model* MeshResourceLoader::Load(const aiScene* scene)
             vertexData[vertexIndex].Normal.z = currentMesh->mNormals[vertexIndex].z;
             vertexData[vertexIndex].UV.x = currentMesh->mTextureCoords[0][vertexIndex].x;
             vertexData[vertexIndex].UV.y = currentMesh->mTextureCoords[0][vertexIndex].y;
+
+            XMVECTOR position = XMLoadFloat3(&vertexData[vertexIndex].Position);
+            boundsMin = XMVectorMin(boundsMin, position);
+            boundsMax = XMVectorMax(boundsMax, position);
         }
 
-        unsigned int* indexData = new unsigned int[indexCount+1];
+        unsigned int* indexData = indexStorage;
+        indexStorage += indexCount;
         unsigned int faceCount = currentMesh->mNumFaces;
         unsigned int indexOffset = 0;
         for (int faceIndex = 0; faceIndex < faceCount; faceIndex++)
         {
-            indexData[++indexOffset] = currentMesh->mFaces[faceIndex].mIndices[0];
-            indexData[++indexOffset] = currentMesh->mFaces[faceIndex].mIndices[1];
-            indexData[++indexOffset] = currentMesh->mFaces[faceIndex].mIndices[2];
+            indexData[indexOffset++] = currentMesh->mFaces[faceIndex].mIndices[0];
+            indexData[indexOffset++] = currentMesh->mFaces[faceIndex].mIndices[1];
+            indexData[indexOffset++] = currentMesh->mFaces[faceIndex].mIndices[2];
         }
 
-        Mesh* drawable = new Mesh();
-        drawable->Load(vertexData, vertexCount, indexData, indexCount);
-        
-        model->AddMesh(drawable);
+        MaterialParameters parameters;
+        if (currentMesh->mMaterialIndex < sceneMaterials.size())
+            parameters = sceneMaterials[currentMesh->mMaterialIndex];
+        else
+            parameters.Reset();
+
+        // Atlased textures - the UVs go onto the page, unless the texture tiles
+        unsigned int diffuse = parameters.Textures[MTS_Diffuse];
+        if ((atlas != nullptr) && currentMesh->HasTextureCoords(0) && (diffuse != MaterialParameters::kNoTexture))
+        {
+            const char* textureName = materials->GetTextureName(diffuse);
+            const AtlasEntry* entry = atlas->Find(textureName);
+            if (entry != nullptr)
+            {
+                if (RemapUVs(*entry, &vertexData[0].UV.x, sizeof(PositionNormalUVLayout), vertexCount))
+                    parameters.Textures[MTS_Diffuse] = materials->InternTexture(atlas->GetPageName(entry->Page).c_str());
+                else
+                    OutputDebugStringA((std::string(textureName) + " is atlased but tiles - the mesh keeps its own UVs\n").c_str());
+            }
+        }
+
+        // The model owns the data, not the mesh
+        Mesh* drawable = model->CreateMesh();
+        drawable->Load(device, vertexData, vertexCount, indexData, indexCount, false);
+        if (materials != nullptr)
+            drawable->SetMaterial(materials->Intern(parameters));
 
         meshIndex++;
     }
 
+    XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+    float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, center)));
+    model->SetBounds(XMVectorGetX(center), XMVectorGetY(center), XMVectorGetZ(center), radius);
+
     return model;
 }
\ No newline at end of file
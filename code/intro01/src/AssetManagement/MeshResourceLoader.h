@@ -4,7 +4,10 @@
 #pragma once
 
 struct aiScene;
+struct ID3D11Device;
 class Model;
+class MaterialLibrary;
+class TextureAtlas;
 
 class MeshResourceLoader
 {
@@ -12,7 +15,11 @@ public:
     MeshResourceLoader();
     ~MeshResourceLoader();
 
-    Model* Load(const aiScene* scene);
+    // Each mesh's material is interned in materials and the mesh given its id, so the same
+    // material in any number of meshes and files is one id. Meshes whose diffuse texture is
+    // in the atlas get their UVs moved onto its page before they're uploaded, and their
+    // material samples the page instead.
+    Model* Load(ID3D11Device* device, const aiScene* scene, MaterialLibrary* materials, const TextureAtlas* atlas = nullptr);
 
 private:
 
@@ -4,3 +4,97 @@
 
 #include "stdafx.h"
 #include "TextureResourceLoader.h"
+
+#include "Graphics\Texture2D.h"
+#include "Graphics\TextureCache.h"
+#include "Graphics\TextureContainer.h"
+#include "Graphics\TextureData.h"
+
+#include "utils\assert.h"
+#include "utils\Profiler.h"
+#include "utils\memory.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+TextureResourceLoader::TextureResourceLoader()
+{
+}
+
+TextureResourceLoader::~TextureResourceLoader()
+{
+}
+
+Texture2D* TextureResourceLoader::Load(ID3D11Device* device, TextureCache* cache, const char* filepath,
+                                       const TextureImportSettings& settings, JobSystem* jobs)
+{
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Assets);
+    ASSERT(device != nullptr);
+    ASSERT(cache != nullptr);
+    ASSERT(filepath != nullptr);
+
+    if (IsContainer(filepath))
+        return LoadContainer(device, filepath);
+
+    TextureData data;
+    std::string errors;
+    TextureImportReport report;
+    if (!cache->Load(filepath, settings, jobs, data, errors, &report))
+    {
+        OutputDebugStringA((errors + "\n").c_str());
+        return nullptr;
+    }
+
+    // What compression cost, so a texture that needs a better format or quality stands out
+    char summary[1200];
+    if (report.Compressed)
+        snprintf(summary, sizeof(summary), "%s: %s, %.2f dB PSNR%s\n", filepath, GetTextureFormatInfo(data.GetFormat()).Name,
+                 report.Psnr, report.FromCache ? " (cached)" : "");
+    else if (settings.Compression.Format != BF_None)
+        snprintf(summary, sizeof(summary), "%s: left uncompressed - %ux%u isn't whole 4x4 blocks\n", filepath, data.GetWidth(), data.GetHeight());
+    else
+        summary[0] = '\0';
+    OutputDebugStringA(summary);
+
+    Texture2D* texture = new Texture2D();
+    if (!texture->Create(device, data))
+    {
+        OutputDebugStringA((std::string("Unable to create the texture for ") + filepath + "\n").c_str());
+        delete texture;
+        return nullptr;
+    }
+
+    return texture;
+}
+
+bool TextureResourceLoader::IsContainer(const char* filepath)
+{
+    const char* extension = strrchr(filepath, '.');
+    return (extension != nullptr) && ((_stricmp(extension, ".dds") == 0) || (_stricmp(extension, ".ktx2") == 0));
+}
+
+Texture2D* TextureResourceLoader::LoadContainer(ID3D11Device* device, const char* filepath)
+{
+    PROFILE_FUNCTION();
+
+    // The mapping only has to last until D3D has copied the pixels out of it
+    TextureContainer container;
+    std::string errors;
+    if (!container.Open(filepath, errors))
+    {
+        OutputDebugStringA((errors + "\n").c_str());
+        return nullptr;
+    }
+
+    Texture2D* texture = new Texture2D();
+    if (!texture->Create(device, container))
+    {
+        OutputDebugStringA((std::string("Unable to create the texture for ") + filepath + "\n").c_str());
+        delete texture;
+        return nullptr;
+    }
+
+    return texture;
+}
@@ -2,3 +2,31 @@
 /// TextureResourceLoader.h - Declaration of the system for loading and interfacing with 2D Textures
 /// 
 #pragma once
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct ID3D11Device;
+struct TextureImportSettings;
+class JobSystem;
+class Texture2D;
+class TextureCache;
+
+class TextureResourceLoader
+{
+public:
+    TextureResourceLoader();
+    ~TextureResourceLoader();
+
+    // Through the cache, so only the first load of an image pays for decoding it and building
+    // its mips. Baked .dds and .ktx2 files skip all that and go straight from the file - the
+    // settings don't apply to them. Null (and the reason in the debug output) on failure.
+    Texture2D* Load(ID3D11Device* device, TextureCache* cache, const char* filepath,
+                    const TextureImportSettings& settings, JobSystem* jobs);
+
+    // A baked .dds or .ktx2, going by the extension
+    static bool IsContainer(const char* filepath);
+
+private:
+    Texture2D* LoadContainer(ID3D11Device* device, const char* filepath);
+};
@@ -1,6 +1,3 @@
-#include "StdAfx.h"
-#include "D3D11.h"
-#include "DirectXMath.h"
 #include "Camera.h"
 
 
@@ -13,17 +10,13 @@ Camera::Camera(void)
     m_rotationX = 0.0f;
     m_rotationY = 0.0f;
     m_rotationZ = 0.0f;
-}
 
-Camera::Camera( Camera &_camera )
-{
-    m_positionX = _camera.m_positionX;
-    m_positionY = _camera.m_positionY;
-    m_positionZ = _camera.m_positionZ;
+    m_reversedZ = false;
+    m_infiniteFar = false;
+    m_version = 0;
 
-    m_rotationX = _camera.m_rotationX;
-    m_rotationY = _camera.m_rotationY;
-    m_rotationZ = _camera.m_rotationZ;
+    SetProjection(45.0f, 4.0f / 3.0f, 0.1f, 1000.0f);
+    m_viewDirty = true;
 }
 
 
@@ -33,24 +26,122 @@ Camera::~Camera(void)
 
 void Camera::SetPosition(float _x, float _y, float _z)
 {
+    if ((_x == m_positionX) && (_y == m_positionY) && (_z == m_positionZ))
+        return;
+
     m_positionX = _x;
     m_positionY = _y;
     m_positionZ = _z;
+    m_viewDirty = true;
 }
 
 
 void Camera::SetRotation(float _x, float _y, float _z)
 {
+    if ((_x == m_rotationX) && (_y == m_rotationY) && (_z == m_rotationZ))
+        return;
+
     m_rotationX = _x;
     m_rotationY = _y;
     m_rotationZ = _z;
+    m_viewDirty = true;
+}
+
+void Camera::SetProjection(float _fovY, float _aspect, float _nearZ, float _farZ)
+{
+    m_fovY = _fovY;
+    m_aspect = _aspect;
+    m_nearZ = _nearZ;
+    m_farZ = _farZ;
+    m_projDirty = true;
+}
+
+float Camera::GetPixelScale(float _viewportHeight) const
+{
+    return _viewportHeight / (2.0f * tanf(Math::ToRadians(m_fovY) * 0.5f));
+}
+
+void Camera::SetAspect(float _aspect)
+{
+    if (_aspect == m_aspect)
+        return;
+
+    m_aspect = _aspect;
+    m_projDirty = true;
+}
+
+void Camera::SetReversedZ(bool _reversed)
+{
+    if (_reversed == m_reversedZ)
+        return;
+
+    m_reversedZ = _reversed;
+    m_projDirty = true;
+}
+
+void Camera::SetInfiniteFar(bool _infinite)
+{
+    if (_infinite == m_infiniteFar)
+        return;
+
+    m_infiniteFar = _infinite;
+    m_projDirty = true;
 }
 
 void Camera::Render()
 {
-    DirectX::XMFLOAT3  up, position, lookAt;
+    Update();
+}
+
+void Camera::Update()
+{
+    if (!m_viewDirty && !m_projDirty)
+        return;
+
+    if (m_viewDirty)
+        UpdateView();
+    if (m_projDirty)
+        UpdateProjection();
+
+    m_viewProjMatrix = Math::MatrixMultiply(m_viewMatrix, m_projMatrix);
+    m_invViewProjMatrix = Math::MatrixInverse(m_viewProjMatrix);
+    Math::FrustumFromMatrix(m_viewProjMatrix, m_reversedZ, m_frustum);
+
+    // Corners from the camera's axes rather than the inverse view-projection, which can't
+    // reach an infinite far plane
+    Math::Vector right = m_invViewMatrix.r[0];
+    Math::Vector up = m_invViewMatrix.r[1];
+    Math::Vector forward = m_invViewMatrix.r[2];
+    Math::Vector eye = m_invViewMatrix.r[3];
+    float tanHalfFov = tanf(Math::ToRadians(m_fovY) * 0.5f);
+
+    const float distances[2] = { m_nearZ, m_farZ };
+    for (unsigned int plane = 0; plane < 2; plane++)
+    {
+        float distance = distances[plane];
+        float halfHeight = distance * tanHalfFov;
+        float halfWidth = halfHeight * m_aspect;
+        Math::Vector center = Math::VectorMultiplyAdd(forward, Math::VectorReplicate(distance), eye);
+
+        const float signs[4][2] = { { -1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f } };
+        for (unsigned int corner = 0; corner < 4; corner++)
+        {
+            Math::Vector point = Math::VectorMultiplyAdd(right, Math::VectorReplicate(signs[corner][0] * halfWidth), center);
+            point = Math::VectorMultiplyAdd(up, Math::VectorReplicate(signs[corner][1] * halfHeight), point);
+            Math::VectorStore3(&m_frustumCorners[plane * 4 + corner], point);
+        }
+    }
+
+    m_viewDirty = false;
+    m_projDirty = false;
+    m_version++;
+}
+
+void Camera::UpdateView()
+{
+    Math::Vec3 up, position, lookAt;
     float yaw, pitch, roll;
-    DirectX::XMMATRIX rotationMatrix;
+    Math::Mat4 rotationMatrix;
 
 
     // Setup the vector that points upwards.
@@ -74,17 +165,31 @@ void Camera::Render()
     roll  = m_rotationZ * 0.0174532925f;
 
     // Create the rotation matrix from the yaw, pitch, and roll values.
-    rotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(pitch, yaw, roll);
+    rotationMatrix = Math::MatrixRotationRollPitchYaw(pitch, yaw, roll);
 
     // Transform the lookAt and up vector by the rotation matrix so the view is correctly rotated at the origin.
-    DirectX::XMVECTOR lookAtVector = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&lookAt), rotationMatrix);
-    DirectX::XMVECTOR upVector = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&up), rotationMatrix);
+    Math::Vector lookAtVector = Math::Vector3TransformCoord(Math::VectorLoad3(&lookAt), rotationMatrix);
+    Math::Vector upVector = Math::Vector3TransformCoord(Math::VectorLoad3(&up), rotationMatrix);
 
     // Translate the rotated camera position to the location of the viewer.
-    lookAtVector = DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&position), lookAtVector);
+    lookAtVector = Math::VectorAdd(Math::VectorLoad3(&position), lookAtVector);
 
     // Finally create the view matrix from the three updated vectors.
-    m_viewMatrix = DirectX::XMMatrixLookAtLH(DirectX::XMLoadFloat3(&position), lookAtVector, upVector);
+    m_viewMatrix = Math::MatrixLookAtLH(Math::VectorLoad3(&position), lookAtVector, upVector);
+
+    // Rotation and translation only, so the cheap inverse will do
+    m_invViewMatrix = Math::MatrixRigidInverse(m_viewMatrix);
+}
 
-    return;
-}
\ No newline at end of file
+void Camera::UpdateProjection()
+{
+    float fovY = Math::ToRadians(m_fovY);
+    float farZ = m_infiniteFar ? INFINITY : m_farZ;
+
+    if (m_reversedZ)
+        m_projMatrix = Math::MatrixPerspectiveFovReversedLH(fovY, m_aspect, m_nearZ, farZ);
+    else
+        m_projMatrix = Math::MatrixPerspectiveFovLH(fovY, m_aspect, m_nearZ, farZ);
+
+    m_invProjMatrix = Math::MatrixInverse(m_projMatrix);
+}
@@ -1,28 +1,85 @@
 #ifndef __CAMERA_H__
 #define __CAMERA_H__
 
+#include "utils\SimdMath.h"
+
+// Keeps its matrices, their inverses and the frustum cached. Setting anything only marks
+// them dirty - they're rebuilt the next time one is asked for, so a camera that doesn't move
+// costs nothing per frame.
 class Camera
 {
 public:
 	Camera(void);
-	Camera(Camera &_camera);
+	Camera(const Camera &_camera) = default;	// nothing but values, the cached matrices included
 	~Camera(void);
 
 	void SetPosition(float, float, float);
 	void SetRotation(float, float, float);
 
-	DirectX::XMFLOAT3 GetPosition() { DirectX::XMFLOAT3(m_positionX, m_positionY, m_positionZ); }
-	DirectX::XMFLOAT3 GetRotation() { DirectX::XMFLOAT3(m_rotationX, m_rotationY, m_rotationZ); }
+	Math::Vec3 GetPosition() { Math::Vec3 position = { m_positionX, m_positionY, m_positionZ }; return position; }
+	Math::Vec3 GetRotation() { Math::Vec3 rotation = { m_rotationX, m_rotationY, m_rotationZ }; return rotation; }
+
+	// Vertical field of view in degrees. With an infinite far plane, farZ only places the far
+	// frustum corners.
+	void SetProjection(float _fovY, float _aspect, float _nearZ, float _farZ);
+	void SetAspect(float _aspect);
+
+	// Depth of one at the near plane and zero at the far one. Needs a GREATER depth test and
+	// depth cleared to zero.
+	void SetReversedZ(bool _reversed);
+	void SetInfiniteFar(bool _infinite);
+	bool IsReversedZ() const { return m_reversedZ; }
+
+	// Pixels per unit of size at a distance of one, for a viewport this tall - what
+	// Scene::Cull wants to work out screen sizes
+	float GetPixelScale(float _viewportHeight) const;
 
+	// Brings the matrices up to date. The getters do it too.
 	void Render();
-	const DirectX::XMMATRIX& GetViewMatrix() { return m_viewMatrix; }
-    const DirectX::XMMATRIX& GetProjMatrix() { return m_projMatrix; }
+
+	const Math::Mat4& GetViewMatrix() { Update(); return m_viewMatrix; }
+    const Math::Mat4& GetProjMatrix() { Update(); return m_projMatrix; }
+	const Math::Mat4& GetViewProjMatrix() { Update(); return m_viewProjMatrix; }
+	const Math::Mat4& GetInvViewMatrix() { Update(); return m_invViewMatrix; }
+	const Math::Mat4& GetInvProjMatrix() { Update(); return m_invProjMatrix; }
+	const Math::Mat4& GetInvViewProjMatrix() { Update(); return m_invViewProjMatrix; }
+
+	// World space planes, ready for Scene::Cull
+	const Math::Frustum& GetFrustum() { Update(); return m_frustum; }
+
+	// World space - the near plane's four corners, then the far plane's, each going bottom
+	// left, top left, top right, bottom right
+	const Math::Vec3* GetFrustumCorners() { Update(); return m_frustumCorners; }
+
+	// Goes up by one every time the matrices change
+	unsigned int GetVersion() { Update(); return m_version; }
+
+private:
+	void Update();
+	void UpdateView();
+	void UpdateProjection();
 
 private:
 	float m_positionX, m_positionY, m_positionZ;
 	float m_rotationX, m_rotationY, m_rotationZ;
-	DirectX::XMMATRIX m_viewMatrix;
-    DirectX::XMMATRIX m_projMatrix;
+
+	float m_fovY, m_aspect, m_nearZ, m_farZ;
+	bool m_reversedZ;
+	bool m_infiniteFar;
+
+	bool m_viewDirty;
+	bool m_projDirty;
+	unsigned int m_version;
+
+	Math::Mat4 m_viewMatrix;
+    Math::Mat4 m_projMatrix;
+	Math::Mat4 m_viewProjMatrix;
+	Math::Mat4 m_invViewMatrix;
+	Math::Mat4 m_invProjMatrix;
+	Math::Mat4 m_invViewProjMatrix;
+
+	Math::Frustum m_frustum;
+	Math::Vec3 m_frustumCorners[8];
 };
 
-#endif // __CAMERA_H__
\ No newline at end of file
+#endif // __CAMERA_H__
@@ -0,0 +1,228 @@
+///
+/// FramePipeline.cpp - Overlaps simulation and rendering.
+///
+
+#include "stdafx.h"
+
+#include "FramePipeline.h"
+
+#include "utils\assert.h"
+#include "utils\Profiler.h"
+
+static double SecondsBetween(PipelineClock::time_point start, PipelineClock::time_point end)
+{
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// ======================================================================================
+// RenderSnapshot
+// ======================================================================================
+void RenderSnapshot::Reset(unsigned long long frame)
+{
+    Frame = frame;
+    Items.clear();      // keeps its capacity, so a steady scene stops allocating
+    DirectX::XMStoreFloat4x4(&View, DirectX::XMMatrixIdentity());
+    DirectX::XMStoreFloat4x4(&Projection, DirectX::XMMatrixIdentity());
+}
+
+void RenderSnapshot::SetCamera(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection)
+{
+    DirectX::XMStoreFloat4x4(&View, view);
+    DirectX::XMStoreFloat4x4(&Projection, projection);
+}
+
+void RenderSnapshot::Add(Model* model, const DirectX::XMMATRIX& world, float screenSize)
+{
+    RenderItem item;
+    item.model = model;
+    DirectX::XMStoreFloat4x4(&item.world, world);
+    item.screenSize = screenSize;
+    Items.push_back(item);
+}
+
+// ======================================================================================
+// FramePipeline
+// ======================================================================================
+FramePipeline::FramePipeline()
+    : mNextSimulate(0)
+    , mNextRender(0)
+    , mFrame(0)
+    , mRunning(false)
+    , mPipelined(false)
+    , mStopping(false)
+{
+    for (unsigned int index = 0; index < kSnapshotCount; index++)
+        mStates[index] = SS_Free;
+
+    ResetStats();
+}
+
+FramePipeline::~FramePipeline()
+{
+    Stop();
+}
+
+bool FramePipeline::Start(const RenderFunction& render, bool pipelined)
+{
+    ASSERT(!mRunning);
+
+    mRender = render;
+    mPipelined = pipelined;
+    mStopping = false;
+    mRunning = true;
+
+    if (mPipelined)
+        mRenderThread = std::thread(&FramePipeline::RenderMain, this);
+
+    return true;
+}
+
+void FramePipeline::Stop()
+{
+    if (!mRunning)
+        return;
+
+    Flush();
+
+    if (mPipelined)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mStopping = true;
+        }
+        mSignal.notify_all();
+        mRenderThread.join();
+    }
+
+    mRunning = false;
+}
+
+RenderSnapshot* FramePipeline::BeginFrame()
+{
+    ASSERT(mRunning);
+
+    unsigned int index = mNextSimulate;
+    RenderSnapshot* snapshot = &mSnapshots[index];
+    {
+        PROFILE_SCOPE("FramePipeline::WaitForSnapshot");
+
+        // Wait for the renderer to hand this snapshot back
+        std::unique_lock<std::mutex> lock(mLock);
+        mSignal.wait(lock, [&] { return mStates[index] == SS_Free; });
+        mStates[index] = SS_Simulating;
+
+        snapshot->SimulationStart = PipelineClock::now();
+        if (!mStatsStarted)
+        {
+            mStatsStart = snapshot->SimulationStart;
+            mStatsStarted = true;
+        }
+    }
+
+    snapshot->Reset(mFrame++);
+    return snapshot;
+}
+
+void FramePipeline::EndFrame(RenderSnapshot* snapshot)
+{
+    unsigned int index = mNextSimulate;
+    ASSERT(snapshot == &mSnapshots[index]);
+
+    snapshot->SimulationEnd = PipelineClock::now();
+    mNextSimulate = (mNextSimulate + 1) % kSnapshotCount;
+
+    if (!mPipelined)
+    {
+        mStates[index] = SS_Rendering;
+        RenderSnapshotNow(index);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStates[index] = SS_Ready;
+    }
+    mSignal.notify_all();
+}
+
+void FramePipeline::Flush()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    mSignal.wait(lock, [&]
+    {
+        for (unsigned int index = 0; index < kSnapshotCount; index++)
+        {
+            if ((mStates[index] == SS_Ready) || (mStates[index] == SS_Rendering))
+                return false;
+        }
+        return true;
+    });
+}
+
+FramePipeline::Stats FramePipeline::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+void FramePipeline::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mStats.FrameCount = 0;
+    mStats.WallSeconds = 0.0;
+    mStats.SimulationSeconds = 0.0;
+    mStats.RenderSeconds = 0.0;
+    mStats.LatencySeconds = 0.0;
+    mStats.MaxLatencySeconds = 0.0;
+    mStatsStarted = false;
+}
+
+void FramePipeline::RenderMain()
+{
+    PROFILE_THREAD_NAME("Render");
+
+    for (;;)
+    {
+        unsigned int index = mNextRender;
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mSignal.wait(lock, [&] { return mStopping || (mStates[index] == SS_Ready); });
+            if (mStates[index] != SS_Ready)
+                return;     // stopping, and nothing left to draw
+            mStates[index] = SS_Rendering;
+        }
+
+        RenderSnapshotNow(index);
+    }
+}
+
+void FramePipeline::RenderSnapshotNow(unsigned int index)
+{
+    RenderSnapshot& snapshot = mSnapshots[index];
+
+    PipelineClock::time_point renderStart = PipelineClock::now();
+    {
+        PROFILE_SCOPE("RenderFrame");
+        mRender(snapshot);
+    }
+    PipelineClock::time_point renderEnd = PipelineClock::now();
+
+    mNextRender = (index + 1) % kSnapshotCount;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        double latency = SecondsBetween(snapshot.SimulationStart, renderEnd);
+        mStats.FrameCount++;
+        mStats.SimulationSeconds += SecondsBetween(snapshot.SimulationStart, snapshot.SimulationEnd);
+        mStats.RenderSeconds += SecondsBetween(renderStart, renderEnd);
+        mStats.LatencySeconds += latency;
+        if (latency > mStats.MaxLatencySeconds)
+            mStats.MaxLatencySeconds = latency;
+        if (mStatsStarted)
+            mStats.WallSeconds = SecondsBetween(mStatsStart, renderEnd);
+
+        mStates[index] = SS_Free;
+    }
+    mSignal.notify_all();
+}
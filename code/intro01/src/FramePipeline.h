@@ -0,0 +1,130 @@
+///
+/// FramePipeline.h - Overlaps simulation and rendering.
+/// The simulation thread fills a RenderSnapshot for frame N+1 while a render thread
+/// records and submits frame N from the previous snapshot. There are two snapshots, so
+/// neither side ever reads something the other is writing, and frame throughput tends
+/// towards max(simulation, render) instead of their sum.
+///
+/// Everything the renderer needs has to be copied into the snapshot - the render thread
+/// must never read the Camera or the scene directly.
+///
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class Model;
+
+typedef std::chrono::high_resolution_clock PipelineClock;
+
+struct RenderItem
+{
+    Model*                  model;
+    DirectX::XMFLOAT4X4     world;
+    float                   screenSize;     // pixels across its bounds, for texture streaming - 0 if not worked out
+};
+
+// One frame's worth of state, handed from the simulation to the renderer
+struct RenderSnapshot
+{
+    void Reset(unsigned long long frame);
+    void SetCamera(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection);
+    void Add(Model* model, const DirectX::XMMATRIX& world, float screenSize = 0.0f);
+
+    unsigned long long          Frame;
+    DirectX::XMFLOAT4X4         View;
+    DirectX::XMFLOAT4X4         Projection;
+    std::vector<RenderItem>     Items;
+
+    PipelineClock::time_point   SimulationStart;
+    PipelineClock::time_point   SimulationEnd;
+};
+
+class FramePipeline
+{
+public:
+    typedef std::function<void(const RenderSnapshot&)> RenderFunction;
+
+    struct Stats
+    {
+        unsigned long long  FrameCount;
+        double              WallSeconds;            // first frame started to last frame finished
+        double              SimulationSeconds;      // totals across every frame
+        double              RenderSeconds;
+        double              LatencySeconds;         // simulation start to render finished
+        double              MaxLatencySeconds;
+
+        double FramesPerSecond() const      { return (WallSeconds > 0.0) ? FrameCount / WallSeconds : 0.0; }
+        double AverageLatency() const       { return (FrameCount > 0) ? LatencySeconds / FrameCount : 0.0; }
+        double AverageSimulation() const    { return (FrameCount > 0) ? SimulationSeconds / FrameCount : 0.0; }
+        double AverageRender() const        { return (FrameCount > 0) ? RenderSeconds / FrameCount : 0.0; }
+    };
+
+private:
+    static const unsigned int kSnapshotCount = 2;
+
+    enum SnapshotState
+    {
+        SS_Free = 0,
+        SS_Simulating,
+        SS_Ready,
+        SS_Rendering,
+    };
+
+public:
+    FramePipeline();
+    ~FramePipeline();
+
+    // Pipelined starts the render thread. Otherwise frames are rendered on the calling
+    // thread as soon as they're submitted - handy for comparing the two.
+    bool Start(const RenderFunction& render, bool pipelined = true);
+
+    // Renders whatever has been submitted, then stops the render thread
+    void Stop();
+
+    bool IsRunning() const { return mRunning; }
+    bool IsPipelined() const { return mPipelined; }
+
+    // Simulation side. Blocks while the renderer still holds both snapshots.
+    RenderSnapshot* BeginFrame();
+    void EndFrame(RenderSnapshot* snapshot);
+
+    // Blocks until every submitted frame has been rendered
+    void Flush();
+
+    Stats GetStats() const;
+    void ResetStats();
+
+private:
+    void RenderMain();
+    void RenderSnapshotNow(unsigned int index);
+
+private:
+    RenderSnapshot              mSnapshots[kSnapshotCount];
+    SnapshotState               mStates[kSnapshotCount];
+    unsigned int                mNextSimulate;
+    unsigned int                mNextRender;
+    unsigned long long          mFrame;
+
+    RenderFunction              mRender;
+    std::thread                 mRenderThread;
+    bool                        mRunning;
+    bool                        mPipelined;
+    bool                        mStopping;
+
+    mutable std::mutex          mLock;
+    std::condition_variable     mSignal;
+
+    Stats                       mStats;
+    bool                        mStatsStarted;
+    PipelineClock::time_point   mStatsStart;
+};
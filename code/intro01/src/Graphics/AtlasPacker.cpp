@@ -0,0 +1,210 @@
+#include "AtlasPacker.h"
+
+#include "utils\Profiler.h"
+#include "utils\assert.h"
+
+#include <algorithm>
+
+namespace
+{
+    unsigned int AlignUp(unsigned int value, unsigned int alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+SkylinePacker::SkylinePacker()
+    : mWidth(0)
+    , mHeight(0)
+    , mUsedArea(0)
+{
+}
+
+void SkylinePacker::Reset(unsigned int width, unsigned int height)
+{
+    mWidth = width;
+    mHeight = height;
+    mUsedArea = 0;
+
+    Segment floor = { 0, 0, width };
+    mSkyline.clear();
+    mSkyline.push_back(floor);
+}
+
+bool SkylinePacker::Insert(unsigned int width, unsigned int height, SkylineHeuristic heuristic, unsigned int& x, unsigned int& y)
+{
+    ASSERT(width > 0 && height > 0);
+
+    unsigned int bestIndex = 0xffffffff;
+    unsigned int bestY = 0;
+    unsigned long long bestScore = ~0ULL;
+    unsigned long long bestTieBreak = ~0ULL;
+
+    for (unsigned int index = 0; index < (unsigned int)mSkyline.size(); index++)
+    {
+        unsigned int top;
+        unsigned long long waste;
+        if (!Fit(index, width, height, top, waste))
+            continue;
+
+        unsigned long long score;
+        unsigned long long tieBreak;
+        if (heuristic == SH_BottomLeft)
+        {
+            score = top + height;
+            tieBreak = mSkyline[index].Width;
+        }
+        else
+        {
+            score = waste;
+            tieBreak = top + height;
+        }
+
+        if ((score < bestScore) || ((score == bestScore) && (tieBreak < bestTieBreak)))
+        {
+            bestIndex = index;
+            bestY = top;
+            bestScore = score;
+            bestTieBreak = tieBreak;
+        }
+    }
+
+    if (bestIndex == 0xffffffff)
+        return false;
+
+    x = mSkyline[bestIndex].X;
+    y = bestY;
+    Place(bestIndex, x, y, width, height);
+    return true;
+}
+
+bool SkylinePacker::Fit(unsigned int index, unsigned int width, unsigned int height, unsigned int& y, unsigned long long& waste) const
+{
+    unsigned int x = mSkyline[index].X;
+    if (x + width > mWidth)
+        return false;
+
+    // It rests on the highest segment it spans
+    y = 0;
+    unsigned int remaining = width;
+    for (unsigned int current = index; remaining > 0; current++)
+    {
+        y = std::max(y, mSkyline[current].Y);
+        if (y + height > mHeight)
+            return false;
+        remaining -= std::min(remaining, mSkyline[current].Width);
+    }
+
+    waste = 0;
+    remaining = width;
+    for (unsigned int current = index; remaining > 0; current++)
+    {
+        unsigned int span = std::min(remaining, mSkyline[current].Width);
+        waste += (unsigned long long)(y - mSkyline[current].Y) * span;
+        remaining -= span;
+    }
+    return true;
+}
+
+void SkylinePacker::Place(unsigned int index, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+    Segment top = { x, y + height, width };
+    mSkyline.insert(mSkyline.begin() + index, top);
+
+    // Whatever the new segment covers goes, and the one it ends part way along is cut short
+    for (size_t current = index + 1; current < mSkyline.size(); )
+    {
+        unsigned int coveredTo = mSkyline[current - 1].X + mSkyline[current - 1].Width;
+        Segment& segment = mSkyline[current];
+        if (segment.X >= coveredTo)
+            break;
+
+        unsigned int shrink = coveredTo - segment.X;
+        if (segment.Width <= shrink)
+        {
+            mSkyline.erase(mSkyline.begin() + current);
+            continue;
+        }
+
+        segment.X += shrink;
+        segment.Width -= shrink;
+        break;
+    }
+
+    // Neighbours at the same height are one segment
+    for (size_t current = 0; current + 1 < mSkyline.size(); )
+    {
+        if (mSkyline[current].Y == mSkyline[current + 1].Y)
+        {
+            mSkyline[current].Width += mSkyline[current + 1].Width;
+            mSkyline.erase(mSkyline.begin() + current + 1);
+        }
+        else
+            current++;
+    }
+
+    mUsedArea += (unsigned long long)width * height;
+}
+
+unsigned int PackAtlas(const AtlasSize* sizes, unsigned int count, const AtlasPackSettings& settings,
+                       std::vector<AtlasPlacement>& placements)
+{
+    PROFILE_FUNCTION();
+
+    unsigned int alignment = std::max(settings.Alignment, 1u);
+
+    std::vector<unsigned int> order(count);
+    for (unsigned int index = 0; index < count; index++)
+        order[index] = index;
+
+    if (settings.Sort)
+    {
+        std::stable_sort(order.begin(), order.end(),
+            [sizes](unsigned int a, unsigned int b)
+            {
+                if (sizes[a].Height != sizes[b].Height)
+                    return sizes[a].Height > sizes[b].Height;
+                return sizes[a].Width > sizes[b].Width;
+            });
+    }
+
+    placements.resize(count);
+    std::vector<SkylinePacker> pages;
+
+    for (unsigned int index : order)
+    {
+        AtlasPlacement& placement = placements[index];
+        placement.Page = AtlasPlacement::kNotPacked;
+        placement.X = 0;
+        placement.Y = 0;
+
+        // The padded rectangle is what's aligned. One with no area still takes an aligned
+        // cell, so everything after it stays aligned too.
+        unsigned int width = std::max(AlignUp(sizes[index].Width + settings.Padding * 2, alignment), alignment);
+        unsigned int height = std::max(AlignUp(sizes[index].Height + settings.Padding * 2, alignment), alignment);
+        if ((width > settings.PageWidth) || (height > settings.PageHeight))
+            continue;
+
+        // Earlier pages first, so small rectangles fill the gaps the big ones left
+        unsigned int x = 0;
+        unsigned int y = 0;
+        unsigned int page = 0;
+        while ((page < (unsigned int)pages.size()) && !pages[page].Insert(width, height, settings.Heuristic, x, y))
+            page++;
+
+        if (page == (unsigned int)pages.size())
+        {
+            pages.push_back(SkylinePacker());
+            pages.back().Reset(settings.PageWidth, settings.PageHeight);
+            bool placed = pages.back().Insert(width, height, settings.Heuristic, x, y);
+            ASSERT(placed);
+            (void)placed;
+        }
+
+        placement.Page = page;
+        placement.X = x + settings.Padding;
+        placement.Y = y + settings.Padding;
+    }
+
+    return (unsigned int)pages.size();
+}
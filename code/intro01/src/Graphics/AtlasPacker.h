@@ -0,0 +1,90 @@
+///
+/// AtlasPacker.h - Packs rectangles into as few fixed size pages as it can.
+/// Each page keeps its skyline - the top edge of everything placed so far, as a list of
+/// horizontal segments - and a rectangle goes on top of it wherever the heuristic likes
+/// best. That's never more than a walk over the segments, so thousands of rectangles pack
+/// in milliseconds, and sorted tallest first it fills pages about as well as the slower
+/// maximal rectangles packers do.
+///
+///     AtlasPackSettings settings;
+///     std::vector<AtlasPlacement> placements;
+///     unsigned int pageCount = PackAtlas(sizes, count, settings, placements);
+///
+/// Rectangles aren't rotated - UVs would have to be rotated with them.
+///
+#pragma once
+
+#include <vector>
+
+enum SkylineHeuristic
+{
+    SH_BottomLeft = 0,      // wherever the top of the rectangle ends up lowest - the better fill on mixed sizes
+    SH_MinWaste,            // wherever it leaves the least space trapped underneath - slower, and
+                            // lets the skyline grow ragged
+};
+
+struct AtlasPackSettings
+{
+    AtlasPackSettings() : PageWidth(2048), PageHeight(2048), Padding(0), Alignment(1), Heuristic(SH_BottomLeft), Sort(true) {}
+
+    unsigned int        PageWidth;
+    unsigned int        PageHeight;
+    unsigned int        Padding;        // clear space kept around each rectangle
+    unsigned int        Alignment;      // padded rectangles start on, and span, a multiple of this. With padding
+                                        // a multiple too, 4 keeps BC blocks to one rectangle each.
+    SkylineHeuristic    Heuristic;
+    bool                Sort;           // tallest first - much better packing, unless the order matters
+};
+
+struct AtlasSize
+{
+    unsigned int    Width;
+    unsigned int    Height;
+};
+
+struct AtlasPlacement
+{
+    static const unsigned int kNotPacked = 0xffffffff;
+
+    unsigned int    Page;           // kNotPacked if it's bigger than a page
+    unsigned int    X;              // inside the padding
+    unsigned int    Y;
+};
+
+class SkylinePacker
+{
+public:
+    SkylinePacker();
+
+    void Reset(unsigned int width, unsigned int height);
+
+    // False if there's no room left for it
+    bool Insert(unsigned int width, unsigned int height, SkylineHeuristic heuristic, unsigned int& x, unsigned int& y);
+
+    unsigned int GetWidth() const { return mWidth; }
+    unsigned int GetHeight() const { return mHeight; }
+    unsigned long long GetUsedArea() const { return mUsedArea; }
+
+private:
+    struct Segment
+    {
+        unsigned int    X;
+        unsigned int    Y;
+        unsigned int    Width;
+    };
+
+    // Where a rectangle at segment index would sit, and the space it would trap under it
+    bool Fit(unsigned int index, unsigned int width, unsigned int height, unsigned int& y, unsigned long long& waste) const;
+    void Place(unsigned int index, unsigned int x, unsigned int y, unsigned int width, unsigned int height);
+
+private:
+    unsigned int            mWidth;
+    unsigned int            mHeight;
+    unsigned long long      mUsedArea;
+    std::vector<Segment>    mSkyline;       // left to right, covering the whole width
+};
+
+// Places every rectangle, opening pages as they fill. Returns the number of pages used.
+// placements has one entry a size, in the same order.
+unsigned int PackAtlas(const AtlasSize* sizes, unsigned int count, const AtlasPackSettings& settings,
+                       std::vector<AtlasPlacement>& placements);
@@ -0,0 +1,87 @@
+///
+/// AtlasPackerBenchmark.cpp - Times the atlas packer and measures how well it fills pages.
+///
+
+#include "AtlasPackerBenchmark.h"
+#include "AtlasPacker.h"
+
+#include <chrono>
+
+typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+const unsigned int kPageSize = 2048;
+
+static unsigned int NextRandom(unsigned int& seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+// Seven in ten are glyph sized, most of the rest icons, and a few are sprites
+static void BuildRectangles(unsigned int count, std::vector<AtlasSize>& sizes)
+{
+    unsigned int seed = 4321;
+    sizes.resize(count);
+    for (auto& size : sizes)
+    {
+        unsigned int kind = NextRandom(seed) % 100;
+        unsigned int low = (kind < 70) ? 6 : ((kind < 95) ? 16 : 96);
+        unsigned int high = (kind < 70) ? 48 : ((kind < 95) ? 128 : 320);
+        size.Width = low + NextRandom(seed) % (high - low);
+        size.Height = low + NextRandom(seed) % (high - low);
+    }
+}
+
+void RunAtlasPackerBenchmarks(std::vector<AtlasPackerBenchmarkResult>& results)
+{
+    static const unsigned int kCounts[] = { 1000, 4000, 16000 };
+    static const char* const kHeuristicNames[] = { "bottom_left", "min_waste" };
+
+    for (unsigned int count : kCounts)
+    {
+        std::vector<AtlasSize> sizes;
+        BuildRectangles(count, sizes);
+
+        for (unsigned int heuristic = SH_BottomLeft; heuristic <= SH_MinWaste; heuristic++)
+        {
+            for (unsigned int sorted = 0; sorted < 2; sorted++)
+            {
+                // What the texture atlas packs with
+                AtlasPackSettings settings;
+                settings.PageWidth = kPageSize;
+                settings.PageHeight = kPageSize;
+                settings.Padding = 4;
+                settings.Alignment = 4;
+                settings.Heuristic = (SkylineHeuristic)heuristic;
+                settings.Sort = (sorted != 0);
+
+                std::vector<AtlasPlacement> placements;
+                BenchmarkClock::time_point start = BenchmarkClock::now();
+                unsigned int pageCount = PackAtlas(sizes.data(), count, settings, placements);
+                double seconds = std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+
+                unsigned long long area = 0;
+                unsigned long long lastPageArea = 0;
+                for (unsigned int i = 0; i < count; i++)
+                {
+                    unsigned long long rectangle = (unsigned long long)sizes[i].Width * sizes[i].Height;
+                    area += rectangle;
+                    if (placements[i].Page + 1 == pageCount)
+                        lastPageArea += rectangle;
+                }
+
+                double pageArea = (double)kPageSize * kPageSize;
+
+                AtlasPackerBenchmarkResult result;
+                result.Heuristic = kHeuristicNames[heuristic];
+                result.Sorted = (sorted != 0);
+                result.RectangleCount = count;
+                result.PageCount = pageCount;
+                result.Occupancy = (double)area / (pageCount * pageArea);
+                result.FullPageOccupancy = (pageCount > 1) ? (double)(area - lastPageArea) / ((pageCount - 1) * pageArea) : result.Occupancy;
+                result.Milliseconds = seconds * 1000.0;
+                results.push_back(result);
+            }
+        }
+    }
+}
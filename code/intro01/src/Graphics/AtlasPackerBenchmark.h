@@ -0,0 +1,23 @@
+///
+/// AtlasPackerBenchmark.h - Times the atlas packer and measures how well it fills pages.
+/// Packs thousands of rectangles shaped like what goes into atlases - mostly glyphs and
+/// icons, some larger sprites - with each heuristic, sorted and not. The benchmark runner
+/// reports the results; nothing here prints.
+///
+#pragma once
+
+#include <vector>
+
+struct AtlasPackerBenchmarkResult
+{
+    const char*     Heuristic;
+    bool            Sorted;
+    unsigned int    RectangleCount;
+
+    unsigned int    PageCount;
+    double          Occupancy;              // rectangle area over page area, every page
+    double          FullPageOccupancy;      // the same without the last page, which is never full
+    double          Milliseconds;
+};
+
+void RunAtlasPackerBenchmarks(std::vector<AtlasPackerBenchmarkResult>& results);
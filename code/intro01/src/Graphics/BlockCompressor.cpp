@@ -0,0 +1,1319 @@
+#include "BlockCompressor.h"
+#include "TextureData.h"
+
+#include "utils\JobSystem.h"
+#include "utils\SimdMath.h"
+#include "utils\assert.h"
+
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+    const unsigned int kBlockTexels = 16;
+
+    // Least squares refinement passes, by BlockQuality
+    const unsigned int kRefinePasses[] = { 1, 2, 4 };
+
+    // Two-subset BC7 partitions tried in full, by BlockQuality - the rest are ruled out on
+    // an estimate
+    const unsigned int kPartitionCandidates[] = { 0, 4, 16 };
+
+    const double kLosslessPsnr = 100.0;
+
+    // BC7's interpolation weights, out of 64
+    const unsigned int kWeights2[4]  = { 0, 21, 43, 64 };
+    const unsigned int kWeights3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    const unsigned int kWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // The same as fractions, for the least squares fit
+    const float kWeights2Float[4] = { 0.0f, 21.0f / 64.0f, 43.0f / 64.0f, 1.0f };
+    const float kWeights3Float[8] =
+    {
+        0.0f, 9.0f / 64.0f, 18.0f / 64.0f, 27.0f / 64.0f, 37.0f / 64.0f, 46.0f / 64.0f, 55.0f / 64.0f, 1.0f,
+    };
+    const float kWeights4Float[16] =
+    {
+        0.0f, 4.0f / 64.0f, 9.0f / 64.0f, 13.0f / 64.0f, 17.0f / 64.0f, 21.0f / 64.0f, 26.0f / 64.0f, 30.0f / 64.0f,
+        34.0f / 64.0f, 38.0f / 64.0f, 43.0f / 64.0f, 47.0f / 64.0f, 51.0f / 64.0f, 55.0f / 64.0f, 60.0f / 64.0f, 1.0f,
+    };
+
+    // The BC7 two-subset partitions - a bit per texel, set for the texels in the second subset
+    const unsigned short kPartitions2[64] =
+    {
+        0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+        0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+        0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+        0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+        0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+        0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+        0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+        0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+    };
+
+    // The second subset's anchor texel for each partition - its index loses its top bit
+    const unsigned char kAnchors2[64] =
+    {
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,
+         2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,
+         2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2,
+        15, 15, 15, 15, 15,  2,  2, 15,
+    };
+
+    struct SourceBlock
+    {
+        Math::Vector    Texels[kBlockTexels];       // 0 to 255 a channel
+        unsigned char   Rgba[kBlockTexels * 4];
+        bool            Opaque;
+    };
+
+    // The texels of a block one pair of endpoints covers
+    struct TexelSet
+    {
+        unsigned char   Members[kBlockTexels];
+        unsigned int    Count;
+    };
+
+    TexelSet AllTexels()
+    {
+        TexelSet set;
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+            set.Members[i] = (unsigned char)i;
+        set.Count = kBlockTexels;
+        return set;
+    }
+
+    void SplitPartition(unsigned int partition, TexelSet sets[2])
+    {
+        sets[0].Count = 0;
+        sets[1].Count = 0;
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+        {
+            TexelSet& set = sets[(kPartitions2[partition] >> i) & 1];
+            set.Members[set.Count++] = (unsigned char)i;
+        }
+    }
+
+    Math::Vector ClampTexel(Math::Vector v)
+    {
+        return Math::VectorMin(Math::VectorMax(v, Math::VectorZero()), Math::VectorReplicate(255.0f));
+    }
+
+    float Dot(Math::Vector a, Math::Vector b)
+    {
+        return Math::VectorGetX(Math::Vector4Dot(a, b));
+    }
+
+    // Fits a line through the texels - through their mean, along the direction they spread
+    // furthest in - and sets low and high to where the texels start and end along it. Only
+    // the channels set in mask count. Returns how far the texels are from the line, squared.
+    float FitLine(const Math::Vector* texels, const TexelSet& set, Math::Vector mask, Math::Vector& low, Math::Vector& high)
+    {
+        Math::Vector sum = Math::VectorZero();
+        for (unsigned int i = 0; i < set.Count; i++)
+            sum = Math::VectorAdd(sum, texels[set.Members[i]]);
+        Math::Vector mean = Math::VectorScale(sum, 1.0f / set.Count);
+
+        // Covariance, a row at a time
+        Math::Vector rows[4] = { Math::VectorZero(), Math::VectorZero(), Math::VectorZero(), Math::VectorZero() };
+        float spread = 0.0f;
+        for (unsigned int i = 0; i < set.Count; i++)
+        {
+            Math::Vector offset = Math::VectorMultiply(Math::VectorSubtract(texels[set.Members[i]], mean), mask);
+            rows[0] = Math::VectorMultiplyAdd(offset, Math::VectorSplatX(offset), rows[0]);
+            rows[1] = Math::VectorMultiplyAdd(offset, Math::VectorSplatY(offset), rows[1]);
+            rows[2] = Math::VectorMultiplyAdd(offset, Math::VectorSplatZ(offset), rows[2]);
+            rows[3] = Math::VectorMultiplyAdd(offset, Math::VectorSplatW(offset), rows[3]);
+            spread += Dot(offset, offset);
+        }
+
+        low = mean;
+        high = mean;
+        if (spread < 1e-3f)
+            return 0.0f;
+
+        // Power iteration, from the row of the channel that varies most - it can't be at
+        // right angles to the answer
+        float variance[4] = { Math::VectorGetX(rows[0]), Math::VectorGetY(rows[1]), Math::VectorGetZ(rows[2]), Math::VectorGetW(rows[3]) };
+        Math::Vector axis = rows[std::max_element(variance, variance + 4) - variance];
+        for (unsigned int iteration = 0; iteration < 8; iteration++)
+        {
+            Math::Vector next = Math::VectorMultiply(rows[0], Math::VectorSplatX(axis));
+            next = Math::VectorMultiplyAdd(rows[1], Math::VectorSplatY(axis), next);
+            next = Math::VectorMultiplyAdd(rows[2], Math::VectorSplatZ(axis), next);
+            next = Math::VectorMultiplyAdd(rows[3], Math::VectorSplatW(axis), next);
+
+            float length = sqrtf(Dot(next, next));
+            if (length < 1e-6f)
+                break;
+            axis = Math::VectorScale(next, 1.0f / length);
+        }
+
+        float minimum = FLT_MAX;
+        float maximum = -FLT_MAX;
+        float along = 0.0f;
+        for (unsigned int i = 0; i < set.Count; i++)
+        {
+            Math::Vector offset = Math::VectorMultiply(Math::VectorSubtract(texels[set.Members[i]], mean), mask);
+            float t = Dot(offset, axis);
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+            along += t * t;
+        }
+
+        low = ClampTexel(Math::VectorMultiplyAdd(axis, Math::VectorReplicate(minimum), mean));
+        high = ClampTexel(Math::VectorMultiplyAdd(axis, Math::VectorReplicate(maximum), mean));
+        return std::max(spread - along, 0.0f);
+    }
+
+    // Picks the nearest palette entry for each texel in the set. Returns the total squared
+    // error over the channels in mask.
+    float SelectIndices(const Math::Vector* texels, const TexelSet& set, const Math::Vector* palette, unsigned int count,
+                        Math::Vector mask, unsigned char* indices)
+    {
+        float total = 0.0f;
+        for (unsigned int i = 0; i < set.Count; i++)
+        {
+            Math::Vector texel = texels[set.Members[i]];
+            float best = FLT_MAX;
+            unsigned int bestIndex = 0;
+            for (unsigned int entry = 0; entry < count; entry++)
+            {
+                Math::Vector difference = Math::VectorMultiply(Math::VectorSubtract(texel, palette[entry]), mask);
+                float error = Dot(difference, difference);
+                if (error < best)
+                {
+                    best = error;
+                    bestIndex = entry;
+                }
+            }
+            indices[set.Members[i]] = (unsigned char)bestIndex;
+            total += best;
+        }
+        return total;
+    }
+
+    // The endpoints that fit the texels best, in least squares, given the indices they've
+    // been given. weights is how far along from low to high each index is. False if the
+    // indices don't pin the endpoints down - when they're all the same, say.
+    bool SolveEndpoints(const Math::Vector* texels, const TexelSet& set, const unsigned char* indices, const float* weights,
+                        Math::Vector& low, Math::Vector& high)
+    {
+        float a = 0.0f;
+        float b = 0.0f;
+        float c = 0.0f;
+        Math::Vector lowSum = Math::VectorZero();
+        Math::Vector highSum = Math::VectorZero();
+        for (unsigned int i = 0; i < set.Count; i++)
+        {
+            unsigned int member = set.Members[i];
+            float w = weights[indices[member]];
+            a += (1.0f - w) * (1.0f - w);
+            b += (1.0f - w) * w;
+            c += w * w;
+            lowSum = Math::VectorMultiplyAdd(texels[member], Math::VectorReplicate(1.0f - w), lowSum);
+            highSum = Math::VectorMultiplyAdd(texels[member], Math::VectorReplicate(w), highSum);
+        }
+
+        float determinant = a * c - b * b;
+        if (fabsf(determinant) < 1e-6f)
+            return false;
+
+        float scale = 1.0f / determinant;
+        low = ClampTexel(Math::VectorScale(Math::VectorSubtract(Math::VectorScale(lowSum, c), Math::VectorScale(highSum, b)), scale));
+        high = ClampTexel(Math::VectorScale(Math::VectorSubtract(Math::VectorScale(highSum, a), Math::VectorScale(lowSum, b)), scale));
+        return true;
+    }
+
+    void StoreTexel(Math::Vector texel, unsigned char* rgba)
+    {
+        Math::Vec4 value;
+        Math::VectorStore4(&value, texel);
+        rgba[0] = (unsigned char)value.x;
+        rgba[1] = (unsigned char)value.y;
+        rgba[2] = (unsigned char)value.z;
+        rgba[3] = (unsigned char)value.w;
+    }
+
+    int RoundChannel(float value, int maximum)
+    {
+        int result = (int)(value + 0.5f);
+        return (result < 0) ? 0 : ((result > maximum) ? maximum : result);
+    }
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(unsigned char* data)
+            : mData(data)
+            , mPosition(0)
+        {
+            memset(data, 0, 16);
+        }
+
+        // Least significant bit first, as the BC7 block is laid out
+        void Write(unsigned int value, unsigned int count)
+        {
+            for (unsigned int bit = 0; bit < count; bit++, mPosition++)
+                mData[mPosition >> 3] |= (unsigned char)(((value >> bit) & 1) << (mPosition & 7));
+        }
+
+    private:
+        unsigned char*  mData;
+        unsigned int    mPosition;
+    };
+
+    // ==================================================================================
+    // BC1 - two 5:6:5 colours and the two between them, 2 bit indices
+    // ==================================================================================
+    const float kBc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    unsigned int Quantize565(Math::Vector color)
+    {
+        Math::Vec4 value;
+        Math::VectorStore4(&value, color);
+        return (RoundChannel(value.x * 31.0f / 255.0f, 31) << 11)
+            | (RoundChannel(value.y * 63.0f / 255.0f, 63) << 5)
+            | RoundChannel(value.z * 31.0f / 255.0f, 31);
+    }
+
+    void Unpack565(unsigned int color, int rgb[3])
+    {
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    void BuildBc1Palette(unsigned int color0, unsigned int color1, Math::Vector palette[4])
+    {
+        int a[3];
+        int b[3];
+        Unpack565(color0, a);
+        Unpack565(color1, b);
+        palette[0] = Math::VectorSet((float)a[0], (float)a[1], (float)a[2], 255.0f);
+        palette[1] = Math::VectorSet((float)b[0], (float)b[1], (float)b[2], 255.0f);
+        palette[2] = Math::VectorSet((float)((2 * a[0] + b[0]) / 3), (float)((2 * a[1] + b[1]) / 3), (float)((2 * a[2] + b[2]) / 3), 255.0f);
+        palette[3] = Math::VectorSet((float)((a[0] + 2 * b[0]) / 3), (float)((a[1] + 2 * b[1]) / 3), (float)((a[2] + 2 * b[2]) / 3), 255.0f);
+    }
+
+    float EvaluateBc1(const SourceBlock& block, unsigned int color0, unsigned int color1, unsigned char* indices)
+    {
+        Math::Vector palette[4];
+        BuildBc1Palette(color0, color1, palette);
+        return SelectIndices(block.Texels, AllTexels(), palette, 4, Math::VectorSet(1.0f, 1.0f, 1.0f, 0.0f), indices);
+    }
+
+    // Nudges each channel of each endpoint a step either way, for as long as that helps
+    float SearchBc1(const SourceBlock& block, unsigned int colors[2], unsigned char* indices, float error)
+    {
+        const unsigned int kShifts[3] = { 11, 5, 0 };
+        const unsigned int kMasks[3] = { 31, 63, 31 };
+
+        bool improved = true;
+        for (unsigned int round = 0; improved && (round < 4); round++)
+        {
+            improved = false;
+            for (unsigned int endpoint = 0; endpoint < 2; endpoint++)
+            {
+                for (unsigned int channel = 0; channel < 3; channel++)
+                {
+                    for (int step = -1; step <= 1; step += 2)
+                    {
+                        int value = (int)((colors[endpoint] >> kShifts[channel]) & kMasks[channel]) + step;
+                        if ((value < 0) || (value > (int)kMasks[channel]))
+                            continue;
+
+                        unsigned int trial[2] = { colors[0], colors[1] };
+                        trial[endpoint] = (trial[endpoint] & ~(kMasks[channel] << kShifts[channel])) | (value << kShifts[channel]);
+
+                        unsigned char trialIndices[kBlockTexels];
+                        float trialError = EvaluateBc1(block, trial[0], trial[1], trialIndices);
+                        if (trialError < error)
+                        {
+                            error = trialError;
+                            colors[0] = trial[0];
+                            colors[1] = trial[1];
+                            memcpy(indices, trialIndices, kBlockTexels);
+                            improved = true;
+                        }
+                    }
+                }
+            }
+        }
+        return error;
+    }
+
+    // The BC1 block, and the colour a decoder gets back from it in decoded
+    void EncodeBc1Color(const SourceBlock& block, BlockQuality quality, unsigned char* output, unsigned char* decoded)
+    {
+        TexelSet all = AllTexels();
+        Math::Vector low;
+        Math::Vector high;
+        FitLine(block.Texels, all, Math::VectorSet(1.0f, 1.0f, 1.0f, 0.0f), low, high);
+
+        unsigned int colors[2] = { Quantize565(low), Quantize565(high) };
+        unsigned char indices[kBlockTexels];
+        float error = EvaluateBc1(block, colors[0], colors[1], indices);
+
+        for (unsigned int pass = 0; (pass < kRefinePasses[quality]) && (error > 0.0f); pass++)
+        {
+            if (!SolveEndpoints(block.Texels, all, indices, kBc1Weights, low, high))
+                break;
+
+            unsigned int trial[2] = { Quantize565(low), Quantize565(high) };
+            unsigned char trialIndices[kBlockTexels];
+            float trialError = EvaluateBc1(block, trial[0], trial[1], trialIndices);
+            if (trialError >= error)
+                break;
+
+            error = trialError;
+            colors[0] = trial[0];
+            colors[1] = trial[1];
+            memcpy(indices, trialIndices, kBlockTexels);
+        }
+
+        if ((quality == BQ_High) && (error > 0.0f))
+            SearchBc1(block, colors, indices, error);
+
+        // The first colour has to be the larger, or the block is read as having transparency
+        if (colors[0] < colors[1])
+        {
+            std::swap(colors[0], colors[1]);
+            for (unsigned int i = 0; i < kBlockTexels; i++)
+                indices[i] ^= 1;
+        }
+        else if (colors[0] == colors[1])
+            memset(indices, 0, sizeof(indices));
+
+        Math::Vector palette[4];
+        BuildBc1Palette(colors[0], colors[1], palette);
+
+        unsigned int bits = 0;
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+        {
+            bits |= (unsigned int)indices[i] << (i * 2);
+            StoreTexel(palette[indices[i]], decoded + i * 4);
+        }
+
+        output[0] = (unsigned char)colors[0];
+        output[1] = (unsigned char)(colors[0] >> 8);
+        output[2] = (unsigned char)colors[1];
+        output[3] = (unsigned char)(colors[1] >> 8);
+        memcpy(output + 4, &bits, 4);
+    }
+
+    // ==================================================================================
+    // BC4 - one channel, two 8 bit endpoints, 3 bit indices. BC3's alpha and BC5's halves.
+    // ==================================================================================
+    void BuildBc4Palette(unsigned int value0, unsigned int value1, int palette[8])
+    {
+        palette[0] = value0;
+        palette[1] = value1;
+        if (value0 > value1)
+        {
+            for (unsigned int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+        }
+        else
+        {
+            // The other ordering has four steps and the two extremes
+            for (unsigned int i = 1; i < 5; i++)
+                palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    int EvaluateBc4(const unsigned char* values, unsigned int stride, unsigned int value0, unsigned int value1, unsigned char* indices)
+    {
+        int palette[8];
+        BuildBc4Palette(value0, value1, palette);
+
+        int total = 0;
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+        {
+            int value = values[i * stride];
+            int best = INT_MAX;
+            for (unsigned int entry = 0; entry < 8; entry++)
+            {
+                int error = (value - palette[entry]) * (value - palette[entry]);
+                if (error < best)
+                {
+                    best = error;
+                    indices[i] = (unsigned char)entry;
+                }
+            }
+            total += best;
+        }
+        return total;
+    }
+
+    // values is every stride'th byte. decoded gets the result at the same stride.
+    void EncodeBc4(const unsigned char* values, unsigned int stride, BlockQuality quality, unsigned char* output, unsigned char* decoded)
+    {
+        unsigned int minimum = 255;
+        unsigned int maximum = 0;
+        unsigned int innerMinimum = 255;
+        unsigned int innerMaximum = 0;
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+        {
+            unsigned int value = values[i * stride];
+            minimum = std::min(minimum, value);
+            maximum = std::max(maximum, value);
+            if ((value != 0) && (value != 255))
+            {
+                innerMinimum = std::min(innerMinimum, value);
+                innerMaximum = std::max(innerMaximum, value);
+            }
+        }
+
+        unsigned int best[2] = { maximum, minimum };
+        unsigned char indices[kBlockTexels];
+        int error = EvaluateBc4(values, stride, maximum, minimum, indices);
+
+        auto consider = [&](unsigned int value0, unsigned int value1)
+        {
+            unsigned char trialIndices[kBlockTexels];
+            int trialError = EvaluateBc4(values, stride, value0, value1, trialIndices);
+            if (trialError < error)
+            {
+                error = trialError;
+                best[0] = value0;
+                best[1] = value1;
+                memcpy(indices, trialIndices, kBlockTexels);
+            }
+        };
+
+        // With 0 or 255 in the block, the six step ordering gets those exactly and spends
+        // its steps on the rest
+        if ((quality != BQ_Fast) && (error > 0) && (innerMinimum <= innerMaximum) && ((minimum == 0) || (maximum == 255)))
+            consider(innerMinimum, innerMaximum);
+
+        // Pulling the ends in a little often lands the steps closer to the values between
+        if ((quality == BQ_High) && (error > 0) && (maximum > minimum))
+        {
+            for (unsigned int high = maximum; (high + 4 > maximum) && (high > minimum); high--)
+            {
+                for (unsigned int low = minimum; (low < minimum + 4) && (low < high); low++)
+                    consider(high, low);
+            }
+        }
+
+        int palette[8];
+        BuildBc4Palette(best[0], best[1], palette);
+
+        unsigned long long bits = 0;
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+        {
+            bits |= (unsigned long long)indices[i] << (i * 3);
+            decoded[i * stride] = (unsigned char)palette[indices[i]];
+        }
+
+        output[0] = (unsigned char)best[0];
+        output[1] = (unsigned char)best[1];
+        for (unsigned int i = 0; i < 6; i++)
+            output[2 + i] = (unsigned char)(bits >> (i * 8));
+    }
+
+    // ==================================================================================
+    // BC7 - mode 6 (one subset, RGBA 7 bits + p-bit, 4 bit indices) for everything,
+    // mode 1 (two subsets, RGB 6 bits + shared p-bit, 3 bit indices) for opaque blocks and
+    // modes 4 and 5 (colour and alpha with indices of their own) for the rest
+    // ==================================================================================
+    Math::Vector InterpolateBc7(const int* endpoint0, const int* endpoint1, unsigned int weight)
+    {
+        int channels[4];
+        for (unsigned int channel = 0; channel < 4; channel++)
+            channels[channel] = ((64 - weight) * endpoint0[channel] + weight * endpoint1[channel] + 32) >> 6;
+        return Math::VectorSet((float)channels[0], (float)channels[1], (float)channels[2], (float)channels[3]);
+    }
+
+    struct Mode6Endpoints
+    {
+        unsigned int    Values[2][4];       // 7 bits
+        unsigned int    PBits[2];
+    };
+
+    // Seven bits a channel and a p-bit under them. pbit picks one, otherwise it's whichever
+    // is closer.
+    void QuantizeMode6(Math::Vector endpoint, int pbit, unsigned int values[4], unsigned int& chosen)
+    {
+        Math::Vec4 value;
+        Math::VectorStore4(&value, endpoint);
+        const float channels[4] = { value.x, value.y, value.z, value.w };
+
+        float bestError = FLT_MAX;
+        for (unsigned int p = 0; p < 2; p++)
+        {
+            if ((pbit >= 0) && (p != (unsigned int)pbit))
+                continue;
+
+            unsigned int trial[4];
+            float error = 0.0f;
+            for (unsigned int channel = 0; channel < 4; channel++)
+            {
+                trial[channel] = RoundChannel((channels[channel] - p) * 0.5f, 127);
+                float difference = (float)(trial[channel] * 2 + p) - channels[channel];
+                error += difference * difference;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                memcpy(values, trial, sizeof(trial));
+                chosen = p;
+            }
+        }
+    }
+
+    void BuildMode6Palette(const Mode6Endpoints& endpoints, Math::Vector palette[16])
+    {
+        int expanded[2][4];
+        for (unsigned int endpoint = 0; endpoint < 2; endpoint++)
+        {
+            for (unsigned int channel = 0; channel < 4; channel++)
+                expanded[endpoint][channel] = (int)((endpoints.Values[endpoint][channel] << 1) | endpoints.PBits[endpoint]);
+        }
+
+        for (unsigned int i = 0; i < 16; i++)
+            palette[i] = InterpolateBc7(expanded[0], expanded[1], kWeights4[i]);
+    }
+
+    float EvaluateMode6(const SourceBlock& block, const Mode6Endpoints& endpoints, unsigned char* indices)
+    {
+        Math::Vector palette[16];
+        BuildMode6Palette(endpoints, palette);
+        return SelectIndices(block.Texels, AllTexels(), palette, 16, Math::VectorReplicate(1.0f), indices);
+    }
+
+    float QuantizeAndEvaluateMode6(const SourceBlock& block, Math::Vector low, Math::Vector high, BlockQuality quality,
+                                   Mode6Endpoints& endpoints, unsigned char* indices)
+    {
+        if (quality != BQ_High)
+        {
+            QuantizeMode6(low, -1, endpoints.Values[0], endpoints.PBits[0]);
+            QuantizeMode6(high, -1, endpoints.Values[1], endpoints.PBits[1]);
+            return EvaluateMode6(block, endpoints, indices);
+        }
+
+        // Every pairing of p-bits - the nearest for each endpoint isn't always the best pair
+        float bestError = FLT_MAX;
+        for (unsigned int pbits = 0; pbits < 4; pbits++)
+        {
+            Mode6Endpoints trial;
+            QuantizeMode6(low, pbits & 1, trial.Values[0], trial.PBits[0]);
+            QuantizeMode6(high, pbits >> 1, trial.Values[1], trial.PBits[1]);
+
+            unsigned char trialIndices[kBlockTexels];
+            float error = EvaluateMode6(block, trial, trialIndices);
+            if (error < bestError)
+            {
+                bestError = error;
+                endpoints = trial;
+                memcpy(indices, trialIndices, kBlockTexels);
+            }
+        }
+        return bestError;
+    }
+
+    float EncodeMode6(const SourceBlock& block, BlockQuality quality, Mode6Endpoints& endpoints, unsigned char* indices)
+    {
+        TexelSet all = AllTexels();
+        Math::Vector low;
+        Math::Vector high;
+        FitLine(block.Texels, all, Math::VectorReplicate(1.0f), low, high);
+        float error = QuantizeAndEvaluateMode6(block, low, high, quality, endpoints, indices);
+
+        for (unsigned int pass = 0; (pass < kRefinePasses[quality]) && (error > 0.0f); pass++)
+        {
+            if (!SolveEndpoints(block.Texels, all, indices, kWeights4Float, low, high))
+                break;
+
+            Mode6Endpoints trial;
+            unsigned char trialIndices[kBlockTexels];
+            float trialError = QuantizeAndEvaluateMode6(block, low, high, quality, trial, trialIndices);
+            if (trialError >= error)
+                break;
+
+            error = trialError;
+            endpoints = trial;
+            memcpy(indices, trialIndices, kBlockTexels);
+        }
+
+        if ((quality == BQ_High) && (error > 0.0f))
+        {
+            bool improved = true;
+            for (unsigned int round = 0; improved && (round < 4); round++)
+            {
+                improved = false;
+                for (unsigned int component = 0; component < 8; component++)
+                {
+                    for (int step = -1; step <= 1; step += 2)
+                    {
+                        Mode6Endpoints trial = endpoints;
+                        int value = (int)trial.Values[component >> 2][component & 3] + step;
+                        if ((value < 0) || (value > 127))
+                            continue;
+                        trial.Values[component >> 2][component & 3] = value;
+
+                        unsigned char trialIndices[kBlockTexels];
+                        float trialError = EvaluateMode6(block, trial, trialIndices);
+                        if (trialError < error)
+                        {
+                            error = trialError;
+                            endpoints = trial;
+                            memcpy(indices, trialIndices, kBlockTexels);
+                            improved = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return error;
+    }
+
+    void WriteMode6(Mode6Endpoints endpoints, unsigned char* indices, unsigned char* output, unsigned char* decoded)
+    {
+        // The first texel's index loses its top bit, so it has to be in the low half
+        if (indices[0] & 8)
+        {
+            std::swap(endpoints.Values[0], endpoints.Values[1]);
+            std::swap(endpoints.PBits[0], endpoints.PBits[1]);
+            for (unsigned int i = 0; i < kBlockTexels; i++)
+                indices[i] = (unsigned char)(15 - indices[i]);
+        }
+
+        BitWriter bits(output);
+        bits.Write(1 << 6, 7);
+        for (unsigned int channel = 0; channel < 4; channel++)
+        {
+            bits.Write(endpoints.Values[0][channel], 7);
+            bits.Write(endpoints.Values[1][channel], 7);
+        }
+        bits.Write(endpoints.PBits[0], 1);
+        bits.Write(endpoints.PBits[1], 1);
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+            bits.Write(indices[i], (i == 0) ? 3 : 4);
+
+        Math::Vector palette[16];
+        BuildMode6Palette(endpoints, palette);
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+            StoreTexel(palette[indices[i]], decoded + i * 4);
+    }
+
+    struct Mode1Subset
+    {
+        unsigned int    Values[2][3];       // 6 bits
+        unsigned int    PBit;               // shared by both endpoints
+    };
+
+    unsigned int ExpandMode1(unsigned int value, unsigned int pbit)
+    {
+        unsigned int seven = (value << 1) | pbit;
+        return (seven << 1) | (seven >> 6);
+    }
+
+    void QuantizeMode1(Math::Vector endpoint, unsigned int pbit, unsigned int values[3])
+    {
+        Math::Vec4 value;
+        Math::VectorStore4(&value, endpoint);
+        const float channels[3] = { value.x, value.y, value.z };
+
+        // The expansion isn't linear, so take the closer of the two either side
+        for (unsigned int channel = 0; channel < 3; channel++)
+        {
+            int guess = (int)((channels[channel] * 127.0f / 255.0f - pbit) * 0.5f);
+            float bestError = FLT_MAX;
+            for (int candidate = guess; candidate <= guess + 1; candidate++)
+            {
+                unsigned int clamped = (unsigned int)((candidate < 0) ? 0 : ((candidate > 63) ? 63 : candidate));
+                float error = fabsf((float)ExpandMode1(clamped, pbit) - channels[channel]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    values[channel] = clamped;
+                }
+            }
+        }
+    }
+
+    void BuildMode1Palette(const Mode1Subset& subset, Math::Vector palette[8])
+    {
+        int expanded[2][4];
+        for (unsigned int endpoint = 0; endpoint < 2; endpoint++)
+        {
+            for (unsigned int channel = 0; channel < 3; channel++)
+                expanded[endpoint][channel] = (int)ExpandMode1(subset.Values[endpoint][channel], subset.PBit);
+            expanded[endpoint][3] = 255;
+        }
+
+        for (unsigned int i = 0; i < 8; i++)
+            palette[i] = InterpolateBc7(expanded[0], expanded[1], kWeights3[i]);
+    }
+
+    float QuantizeAndEvaluateMode1(const SourceBlock& block, const TexelSet& set, Math::Vector low, Math::Vector high,
+                                   Mode1Subset& subset, unsigned char* indices)
+    {
+        float bestError = FLT_MAX;
+        for (unsigned int pbit = 0; pbit < 2; pbit++)
+        {
+            Mode1Subset trial;
+            trial.PBit = pbit;
+            QuantizeMode1(low, pbit, trial.Values[0]);
+            QuantizeMode1(high, pbit, trial.Values[1]);
+
+            Math::Vector palette[8];
+            BuildMode1Palette(trial, palette);
+
+            unsigned char trialIndices[kBlockTexels];
+            float error = SelectIndices(block.Texels, set, palette, 8, Math::VectorSet(1.0f, 1.0f, 1.0f, 0.0f), trialIndices);
+            if (error < bestError)
+            {
+                bestError = error;
+                subset = trial;
+                for (unsigned int i = 0; i < set.Count; i++)
+                    indices[set.Members[i]] = trialIndices[set.Members[i]];
+            }
+        }
+        return bestError;
+    }
+
+    float EncodeMode1Subset(const SourceBlock& block, const TexelSet& set, BlockQuality quality, Mode1Subset& subset, unsigned char* indices)
+    {
+        Math::Vector low;
+        Math::Vector high;
+        FitLine(block.Texels, set, Math::VectorSet(1.0f, 1.0f, 1.0f, 0.0f), low, high);
+        float error = QuantizeAndEvaluateMode1(block, set, low, high, subset, indices);
+
+        for (unsigned int pass = 0; (pass < kRefinePasses[quality]) && (error > 0.0f); pass++)
+        {
+            if (!SolveEndpoints(block.Texels, set, indices, kWeights3Float, low, high))
+                break;
+
+            Mode1Subset trial;
+            unsigned char trialIndices[kBlockTexels];
+            float trialError = QuantizeAndEvaluateMode1(block, set, low, high, trial, trialIndices);
+            if (trialError >= error)
+                break;
+
+            error = trialError;
+            subset = trial;
+            for (unsigned int i = 0; i < set.Count; i++)
+                indices[set.Members[i]] = trialIndices[set.Members[i]];
+        }
+
+        return error;
+    }
+
+    // Only for opaque blocks - mode 1 has no alpha
+    float EncodeMode1(const SourceBlock& block, BlockQuality quality, unsigned int& partition, Mode1Subset subsets[2], unsigned char* indices)
+    {
+        // Rank the partitions by how close their texels are to a line a subset, and only
+        // encode the best few properly
+        struct Candidate
+        {
+            float           Estimate;
+            unsigned int    Partition;
+
+            bool operator<(const Candidate& other) const { return Estimate < other.Estimate; }
+        };
+
+        Candidate candidates[64];
+        for (unsigned int i = 0; i < 64; i++)
+        {
+            TexelSet sets[2];
+            SplitPartition(i, sets);
+
+            Math::Vector low;
+            Math::Vector high;
+            candidates[i].Partition = i;
+            candidates[i].Estimate = FitLine(block.Texels, sets[0], Math::VectorSet(1.0f, 1.0f, 1.0f, 0.0f), low, high)
+                                   + FitLine(block.Texels, sets[1], Math::VectorSet(1.0f, 1.0f, 1.0f, 0.0f), low, high);
+        }
+
+        unsigned int candidateCount = kPartitionCandidates[quality];
+        std::partial_sort(candidates, candidates + candidateCount, candidates + 64);
+
+        float bestError = FLT_MAX;
+        for (unsigned int i = 0; i < candidateCount; i++)
+        {
+            TexelSet sets[2];
+            SplitPartition(candidates[i].Partition, sets);
+
+            Mode1Subset trial[2];
+            unsigned char trialIndices[kBlockTexels];
+            float error = EncodeMode1Subset(block, sets[0], quality, trial[0], trialIndices);
+            if (error < bestError)
+                error += EncodeMode1Subset(block, sets[1], quality, trial[1], trialIndices);
+
+            if (error < bestError)
+            {
+                bestError = error;
+                partition = candidates[i].Partition;
+                subsets[0] = trial[0];
+                subsets[1] = trial[1];
+                memcpy(indices, trialIndices, kBlockTexels);
+            }
+        }
+
+        return bestError;
+    }
+
+    void WriteMode1(unsigned int partition, Mode1Subset subsets[2], unsigned char* indices, unsigned char* output, unsigned char* decoded)
+    {
+        TexelSet sets[2];
+        SplitPartition(partition, sets);
+
+        // Each subset's anchor texel loses the top bit of its index
+        const unsigned int anchors[2] = { 0, kAnchors2[partition] };
+        for (unsigned int subset = 0; subset < 2; subset++)
+        {
+            if (indices[anchors[subset]] & 4)
+            {
+                std::swap(subsets[subset].Values[0], subsets[subset].Values[1]);
+                for (unsigned int i = 0; i < sets[subset].Count; i++)
+                    indices[sets[subset].Members[i]] = (unsigned char)(7 - indices[sets[subset].Members[i]]);
+            }
+        }
+
+        BitWriter bits(output);
+        bits.Write(1 << 1, 2);
+        bits.Write(partition, 6);
+        for (unsigned int channel = 0; channel < 3; channel++)
+        {
+            for (unsigned int subset = 0; subset < 2; subset++)
+            {
+                bits.Write(subsets[subset].Values[0][channel], 6);
+                bits.Write(subsets[subset].Values[1][channel], 6);
+            }
+        }
+        bits.Write(subsets[0].PBit, 1);
+        bits.Write(subsets[1].PBit, 1);
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+            bits.Write(indices[i], ((i == anchors[0]) || (i == anchors[1])) ? 2 : 3);
+
+        Math::Vector palettes[2][8];
+        BuildMode1Palette(subsets[0], palettes[0]);
+        BuildMode1Palette(subsets[1], palettes[1]);
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+            StoreTexel(palettes[(kPartitions2[partition] >> i) & 1][indices[i]], decoded + i * 4);
+    }
+
+    // Modes 4 and 5 keep colour and alpha apart - a block whose alpha doesn't follow its
+    // colour can't be put on one line through RGBA, which is all mode 6 has. Mode 5 has the
+    // finer endpoints, mode 4 the finer alpha steps. Always rotation 0, so alpha stays alpha,
+    // and mode 4's 3 bit indices always go to alpha.
+    struct SeparateAlphaMode
+    {
+        unsigned int    Mode;
+        unsigned int    ColorBits;
+        unsigned int    AlphaBits;
+        unsigned int    AlphaIndexBits;
+    };
+
+    const SeparateAlphaMode kMode4 = { 4, 5, 6, 3 };
+    const SeparateAlphaMode kMode5 = { 5, 7, 8, 2 };
+
+    struct SeparateAlphaEndpoints
+    {
+        unsigned int    Colors[2][3];
+        unsigned int    Alphas[2];
+    };
+
+    unsigned int ExpandBits(unsigned int value, unsigned int bits)
+    {
+        return (bits == 8) ? value : ((value << (8 - bits)) | (value >> (bits * 2 - 8)));
+    }
+
+    // As with mode 1, the expansion isn't linear, so take the closer of the two either side
+    unsigned int QuantizeBits(float channel, unsigned int bits)
+    {
+        unsigned int maximum = (1 << bits) - 1;
+        int guess = (int)(channel * maximum / 255.0f);
+        unsigned int best = 0;
+        float bestError = FLT_MAX;
+        for (int candidate = guess; candidate <= guess + 1; candidate++)
+        {
+            unsigned int clamped = (unsigned int)((candidate < 0) ? 0 : (((unsigned int)candidate > maximum) ? maximum : candidate));
+            float error = fabsf((float)ExpandBits(clamped, bits) - channel);
+            if (error < bestError)
+            {
+                bestError = error;
+                best = clamped;
+            }
+        }
+        return best;
+    }
+
+    void QuantizeSeparateColor(const SeparateAlphaMode& mode, Math::Vector endpoint, unsigned int values[3])
+    {
+        Math::Vec4 value;
+        Math::VectorStore4(&value, endpoint);
+        values[0] = QuantizeBits(value.x, mode.ColorBits);
+        values[1] = QuantizeBits(value.y, mode.ColorBits);
+        values[2] = QuantizeBits(value.z, mode.ColorBits);
+    }
+
+    // Colour in the palettes' RGB and alpha in their W
+    void BuildSeparateAlphaPalettes(const SeparateAlphaMode& mode, const SeparateAlphaEndpoints& endpoints,
+                                    Math::Vector colors[4], Math::Vector alphas[8])
+    {
+        int expanded[2][4];
+        for (unsigned int endpoint = 0; endpoint < 2; endpoint++)
+        {
+            for (unsigned int channel = 0; channel < 3; channel++)
+                expanded[endpoint][channel] = (int)ExpandBits(endpoints.Colors[endpoint][channel], mode.ColorBits);
+            expanded[endpoint][3] = (int)ExpandBits(endpoints.Alphas[endpoint], mode.AlphaBits);
+        }
+
+        for (unsigned int i = 0; i < 4; i++)
+            colors[i] = InterpolateBc7(expanded[0], expanded[1], kWeights2[i]);
+        for (unsigned int i = 0; i < (1u << mode.AlphaIndexBits); i++)
+            alphas[i] = InterpolateBc7(expanded[0], expanded[1], (mode.AlphaIndexBits == 3) ? kWeights3[i] : kWeights2[i]);
+    }
+
+    float EvaluateSeparateAlpha(const SourceBlock& block, const SeparateAlphaMode& mode, const SeparateAlphaEndpoints& endpoints,
+                                unsigned char* colorIndices, unsigned char* alphaIndices)
+    {
+        Math::Vector colors[4];
+        Math::Vector alphas[8];
+        BuildSeparateAlphaPalettes(mode, endpoints, colors, alphas);
+
+        TexelSet all = AllTexels();
+        return SelectIndices(block.Texels, all, colors, 4, Math::VectorSet(1.0f, 1.0f, 1.0f, 0.0f), colorIndices)
+             + SelectIndices(block.Texels, all, alphas, 1 << mode.AlphaIndexBits, Math::VectorSet(0.0f, 0.0f, 0.0f, 1.0f), alphaIndices);
+    }
+
+    // Only for blocks with alpha - opaque ones do better with mode 6's finer indices
+    float EncodeSeparateAlpha(const SourceBlock& block, const SeparateAlphaMode& mode, BlockQuality quality,
+                              SeparateAlphaEndpoints& endpoints, unsigned char* colorIndices, unsigned char* alphaIndices)
+    {
+        TexelSet all = AllTexels();
+        Math::Vector low;
+        Math::Vector high;
+        FitLine(block.Texels, all, Math::VectorSet(1.0f, 1.0f, 1.0f, 0.0f), low, high);
+        QuantizeSeparateColor(mode, low, endpoints.Colors[0]);
+        QuantizeSeparateColor(mode, high, endpoints.Colors[1]);
+
+        unsigned int minimum = 255;
+        unsigned int maximum = 0;
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+        {
+            minimum = std::min(minimum, (unsigned int)block.Rgba[i * 4 + 3]);
+            maximum = std::max(maximum, (unsigned int)block.Rgba[i * 4 + 3]);
+        }
+        endpoints.Alphas[0] = QuantizeBits((float)minimum, mode.AlphaBits);
+        endpoints.Alphas[1] = QuantizeBits((float)maximum, mode.AlphaBits);
+
+        float error = EvaluateSeparateAlpha(block, mode, endpoints, colorIndices, alphaIndices);
+
+        // Colour and alpha are refined on their own indices
+        const float* alphaWeights = (mode.AlphaIndexBits == 3) ? kWeights3Float : kWeights2Float;
+        for (unsigned int pass = 0; (pass < kRefinePasses[quality]) && (error > 0.0f); pass++)
+        {
+            SeparateAlphaEndpoints trial = endpoints;
+            bool solved = false;
+            if (SolveEndpoints(block.Texels, all, colorIndices, kWeights2Float, low, high))
+            {
+                QuantizeSeparateColor(mode, low, trial.Colors[0]);
+                QuantizeSeparateColor(mode, high, trial.Colors[1]);
+                solved = true;
+            }
+
+            Math::Vector alphaLow;
+            Math::Vector alphaHigh;
+            if (SolveEndpoints(block.Texels, all, alphaIndices, alphaWeights, alphaLow, alphaHigh))
+            {
+                trial.Alphas[0] = QuantizeBits(Math::VectorGetW(alphaLow), mode.AlphaBits);
+                trial.Alphas[1] = QuantizeBits(Math::VectorGetW(alphaHigh), mode.AlphaBits);
+                solved = true;
+            }
+
+            if (!solved)
+                break;
+
+            unsigned char trialColors[kBlockTexels];
+            unsigned char trialAlphas[kBlockTexels];
+            float trialError = EvaluateSeparateAlpha(block, mode, trial, trialColors, trialAlphas);
+            if (trialError >= error)
+                break;
+
+            error = trialError;
+            endpoints = trial;
+            memcpy(colorIndices, trialColors, kBlockTexels);
+            memcpy(alphaIndices, trialAlphas, kBlockTexels);
+        }
+
+        return error;
+    }
+
+    void WriteSeparateAlpha(const SeparateAlphaMode& mode, SeparateAlphaEndpoints endpoints, unsigned char* colorIndices,
+                            unsigned char* alphaIndices, unsigned char* output, unsigned char* decoded)
+    {
+        // The first texel's indices lose their top bit - colour and alpha flip separately
+        if (colorIndices[0] & 2)
+        {
+            std::swap(endpoints.Colors[0], endpoints.Colors[1]);
+            for (unsigned int i = 0; i < kBlockTexels; i++)
+                colorIndices[i] = (unsigned char)(3 - colorIndices[i]);
+        }
+
+        unsigned int alphaTop = (1 << mode.AlphaIndexBits) - 1;
+        if (alphaIndices[0] & (1 << (mode.AlphaIndexBits - 1)))
+        {
+            std::swap(endpoints.Alphas[0], endpoints.Alphas[1]);
+            for (unsigned int i = 0; i < kBlockTexels; i++)
+                alphaIndices[i] = (unsigned char)(alphaTop - alphaIndices[i]);
+        }
+
+        BitWriter bits(output);
+        bits.Write(1 << mode.Mode, mode.Mode + 1);
+        bits.Write(0, 2);                   // rotation
+        if (mode.Mode == 4)
+            bits.Write(0, 1);               // the 2 bit indices are colour's
+        for (unsigned int channel = 0; channel < 3; channel++)
+        {
+            bits.Write(endpoints.Colors[0][channel], mode.ColorBits);
+            bits.Write(endpoints.Colors[1][channel], mode.ColorBits);
+        }
+        bits.Write(endpoints.Alphas[0], mode.AlphaBits);
+        bits.Write(endpoints.Alphas[1], mode.AlphaBits);
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+            bits.Write(colorIndices[i], (i == 0) ? 1 : 2);
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+            bits.Write(alphaIndices[i], (i == 0) ? mode.AlphaIndexBits - 1 : mode.AlphaIndexBits);
+
+        Math::Vector colors[4];
+        Math::Vector alphas[8];
+        BuildSeparateAlphaPalettes(mode, endpoints, colors, alphas);
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+        {
+            StoreTexel(colors[colorIndices[i]], decoded + i * 4);
+            decoded[i * 4 + 3] = (unsigned char)Math::VectorGetW(alphas[alphaIndices[i]]);
+        }
+    }
+
+    // ==================================================================================
+    // Whole blocks
+    // ==================================================================================
+    void EncodeBc1(const SourceBlock& block, BlockQuality quality, unsigned char* output, unsigned char* decoded)
+    {
+        EncodeBc1Color(block, quality, output, decoded);
+    }
+
+    void EncodeBc3(const SourceBlock& block, BlockQuality quality, unsigned char* output, unsigned char* decoded)
+    {
+        EncodeBc1Color(block, quality, output + 8, decoded);
+        EncodeBc4(block.Rgba + 3, 4, quality, output, decoded + 3);
+    }
+
+    void EncodeBc5(const SourceBlock& block, BlockQuality quality, unsigned char* output, unsigned char* decoded)
+    {
+        EncodeBc4(block.Rgba + 0, 4, quality, output, decoded + 0);
+        EncodeBc4(block.Rgba + 1, 4, quality, output + 8, decoded + 1);
+        for (unsigned int i = 0; i < kBlockTexels; i++)
+        {
+            decoded[i * 4 + 2] = 0;
+            decoded[i * 4 + 3] = 255;
+        }
+    }
+
+    void EncodeBc7(const SourceBlock& block, BlockQuality quality, unsigned char* output, unsigned char* decoded)
+    {
+        Mode6Endpoints endpoints;
+        unsigned char indices[kBlockTexels];
+        float error = EncodeMode6(block, quality, endpoints, indices);
+
+        if ((kPartitionCandidates[quality] > 0) && block.Opaque && (error > 0.0f))
+        {
+            unsigned int partition = 0;
+            Mode1Subset subsets[2];
+            unsigned char subsetIndices[kBlockTexels];
+            if (EncodeMode1(block, quality, partition, subsets, subsetIndices) < error)
+            {
+                WriteMode1(partition, subsets, subsetIndices, output, decoded);
+                return;
+            }
+        }
+
+        if ((quality != BQ_Fast) && !block.Opaque && (error > 0.0f))
+        {
+            const SeparateAlphaMode* modes[2] = { &kMode5, &kMode4 };
+            const SeparateAlphaMode* best = nullptr;
+            SeparateAlphaEndpoints bestEndpoints;
+            unsigned char bestColors[kBlockTexels];
+            unsigned char bestAlphas[kBlockTexels];
+            for (unsigned int index = 0; index < 2; index++)
+            {
+                SeparateAlphaEndpoints separate;
+                unsigned char colorIndices[kBlockTexels];
+                unsigned char alphaIndices[kBlockTexels];
+                float separateError = EncodeSeparateAlpha(block, *modes[index], quality, separate, colorIndices, alphaIndices);
+                if (separateError < error)
+                {
+                    error = separateError;
+                    best = modes[index];
+                    bestEndpoints = separate;
+                    memcpy(bestColors, colorIndices, kBlockTexels);
+                    memcpy(bestAlphas, alphaIndices, kBlockTexels);
+                }
+            }
+
+            if (best != nullptr)
+            {
+                WriteSeparateAlpha(*best, bestEndpoints, bestColors, bestAlphas, output, decoded);
+                return;
+            }
+        }
+
+        WriteMode6(endpoints, indices, output, decoded);
+    }
+
+    typedef void (*BlockEncoder)(const SourceBlock& block, BlockQuality quality, unsigned char* output, unsigned char* decoded);
+
+    // Edge texels stand in for the ones past the edge of levels smaller than a block
+    void LoadBlock(const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height,
+                   unsigned int x, unsigned int y, SourceBlock& block)
+    {
+        block.Opaque = true;
+        for (unsigned int row = 0; row < 4; row++)
+        {
+            const unsigned char* source = pixels + (size_t)std::min(y + row, height - 1) * rowPitch;
+            for (unsigned int column = 0; column < 4; column++)
+            {
+                const unsigned char* texel = source + std::min(x + column, width - 1) * 4;
+                unsigned int i = row * 4 + column;
+                memcpy(block.Rgba + i * 4, texel, 4);
+                block.Texels[i] = Math::VectorSet((float)texel[0], (float)texel[1], (float)texel[2], (float)texel[3]);
+                block.Opaque = block.Opaque && (texel[3] == 255);
+            }
+        }
+    }
+
+    // Over the texels inside the level and the first channelCount channels
+    double MeasureBlock(const SourceBlock& block, const unsigned char* decoded, unsigned int columns, unsigned int rows, unsigned int channelCount)
+    {
+        double total = 0.0;
+        for (unsigned int row = 0; row < rows; row++)
+        {
+            for (unsigned int column = 0; column < columns; column++)
+            {
+                unsigned int i = (row * 4 + column) * 4;
+                for (unsigned int channel = 0; channel < channelCount; channel++)
+                {
+                    double difference = (double)block.Rgba[i + channel] - (double)decoded[i + channel];
+                    total += difference * difference;
+                }
+            }
+        }
+        return total;
+    }
+
+    // One row of blocks in one mip
+    struct BlockRow
+    {
+        unsigned int    Mip;
+        unsigned int    Row;
+    };
+}
+
+bool CanBlockCompress(unsigned int width, unsigned int height)
+{
+    return (width > 0) && (height > 0) && ((width & 3) == 0) && ((height & 3) == 0);
+}
+
+bool CompressTexture(const TextureData& source, const CompressionSettings& settings, JobSystem* jobs,
+                     TextureData& dest, double* psnr)
+{
+    bool srgb = (source.GetFormat() == TF_RGBA8_SRGB);
+    if (((source.GetFormat() != TF_RGBA8) && !srgb) || !CanBlockCompress(source.GetWidth(), source.GetHeight()))
+        return false;
+
+    TextureFormat format = TF_Unknown;
+    BlockEncoder encoder = nullptr;
+    unsigned int channelCount = 4;
+    switch (settings.Format)
+    {
+    case BF_BC1:    format = srgb ? TF_BC1_SRGB : TF_BC1;   encoder = &EncodeBc1;   channelCount = 3;   break;
+    case BF_BC3:    format = srgb ? TF_BC3_SRGB : TF_BC3;   encoder = &EncodeBc3;                       break;
+    case BF_BC5:    format = TF_BC5;                        encoder = &EncodeBc5;   channelCount = 2;   break;
+    case BF_BC7:    format = srgb ? TF_BC7_SRGB : TF_BC7;   encoder = &EncodeBc7;                       break;
+    default:
+        return false;
+    }
+
+    if (!dest.Allocate(format, source.GetWidth(), source.GetHeight(), source.GetMipCount()))
+        return false;
+
+    std::vector<BlockRow> rows;
+    unsigned long long sampleCount = 0;
+    for (unsigned int mip = 0; mip < dest.GetMipCount(); mip++)
+    {
+        for (unsigned int row = 0; row < dest.GetMip(mip).RowCount; row++)
+            rows.push_back({ mip, row });
+        sampleCount += (unsigned long long)source.GetMip(mip).Width * source.GetMip(mip).Height * channelCount;
+    }
+
+    // A total a row, added up in order afterwards, so the result doesn't depend on the threads
+    std::vector<double> errors(rows.size(), 0.0);
+    BlockQuality quality = settings.Quality;
+
+    auto compressRow = [&](unsigned int index)
+    {
+        const BlockRow& blockRow = rows[index];
+        const TextureMip& sourceMip = source.GetMip(blockRow.Mip);
+        const TextureMip& destMip = dest.GetMip(blockRow.Mip);
+        const unsigned char* pixels = source.GetMipData(blockRow.Mip);
+        unsigned char* output = dest.GetMipData(blockRow.Mip) + (size_t)blockRow.Row * destMip.RowPitch;
+
+        unsigned int y = blockRow.Row * 4;
+        unsigned int rowsInside = std::min(4u, sourceMip.Height - y);
+
+        double error = 0.0;
+        SourceBlock block;
+        unsigned char decoded[kBlockTexels * 4];
+        for (unsigned int x = 0; x < sourceMip.Width; x += 4, output += GetTextureFormatInfo(format).BytesPerBlock)
+        {
+            LoadBlock(pixels, sourceMip.RowPitch, sourceMip.Width, sourceMip.Height, x, y, block);
+            encoder(block, quality, output, decoded);
+            error += MeasureBlock(block, decoded, std::min(4u, sourceMip.Width - x), rowsInside, channelCount);
+        }
+        errors[index] = error;
+    };
+
+    if ((jobs != nullptr) && (rows.size() > 1))
+    {
+        JobCounter counter;
+        jobs->ParallelFor((unsigned int)rows.size(), compressRow, &counter, 1);
+        jobs->Wait(&counter);
+    }
+    else
+    {
+        for (unsigned int index = 0; index < rows.size(); index++)
+            compressRow(index);
+    }
+
+    if (psnr != nullptr)
+    {
+        double total = 0.0;
+        for (double error : errors)
+            total += error;
+
+        double meanSquared = total / (double)sampleCount;
+        *psnr = (meanSquared > 0.0) ? std::min(10.0 * log10(255.0 * 255.0 / meanSquared), kLosslessPsnr) : kLosslessPsnr;
+    }
+
+    return true;
+}
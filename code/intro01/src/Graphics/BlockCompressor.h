@@ -0,0 +1,58 @@
+///
+/// BlockCompressor.h - Encodes textures to the BC formats the GPU samples as they are.
+/// BC1 stores a 4x4 block in 8 bytes and BC3, BC5 and BC7 in 16, against 64 for RGBA8, so
+/// a compressed texture takes a quarter to an eighth of the memory and of the bandwidth
+/// to sample it. Each block is two endpoint colours and an index per texel into the
+/// colours between them - the encoder fits the line through the block's texels, snaps the
+/// endpoints to what the format can store, and refines them against the indices they give.
+///
+/// Texels are worked on a whole RGBA texel per Math::Vector, and rows of blocks are spread
+/// over the job system. BC7 has quality levels, since its search is where the time goes:
+///
+///     CompressionSettings settings;
+///     settings.Format = BF_BC7;
+///     settings.Quality = BQ_Normal;
+///     double psnr = 0.0;
+///     CompressTexture(texture, settings, &jobs, compressed, &psnr);
+///
+#pragma once
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class JobSystem;
+class TextureData;
+
+enum BlockFormat
+{
+    BF_None = 0,
+    BF_BC1,                 // opaque colour - alpha is dropped
+    BF_BC3,                 // colour as BC1, plus alpha
+    BF_BC5,                 // red and green only, each as good as BC3's alpha - for normal maps
+    BF_BC7,                 // colour and alpha in BC3's size - better colour, alpha about as good, slower to encode
+};
+
+enum BlockQuality
+{
+    BQ_Fast = 0,            // one fit a block - for iterating on content, though BC7 alpha suffers
+    BQ_Normal,              // BC7 also tries the likeliest two-subset partitions, and separate alpha
+    BQ_High,                // more partitions, more refinement and an endpoint search
+};
+
+struct CompressionSettings
+{
+    CompressionSettings() : Format(BF_None), Quality(BQ_Normal) {}
+
+    BlockFormat     Format;
+    BlockQuality    Quality;
+};
+
+// D3D11 wants the top level of a block compressed texture to be whole blocks
+bool CanBlockCompress(unsigned int width, unsigned int height);
+
+// source is RGBA8 or RGBA8_SRGB, any number of mips. dest gets every mip in the BC format,
+// sRGB if the source was (but BC5, which is never colour). psnr, if it's wanted, is over
+// every texel of every mip and the channels the format keeps - 100 for a lossless result.
+// False if the source isn't RGBA8 or can't be block compressed.
+bool CompressTexture(const TextureData& source, const CompressionSettings& settings, JobSystem* jobs,
+                     TextureData& dest, double* psnr);
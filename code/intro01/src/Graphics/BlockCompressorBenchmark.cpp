@@ -0,0 +1,97 @@
+///
+/// BlockCompressorBenchmark.cpp - Times the block compressor on a synthetic texture.
+///
+
+#include "BlockCompressorBenchmark.h"
+#include "BlockCompressor.h"
+#include "MipGenerator.h"
+#include "TextureData.h"
+
+#include "utils\JobSystem.h"
+
+#include <chrono>
+#include <math.h>
+
+typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+const unsigned int kTextureSize = 512;
+
+static unsigned char ClampByte(float value)
+{
+    return (unsigned char)((value < 0.0f) ? 0.0f : ((value > 255.0f) ? 255.0f : value));
+}
+
+// Something of everything the encoder has to cope with - a block of flat colour, a
+// gradient, a hard edge, noise - so no one format looks better than it is
+static void BuildTexture(std::vector<unsigned char>& rgba)
+{
+    rgba.resize(kTextureSize * kTextureSize * 4);
+
+    unsigned int seed = 12345;
+    for (unsigned int y = 0; y < kTextureSize; y++)
+    {
+        for (unsigned int x = 0; x < kTextureSize; x++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            float noise = (float)(seed >> 24) / 16.0f - 8.0f;
+
+            float u = (float)x / kTextureSize;
+            float v = (float)y / kTextureSize;
+            bool checker = (((x / 24) + (y / 24)) & 1) != 0;
+
+            unsigned char* texel = &rgba[(y * kTextureSize + x) * 4];
+            texel[0] = ClampByte(127.5f + 127.5f * sinf(u * 17.0f + v * 5.0f) + ((u > 0.5f) ? noise : 0.0f));
+            texel[1] = ClampByte(v * 255.0f);
+            texel[2] = checker ? 210 : 40;
+            texel[3] = ClampByte((v < 0.5f) ? 255.0f : u * 255.0f);
+        }
+    }
+}
+
+void RunBlockCompressorBenchmarks(unsigned int threadCount, std::vector<BlockCompressorBenchmarkResult>& results)
+{
+    static const char* const kFormatNames[] = { "none", "bc1", "bc3", "bc5", "bc7" };
+    static const char* const kQualityNames[] = { "fast", "normal", "high" };
+
+    std::vector<unsigned char> rgba;
+    BuildTexture(rgba);
+
+    JobSystem jobs;
+    jobs.Initialize(threadCount);
+
+    MipSettings mipSettings;
+    mipSettings.Srgb = false;
+    TextureData source;
+    GenerateMips(rgba.data(), kTextureSize, kTextureSize, kTextureSize * 4, mipSettings, &jobs, source);
+
+    double megatexels = 0.0;
+    for (unsigned int mip = 0; mip < source.GetMipCount(); mip++)
+        megatexels += (double)source.GetMip(mip).Width * source.GetMip(mip).Height / 1000000.0;
+
+    for (unsigned int format = BF_BC1; format <= BF_BC7; format++)
+    {
+        for (unsigned int quality = BQ_Fast; quality <= BQ_High; quality++)
+        {
+            CompressionSettings settings;
+            settings.Format = (BlockFormat)format;
+            settings.Quality = (BlockQuality)quality;
+
+            BlockCompressorBenchmarkResult result;
+            result.Format = kFormatNames[format];
+            result.Quality = kQualityNames[quality];
+            result.ThreadCount = jobs.GetThreadCount();
+            result.Psnr = 0.0;
+
+            TextureData compressed;
+            BenchmarkClock::time_point start = BenchmarkClock::now();
+            CompressTexture(source, settings, &jobs, compressed, &result.Psnr);
+            double seconds = std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+
+            result.Milliseconds = seconds * 1000.0;
+            result.MegatexelsPerSecond = megatexels / seconds;
+            results.push_back(result);
+        }
+    }
+
+    jobs.Shutdown();
+}
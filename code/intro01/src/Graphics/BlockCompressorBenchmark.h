@@ -0,0 +1,23 @@
+///
+/// BlockCompressorBenchmark.h - Times the block compressor on a synthetic texture.
+/// Builds a texture with smooth gradients, noise, hard edges and an alpha ramp, then
+/// compresses it in every format at every quality on the job system, checking the speed
+/// and the PSNR together. The benchmark runner reports the results; nothing here prints.
+///
+#pragma once
+
+#include <vector>
+
+struct BlockCompressorBenchmarkResult
+{
+    const char*     Format;
+    const char*     Quality;
+    unsigned int    ThreadCount;
+
+    double          Milliseconds;           // the whole mip chain
+    double          MegatexelsPerSecond;
+    double          Psnr;
+};
+
+// threadCount of zero uses every hardware thread
+void RunBlockCompressorBenchmarks(unsigned int threadCount, std::vector<BlockCompressorBenchmarkResult>& results);
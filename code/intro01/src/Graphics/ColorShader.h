@@ -1,29 +1,47 @@
 #pragma once
 
+#include "ConstantBlock.h"
+
 // ======================================================================================
 // Forward Declarations - so the header file doesn't have to #include anything
 // ======================================================================================
 class ShaderResource;
+class ShaderLayoutCache;
+
+// basicPS.hlsl's variant bits, in the order it lists its @keywords
+enum BasicPixelShaderVariant
+{
+    BPS_DiffuseTexture  = 1 << 0,
+    BPS_Lighting        = 1 << 1,
+
+    BPS_Default         = BPS_DiffuseTexture | BPS_Lighting,
+};
 
 class ColorShader
 {
-private:
-    struct MatrixBufferType
+public:
+    enum Matrix
     {
-        DirectX::XMMATRIX world;
-        DirectX::XMMATRIX view;
-        DirectX::XMMATRIX projection;
+        Projection = 0,
+        View,
+        World,
+        NumMatrices
     };
 
 public:
     ColorShader();
     ~ColorShader();
 
-    bool InitShader(ID3D11Device* _device, HWND _hwnd, ShaderResource* _vertexShader, ShaderResource* _pixelShader);
+    // The input layout and constant blocks come from the layout cache, built from the shaders'
+    // reflection
+    bool InitShader(ID3D11Device* _device, HWND _hwnd, ShaderLayoutCache* _layouts, ShaderResource* _vertexShader, ShaderResource* _pixelShader);
     void Shutdown();
 
     bool Render(ID3D11DeviceContext* _context, DirectX::XMMATRIX& _worldMatrix, DirectX::XMMATRIX& _viewMatrix, DirectX::XMMATRIX& _projectionMatrix);
 
+    // Constant upload counters for the last Render
+    const ConstantBlockSet::Stats& GetConstantStats() const { return m_constants->GetFrameStats(); }
+
 private:
     void ShutdownShader();
     void OutputShaderErrorMessage(ID3D10Blob*, HWND, WCHAR*);
@@ -35,6 +53,8 @@ private:
     ID3D11VertexShader*  m_vertexShader;
     ID3D11PixelShader*   m_pixelShader;
     ID3D11InputLayout*   m_layout;
-    ID3D11Buffer*        m_matrixBuffer;
+    ConstantBlockSet*    m_constants;
+    unsigned int         m_matrixBlock[NumMatrices];
+    unsigned int         m_matrixField[NumMatrices];
 };
 
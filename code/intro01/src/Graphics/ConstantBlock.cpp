@@ -0,0 +1,374 @@
+///
+/// ConstantBlock.cpp - Layout, dirty tracking and coalesced uploading of constant buffer blocks.
+///
+
+#include "stdafx.h"
+#include "d3d11_1.h"
+#include "DirectXMath.h"
+
+#include "ConstantBlock.h"
+#include "ShaderReflection.h"
+
+#include "utils\assert.h"
+#include "utils\utils.h"
+
+#include <string.h>
+
+// Blocks that share the one buffer have to start on a 16 constant (256 byte) boundary to be bound by offset
+const unsigned int kBlockAlignment = 256;
+
+// HLSL packing rules - nothing may straddle a 16 byte register
+const unsigned int kRegisterSize = 16;
+
+static unsigned int AlignUp(unsigned int value, unsigned int alignment)
+{
+    return (value + (alignment - 1)) & ~(alignment - 1);
+}
+
+ConstantBlockSet::ConstantBlockSet()
+    : mContext1(nullptr),
+      mBuffer(nullptr)
+{
+    memset(&mPendingStats, 0, sizeof(Stats));
+    memset(&mFrameStats, 0, sizeof(Stats));
+    memset(&mTotalStats, 0, sizeof(Stats));
+}
+
+ConstantBlockSet::~ConstantBlockSet()
+{
+    Shutdown();
+}
+
+unsigned int ConstantBlockSet::SizeOf(ConstantType type)
+{
+    switch (type)
+    {
+    case CT_Float:  return 4;
+    case CT_Float2: return 8;
+    case CT_Float3: return 12;
+    case CT_Float4: return 16;
+    case CT_Matrix: return 64;
+    default:
+        break;
+    }
+
+    ASSERTD(false, "ConstantBlockSet: unknown constant type");
+    return 0;
+}
+
+unsigned int ConstantBlockSet::AddBlock(const ConstantBlockDesc& desc)
+{
+    ASSERT(desc.Fields != nullptr);
+    ASSERT(desc.FieldCount != 0);
+    ASSERTD(mShadow.empty(), "ConstantBlockSet: blocks must be added before Initialize");
+
+    Block block;
+    block.Slot = desc.Slot;
+    block.FirstField = (unsigned int)mFields.size();
+    block.FieldCount = desc.FieldCount;
+    block.DirtyBegin = 0;
+    block.DirtyEnd = 0;
+    block.Buffer = nullptr;
+
+    // Lay the fields out the way the HLSL compiler will
+    unsigned int offset = 0;
+    for (unsigned int index = 0; index < desc.FieldCount; index++)
+    {
+        unsigned int size = SizeOf(desc.Fields[index].Type);
+        unsigned int registerStart = offset & ~(kRegisterSize - 1);
+
+        if ((size >= kRegisterSize) || (offset + size > registerStart + kRegisterSize))
+            offset = AlignUp(offset, kRegisterSize);
+
+        Field field;
+        field.Offset = offset;
+        field.Size = size;
+        mFields.push_back(field);
+
+        offset += size;
+    }
+
+    block.Size = AlignUp(offset, kRegisterSize);
+
+    for (unsigned int index = 0; index < desc.FieldCount; index++)
+        mFieldNames.push_back(desc.Fields[index].Name);
+
+    return PlaceBlock(block);
+}
+
+unsigned int ConstantBlockSet::AddBlock(const ShaderConstantBuffer& buffer)
+{
+    ASSERT(!buffer.Variables.empty());
+    ASSERTD(mShadow.empty(), "ConstantBlockSet: blocks must be added before Initialize");
+
+    Block block;
+    block.Slot = buffer.Slot;
+    block.FirstField = (unsigned int)mFields.size();
+    block.FieldCount = (unsigned int)buffer.Variables.size();
+    block.DirtyBegin = 0;
+    block.DirtyEnd = 0;
+    block.Buffer = nullptr;
+    block.Size = AlignUp(buffer.Size, kRegisterSize);
+
+    // The compiler has already done the packing
+    for (auto& variable : buffer.Variables)
+    {
+        ASSERT(variable.Offset + variable.Size <= block.Size);
+
+        Field field;
+        field.Offset = variable.Offset;
+        field.Size = variable.Size;
+        mFields.push_back(field);
+        mFieldNames.push_back(variable.Name);
+    }
+
+    return PlaceBlock(block);
+}
+
+unsigned int ConstantBlockSet::PlaceBlock(Block& block)
+{
+    // Place the block after the previous one
+    block.Offset = 0;
+    if (!mBlocks.empty())
+    {
+        const Block& previous = mBlocks.back();
+        block.Offset = AlignUp(previous.Offset + previous.Size, kBlockAlignment);
+    }
+
+    mBlocks.push_back(block);
+    return (unsigned int)mBlocks.size() - 1;
+}
+
+bool ConstantBlockSet::FindField(const char* name, unsigned int* block, unsigned int* field) const
+{
+    ASSERT(name != nullptr);
+    ASSERT(block != nullptr);
+    ASSERT(field != nullptr);
+
+    for (unsigned int index = 0; index < mBlocks.size(); index++)
+    {
+        const Block& candidate = mBlocks[index];
+        for (unsigned int fieldIndex = 0; fieldIndex < candidate.FieldCount; fieldIndex++)
+        {
+            if (mFieldNames[candidate.FirstField + fieldIndex] == name)
+            {
+                *block = index;
+                *field = fieldIndex;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ConstantBlockSet::Initialize(ID3D11Device* device)
+{
+    ASSERT(device != nullptr);
+    ASSERT(!mBlocks.empty());
+
+    const Block& last = mBlocks.back();
+    mShadow.resize(AlignUp(last.Offset + last.Size, kBlockAlignment), 0);
+
+    // Everything starts dirty so the first Commit uploads the initial contents
+    for (auto& block : mBlocks)
+    {
+        block.DirtyBegin = 0;
+        block.DirtyEnd = block.Size;
+    }
+
+    // The single buffer path needs D3D11.1 - offset binding, and partial updates of constant buffers
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+    ZeroMemory(&options, sizeof(options));
+    bool singleBuffer = SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))
+                        && options.ConstantBufferOffsetting
+                        && options.ConstantBufferPartialUpdate;
+
+    if (singleBuffer)
+    {
+        ID3D11DeviceContext* context = nullptr;
+        device->GetImmediateContext(&context);
+        HRESULT hr = context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&mContext1);
+        SafeRelease(context);
+
+        singleBuffer = SUCCEEDED(hr);
+    }
+
+    D3D11_BUFFER_DESC bufferDesc;
+    ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+    bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bufferDesc.CPUAccessFlags = 0;
+    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+
+    if (singleBuffer)
+    {
+        bufferDesc.ByteWidth = (UINT)mShadow.size();
+        return SUCCEEDED(device->CreateBuffer(&bufferDesc, nullptr, &mBuffer));
+    }
+
+    // Fall back to a buffer per block - still only dirty blocks get uploaded
+    for (auto& block : mBlocks)
+    {
+        bufferDesc.ByteWidth = block.Size;
+        if (FAILED(device->CreateBuffer(&bufferDesc, nullptr, &block.Buffer)))
+            return false;
+    }
+
+    return true;
+}
+
+void ConstantBlockSet::Shutdown()
+{
+    for (auto& block : mBlocks)
+        SafeRelease(block.Buffer);
+
+    SafeRelease(mBuffer);
+    SafeRelease(mContext1);
+}
+
+bool ConstantBlockSet::SetField(unsigned int block, unsigned int field, const void* data, unsigned int size)
+{
+    ASSERT(block < mBlocks.size());
+    ASSERT(data != nullptr);
+
+    Block& target = mBlocks[block];
+    ASSERT(field < target.FieldCount);
+
+    const Field& targetField = mFields[target.FirstField + field];
+    ASSERT(size == targetField.Size);
+
+    mPendingStats.FieldWrites++;
+
+    unsigned char* shadow = &mShadow[target.Offset + targetField.Offset];
+    if (memcmp(shadow, data, size) == 0)
+    {
+        mPendingStats.RedundantWrites++;
+        return false;
+    }
+
+    memcpy(shadow, data, size);
+
+    // Grow the block's dirty range to cover this field
+    unsigned int begin = targetField.Offset;
+    unsigned int end = targetField.Offset + targetField.Size;
+    if (target.DirtyBegin == target.DirtyEnd)
+    {
+        target.DirtyBegin = begin;
+        target.DirtyEnd = end;
+    }
+    else
+    {
+        target.DirtyBegin = (begin < target.DirtyBegin) ? begin : target.DirtyBegin;
+        target.DirtyEnd = (end > target.DirtyEnd) ? end : target.DirtyEnd;
+    }
+
+    return true;
+}
+
+bool ConstantBlockSet::SetMatrix(unsigned int block, unsigned int field, const DirectX::XMMATRIX& matrix)
+{
+    // Shaders default to column major matrices
+    DirectX::XMFLOAT4X4 transposed;
+    DirectX::XMStoreFloat4x4(&transposed, DirectX::XMMatrixTranspose(matrix));
+
+    return SetField(block, field, &transposed, sizeof(transposed));
+}
+
+void ConstantBlockSet::Commit(ID3D11DeviceContext* context)
+{
+    ASSERT(context != nullptr);
+
+    if (mBuffer != nullptr)
+    {
+        // Coalesce every dirty range into one span of the shared buffer
+        unsigned int begin = (unsigned int)mShadow.size();
+        unsigned int end = 0;
+        for (auto& block : mBlocks)
+        {
+            if (block.DirtyBegin == block.DirtyEnd)
+                continue;
+
+            unsigned int blockBegin = block.Offset + block.DirtyBegin;
+            unsigned int blockEnd = block.Offset + block.DirtyEnd;
+            begin = (blockBegin < begin) ? blockBegin : begin;
+            end = (blockEnd > end) ? blockEnd : end;
+
+            block.DirtyBegin = block.DirtyEnd = 0;
+        }
+
+        if (begin < end)
+        {
+            D3D11_BOX box;
+            box.left = begin;
+            box.right = end;
+            box.top = 0;
+            box.bottom = 1;
+            box.front = 0;
+            box.back = 1;
+
+            mContext1->UpdateSubresource1(mBuffer, 0, &box, &mShadow[begin], 0, 0, 0);
+
+            mPendingStats.BytesUploaded += end - begin;
+            mPendingStats.Uploads++;
+        }
+    }
+    else
+    {
+        // Constant buffers can only be updated as a whole without D3D11.1
+        for (auto& block : mBlocks)
+        {
+            if (block.DirtyBegin == block.DirtyEnd)
+                continue;
+
+            context->UpdateSubresource(block.Buffer, 0, nullptr, &mShadow[block.Offset], 0, 0);
+            block.DirtyBegin = block.DirtyEnd = 0;
+
+            mPendingStats.BytesUploaded += block.Size;
+            mPendingStats.Uploads++;
+        }
+    }
+
+    mFrameStats = mPendingStats;
+    mTotalStats.BytesUploaded += mPendingStats.BytesUploaded;
+    mTotalStats.Uploads += mPendingStats.Uploads;
+    mTotalStats.FieldWrites += mPendingStats.FieldWrites;
+    mTotalStats.RedundantWrites += mPendingStats.RedundantWrites;
+    memset(&mPendingStats, 0, sizeof(Stats));
+}
+
+void ConstantBlockSet::BindVS(ID3D11DeviceContext* context)
+{
+    Bind(context, false);
+}
+
+void ConstantBlockSet::BindPS(ID3D11DeviceContext* context)
+{
+    Bind(context, true);
+}
+
+void ConstantBlockSet::Bind(ID3D11DeviceContext* context, bool pixelShader)
+{
+    ASSERT(context != nullptr);
+
+    for (auto& block : mBlocks)
+    {
+        if (mBuffer != nullptr)
+        {
+            // Offsets and counts are in constants, and counts must be a multiple of 16
+            UINT firstConstant = block.Offset / kRegisterSize;
+            UINT numConstants = AlignUp(block.Size, kBlockAlignment) / kRegisterSize;
+            if (pixelShader)
+                mContext1->PSSetConstantBuffers1(block.Slot, 1, &mBuffer, &firstConstant, &numConstants);
+            else
+                mContext1->VSSetConstantBuffers1(block.Slot, 1, &mBuffer, &firstConstant, &numConstants);
+        }
+        else if (pixelShader)
+        {
+            context->PSSetConstantBuffers(block.Slot, 1, &block.Buffer);
+        }
+        else
+        {
+            context->VSSetConstantBuffers(block.Slot, 1, &block.Buffer);
+        }
+    }
+}
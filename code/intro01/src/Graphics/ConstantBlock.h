@@ -0,0 +1,124 @@
+///
+/// ConstantBlock.h - Constant buffer blocks built from a layout description.
+/// A CPU shadow copy of every block is kept so writes that don't change anything are dropped,
+/// and only the dirty byte ranges are sent to the GPU - once per frame, in a single upload.
+///
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <string>
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11DeviceContext1;
+struct ID3D11Buffer;
+struct ShaderConstantBuffer;
+
+enum ConstantType
+{
+    CT_Float = 0,
+    CT_Float2,
+    CT_Float3,
+    CT_Float4,
+    CT_Matrix,
+};
+
+struct ConstantFieldDesc
+{
+    const char*     Name;
+    ConstantType    Type;
+};
+
+struct ConstantBlockDesc
+{
+    const char*                 Name;
+    unsigned int                Slot;
+    const ConstantFieldDesc*    Fields;
+    unsigned int                FieldCount;
+};
+
+class ConstantBlockSet
+{
+public:
+    struct Stats
+    {
+        unsigned int BytesUploaded;
+        unsigned int Uploads;
+        unsigned int FieldWrites;
+        unsigned int RedundantWrites;
+    };
+
+private:
+    struct Field
+    {
+        unsigned int Offset;
+        unsigned int Size;
+    };
+
+    struct Block
+    {
+        unsigned int    Slot;
+        unsigned int    Offset;
+        unsigned int    Size;
+        unsigned int    FirstField;
+        unsigned int    FieldCount;
+
+        // Dirty range, relative to the start of the block. Begin == End means clean.
+        unsigned int    DirtyBegin;
+        unsigned int    DirtyEnd;
+
+        // Only used when the device can't bind constant buffers by offset
+        ID3D11Buffer*   Buffer;
+    };
+
+public:
+    ConstantBlockSet();
+    ~ConstantBlockSet();
+
+    // Add all the blocks before calling Initialize. Returns the index of the new block.
+    unsigned int AddBlock(const ConstantBlockDesc& desc);
+
+    // Laid out exactly as the compiler reported it, fields in the buffer's variable order
+    unsigned int AddBlock(const ShaderConstantBuffer& buffer);
+    bool Initialize(ID3D11Device* device);
+    void Shutdown();
+
+    bool SetField(unsigned int block, unsigned int field, const void* data, unsigned int size);
+    bool SetMatrix(unsigned int block, unsigned int field, const DirectX::XMMATRIX& matrix);
+
+    // Looks a field up by name, across every block - do it once, not per frame
+    bool FindField(const char* name, unsigned int* block, unsigned int* field) const;
+
+    void Commit(ID3D11DeviceContext* context);
+    void BindVS(ID3D11DeviceContext* context);
+    void BindPS(ID3D11DeviceContext* context);
+
+    unsigned int GetBlockSize(unsigned int block) const { return mBlocks[block].Size; }
+
+    // Counters for the last Commit, and since Initialize
+    const Stats& GetFrameStats() const { return mFrameStats; }
+    const Stats& GetTotalStats() const { return mTotalStats; }
+
+private:
+    static unsigned int SizeOf(ConstantType type);
+    unsigned int PlaceBlock(Block& block);
+    void Bind(ID3D11DeviceContext* context, bool pixelShader);
+
+private:
+    std::vector<Block>          mBlocks;
+    std::vector<Field>          mFields;
+    std::vector<std::string>    mFieldNames;
+    std::vector<unsigned char>  mShadow;
+
+    ID3D11DeviceContext1*       mContext1;
+    ID3D11Buffer*               mBuffer;
+
+    Stats                       mPendingStats;
+    Stats                       mFrameStats;
+    Stats                       mTotalStats;
+};
@@ -0,0 +1,545 @@
+#include "CpuShader.h"
+#include "VertexFormat.h"
+
+#include "utils\assert.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace
+{
+    const unsigned int kProgramMagic        = 0x48535043;   // 'CPSH'
+    const unsigned int kProgramVersion      = 1;
+    const unsigned int kMaxRegisters        = 0x10000;      // what an instruction can address
+    const unsigned int kMaxConstantOffset   = 4096 * 16;    // D3D11's largest constant buffer
+
+    // Everything after it is arrays of the structs in CpuShader.h, then the reflection
+    struct ProgramHeader
+    {
+        unsigned int    Magic;
+        unsigned int    Version;
+        unsigned int    RegisterCount;
+        unsigned int    InstructionCount;
+        unsigned int    LiteralCount;
+        unsigned int    ConstantCount;
+        unsigned int    InputCount;
+        unsigned int    OutputCount;
+        unsigned int    ReflectionSize;
+    };
+
+    template <typename T>
+    void WriteArray(std::vector<unsigned char>& data, const std::vector<T>& items)
+    {
+        const unsigned char* bytes = (const unsigned char*)items.data();
+        data.insert(data.end(), bytes, bytes + items.size() * sizeof(T));
+    }
+
+    template <typename T>
+    const unsigned char* ReadArray(const unsigned char* data, unsigned int count, std::vector<T>& items)
+    {
+        items.resize(count);
+        if (count > 0)
+            memcpy(items.data(), data, count * sizeof(T));
+        return data + count * sizeof(T);
+    }
+
+    bool SemanticsMatch(const char* a, const char* b)
+    {
+        while ((*a != 0) && (tolower((unsigned char)*a) == tolower((unsigned char)*b)))
+        {
+            a++;
+            b++;
+        }
+        return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+    }
+
+    int FindAttribute(const std::vector<CpuShaderAttribute>& attributes, const char* semanticName, unsigned int semanticIndex)
+    {
+        for (unsigned int index = 0; index < attributes.size(); index++)
+        {
+            const CpuShaderAttribute& attribute = attributes[index];
+            if ((attribute.SemanticIndex == semanticIndex) && SemanticsMatch(attribute.SemanticName, semanticName))
+                return (int)index;
+        }
+        return kInvalidCpuShaderAttribute;
+    }
+
+    bool IsValidAttribute(const CpuShaderAttribute& attribute, unsigned int registerCount)
+    {
+        if (memchr(attribute.SemanticName, 0, kCpuShaderMaxSemantic) == nullptr)
+            return false;
+
+        if ((attribute.ComponentCount == 0) || (attribute.ComponentCount > 4))
+            return false;
+
+        for (unsigned int component = 0; component < attribute.ComponentCount; component++)
+        {
+            if (attribute.Registers[component] >= registerCount)
+                return false;
+        }
+        return true;
+    }
+
+    bool IsValidInstruction(const CpuShaderInstruction& instruction, unsigned int registerCount)
+    {
+        if (instruction.Op >= CSO_Count)
+            return false;
+
+        // Unused sources are zero, so the first two are always in range
+        if ((instruction.Dest >= registerCount) || (instruction.Source[0] >= registerCount) || (instruction.Source[1] >= registerCount))
+            return false;
+
+        if (instruction.Op == CSO_Sample)
+        {
+            unsigned int texture = instruction.Source[2] & 0xff;
+            unsigned int sampler = instruction.Source[2] >> 8;
+            return (instruction.Dest + 3u < registerCount) && (texture < kCpuShaderMaxSlots) && (sampler < kCpuShaderMaxSlots);
+        }
+
+        return instruction.Source[2] < registerCount;
+    }
+
+    // Large enough for any real coordinate, small enough to turn into an int
+    float ClampCoordinate(float value)
+    {
+        if (!(value == value))
+            return 0.0f;
+        return fminf(fmaxf(value, -16777216.0f), 16777216.0f);
+    }
+
+    int AddressTexel(int coordinate, int size, CpuTextureAddress address)
+    {
+        if (address == CTA_Wrap)
+            return ((coordinate % size) + size) % size;
+        return (coordinate < 0) ? 0 : ((coordinate >= size) ? size - 1 : coordinate);
+    }
+
+    void FetchTexel(const CpuTexture& texture, int x, int y, CpuTextureAddress address, float* texel)
+    {
+        x = AddressTexel(x, (int)texture.Width, address);
+        y = AddressTexel(y, (int)texture.Height, address);
+
+        const unsigned char* rgba = texture.Texels + (size_t)y * texture.RowPitch + (size_t)x * 4;
+        for (unsigned int component = 0; component < 4; component++)
+            texel[component] = rgba[component] * (1.0f / 255.0f);
+    }
+}
+
+// ======================================================================================
+// CpuShaderProgram
+// ======================================================================================
+void CpuShaderProgram::Clear()
+{
+    RegisterCount = 0;
+    Instructions.clear();
+    Literals.clear();
+    Constants.clear();
+    Inputs.clear();
+    Outputs.clear();
+    Reflection.Clear();
+}
+
+int CpuShaderProgram::FindInput(const char* semanticName, unsigned int semanticIndex) const
+{
+    return FindAttribute(Inputs, semanticName, semanticIndex);
+}
+
+int CpuShaderProgram::FindOutput(const char* semanticName, unsigned int semanticIndex) const
+{
+    return FindAttribute(Outputs, semanticName, semanticIndex);
+}
+
+void CpuShaderProgram::Write(std::vector<unsigned char>& data) const
+{
+    std::vector<unsigned char> reflection;
+    Reflection.Write(reflection);
+
+    ProgramHeader header;
+    header.Magic = kProgramMagic;
+    header.Version = kProgramVersion;
+    header.RegisterCount = RegisterCount;
+    header.InstructionCount = (unsigned int)Instructions.size();
+    header.LiteralCount = (unsigned int)Literals.size();
+    header.ConstantCount = (unsigned int)Constants.size();
+    header.InputCount = (unsigned int)Inputs.size();
+    header.OutputCount = (unsigned int)Outputs.size();
+    header.ReflectionSize = (unsigned int)reflection.size();
+
+    const unsigned char* bytes = (const unsigned char*)&header;
+    data.insert(data.end(), bytes, bytes + sizeof(header));
+
+    WriteArray(data, Instructions);
+    WriteArray(data, Literals);
+    WriteArray(data, Constants);
+    WriteArray(data, Inputs);
+    WriteArray(data, Outputs);
+    WriteArray(data, reflection);
+}
+
+bool CpuShaderProgram::Read(const void* data, size_t size)
+{
+    Clear();
+
+    ProgramHeader header;
+    if ((data == nullptr) || (size < sizeof(header)))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+    if ((header.Magic != kProgramMagic) || (header.Version != kProgramVersion) || (header.RegisterCount > kMaxRegisters))
+        return false;
+
+    // In 64 bits, so corrupt counts can't wrap around
+    unsigned long long expected = sizeof(header)
+        + (unsigned long long)header.InstructionCount * sizeof(CpuShaderInstruction)
+        + (unsigned long long)header.LiteralCount * sizeof(CpuShaderLiteral)
+        + (unsigned long long)header.ConstantCount * sizeof(CpuShaderConstant)
+        + ((unsigned long long)header.InputCount + header.OutputCount) * sizeof(CpuShaderAttribute)
+        + header.ReflectionSize;
+    if (expected != size)
+        return false;
+
+    const unsigned char* read = (const unsigned char*)data + sizeof(header);
+    read = ReadArray(read, header.InstructionCount, Instructions);
+    read = ReadArray(read, header.LiteralCount, Literals);
+    read = ReadArray(read, header.ConstantCount, Constants);
+    read = ReadArray(read, header.InputCount, Inputs);
+    read = ReadArray(read, header.OutputCount, Outputs);
+    RegisterCount = header.RegisterCount;
+
+    bool valid = Reflection.Read(read, header.ReflectionSize);
+
+    for (auto& instruction : Instructions)
+        valid = valid && IsValidInstruction(instruction, RegisterCount);
+
+    for (auto& literal : Literals)
+        valid = valid && (literal.Register < RegisterCount);
+
+    for (auto& constant : Constants)
+        valid = valid && (constant.Register < RegisterCount) && (constant.Slot < kCpuShaderMaxSlots) && (constant.Offset < kMaxConstantOffset);
+
+    for (auto& attribute : Inputs)
+        valid = valid && IsValidAttribute(attribute, RegisterCount);
+
+    for (auto& attribute : Outputs)
+        valid = valid && IsValidAttribute(attribute, RegisterCount);
+
+    if (!valid)
+        Clear();
+
+    return valid;
+}
+
+// ======================================================================================
+// CpuShaderExecutor
+// ======================================================================================
+CpuShaderExecutor::CpuShaderExecutor(const CpuShaderProgram& program)
+    : mProgram(program)
+{
+    // One spare, so the registers can start on the first 16 byte boundary. Zeroed.
+    mRegisterStorage.resize(program.RegisterCount * kVectorsPerRegister + 1);
+    uintptr_t storage = (uintptr_t)mRegisterStorage.data();
+    mRegisters = (Math::Vector*)((storage + 15) & ~(uintptr_t)15);
+
+    Binding unbound = { nullptr, 0, 0 };
+    mInputs.resize(program.Inputs.size(), unbound);
+    mOutputs.resize(program.Outputs.size(), unbound);
+
+    for (unsigned int slot = 0; slot < kCpuShaderMaxSlots; slot++)
+        mTextures[slot] = nullptr;
+
+    // Literals never change, so they're loaded once
+    for (auto& literal : program.Literals)
+    {
+        Math::Vector* lanes = GetRegister(literal.Register);
+        for (unsigned int vector = 0; vector < kVectorsPerRegister; vector++)
+            lanes[vector] = Math::VectorReplicate(literal.Value);
+    }
+}
+
+void CpuShaderExecutor::SetConstantBuffer(unsigned int slot, const void* data, unsigned int size)
+{
+    ASSERT((data != nullptr) || (size == 0));
+
+    for (auto& constant : mProgram.Constants)
+    {
+        if (constant.Slot != slot)
+            continue;
+
+        float value = 0.0f;
+        if (constant.Offset + sizeof(float) <= size)
+            memcpy(&value, (const unsigned char*)data + constant.Offset, sizeof(float));
+
+        Math::Vector* lanes = GetRegister(constant.Register);
+        for (unsigned int vector = 0; vector < kVectorsPerRegister; vector++)
+            lanes[vector] = Math::VectorReplicate(value);
+    }
+}
+
+void CpuShaderExecutor::SetTexture(unsigned int slot, const CpuTexture* texture)
+{
+    ASSERT(slot < kCpuShaderMaxSlots);
+    ASSERT((texture == nullptr) || ((texture->Texels != nullptr) && (texture->Width > 0) && (texture->Height > 0)));
+    mTextures[slot] = texture;
+}
+
+void CpuShaderExecutor::SetSampler(unsigned int slot, const CpuSampler& sampler)
+{
+    ASSERT(slot < kCpuShaderMaxSlots);
+    mSamplers[slot] = sampler;
+}
+
+void CpuShaderExecutor::SetInput(int input, const void* data, unsigned int stride, unsigned int components)
+{
+    if (input == kInvalidCpuShaderAttribute)
+        return;
+
+    ASSERT((unsigned int)input < mInputs.size());
+    mInputs[input].Data = (unsigned char*)data;
+    mInputs[input].Stride = stride;
+    mInputs[input].Components = components;
+}
+
+void CpuShaderExecutor::SetOutput(int output, void* data, unsigned int stride)
+{
+    if (output == kInvalidCpuShaderAttribute)
+        return;
+
+    ASSERT((unsigned int)output < mOutputs.size());
+    mOutputs[output].Data = (unsigned char*)data;
+    mOutputs[output].Stride = stride;
+    mOutputs[output].Components = mProgram.Outputs[output].ComponentCount;
+}
+
+bool CpuShaderExecutor::SetVertexStreams(const VertexFormat& format, const void* const* streams, const unsigned int* strides, unsigned int instance)
+{
+    ASSERT(streams != nullptr);
+    ASSERT(strides != nullptr);
+
+    for (unsigned int input = 0; input < mProgram.Inputs.size(); input++)
+    {
+        const CpuShaderAttribute& attribute = mProgram.Inputs[input];
+
+        const VertexElement* element = nullptr;
+        for (unsigned int index = 0; (index < format.ElementCount) && (element == nullptr); index++)
+        {
+            const VertexElement& candidate = format.Elements[index];
+            if ((candidate.SemanticIndex == attribute.SemanticIndex) && SemanticsMatch(candidate.Semantic, attribute.SemanticName))
+                element = &candidate;
+        }
+
+        if ((element == nullptr) || (element->Format > VEF_Float4) || (streams[element->Stream] == nullptr))
+            return false;
+
+        const unsigned char* data = (const unsigned char*)streams[element->Stream] + element->Offset;
+        unsigned int stride = strides[element->Stream];
+        if (element->InstanceStepRate > 0)
+        {
+            data += (size_t)(instance / element->InstanceStepRate) * stride;
+            stride = 0;
+        }
+
+        SetInput((int)input, data, stride, (unsigned int)(element->Format - VEF_Float) + 1);
+    }
+
+    return true;
+}
+
+void CpuShaderExecutor::Run(unsigned int count)
+{
+    static const float kDefaults[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    for (unsigned int first = 0; first < count; first += kCpuShaderLanes)
+    {
+        unsigned int lanes = ((count - first) < kCpuShaderLanes) ? (count - first) : kCpuShaderLanes;
+
+        // Inputs are stored a vertex at a time - turn them on their side, a component per
+        // register. Lanes past the end are zeroed so they don't shade garbage.
+        for (unsigned int input = 0; input < mInputs.size(); input++)
+        {
+            const CpuShaderAttribute& attribute = mProgram.Inputs[input];
+            const Binding& binding = mInputs[input];
+
+            for (unsigned int component = 0; component < attribute.ComponentCount; component++)
+            {
+                float* values = GetLanes(attribute.Registers[component]);
+                unsigned int lane = 0;
+
+                if ((binding.Data != nullptr) && (component < binding.Components))
+                {
+                    const unsigned char* source = binding.Data + (size_t)first * binding.Stride + component * sizeof(float);
+                    for (; lane < lanes; lane++, source += binding.Stride)
+                        memcpy(&values[lane], source, sizeof(float));
+                }
+                else if (binding.Data != nullptr)
+                {
+                    for (; lane < lanes; lane++)
+                        values[lane] = kDefaults[component];
+                }
+
+                for (; lane < kCpuShaderLanes; lane++)
+                    values[lane] = 0.0f;
+            }
+        }
+
+        Execute();
+
+        for (unsigned int output = 0; output < mOutputs.size(); output++)
+        {
+            const CpuShaderAttribute& attribute = mProgram.Outputs[output];
+            const Binding& binding = mOutputs[output];
+            if (binding.Data == nullptr)
+                continue;
+
+            for (unsigned int component = 0; component < attribute.ComponentCount; component++)
+            {
+                const float* values = GetLanes(attribute.Registers[component]);
+                unsigned char* destination = binding.Data + (size_t)first * binding.Stride + component * sizeof(float);
+                for (unsigned int lane = 0; lane < lanes; lane++, destination += binding.Stride)
+                    memcpy(destination, &values[lane], sizeof(float));
+            }
+        }
+    }
+}
+
+void CpuShaderExecutor::Execute()
+{
+    const Math::Vector zero = Math::VectorZero();
+    const Math::Vector one = Math::VectorReplicate(1.0f);
+
+    for (auto& instruction : mProgram.Instructions)
+    {
+        Math::Vector* d = GetRegister(instruction.Dest);
+        const Math::Vector* a = GetRegister(instruction.Source[0]);
+        const Math::Vector* b = GetRegister(instruction.Source[1]);
+
+        switch (instruction.Op)
+        {
+        case CSO_Move:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = a[v];
+            break;
+
+        case CSO_Add:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorAdd(a[v], b[v]);
+            break;
+
+        case CSO_Subtract:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorSubtract(a[v], b[v]);
+            break;
+
+        case CSO_Multiply:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorMultiply(a[v], b[v]);
+            break;
+
+        case CSO_Divide:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorDivide(a[v], b[v]);
+            break;
+
+        case CSO_MultiplyAdd:
+        {
+            const Math::Vector* c = GetRegister(instruction.Source[2]);
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorMultiplyAdd(a[v], b[v], c[v]);
+            break;
+        }
+
+        case CSO_Min:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorMin(a[v], b[v]);
+            break;
+
+        case CSO_Max:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorMax(a[v], b[v]);
+            break;
+
+        case CSO_Saturate:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorMin(Math::VectorMax(a[v], zero), one);
+            break;
+
+        case CSO_Abs:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorMax(a[v], Math::VectorNegate(a[v]));
+            break;
+
+        case CSO_Sqrt:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorSqrt(a[v]);
+            break;
+
+        case CSO_ReciprocalSqrt:
+            for (unsigned int v = 0; v < kVectorsPerRegister; v++)
+                d[v] = Math::VectorDivide(one, Math::VectorSqrt(a[v]));
+            break;
+
+        case CSO_Sample:
+            Sample(instruction);
+            break;
+        }
+    }
+}
+
+void CpuShaderExecutor::Sample(const CpuShaderInstruction& instruction)
+{
+    const CpuTexture* texture = mTextures[instruction.Source[2] & 0xff];
+    const CpuSampler& sampler = mSamplers[instruction.Source[2] >> 8];
+
+    // The coordinates are copied out first, in case the result lands on top of them
+    float u[kCpuShaderLanes];
+    float v[kCpuShaderLanes];
+    memcpy(u, GetLanes(instruction.Source[0]), sizeof(u));
+    memcpy(v, GetLanes(instruction.Source[1]), sizeof(v));
+
+    float* result[4];
+    for (unsigned int component = 0; component < 4; component++)
+        result[component] = GetLanes(instruction.Dest + component);
+
+    for (unsigned int lane = 0; lane < kCpuShaderLanes; lane++)
+    {
+        float texel[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        if (texture != nullptr)
+        {
+            float x = ClampCoordinate(u[lane]) * texture->Width;
+            float y = ClampCoordinate(v[lane]) * texture->Height;
+
+            if (sampler.Filter == CTF_Point)
+            {
+                FetchTexel(*texture, (int)floorf(x), (int)floorf(y), sampler.Address, texel);
+            }
+            else
+            {
+                // Texel centres are at the halves
+                x -= 0.5f;
+                y -= 0.5f;
+                float left = floorf(x);
+                float top = floorf(y);
+                float tx = x - left;
+                float ty = y - top;
+
+                float corners[4][4];
+                FetchTexel(*texture, (int)left,     (int)top,     sampler.Address, corners[0]);
+                FetchTexel(*texture, (int)left + 1, (int)top,     sampler.Address, corners[1]);
+                FetchTexel(*texture, (int)left,     (int)top + 1, sampler.Address, corners[2]);
+                FetchTexel(*texture, (int)left + 1, (int)top + 1, sampler.Address, corners[3]);
+
+                for (unsigned int component = 0; component < 4; component++)
+                {
+                    float upper = corners[0][component] + (corners[1][component] - corners[0][component]) * tx;
+                    float lower = corners[2][component] + (corners[3][component] - corners[2][component]) * tx;
+                    texel[component] = upper + (lower - upper) * ty;
+                }
+            }
+        }
+
+        for (unsigned int component = 0; component < 4; component++)
+            result[component][lane] = texel[component];
+    }
+}
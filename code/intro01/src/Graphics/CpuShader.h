@@ -0,0 +1,202 @@
+///
+/// CpuShader.h - Compiled shaders run on the CPU, for validating them without a GPU.
+/// CpuShaderCompiler turns the HLSL our shaders are written in into a CpuShaderProgram: a
+/// straight line of instructions over a register file, with no branches. Each register
+/// holds one component for kCpuShaderLanes vertices or pixels, and each instruction works
+/// on all of them with SimdMath, so the cost of decoding it is paid once per batch.
+///
+///     CpuShaderProgram program;
+///     program.Read(bytecode.data(), bytecode.size());
+///
+///     CpuShaderExecutor executor(program);
+///     executor.SetConstantBuffer(0, &perObject, sizeof(perObject));
+///     executor.SetInput(program.FindInput("POSITION", 0), positions, sizeof(Math::Vec4));
+///     executor.SetOutput(program.FindOutput("SV_POSITION", 0), clipPositions, sizeof(Math::Vec4));
+///     executor.Run(vertexCount);
+///
+/// Constant buffers hold exactly what the GPU would be given, so matrices go in transposed
+/// unless the shader declares them row_major.
+///
+#pragma once
+
+#include "ShaderReflection.h"
+
+#include "utils\SimdMath.h"
+
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct VertexFormat;
+
+// Invocations shaded by each instruction - a multiple of the four in a Math::Vector
+static const unsigned int kCpuShaderLanes           = 8;
+
+static const unsigned int kCpuShaderMaxSlots        = 16;   // per kind of binding
+static const unsigned int kCpuShaderMaxSemantic     = 32;
+static const int kInvalidCpuShaderAttribute         = -1;
+
+enum CpuShaderOp
+{
+    CSO_Move = 0,               // d = a
+    CSO_Add,                    // d = a + b
+    CSO_Subtract,               // d = a - b
+    CSO_Multiply,               // d = a * b
+    CSO_Divide,                 // d = a / b
+    CSO_MultiplyAdd,            // d = a * b + c
+    CSO_Min,
+    CSO_Max,
+    CSO_Saturate,
+    CSO_Abs,
+    CSO_Sqrt,
+    CSO_ReciprocalSqrt,
+    CSO_Sample,                 // d..d+3 = texture c & 0xff, sampler c >> 8, at (a, b)
+
+    CSO_Count
+};
+
+struct CpuShaderInstruction
+{
+    unsigned short  Op;
+    unsigned short  Dest;
+    unsigned short  Source[3];
+    unsigned short  Padding;
+};
+
+// A register that holds the same value in every lane
+struct CpuShaderLiteral
+{
+    unsigned int    Register;
+    float           Value;
+};
+
+struct CpuShaderConstant
+{
+    unsigned int    Register;
+    unsigned int    Slot;           // constant buffer
+    unsigned int    Offset;         // bytes into it
+};
+
+// An input the caller fills, or an output the program leaves behind - one register per
+// component. Matrix inputs take a semantic index per row (or column, if column_major), the
+// way the input assembler sees them.
+struct CpuShaderAttribute
+{
+    char            SemanticName[kCpuShaderMaxSemantic];
+    unsigned int    SemanticIndex;
+    unsigned int    ComponentCount;
+    unsigned short  Registers[4];
+};
+
+class CpuShaderProgram
+{
+public:
+    unsigned int                        RegisterCount;
+    std::vector<CpuShaderInstruction>   Instructions;
+    std::vector<CpuShaderLiteral>       Literals;
+    std::vector<CpuShaderConstant>      Constants;
+    std::vector<CpuShaderAttribute>     Inputs;
+    std::vector<CpuShaderAttribute>     Outputs;
+    ShaderReflection                    Reflection;
+
+public:
+    CpuShaderProgram() : RegisterCount(0) {}
+
+    void Clear();
+
+    // Semantic names are matched without regard to case. kInvalidCpuShaderAttribute if
+    // there's no such attribute.
+    int FindInput(const char* semanticName, unsigned int semanticIndex) const;
+    int FindOutput(const char* semanticName, unsigned int semanticIndex) const;
+
+    // Appends to data. Read checks every register and slot, so a program that reads back
+    // can be run without further checks.
+    void Write(std::vector<unsigned char>& data) const;
+    bool Read(const void* data, size_t size);
+};
+
+enum CpuTextureFilter
+{
+    CTF_Point = 0,
+    CTF_Linear,
+};
+
+enum CpuTextureAddress
+{
+    CTA_Clamp = 0,
+    CTA_Wrap,
+};
+
+// RGBA8 texels, top row first
+struct CpuTexture
+{
+    const unsigned char*    Texels;
+    unsigned int            Width;
+    unsigned int            Height;
+    unsigned int            RowPitch;       // bytes
+};
+
+// Defaults to D3D11's default sampler state - linear, clamped
+struct CpuSampler
+{
+    CpuSampler() : Filter(CTF_Linear), Address(CTA_Clamp) {}
+
+    CpuTextureFilter        Filter;
+    CpuTextureAddress       Address;
+};
+
+// Runs one program. Holds the bindings and the register file, so give each thread its own.
+class CpuShaderExecutor
+{
+public:
+    explicit CpuShaderExecutor(const CpuShaderProgram& program);
+    CpuShaderExecutor(const CpuShaderExecutor&) = delete;
+    CpuShaderExecutor& operator=(const CpuShaderExecutor&) = delete;
+
+    // The values are copied out now. Anything past size reads as zero, as it would on the GPU.
+    void SetConstantBuffer(unsigned int slot, const void* data, unsigned int size);
+
+    // Unbound textures sample as zero
+    void SetTexture(unsigned int slot, const CpuTexture* texture);
+    void SetSampler(unsigned int slot, const CpuSampler& sampler);
+
+    // components floats for each invocation, stride bytes apart. Components the shader reads
+    // past those default to 0, 0, 0, 1 like the input assembler's do, and a stride of zero
+    // gives every invocation the same value. Unbound inputs read as zero.
+    void SetInput(int input, const void* data, unsigned int stride, unsigned int components = 4);
+    void SetOutput(int output, void* data, unsigned int stride);
+
+    // Binds every input from vertex streams, matched by semantic. Per instance elements are
+    // read for the one instance. False if the program wants something the format doesn't have,
+    // or that isn't floats.
+    bool SetVertexStreams(const VertexFormat& format, const void* const* streams, const unsigned int* strides, unsigned int instance);
+
+    // Shades count invocations, reading and writing from the start of every binding
+    void Run(unsigned int count);
+
+private:
+    static const unsigned int kVectorsPerRegister = kCpuShaderLanes / 4;
+
+    struct Binding
+    {
+        unsigned char*          Data;       // read only for inputs
+        unsigned int            Stride;
+        unsigned int            Components;
+    };
+
+    void Execute();
+    void Sample(const CpuShaderInstruction& instruction);
+
+    Math::Vector* GetRegister(unsigned int index) { return mRegisters + index * kVectorsPerRegister; }
+    float* GetLanes(unsigned int index) { return (float*)GetRegister(index); }
+
+private:
+    const CpuShaderProgram&     mProgram;
+    std::vector<Math::Vec4>     mRegisterStorage;   // plain floats - a vector of __m128 can't promise the alignment
+    Math::Vector*               mRegisters;         // 16 byte aligned, inside mRegisterStorage
+    std::vector<Binding>        mInputs;
+    std::vector<Binding>        mOutputs;
+    const CpuTexture*           mTextures[kCpuShaderMaxSlots];
+    CpuSampler                  mSamplers[kCpuShaderMaxSlots];
+};
@@ -0,0 +1,304 @@
+///
+/// CpuShaderBenchmark.cpp - Runs the sample's shaders through CpuShaderExecutor.
+///
+
+#include "CpuShaderBenchmark.h"
+#include "CpuShader.h"
+#include "CpuShaderCompiler.h"
+#include "VertexFormat.h"
+
+#include "utils\SimdMath.h"
+
+#include <chrono>
+#include <math.h>
+#include <stddef.h>
+
+typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+const unsigned int kVertexCount     = 1 << 16;
+const unsigned int kTextureSize     = 64;
+const unsigned int kPixelCount      = kTextureSize * kTextureSize * 16;
+
+// Best of this many passes, so one slow pass doesn't skew the result
+const unsigned int kPassCount       = 8;
+
+// The instanced mesh's streams, laid out like PositionNormalUVLayout and PerInstanceLayout
+// without needing DirectXMath
+struct BenchmarkVertex
+{
+    Math::Vec3  Position;
+    Math::Vec3  Normal;
+    float       UV[2];
+};
+
+struct BenchmarkInstance
+{
+    Math::Float4x4 World;
+};
+
+static const VertexElement kBenchmarkElements[] =
+{
+    { "POSITION", 0, VEF_Float3, 0, offsetof(BenchmarkVertex, Position), 0 },
+    { "NORMAL",   0, VEF_Float3, 0, offsetof(BenchmarkVertex, Normal),   0 },
+    { "TEXCOORD", 0, VEF_Float2, 0, offsetof(BenchmarkVertex, UV),       0 },
+    { "WORLD",    0, VEF_Float4, 1, offsetof(BenchmarkInstance, World) + 0 * sizeof(Math::Vec4), 1 },
+    { "WORLD",    1, VEF_Float4, 1, offsetof(BenchmarkInstance, World) + 1 * sizeof(Math::Vec4), 1 },
+    { "WORLD",    2, VEF_Float4, 1, offsetof(BenchmarkInstance, World) + 2 * sizeof(Math::Vec4), 1 },
+    { "WORLD",    3, VEF_Float4, 1, offsetof(BenchmarkInstance, World) + 3 * sizeof(Math::Vec4), 1 },
+};
+
+static const VertexFormat kBenchmarkFormat = { kBenchmarkElements, sizeof(kBenchmarkElements) / sizeof(kBenchmarkElements[0]) };
+
+static double SecondsSince(BenchmarkClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+}
+
+// Deterministic values in [-1, 1), so runs are comparable
+static float NextValue(unsigned int& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1 << 23) - 1.0f;
+}
+
+static void MaxDifference(const float* a, const float* b, unsigned int count, float& maxError)
+{
+    for (unsigned int index = 0; index < count; index++)
+    {
+        float error = fabsf(a[index] - b[index]);
+        if (error > maxError)
+            maxError = error;
+    }
+}
+
+static Math::Float4x4 RandomMatrix(unsigned int& state)
+{
+    Math::Float4x4 matrix;
+    for (unsigned int row = 0; row < 4; row++)
+    {
+        for (unsigned int column = 0; column < 4; column++)
+            matrix.m[row][column] = NextValue(state);
+    }
+    return matrix;
+}
+
+// The shaders don't say row_major, so their cbuffer matrices go in the way ColorShader
+// uploads them - transposed
+static Math::Float4x4 Transposed(const Math::Float4x4& matrix)
+{
+    Math::Float4x4 transposed;
+    Math::MatrixStore(&transposed, Math::MatrixTranspose(Math::MatrixLoad(&matrix)));
+    return transposed;
+}
+
+static bool Compile(const char* shaderDirectory, const char* filename, const char* entryPoint, const char* profile,
+                    CpuShaderProgram& program, std::string& errors)
+{
+    std::string path = std::string(shaderDirectory) + "/" + filename;
+
+    std::string source;
+    if (!ShaderCache::ReadSource(path.c_str(), source))
+    {
+        errors += "couldn't read " + path + "\n";
+        return false;
+    }
+
+    // Keywords are left to default to on, as they do for BPS_Default
+    CpuShaderCompiler compiler;
+    ShaderCompileRequest request(path.c_str(), entryPoint, profile);
+    std::vector<unsigned char> bytecode;
+    return compiler.Compile(request, source, bytecode, errors) && program.Read(bytecode.data(), bytecode.size());
+}
+
+// ======================================================================================
+// instancedVS.hlsl - a mesh's worth of vertices for one instance
+// ======================================================================================
+static bool MeasureVertexShader(const char* shaderDirectory, CpuShaderBenchmarkResult& result, std::string& errors)
+{
+    CpuShaderProgram program;
+    if (!Compile(shaderDirectory, "instancedVS.hlsl", "VSMain", "vs_5_0", program, errors))
+        return false;
+
+    unsigned int state = 1;
+    std::vector<BenchmarkVertex> vertices(kVertexCount);
+    for (auto& vertex : vertices)
+    {
+        vertex.Position.x = NextValue(state) * 10.0f;
+        vertex.Position.y = NextValue(state) * 10.0f;
+        vertex.Position.z = NextValue(state) * 10.0f;
+        vertex.Normal.x = NextValue(state);
+        vertex.Normal.y = NextValue(state);
+        vertex.Normal.z = NextValue(state);
+        vertex.UV[0] = NextValue(state);
+        vertex.UV[1] = NextValue(state);
+    }
+
+    BenchmarkInstance instance;
+    instance.World = RandomMatrix(state);
+    Math::Float4x4 projection = RandomMatrix(state);
+    Math::Float4x4 view = RandomMatrix(state);
+    Math::Float4x4 world = RandomMatrix(state);
+
+    Math::Float4x4 projectionConstants = Transposed(projection);
+    Math::Float4x4 viewConstants = Transposed(view);
+    Math::Float4x4 worldConstants = Transposed(world);
+
+    CpuShaderExecutor executor(program);
+    executor.SetConstantBuffer(0, &projectionConstants, sizeof(projectionConstants));
+    executor.SetConstantBuffer(1, &viewConstants, sizeof(viewConstants));
+    executor.SetConstantBuffer(2, &worldConstants, sizeof(worldConstants));
+
+    const void* streams[2] = { vertices.data(), &instance };
+    unsigned int strides[2] = { sizeof(BenchmarkVertex), sizeof(BenchmarkInstance) };
+    if (!executor.SetVertexStreams(kBenchmarkFormat, streams, strides, 0))
+    {
+        errors += "instancedVS.hlsl wants inputs the instanced mesh format doesn't have\n";
+        return false;
+    }
+
+    std::vector<Math::Vec4> positions(kVertexCount);
+    std::vector<Math::Vec3> normals(kVertexCount);
+    std::vector<float> uvs(kVertexCount * 2);
+    executor.SetOutput(program.FindOutput("SV_POSITION", 0), positions.data(), sizeof(Math::Vec4));
+    executor.SetOutput(program.FindOutput("NORMAL", 0), normals.data(), sizeof(Math::Vec3));
+    executor.SetOutput(program.FindOutput("TEXCOORD", 0), uvs.data(), 2 * sizeof(float));
+
+    result.Name = "instanced_vs";
+    result.Count = kVertexCount;
+    result.Instructions = (unsigned int)program.Instructions.size();
+    result.Nanoseconds = 1e30;
+
+    for (unsigned int pass = 0; pass < kPassCount; pass++)
+    {
+        BenchmarkClock::time_point start = BenchmarkClock::now();
+        executor.Run(kVertexCount);
+        double nanoseconds = SecondsSince(start) * 1e9 / kVertexCount;
+
+        if (nanoseconds < result.Nanoseconds)
+            result.Nanoseconds = nanoseconds;
+    }
+
+    // The same transforms with SimdMath
+    Math::Mat4 combined = Math::MatrixMultiply(Math::MatrixLoad(&instance.World), Math::MatrixLoad(&world));
+    Math::Mat4 viewMatrix = Math::MatrixLoad(&view);
+    Math::Mat4 projectionMatrix = Math::MatrixLoad(&projection);
+
+    result.MaxError = 0.0f;
+    for (unsigned int index = 0; index < kVertexCount; index++)
+    {
+        Math::Vector position = Math::VectorSetW(Math::VectorLoad3(&vertices[index].Position), 1.0f);
+        position = Math::Vector4Transform(position, combined);
+        position = Math::Vector4Transform(position, viewMatrix);
+        position = Math::Vector4Transform(position, projectionMatrix);
+
+        Math::Vec4 expectedPosition;
+        Math::VectorStore4(&expectedPosition, position);
+
+        Math::Vec3 expectedNormal;
+        Math::VectorStore3(&expectedNormal, Math::Vector3TransformNormal(Math::VectorLoad3(&vertices[index].Normal), combined));
+
+        MaxDifference(&expectedPosition.x, &positions[index].x, 4, result.MaxError);
+        MaxDifference(&expectedNormal.x, &normals[index].x, 3, result.MaxError);
+        MaxDifference(vertices[index].UV, &uvs[index * 2], 2, result.MaxError);
+    }
+    return true;
+}
+
+// ======================================================================================
+// basicPS.hlsl - textured and lit
+// ======================================================================================
+static bool MeasurePixelShader(const char* shaderDirectory, CpuShaderBenchmarkResult& result, std::string& errors)
+{
+    CpuShaderProgram program;
+    if (!Compile(shaderDirectory, "basicPS.hlsl", "PSMain", "ps_5_0", program, errors))
+        return false;
+
+    unsigned int state = 2;
+    std::vector<unsigned char> texels(kTextureSize * kTextureSize * 4);
+    for (auto& texel : texels)
+        texel = (unsigned char)(NextValue(state) * 127.5f + 127.5f);
+
+    CpuTexture texture;
+    texture.Texels = texels.data();
+    texture.Width = kTextureSize;
+    texture.Height = kTextureSize;
+    texture.RowPitch = kTextureSize * 4;
+
+    // Light direction, then the ambient floor in w
+    float perFrame[4] = { 0.48f, 0.6f, 0.64f, 0.2f };
+
+    CpuShaderExecutor executor(program);
+    executor.SetConstantBuffer(1, perFrame, sizeof(perFrame));
+    executor.SetTexture(0, &texture);
+    executor.SetSampler(0, CpuSampler());
+
+    // Coordinates on texel centres, so the bilinear filter lands on exactly one texel and
+    // the reference can just look it up
+    std::vector<Math::Vec3> normals(kPixelCount);
+    std::vector<float> uvs(kPixelCount * 2);
+    std::vector<unsigned int> expectedTexels(kPixelCount);
+    for (unsigned int index = 0; index < kPixelCount; index++)
+    {
+        normals[index].x = NextValue(state);
+        normals[index].y = NextValue(state);
+        normals[index].z = NextValue(state);
+
+        unsigned int x = (index * 7) % kTextureSize;
+        unsigned int y = (index / kTextureSize) % kTextureSize;
+        uvs[index * 2 + 0] = (x + 0.5f) / kTextureSize;
+        uvs[index * 2 + 1] = (y + 0.5f) / kTextureSize;
+        expectedTexels[index] = (y * kTextureSize + x) * 4;
+    }
+
+    std::vector<Math::Vec4> colors(kPixelCount);
+    executor.SetInput(program.FindInput("NORMAL", 0), normals.data(), sizeof(Math::Vec3), 3);
+    executor.SetInput(program.FindInput("TEXCOORD", 0), uvs.data(), 2 * sizeof(float), 2);
+    executor.SetOutput(program.FindOutput("SV_TARGET", 0), colors.data(), sizeof(Math::Vec4));
+
+    result.Name = "basic_ps";
+    result.Count = kPixelCount;
+    result.Instructions = (unsigned int)program.Instructions.size();
+    result.Nanoseconds = 1e30;
+
+    for (unsigned int pass = 0; pass < kPassCount; pass++)
+    {
+        BenchmarkClock::time_point start = BenchmarkClock::now();
+        executor.Run(kPixelCount);
+        double nanoseconds = SecondsSince(start) * 1e9 / kPixelCount;
+
+        if (nanoseconds < result.Nanoseconds)
+            result.Nanoseconds = nanoseconds;
+    }
+
+    result.MaxError = 0.0f;
+    for (unsigned int index = 0; index < kPixelCount; index++)
+    {
+        const Math::Vec3& normal = normals[index];
+        float lighting = perFrame[0] * normal.x + perFrame[1] * normal.y + perFrame[2] * normal.z;
+        lighting = (lighting < 0.0f) ? 0.0f : (lighting > 1.0f) ? 1.0f : lighting;
+        lighting = (lighting < perFrame[3]) ? perFrame[3] : lighting;
+
+        float expected[4];
+        for (unsigned int component = 0; component < 4; component++)
+            expected[component] = texels[expectedTexels[index] + component] / 255.0f * lighting;
+
+        MaxDifference(expected, &colors[index].x, 4, result.MaxError);
+    }
+    return true;
+}
+
+bool RunCpuShaderBenchmarks(const char* shaderDirectory, std::vector<CpuShaderBenchmarkResult>& results, std::string& errors)
+{
+    bool (*benchmarks[])(const char*, CpuShaderBenchmarkResult&, std::string&) = { &MeasureVertexShader, &MeasurePixelShader };
+
+    bool succeeded = true;
+    for (auto benchmark : benchmarks)
+    {
+        CpuShaderBenchmarkResult result;
+        if (benchmark(shaderDirectory, result, errors))
+            results.push_back(result);
+        else
+            succeeded = false;
+    }
+    return succeeded;
+}
@@ -0,0 +1,26 @@
+///
+/// CpuShaderBenchmark.h - Runs the sample's shaders through CpuShaderExecutor.
+/// Compiles instancedVS.hlsl and basicPS.hlsl with CpuShaderCompiler, shades a batch of
+/// vertices and pixels with them, and checks the results against the same math written out
+/// with SimdMath and plain floats. Both a speed check on the interpreter and a check that
+/// the compiler still understands the shaders we ship. The benchmark runner reports the
+/// results; nothing here prints.
+///
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct CpuShaderBenchmarkResult
+{
+    const char*     Name;
+    unsigned int    Count;                  // invocations per pass
+    unsigned int    Instructions;           // in the compiled program
+
+    double          Nanoseconds;            // per invocation
+    float           MaxError;               // largest difference from the reference
+};
+
+// shaderDirectory holds the .hlsl files. False, with errors filled in, if a shader didn't
+// compile.
+bool RunCpuShaderBenchmarks(const char* shaderDirectory, std::vector<CpuShaderBenchmarkResult>& results, std::string& errors);
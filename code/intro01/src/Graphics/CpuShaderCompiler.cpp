@@ -0,0 +1,2281 @@
+#include "CpuShaderCompiler.h"
+#include "CpuShader.h"
+
+#include "utils\assert.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    const unsigned int kMaxRegister         = 0xffff;
+    const unsigned int kMaxMacroDepth       = 16;
+    const unsigned int kRegisterSize        = 16;       // bytes in a constant register
+
+    void AddError(std::string& errors, const char* filename, unsigned int line, const std::string& message)
+    {
+        char location[32];
+        snprintf(location, sizeof(location), "(%u): error: ", line);
+        errors += filename;
+        errors += location;
+        errors += message;
+        errors += "\n";
+    }
+
+    unsigned int AlignUp(unsigned int value, unsigned int alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // ======================================================================================
+    // Tokens
+    // ======================================================================================
+    enum TokenType
+    {
+        TT_End = 0,
+        TT_Identifier,
+        TT_Number,
+        TT_Punctuation,
+    };
+
+    struct Token
+    {
+        TokenType       Type;
+        std::string     Text;
+        unsigned int    Line;
+    };
+
+    bool IsIdentifierStart(char c) { return isalpha((unsigned char)c) || (c == '_'); }
+    bool IsIdentifierChar(char c) { return isalnum((unsigned char)c) || (c == '_'); }
+
+    // Splits one line up. Fails on a character that can't start a token, leaving it in bad.
+    bool Tokenize(const std::string& text, unsigned int line, std::vector<Token>& tokens, char& bad)
+    {
+        static const char* kPairs[] = { "+=", "-=", "*=", "/=", "&&", "||", "==", "!=", "<=", ">=" };
+
+        size_t position = 0;
+        while (position < text.size())
+        {
+            char c = text[position];
+            if (isspace((unsigned char)c))
+            {
+                position++;
+                continue;
+            }
+
+            Token token;
+            token.Line = line;
+            size_t start = position;
+
+            if (IsIdentifierStart(c))
+            {
+                while ((position < text.size()) && IsIdentifierChar(text[position]))
+                    position++;
+                token.Type = TT_Identifier;
+            }
+            else if (isdigit((unsigned char)c) || ((c == '.') && (position + 1 < text.size()) && isdigit((unsigned char)text[position + 1])))
+            {
+                // Digits, a fraction, an exponent and a suffix - the value is worked out later
+                for (position++; position < text.size(); position++)
+                {
+                    char next = text[position];
+                    bool exponentSign = ((next == '+') || (next == '-')) && ((text[position - 1] == 'e') || (text[position - 1] == 'E'));
+                    if (!isalnum((unsigned char)next) && (next != '.') && !exponentSign)
+                        break;
+                }
+                token.Type = TT_Number;
+            }
+            else if ((c != 0) && (strchr("{}()[];:,.=+-*/<>!&|", c) != nullptr))
+            {
+                position++;
+                for (auto pair : kPairs)
+                {
+                    if (text.compare(start, 2, pair) == 0)
+                        position = start + 2;
+                }
+                token.Type = TT_Punctuation;
+            }
+            else
+            {
+                bad = c;
+                return false;
+            }
+
+            token.Text = text.substr(start, position - start);
+            tokens.push_back(token);
+        }
+        return true;
+    }
+
+    bool ParseFloat(const std::string& text, float& value)
+    {
+        // Drop the suffix - 1.0f, 2h and so on
+        std::string digits = text;
+        if ((digits.size() > 1) && (strchr("fFhHlL", digits.back()) != nullptr) && (digits.compare(0, 2, "0x") != 0))
+            digits.pop_back();
+
+        char* end = nullptr;
+        double parsed = (digits.compare(0, 2, "0x") == 0) ? (double)strtoul(digits.c_str(), &end, 16) : strtod(digits.c_str(), &end);
+        value = (float)parsed;
+        return (end != nullptr) && (*end == 0);
+    }
+
+    // Blanks out comments, keeping the newlines so line numbers still match
+    std::string StripComments(const std::string& source)
+    {
+        std::string text = source;
+        for (size_t position = 0; position < text.size(); position++)
+        {
+            if ((text[position] != '/') || (position + 1 >= text.size()))
+                continue;
+
+            if (text[position + 1] == '/')
+            {
+                for (; (position < text.size()) && (text[position] != '\n'); position++)
+                    text[position] = ' ';
+            }
+            else if (text[position + 1] == '*')
+            {
+                size_t end = text.find("*/", position + 2);
+                end = (end == std::string::npos) ? text.size() : end + 2;
+                for (; position < end; position++)
+                {
+                    if (text[position] != '\n')
+                        text[position] = ' ';
+                }
+                position--;
+            }
+        }
+        return text;
+    }
+
+    // ======================================================================================
+    // Preprocessor - object-like macros and conditionals, which is all variants need
+    // ======================================================================================
+    class Preprocessor
+    {
+    public:
+        Preprocessor(const char* filename, std::string& errors)
+            : mFilename(filename), mErrors(errors), mFailed(false) {}
+
+        void Define(const char* name, const char* value) { mMacros[name] = value; }
+
+        bool Run(const std::string& source, std::vector<Token>& tokens)
+        {
+            std::string text = StripComments(source);
+
+            unsigned int lineNumber = 0;
+            size_t start = 0;
+            while (!mFailed && (start < text.size()))
+            {
+                size_t end = text.find('\n', start);
+                if (end == std::string::npos)
+                    end = text.size();
+
+                std::string line = text.substr(start, end - start);
+                start = end + 1;
+                lineNumber++;
+
+                size_t first = line.find_first_not_of(" \t\r");
+                if ((first != std::string::npos) && (line[first] == '#'))
+                {
+                    Directive(line.substr(first + 1), lineNumber);
+                }
+                else if (IsActive())
+                {
+                    std::vector<Token> lineTokens;
+                    char bad = 0;
+                    if (!Tokenize(line, lineNumber, lineTokens, bad))
+                        Fail(lineNumber, std::string("unexpected character '") + bad + "'");
+
+                    for (auto& token : lineTokens)
+                        Expand(token, tokens, 0);
+                }
+            }
+
+            if (!mFailed && !mConditionals.empty())
+                Fail(lineNumber, "#if without a matching #endif");
+
+            Token end;
+            end.Type = TT_End;
+            end.Line = lineNumber;
+            tokens.push_back(end);
+
+            return !mFailed;
+        }
+
+    private:
+        struct Conditional
+        {
+            bool    EnclosingActive;
+            bool    Active;             // this branch is being kept
+            bool    Taken;              // some branch of this #if has been
+            bool    SeenElse;
+        };
+
+        bool IsActive() const { return mConditionals.empty() || mConditionals.back().Active; }
+
+        void Fail(unsigned int line, const std::string& message)
+        {
+            if (!mFailed)
+                AddError(mErrors, mFilename, line, message);
+            mFailed = true;
+        }
+
+        void Directive(const std::string& text, unsigned int line)
+        {
+            size_t nameStart = text.find_first_not_of(" \t");
+            size_t nameEnd = nameStart;
+            while ((nameEnd < text.size()) && IsIdentifierChar(text[nameEnd]))
+                nameEnd++;
+
+            std::string name = (nameStart == std::string::npos) ? "" : text.substr(nameStart, nameEnd - nameStart);
+            std::string rest = (nameStart == std::string::npos) ? "" : text.substr(nameEnd);
+
+            if ((name == "if") || (name == "ifdef") || (name == "ifndef"))
+            {
+                Conditional conditional;
+                conditional.EnclosingActive = IsActive();
+                conditional.Active = conditional.EnclosingActive && Condition(name, rest, line);
+                conditional.Taken = conditional.Active;
+                conditional.SeenElse = false;
+                mConditionals.push_back(conditional);
+                return;
+            }
+
+            if ((name == "elif") || (name == "else") || (name == "endif"))
+            {
+                if (mConditionals.empty() || (mConditionals.back().SeenElse && (name != "endif")))
+                {
+                    Fail(line, "#" + name + " without a matching #if");
+                    return;
+                }
+
+                Conditional& conditional = mConditionals.back();
+                if (name == "endif")
+                {
+                    mConditionals.pop_back();
+                }
+                else if (name == "else")
+                {
+                    conditional.Active = conditional.EnclosingActive && !conditional.Taken;
+                    conditional.Taken = true;
+                    conditional.SeenElse = true;
+                }
+                else
+                {
+                    conditional.Active = conditional.EnclosingActive && !conditional.Taken && Condition("if", rest, line);
+                    conditional.Taken = conditional.Taken || conditional.Active;
+                }
+                return;
+            }
+
+            if (!IsActive() || name.empty() || (name == "pragma"))
+                return;
+
+            if ((name == "define") || (name == "undef"))
+            {
+                size_t macroStart = rest.find_first_not_of(" \t");
+                size_t macroEnd = macroStart;
+                while ((macroEnd < rest.size()) && IsIdentifierChar(rest[macroEnd]))
+                    macroEnd++;
+
+                if ((macroStart == std::string::npos) || (macroStart == macroEnd) || !IsIdentifierStart(rest[macroStart]))
+                {
+                    Fail(line, "#" + name + " needs a macro name");
+                    return;
+                }
+
+                std::string macro = rest.substr(macroStart, macroEnd - macroStart);
+                if (name == "undef")
+                {
+                    mMacros.erase(macro);
+                }
+                else if ((macroEnd < rest.size()) && (rest[macroEnd] == '('))
+                {
+                    Fail(line, "function-like macros aren't supported");
+                }
+                else
+                {
+                    std::string value = rest.substr(macroEnd);
+                    size_t valueStart = value.find_first_not_of(" \t");
+                    size_t valueEnd = value.find_last_not_of(" \t\r");
+                    mMacros[macro] = (valueStart == std::string::npos) ? "" : value.substr(valueStart, valueEnd - valueStart + 1);
+                }
+                return;
+            }
+
+            if (name == "include")
+            {
+                Fail(line, "#include isn't supported");
+                return;
+            }
+
+            Fail(line, "#" + name + " isn't supported");
+        }
+
+        bool Condition(const std::string& directive, const std::string& text, unsigned int line)
+        {
+            std::vector<Token> tokens;
+            char bad = 0;
+            if (!Tokenize(text, line, tokens, bad))
+            {
+                Fail(line, std::string("unexpected character '") + bad + "'");
+                return false;
+            }
+
+            if (directive != "if")
+            {
+                if ((tokens.size() != 1) || (tokens[0].Type != TT_Identifier))
+                {
+                    Fail(line, "#" + directive + " needs a macro name");
+                    return false;
+                }
+                bool defined = (mMacros.find(tokens[0].Text) != mMacros.end());
+                return (directive == "ifdef") ? defined : !defined;
+            }
+
+            size_t position = 0;
+            long long value = EvaluateOr(tokens, position, line, 0);
+            if (position != tokens.size())
+                Fail(line, "unexpected '" + tokens[position].Text + "' in #if");
+            return value != 0;
+        }
+
+        // #if expressions - || && == != < > <= >= + - ! and defined(), on integers
+        long long EvaluateOr(const std::vector<Token>& tokens, size_t& position, unsigned int line, unsigned int depth)
+        {
+            long long value = EvaluateAnd(tokens, position, line, depth);
+            while ((position < tokens.size()) && (tokens[position].Text == "||"))
+            {
+                position++;
+                long long right = EvaluateAnd(tokens, position, line, depth);
+                value = (value != 0) || (right != 0);
+            }
+            return value;
+        }
+
+        long long EvaluateAnd(const std::vector<Token>& tokens, size_t& position, unsigned int line, unsigned int depth)
+        {
+            long long value = EvaluateComparison(tokens, position, line, depth);
+            while ((position < tokens.size()) && (tokens[position].Text == "&&"))
+            {
+                position++;
+                long long right = EvaluateComparison(tokens, position, line, depth);
+                value = (value != 0) && (right != 0);
+            }
+            return value;
+        }
+
+        long long EvaluateComparison(const std::vector<Token>& tokens, size_t& position, unsigned int line, unsigned int depth)
+        {
+            long long value = EvaluateAdditive(tokens, position, line, depth);
+            while (position < tokens.size())
+            {
+                const std::string& op = tokens[position].Text;
+                if ((op != "==") && (op != "!=") && (op != "<") && (op != ">") && (op != "<=") && (op != ">="))
+                    break;
+
+                position++;
+                long long right = EvaluateAdditive(tokens, position, line, depth);
+                value = (op == "==") ? (value == right) : (op == "!=") ? (value != right)
+                      : (op == "<") ? (value < right) : (op == ">") ? (value > right)
+                      : (op == "<=") ? (value <= right) : (value >= right);
+            }
+            return value;
+        }
+
+        long long EvaluateAdditive(const std::vector<Token>& tokens, size_t& position, unsigned int line, unsigned int depth)
+        {
+            long long value = EvaluateUnary(tokens, position, line, depth);
+            while ((position < tokens.size()) && ((tokens[position].Text == "+") || (tokens[position].Text == "-")))
+            {
+                bool add = (tokens[position++].Text == "+");
+                long long right = EvaluateUnary(tokens, position, line, depth);
+                value = add ? value + right : value - right;
+            }
+            return value;
+        }
+
+        long long EvaluateUnary(const std::vector<Token>& tokens, size_t& position, unsigned int line, unsigned int depth)
+        {
+            if (position >= tokens.size())
+            {
+                Fail(line, "#if expression ends early");
+                return 0;
+            }
+
+            const Token& token = tokens[position++];
+            if (token.Text == "!")
+                return !EvaluateUnary(tokens, position, line, depth);
+
+            if (token.Text == "-")
+                return -EvaluateUnary(tokens, position, line, depth);
+
+            if (token.Text == "(")
+            {
+                long long value = EvaluateOr(tokens, position, line, depth);
+                if ((position >= tokens.size()) || (tokens[position++].Text != ")"))
+                    Fail(line, "missing ')' in #if");
+                return value;
+            }
+
+            if (token.Type == TT_Number)
+                return strtoll(token.Text.c_str(), nullptr, 0);
+
+            if (token.Text == "defined")
+            {
+                bool parenthesized = (position < tokens.size()) && (tokens[position].Text == "(");
+                position += parenthesized ? 1 : 0;
+
+                if ((position >= tokens.size()) || (tokens[position].Type != TT_Identifier))
+                {
+                    Fail(line, "defined needs a macro name");
+                    return 0;
+                }
+
+                bool defined = (mMacros.find(tokens[position++].Text) != mMacros.end());
+                if (parenthesized && ((position >= tokens.size()) || (tokens[position++].Text != ")")))
+                    Fail(line, "missing ')' after defined");
+                return defined;
+            }
+
+            if (token.Type == TT_Identifier)
+            {
+                // A macro's value is an expression of its own. Anything undefined is zero.
+                auto macro = mMacros.find(token.Text);
+                if ((macro == mMacros.end()) || (depth >= kMaxMacroDepth))
+                    return 0;
+
+                std::vector<Token> valueTokens;
+                char bad = 0;
+                if (!Tokenize(macro->second, line, valueTokens, bad) || valueTokens.empty())
+                    return 0;
+
+                size_t valuePosition = 0;
+                return EvaluateOr(valueTokens, valuePosition, line, depth + 1);
+            }
+
+            Fail(line, "unexpected '" + token.Text + "' in #if");
+            return 0;
+        }
+
+        void Expand(const Token& token, std::vector<Token>& tokens, unsigned int depth)
+        {
+            auto macro = (token.Type == TT_Identifier) ? mMacros.find(token.Text) : mMacros.end();
+            if ((macro == mMacros.end()) || (depth >= kMaxMacroDepth))
+            {
+                tokens.push_back(token);
+                return;
+            }
+
+            std::vector<Token> valueTokens;
+            char bad = 0;
+            if (!Tokenize(macro->second, token.Line, valueTokens, bad))
+                Fail(token.Line, std::string("unexpected character '") + bad + "' in " + token.Text);
+
+            for (auto& valueToken : valueTokens)
+                Expand(valueToken, tokens, depth + 1);
+        }
+
+    private:
+        const char*                         mFilename;
+        std::string&                        mErrors;
+        bool                                mFailed;
+        std::map<std::string, std::string>  mMacros;
+        std::vector<Conditional>            mConditionals;
+    };
+
+    // ======================================================================================
+    // Types and values
+    // ======================================================================================
+    // Zero until ParseTypeName fills it in - a failed parse carries on with it
+    struct TypeInfo
+    {
+        TypeInfo() : Rows(0), Columns(0), Matrix(false) {}
+
+        unsigned int    Rows;
+        unsigned int    Columns;
+        bool            Matrix;
+
+        unsigned int GetCount() const { return Rows * Columns; }
+        bool operator==(const TypeInfo& other) const { return (Rows == other.Rows) && (Columns == other.Columns) && (Matrix == other.Matrix); }
+    };
+
+    TypeInfo MakeType(unsigned int rows, unsigned int columns, bool matrix)
+    {
+        TypeInfo type;
+        type.Rows = rows;
+        type.Columns = columns;
+        type.Matrix = matrix;
+        return type;
+    }
+
+    // float, floatN, floatNxM and matrix
+    bool ParseTypeName(const std::string& name, TypeInfo& type)
+    {
+        if (name == "matrix")
+        {
+            type = MakeType(4, 4, true);
+            return true;
+        }
+
+        if (name.compare(0, 5, "float") != 0)
+            return false;
+
+        std::string size = name.substr(5);
+        if (size.empty())
+        {
+            type = MakeType(1, 1, false);
+            return true;
+        }
+
+        if ((size.size() == 1) && (size[0] >= '1') && (size[0] <= '4'))
+        {
+            type = MakeType(1, size[0] - '0', false);
+            return true;
+        }
+
+        if ((size.size() == 3) && (size[0] >= '1') && (size[0] <= '4') && (size[1] == 'x') && (size[2] >= '1') && (size[2] <= '4'))
+        {
+            type = MakeType(size[0] - '0', size[2] - '0', true);
+            return true;
+        }
+
+        return false;
+    }
+
+    std::string GetTypeName(const TypeInfo& type)
+    {
+        char name[16];
+        if (type.Matrix)
+            snprintf(name, sizeof(name), "float%ux%u", type.Rows, type.Columns);
+        else if (type.Columns > 1)
+            snprintf(name, sizeof(name), "float%u", type.Columns);
+        else
+            snprintf(name, sizeof(name), "float");
+        return name;
+    }
+
+    // A register per component, row by row. Nothing is copied - swizzles and casts just
+    // pick registers.
+    struct Value
+    {
+        TypeInfo        Type;
+        unsigned short  Components[16];
+    };
+
+    Value MakeValue(const TypeInfo& type)
+    {
+        Value value;
+        value.Type = type;
+        memset(value.Components, 0, sizeof(value.Components));
+        return value;
+    }
+
+    // TEXCOORD1 is TEXCOORD, index 1
+    void SplitSemantic(const std::string& semantic, std::string& name, unsigned int& index)
+    {
+        size_t digits = semantic.size();
+        while ((digits > 0) && isdigit((unsigned char)semantic[digits - 1]))
+            digits--;
+
+        name = semantic.substr(0, digits);
+        index = (digits < semantic.size()) ? (unsigned int)atoi(semantic.c_str() + digits) : 0;
+    }
+
+    bool IsSystemValue(const char* semantic)
+    {
+        return (toupper((unsigned char)semantic[0]) == 'S') && (toupper((unsigned char)semantic[1]) == 'V') && (semantic[2] == '_');
+    }
+
+    // ======================================================================================
+    // Declarations
+    // ======================================================================================
+    struct StructMember
+    {
+        std::string     Name;
+        TypeInfo        Type;
+        std::string     Semantic;
+        bool            RowMajor;
+    };
+
+    struct StructDefinition
+    {
+        std::string                 Name;
+        std::vector<StructMember>   Members;
+    };
+
+    struct ConstantBufferDefinition
+    {
+        std::string     Name;
+        unsigned int    Slot;
+        bool            ExplicitSlot;
+        unsigned int    Size;
+        bool            Used;
+    };
+
+    struct ConstantDefinition
+    {
+        std::string     Name;
+        TypeInfo        Type;
+        unsigned int    Buffer;
+        unsigned int    Offset;
+        unsigned int    Size;
+        bool            RowMajor;
+        bool            Loaded;
+        Value           Registers;      // once loaded
+    };
+
+    struct ResourceDefinition
+    {
+        std::string         Name;
+        ShaderBindingType   Type;
+        unsigned int        Slot;
+        bool                ExplicitSlot;
+        bool                Used;
+    };
+
+    struct LocalVariable
+    {
+        std::string         Name;
+        int                 Struct;     // -1 for a float type
+        TypeInfo            Type;
+        std::vector<Value>  Values;     // one, or one per struct member
+        std::vector<bool>   Assigned;
+    };
+
+    // Constants and samples name their buffer or resource - slots are only settled once the
+    // whole shader has been seen
+    struct PendingConstant
+    {
+        unsigned int    Register;
+        unsigned int    Buffer;
+        unsigned int    Offset;
+    };
+
+    struct PendingSample
+    {
+        unsigned int    Instruction;
+        unsigned int    Texture;
+        unsigned int    Sampler;
+    };
+
+    // ======================================================================================
+    // Parser - generates code as it goes, there being no branches to worry about
+    // ======================================================================================
+    class ShaderParser
+    {
+    public:
+        ShaderParser(const ShaderCompileRequest& request, const std::vector<Token>& tokens, std::string& errors)
+            : mRequest(request), mTokens(tokens), mErrors(errors), mPosition(0), mFailed(false),
+              mCompiledEntryPoint(false), mReturned(false), mReturnStruct(-1), mRegisterCount(0) {}
+
+        bool Compile(CpuShaderProgram& program)
+        {
+            while (!mFailed && (Peek().Type != TT_End))
+                ParseGlobal();
+
+            if (!mFailed && !mCompiledEntryPoint)
+                Fail(Peek().Line, std::string("entry point '") + mRequest.EntryPoint + "' not found");
+
+            if (!mFailed)
+                Finish(program);
+
+            return !mFailed;
+        }
+
+    private:
+        // ---- Tokens ----
+        const Token& Peek(unsigned int ahead = 0) const
+        {
+            size_t index = mPosition + ahead;
+            return mTokens[(index < mTokens.size()) ? index : mTokens.size() - 1];
+        }
+
+        const Token& Next()
+        {
+            const Token& token = Peek();
+            if (mPosition + 1 < mTokens.size())
+                mPosition++;
+            return token;
+        }
+
+        bool IsNext(const char* text) const { return (Peek().Type != TT_End) && (Peek().Text == text); }
+
+        bool Accept(const char* text)
+        {
+            if (!IsNext(text))
+                return false;
+            Next();
+            return true;
+        }
+
+        bool Expect(const char* text)
+        {
+            if (Accept(text))
+                return true;
+            return Fail(Peek().Line, std::string("expected '") + text + "' but found " + Describe(Peek()));
+        }
+
+        std::string ExpectIdentifier(const char* what)
+        {
+            if (Peek().Type == TT_Identifier)
+                return Next().Text;
+            Fail(Peek().Line, std::string("expected ") + what + " but found " + Describe(Peek()));
+            return "";
+        }
+
+        static std::string Describe(const Token& token)
+        {
+            return (token.Type == TT_End) ? "the end of the file" : "'" + token.Text + "'";
+        }
+
+        bool Fail(unsigned int line, const std::string& message)
+        {
+            if (!mFailed)
+                AddError(mErrors, mRequest.Filename, line, message);
+            mFailed = true;
+            return false;
+        }
+
+        // ---- Lookups ----
+        int FindStruct(const std::string& name) const
+        {
+            for (unsigned int index = 0; index < mStructs.size(); index++)
+            {
+                if (mStructs[index].Name == name)
+                    return (int)index;
+            }
+            return -1;
+        }
+
+        int FindLocal(const std::string& name) const
+        {
+            for (unsigned int index = 0; index < mLocals.size(); index++)
+            {
+                if (mLocals[index].Name == name)
+                    return (int)index;
+            }
+            return -1;
+        }
+
+        int FindConstant(const std::string& name) const
+        {
+            for (unsigned int index = 0; index < mConstants.size(); index++)
+            {
+                if (mConstants[index].Name == name)
+                    return (int)index;
+            }
+            return -1;
+        }
+
+        int FindResource(const std::string& name) const
+        {
+            for (unsigned int index = 0; index < mResources.size(); index++)
+            {
+                if (mResources[index].Name == name)
+                    return (int)index;
+            }
+            return -1;
+        }
+
+        bool IsTypeName(const std::string& name) const
+        {
+            TypeInfo type;
+            return ParseTypeName(name, type) || (FindStruct(name) >= 0);
+        }
+
+        bool CheckGlobalName(const std::string& name, unsigned int line)
+        {
+            if ((FindConstant(name) >= 0) || (FindResource(name) >= 0) || (FindStruct(name) >= 0))
+                return Fail(line, "'" + name + "' is already defined");
+            return true;
+        }
+
+        // ---- Globals ----
+        void ParseGlobal()
+        {
+            if (Accept(";"))
+                return;
+
+            if (Accept("cbuffer"))
+                ParseConstantBuffer();
+            else if (Accept("struct"))
+                ParseStruct();
+            else if (IsNext("Texture2D") || IsNext("SamplerState"))
+                ParseResource();
+            else
+                ParseFunction();
+        }
+
+        // ": register(b0)", with the letter given
+        bool ParseRegister(char kind, unsigned int& slot)
+        {
+            unsigned int line = Peek().Line;
+            if (!Expect("register") || !Expect("("))
+                return false;
+
+            std::string name = ExpectIdentifier("a register");
+            if (mFailed)
+                return false;
+
+            if ((name.size() < 2) || (tolower((unsigned char)name[0]) != kind) || (name.find_first_not_of("0123456789", 1) != std::string::npos))
+                return Fail(line, std::string("expected a register like ") + kind + "0 but found '" + name + "'");
+
+            slot = (unsigned int)atoi(name.c_str() + 1);
+            if (slot >= kCpuShaderMaxSlots)
+                return Fail(line, "register '" + name + "' is past the last slot the CPU executor has");
+
+            return Expect(")");
+        }
+
+        void ParseConstantBuffer()
+        {
+            unsigned int line = Peek().Line;
+
+            ConstantBufferDefinition buffer;
+            buffer.Name = ExpectIdentifier("a cbuffer name");
+            buffer.Slot = 0;
+            buffer.ExplicitSlot = false;
+            buffer.Used = false;
+            for (auto& other : mBuffers)
+            {
+                if (other.Name == buffer.Name)
+                    Fail(line, "cbuffer '" + buffer.Name + "' is already defined");
+            }
+
+            if (Accept(":"))
+                buffer.ExplicitSlot = ParseRegister('b', buffer.Slot);
+
+            Expect("{");
+
+            unsigned int bufferIndex = (unsigned int)mBuffers.size();
+            unsigned int cursor = 0;
+            unsigned int end = 0;
+            while (!mFailed && !Accept("}"))
+            {
+                ConstantDefinition constant;
+                constant.Buffer = bufferIndex;
+                constant.Loaded = false;
+                constant.RowMajor = Accept("row_major");
+                if (!constant.RowMajor)
+                    Accept("column_major");
+
+                line = Peek().Line;
+                std::string typeName = ExpectIdentifier("a type");
+                if (!mFailed && !ParseTypeName(typeName, constant.Type))
+                    Fail(line, "cbuffers can only hold float types, not '" + typeName + "'");
+
+                constant.Name = ExpectIdentifier("a variable name");
+                CheckGlobalName(constant.Name, line);
+                if (IsNext("["))
+                    Fail(line, "arrays aren't supported");
+
+                // Matrices take a register per column, or per row if they're row_major
+                const TypeInfo& type = constant.Type;
+                constant.Size = !type.Matrix ? type.Columns * 4
+                              : constant.RowMajor ? (type.Rows - 1) * kRegisterSize + type.Columns * 4
+                              : (type.Columns - 1) * kRegisterSize + type.Rows * 4;
+
+                if (Accept(":"))
+                {
+                    // packoffset(c1) or packoffset(c1.y)
+                    Expect("packoffset");
+                    Expect("(");
+                    std::string registerName = ExpectIdentifier("a register");
+                    unsigned int component = 0;
+                    if (Accept("."))
+                    {
+                        std::string mask = ExpectIdentifier("a component");
+                        const char* components = "xyzw";
+                        const char* found = (mask.size() == 1) ? strchr(components, mask[0]) : nullptr;
+                        if (found == nullptr)
+                            Fail(line, "expected x, y, z or w but found '" + mask + "'");
+                        else
+                            component = (unsigned int)(found - components);
+                    }
+                    Expect(")");
+
+                    if (!mFailed && ((registerName.size() < 2) || (registerName[0] != 'c') || (registerName.find_first_not_of("0123456789", 1) != std::string::npos)))
+                        Fail(line, "expected a register like c0 but found '" + registerName + "'");
+
+                    constant.Offset = (unsigned int)atoi(registerName.c_str() + 1) * kRegisterSize + component * 4;
+                    if (!mFailed && (constant.Offset / kRegisterSize != (constant.Offset + constant.Size - 1) / kRegisterSize) && !type.Matrix)
+                        Fail(line, "'" + constant.Name + "' crosses a register boundary");
+                }
+                else
+                {
+                    // Nothing straddles a 16 byte register, and matrices start on a new one
+                    constant.Offset = cursor;
+                    if (type.Matrix || ((cursor % kRegisterSize) + constant.Size > kRegisterSize))
+                        constant.Offset = AlignUp(cursor, kRegisterSize);
+                }
+                Expect(";");
+
+                cursor = constant.Offset + constant.Size;
+                end = (cursor > end) ? cursor : end;
+                mConstants.push_back(constant);
+            }
+            Accept(";");
+
+            buffer.Size = AlignUp(end, kRegisterSize);
+            mBuffers.push_back(buffer);
+        }
+
+        void ParseStruct()
+        {
+            unsigned int line = Peek().Line;
+
+            StructDefinition definition;
+            definition.Name = ExpectIdentifier("a struct name");
+            CheckGlobalName(definition.Name, line);
+            Expect("{");
+
+            while (!mFailed && !Accept("}"))
+            {
+                StructMember member;
+                member.RowMajor = Accept("row_major");
+                if (!member.RowMajor)
+                    Accept("column_major");
+
+                line = Peek().Line;
+                std::string typeName = ExpectIdentifier("a type");
+                if (!mFailed && !ParseTypeName(typeName, member.Type))
+                    Fail(line, "struct members can only be float types, not '" + typeName + "'");
+
+                member.Name = ExpectIdentifier("a member name");
+                for (auto& other : definition.Members)
+                {
+                    if (other.Name == member.Name)
+                        Fail(line, "'" + member.Name + "' is already a member of " + definition.Name);
+                }
+
+                if (Accept(":"))
+                    member.Semantic = ExpectIdentifier("a semantic");
+                Expect(";");
+
+                definition.Members.push_back(member);
+            }
+            Expect(";");
+
+            mStructs.push_back(definition);
+        }
+
+        void ParseResource()
+        {
+            unsigned int line = Peek().Line;
+
+            ResourceDefinition resource;
+            resource.Type = (Next().Text == "Texture2D") ? SBT_Texture : SBT_Sampler;
+            resource.Slot = 0;
+            resource.ExplicitSlot = false;
+            resource.Used = false;
+
+            // Texture2D<float4> is the same texture
+            if ((resource.Type == SBT_Texture) && Accept("<"))
+            {
+                ExpectIdentifier("a type");
+                Expect(">");
+            }
+
+            resource.Name = ExpectIdentifier("a name");
+            CheckGlobalName(resource.Name, line);
+
+            if (Accept(":"))
+                resource.ExplicitSlot = ParseRegister((resource.Type == SBT_Texture) ? 't' : 's', resource.Slot);
+            Expect(";");
+
+            mResources.push_back(resource);
+        }
+
+        void ParseFunction()
+        {
+            unsigned int line = Peek().Line;
+            std::string returnType = ExpectIdentifier("a declaration");
+            std::string name = ExpectIdentifier("a name");
+            if (mFailed)
+                return;
+
+            if (!IsNext("("))
+            {
+                Fail(line, "'" + name + "' - only cbuffers, structs, textures, samplers and functions can be declared globally");
+                return;
+            }
+
+            if (name != mRequest.EntryPoint)
+            {
+                SkipFunction(name);
+                return;
+            }
+
+            if (mCompiledEntryPoint)
+            {
+                Fail(line, "'" + name + "' is defined twice");
+                return;
+            }
+
+            CompileEntryPoint(returnType, line);
+            mCompiledEntryPoint = true;
+        }
+
+        // Other functions are stepped over. Calling one is an error.
+        void SkipFunction(const std::string& name)
+        {
+            mFunctions.push_back(name);
+
+            unsigned int depth = 0;
+            while (!mFailed && (Peek().Type != TT_End))
+            {
+                const Token& token = Next();
+                if ((depth == 0) && (token.Text == ";"))
+                    return;
+
+                if ((token.Text == "{") || (token.Text == "("))
+                {
+                    depth++;
+                }
+                else if ((token.Text == "}") || (token.Text == ")"))
+                {
+                    depth--;
+                    if ((depth == 0) && (token.Text == "}"))
+                        return;
+                }
+            }
+            Fail(Peek().Line, "'" + name + "' doesn't end");
+        }
+
+        // ---- The entry point ----
+        void CompileEntryPoint(const std::string& returnType, unsigned int line)
+        {
+            Expect("(");
+            if (!Accept(")"))
+            {
+                do
+                {
+                    ParseParameter();
+                }
+                while (!mFailed && Accept(","));
+                Expect(")");
+            }
+
+            mReturnStruct = FindStruct(returnType);
+            if ((mReturnStruct < 0) && !ParseTypeName(returnType, mReturnType))
+                Fail(line, "the entry point has to return a struct or a float type, not '" + returnType + "'");
+
+            if (Accept(":"))
+                mReturnSemantic = ExpectIdentifier("a semantic");
+            else if (mReturnStruct < 0)
+                Fail(line, "the entry point's return value needs a semantic");
+
+            Expect("{");
+            while (!mFailed && !mReturned)
+                ParseStatement();
+            Expect("}");
+        }
+
+        void ParseParameter()
+        {
+            unsigned int line = Peek().Line;
+            if (IsNext("out") || IsNext("inout") || IsNext("uniform"))
+            {
+                Fail(line, Peek().Text + " parameters aren't supported");
+                return;
+            }
+            Accept("in");
+
+            bool rowMajor = Accept("row_major");
+            if (!rowMajor)
+                Accept("column_major");
+
+            std::string typeName = ExpectIdentifier("a type");
+            LocalVariable variable;
+            variable.Name = ExpectIdentifier("a parameter name");
+            variable.Struct = FindStruct(typeName);
+            if (mFailed)
+                return;
+
+            if (FindLocal(variable.Name) >= 0)
+            {
+                Fail(line, "'" + variable.Name + "' is already defined");
+                return;
+            }
+
+            if (variable.Struct >= 0)
+            {
+                for (auto& member : mStructs[variable.Struct].Members)
+                {
+                    if (member.Semantic.empty())
+                        Fail(line, typeName + "." + member.Name + " needs a semantic to be an input");
+
+                    variable.Values.push_back(AddInput(member.Semantic, member.Type, member.RowMajor, line));
+                    variable.Assigned.push_back(true);
+                }
+            }
+            else
+            {
+                if (!ParseTypeName(typeName, variable.Type))
+                {
+                    Fail(line, "'" + typeName + "' isn't a type");
+                    return;
+                }
+
+                Expect(":");
+                std::string semantic = ExpectIdentifier("a semantic");
+                variable.Values.push_back(AddInput(semantic, variable.Type, rowMajor, line));
+                variable.Assigned.push_back(true);
+            }
+
+            mLocals.push_back(variable);
+        }
+
+        // Matrices take an attribute per row if they're row_major, or per column if not
+        void SplitAttributes(const std::string& semantic, const TypeInfo& type, bool rowMajor, std::vector<CpuShaderAttribute>& attributes,
+                             Value& value, bool allocate, unsigned int line)
+        {
+            std::string name;
+            unsigned int index = 0;
+            SplitSemantic(semantic, name, index);
+
+            if (name.size() >= kCpuShaderMaxSemantic)
+            {
+                Fail(line, "semantic '" + semantic + "' is too long");
+                return;
+            }
+
+            unsigned int count = type.Matrix ? (rowMajor ? type.Rows : type.Columns) : 1;
+            unsigned int components = type.Matrix ? (rowMajor ? type.Columns : type.Rows) : type.Columns;
+
+            for (unsigned int attributeIndex = 0; attributeIndex < count; attributeIndex++)
+            {
+                CpuShaderAttribute attribute;
+                memset(&attribute, 0, sizeof(attribute));
+                strcpy(attribute.SemanticName, name.c_str());
+                attribute.SemanticIndex = index + attributeIndex;
+                attribute.ComponentCount = components;
+
+                for (auto& other : attributes)
+                {
+                    if ((other.SemanticIndex == attribute.SemanticIndex) && (strcmp(other.SemanticName, attribute.SemanticName) == 0))
+                        Fail(line, "semantic '" + semantic + "' is used twice");
+                }
+
+                for (unsigned int component = 0; component < components; component++)
+                {
+                    unsigned int element = !type.Matrix ? component
+                                         : rowMajor ? attributeIndex * type.Columns + component
+                                         : component * type.Columns + attributeIndex;
+                    if (allocate)
+                        value.Components[element] = NewRegister();
+                    attribute.Registers[component] = value.Components[element];
+                }
+
+                attributes.push_back(attribute);
+            }
+        }
+
+        Value AddInput(const std::string& semantic, const TypeInfo& type, bool rowMajor, unsigned int line)
+        {
+            Value value = MakeValue(type);
+            SplitAttributes(semantic, type, rowMajor, mInputs, value, true, line);
+            return value;
+        }
+
+        void AddOutput(const std::string& semantic, bool rowMajor, Value value, unsigned int line)
+        {
+            SplitAttributes(semantic, value.Type, rowMajor, mOutputs, value, false, line);
+        }
+
+        // ---- Statements ----
+        void ParseStatement()
+        {
+            const Token& token = Peek();
+            unsigned int line = token.Line;
+
+            if (Accept(";"))
+                return;
+
+            if (Accept("return"))
+            {
+                ParseReturn(line);
+                return;
+            }
+
+            static const char* kUnsupported[] = { "if", "else", "for", "while", "do", "switch", "discard", "clip", "break", "continue" };
+            for (auto keyword : kUnsupported)
+            {
+                if (token.Text == keyword)
+                {
+                    Fail(line, "'" + token.Text + "' isn't supported - the CPU compiler only takes straight line code");
+                    return;
+                }
+            }
+
+            if ((token.Text == "{") || (token.Text == "}") || (token.Type == TT_End))
+            {
+                Fail(line, "the entry point has to end with a return");
+                return;
+            }
+
+            Accept("const");
+            if (IsTypeName(Peek().Text) && (Peek(1).Type == TT_Identifier))
+                ParseDeclaration();
+            else
+                ParseAssignment();
+        }
+
+        void ParseDeclaration()
+        {
+            std::string typeName = Next().Text;
+            int structIndex = FindStruct(typeName);
+
+            TypeInfo type = MakeType(1, 1, false);
+            if (structIndex < 0)
+                ParseTypeName(typeName, type);
+
+            do
+            {
+                unsigned int line = Peek().Line;
+
+                LocalVariable variable;
+                variable.Name = ExpectIdentifier("a variable name");
+                variable.Struct = structIndex;
+                variable.Type = type;
+                if (mFailed)
+                    return;
+
+                if (FindLocal(variable.Name) >= 0)
+                {
+                    Fail(line, "'" + variable.Name + "' is already defined");
+                    return;
+                }
+
+                if (structIndex >= 0)
+                {
+                    // The only initializer for a struct is (Struct)0
+                    bool zeroed = Accept("=");
+                    if (zeroed)
+                    {
+                        Expect("(");
+                        Expect(typeName.c_str());
+                        Expect(")");
+                        if (!mFailed && (Next().Text != "0"))
+                            Fail(line, "structs can only be initialized with (" + typeName + ")0");
+                    }
+
+                    for (auto& member : mStructs[structIndex].Members)
+                    {
+                        Value value = MakeValue(member.Type);
+                        if (zeroed)
+                            value = Broadcast(Literal(0.0f), member.Type);
+                        variable.Values.push_back(value);
+                        variable.Assigned.push_back(zeroed);
+                    }
+                }
+                else
+                {
+                    bool initialized = Accept("=");
+                    variable.Values.push_back(initialized ? Convert(ParseExpression(), type, line) : MakeValue(type));
+                    variable.Assigned.push_back(initialized);
+                }
+
+                mLocals.push_back(variable);
+            }
+            while (!mFailed && Accept(","));
+
+            Expect(";");
+        }
+
+        void ParseAssignment()
+        {
+            unsigned int line = Peek().Line;
+            std::string name = ExpectIdentifier("a statement");
+            if (mFailed)
+                return;
+
+            int local = FindLocal(name);
+            if (local < 0)
+            {
+                Fail(line, (FindConstant(name) >= 0) ? "'" + name + "' is a constant and can't be assigned to" : "'" + name + "' isn't defined");
+                return;
+            }
+
+            // Which value - the variable, or one member of it
+            unsigned int slot = 0;
+            std::string description = name;
+            if (mLocals[local].Struct >= 0)
+            {
+                Expect(".");
+                std::string memberName = ExpectIdentifier("a member");
+                if (!FindMember(mLocals[local].Struct, memberName, slot, line))
+                    return;
+                description += "." + memberName;
+            }
+
+            // An optional write mask
+            std::vector<unsigned int> mask;
+            if (Accept("."))
+            {
+                std::string swizzle = ExpectIdentifier("a write mask");
+                if (!ParseSwizzle(mLocals[local].Values[slot].Type, swizzle, true, mask, line))
+                    return;
+            }
+
+            std::string op = Next().Text;
+            if ((op != "=") && (op != "+=") && (op != "-=") && (op != "*=") && (op != "/="))
+            {
+                Fail(line, "expected an assignment but found '" + op + "'");
+                return;
+            }
+
+            Value source = ParseExpression();
+            Expect(";");
+            if (mFailed)
+                return;
+
+            Value& target = mLocals[local].Values[slot];
+            if (((op != "=") || !mask.empty()) && !mLocals[local].Assigned[slot])
+            {
+                Fail(line, "'" + description + "' is used before it's set");
+                return;
+            }
+
+            Value current = mask.empty() ? target : Select(target, mask);
+            if (op != "=")
+            {
+                CpuShaderOp arithmetic = (op == "+=") ? CSO_Add : (op == "-=") ? CSO_Subtract : (op == "*=") ? CSO_Multiply : CSO_Divide;
+                source = Binary(arithmetic, current, source, line);
+            }
+
+            Value converted = Convert(source, current.Type, line);
+            if (mask.empty())
+            {
+                target = converted;
+            }
+            else
+            {
+                for (unsigned int component = 0; component < mask.size(); component++)
+                    target.Components[mask[component]] = converted.Components[component];
+            }
+            mLocals[local].Assigned[slot] = true;
+        }
+
+        void ParseReturn(unsigned int line)
+        {
+            if (mReturnStruct >= 0)
+            {
+                const StructDefinition& definition = mStructs[mReturnStruct];
+                std::string name = ExpectIdentifier("a variable to return");
+                int local = FindLocal(name);
+                if (!mFailed && ((local < 0) || (mLocals[local].Struct != mReturnStruct)))
+                {
+                    Fail(line, "return a " + definition.Name + " variable");
+                    return;
+                }
+                Expect(";");
+                if (mFailed)
+                    return;
+
+                for (unsigned int member = 0; member < definition.Members.size(); member++)
+                {
+                    const StructMember& declaration = definition.Members[member];
+                    if (declaration.Semantic.empty())
+                        Fail(line, definition.Name + "." + declaration.Name + " needs a semantic to be an output");
+                    else if (!mLocals[local].Assigned[member])
+                        Fail(line, name + "." + declaration.Name + " isn't set before it's returned");
+                    else
+                        AddOutput(declaration.Semantic, declaration.RowMajor, mLocals[local].Values[member], line);
+                }
+            }
+            else
+            {
+                Value value = Convert(ParseExpression(), mReturnType, line);
+                Expect(";");
+                AddOutput(mReturnSemantic, false, value, line);
+            }
+
+            mReturned = true;
+            if (!mFailed && !IsNext("}"))
+                Fail(Peek().Line, "nothing can come after the return");
+        }
+
+        bool FindMember(int structIndex, const std::string& name, unsigned int& member, unsigned int line)
+        {
+            const StructDefinition& definition = mStructs[structIndex];
+            for (member = 0; member < definition.Members.size(); member++)
+            {
+                if (definition.Members[member].Name == name)
+                    return true;
+            }
+            return Fail(line, "'" + name + "' isn't a member of " + definition.Name);
+        }
+
+        // ---- Expressions ----
+        Value ParseExpression()
+        {
+            Value value = ParseMultiplicative();
+            while (!mFailed && (IsNext("+") || IsNext("-")))
+            {
+                unsigned int line = Peek().Line;
+                CpuShaderOp op = (Next().Text == "+") ? CSO_Add : CSO_Subtract;
+                value = Binary(op, value, ParseMultiplicative(), line);
+            }
+            return value;
+        }
+
+        Value ParseMultiplicative()
+        {
+            Value value = ParseUnary();
+            while (!mFailed && (IsNext("*") || IsNext("/")))
+            {
+                unsigned int line = Peek().Line;
+                CpuShaderOp op = (Next().Text == "*") ? CSO_Multiply : CSO_Divide;
+                value = Binary(op, value, ParseUnary(), line);
+            }
+            return value;
+        }
+
+        Value ParseUnary()
+        {
+            unsigned int line = Peek().Line;
+            if (Accept("-"))
+                return Negate(ParseUnary());
+
+            if (Accept("+"))
+                return ParseUnary();
+
+            // (float3x3)m
+            TypeInfo type;
+            if (IsNext("(") && ParseTypeName(Peek(1).Text, type) && (Peek(2).Text == ")"))
+            {
+                Next();
+                Next();
+                Next();
+                return Convert(ParseUnary(), type, line);
+            }
+
+            return ParsePostfix(ParsePrimary());
+        }
+
+        Value ParsePostfix(Value value)
+        {
+            while (!mFailed)
+            {
+                unsigned int line = Peek().Line;
+                if (Accept("."))
+                {
+                    std::vector<unsigned int> selection;
+                    std::string swizzle = ExpectIdentifier("a swizzle");
+                    if (ParseSwizzle(value.Type, swizzle, false, selection, line))
+                        value = Select(value, selection);
+                }
+                else if (Accept("["))
+                {
+                    const Token& index = Next();
+                    Expect("]");
+                    if (mFailed)
+                        break;
+
+                    unsigned int element = (unsigned int)atoi(index.Text.c_str());
+                    unsigned int limit = value.Type.Matrix ? value.Type.Rows : value.Type.Columns;
+                    if ((index.Type != TT_Number) || (index.Text.find_first_not_of("0123456789") != std::string::npos) || (element >= limit))
+                    {
+                        Fail(line, "indices have to be constants in range");
+                        break;
+                    }
+
+                    // A row of a matrix, or a component of a vector
+                    Value indexed = MakeValue(MakeType(1, value.Type.Matrix ? value.Type.Columns : 1, false));
+                    for (unsigned int component = 0; component < indexed.Type.Columns; component++)
+                        indexed.Components[component] = value.Components[value.Type.Matrix ? element * value.Type.Columns + component : element];
+                    value = indexed;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            return value;
+        }
+
+        Value ParsePrimary()
+        {
+            const Token& token = Next();
+            unsigned int line = token.Line;
+            Value failed = MakeValue(MakeType(1, 1, false));
+
+            if (token.Type == TT_Number)
+            {
+                float number = 0.0f;
+                if (!ParseFloat(token.Text, number))
+                    Fail(line, "'" + token.Text + "' isn't a number");
+                return Literal(number);
+            }
+
+            if (token.Text == "(")
+            {
+                Value value = ParseExpression();
+                Expect(")");
+                return value;
+            }
+
+            if (token.Type != TT_Identifier)
+            {
+                Fail(line, "unexpected " + Describe(token));
+                return failed;
+            }
+
+            std::string name = token.Text;
+            if (IsNext("("))
+            {
+                std::vector<Value> arguments;
+                ParseArguments(arguments);
+                if (mFailed)
+                    return failed;
+
+                TypeInfo type;
+                if (ParseTypeName(name, type))
+                    return Construct(type, arguments, line);
+                return CallIntrinsic(name, arguments, line);
+            }
+
+            int local = FindLocal(name);
+            if (local >= 0)
+            {
+                unsigned int slot = 0;
+                std::string description = name;
+                if (mLocals[local].Struct >= 0)
+                {
+                    // Structs are only ever read a member at a time
+                    if (!Expect("."))
+                        return failed;
+                    std::string member = ExpectIdentifier("a member");
+                    if (!FindMember(mLocals[local].Struct, member, slot, line))
+                        return failed;
+                    description += "." + member;
+                }
+
+                if (!mLocals[local].Assigned[slot])
+                {
+                    Fail(line, "'" + description + "' is used before it's set");
+                    return failed;
+                }
+                return mLocals[local].Values[slot];
+            }
+
+            int constant = FindConstant(name);
+            if (constant >= 0)
+                return LoadConstant((unsigned int)constant);
+
+            int resource = FindResource(name);
+            if ((resource >= 0) && (mResources[resource].Type == SBT_Texture))
+                return ParseSample((unsigned int)resource, line);
+
+            if (resource >= 0)
+                Fail(line, "samplers can only be passed to Sample");
+            else if (FindStruct(name) >= 0)
+                Fail(line, "'" + name + "' is a struct, not a value");
+            else
+                Fail(line, "'" + name + "' isn't defined");
+            return failed;
+        }
+
+        void ParseArguments(std::vector<Value>& arguments)
+        {
+            Expect("(");
+            if (Accept(")"))
+                return;
+
+            do
+            {
+                arguments.push_back(ParseExpression());
+            }
+            while (!mFailed && Accept(","));
+            Expect(")");
+        }
+
+        // texture.Sample(sampler, uv)
+        Value ParseSample(unsigned int texture, unsigned int line)
+        {
+            Value result = MakeValue(MakeType(1, 4, false));
+            Expect(".");
+            std::string method = ExpectIdentifier("a method");
+            if (!mFailed && (method != "Sample"))
+            {
+                Fail(line, "'" + method + "' isn't supported - textures can only be sampled with Sample");
+                return result;
+            }
+
+            Expect("(");
+            std::string samplerName = ExpectIdentifier("a sampler");
+            int sampler = FindResource(samplerName);
+            if (!mFailed && ((sampler < 0) || (mResources[sampler].Type != SBT_Sampler)))
+            {
+                Fail(line, "'" + samplerName + "' isn't a sampler");
+                return result;
+            }
+            Expect(",");
+            Value coordinates = Convert(ParseExpression(), MakeType(1, 2, false), line);
+            Expect(")");
+            if (mFailed)
+                return result;
+
+            mResources[texture].Used = true;
+            mResources[sampler].Used = true;
+
+            // The four results have to be in consecutive registers
+            PendingSample sample;
+            sample.Instruction = (unsigned int)mInstructions.size();
+            sample.Texture = texture;
+            sample.Sampler = (unsigned int)sampler;
+            mSamples.push_back(sample);
+
+            unsigned short dest = NewRegister();
+            for (unsigned int component = 1; component < 4; component++)
+                NewRegister();
+
+            CpuShaderInstruction instruction;
+            memset(&instruction, 0, sizeof(instruction));
+            instruction.Op = CSO_Sample;
+            instruction.Dest = dest;
+            instruction.Source[0] = coordinates.Components[0];
+            instruction.Source[1] = coordinates.Components[1];
+            mInstructions.push_back(instruction);
+
+            for (unsigned int component = 0; component < 4; component++)
+                result.Components[component] = (unsigned short)(dest + component);
+            return result;
+        }
+
+        // ---- Code generation ----
+        unsigned short NewRegister()
+        {
+            if (mRegisterCount >= kMaxRegister)
+            {
+                Fail(Peek().Line, "the shader needs more registers than the CPU executor has");
+                return 0;
+            }
+            return (unsigned short)mRegisterCount++;
+        }
+
+        unsigned short Emit(CpuShaderOp op, unsigned short a, unsigned short b = 0, unsigned short c = 0)
+        {
+            CpuShaderInstruction instruction;
+            memset(&instruction, 0, sizeof(instruction));
+            instruction.Op = (unsigned short)op;
+            instruction.Dest = NewRegister();
+            instruction.Source[0] = a;
+            instruction.Source[1] = b;
+            instruction.Source[2] = c;
+            mInstructions.push_back(instruction);
+            return instruction.Dest;
+        }
+
+        Value Literal(float number)
+        {
+            unsigned int bits;
+            memcpy(&bits, &number, sizeof(bits));
+
+            auto found = mLiteralRegisters.find(bits);
+            unsigned short reg = 0;
+            if (found != mLiteralRegisters.end())
+            {
+                reg = found->second;
+            }
+            else
+            {
+                reg = NewRegister();
+                mLiteralRegisters[bits] = reg;
+                mLiteralValues[reg] = number;
+            }
+
+            Value value = MakeValue(MakeType(1, 1, false));
+            value.Components[0] = reg;
+            return value;
+        }
+
+        Value LoadConstant(unsigned int index)
+        {
+            ConstantDefinition& constant = mConstants[index];
+            if (constant.Loaded)
+                return constant.Registers;
+
+            const TypeInfo& type = constant.Type;
+            constant.Registers = MakeValue(type);
+            for (unsigned int row = 0; row < type.Rows; row++)
+            {
+                for (unsigned int column = 0; column < type.Columns; column++)
+                {
+                    PendingConstant pending;
+                    pending.Register = NewRegister();
+                    pending.Buffer = constant.Buffer;
+                    pending.Offset = constant.Offset
+                                   + (!type.Matrix ? column * 4
+                                   : constant.RowMajor ? row * kRegisterSize + column * 4
+                                   : column * kRegisterSize + row * 4);
+                    mPendingConstants.push_back(pending);
+
+                    constant.Registers.Components[row * type.Columns + column] = (unsigned short)pending.Register;
+                }
+            }
+
+            constant.Loaded = true;
+            mBuffers[constant.Buffer].Used = true;
+            return constant.Registers;
+        }
+
+        Value Broadcast(const Value& scalar, const TypeInfo& type)
+        {
+            Value value = MakeValue(type);
+            for (unsigned int component = 0; component < type.GetCount(); component++)
+                value.Components[component] = scalar.Components[0];
+            return value;
+        }
+
+        // Implicit and explicit conversions alike - scalars spread out, and vectors and matrices
+        // are cut down to size
+        Value Convert(const Value& value, const TypeInfo& type, unsigned int line)
+        {
+            const TypeInfo& from = value.Type;
+            if (from == type)
+                return value;
+
+            if (from.GetCount() == 1)
+                return Broadcast(value, type);
+
+            Value converted = MakeValue(type);
+            if (!from.Matrix && !type.Matrix && (type.Columns <= from.Columns))
+            {
+                for (unsigned int component = 0; component < type.Columns; component++)
+                    converted.Components[component] = value.Components[component];
+                return converted;
+            }
+
+            if (from.Matrix && type.Matrix && (type.Rows <= from.Rows) && (type.Columns <= from.Columns))
+            {
+                for (unsigned int row = 0; row < type.Rows; row++)
+                {
+                    for (unsigned int column = 0; column < type.Columns; column++)
+                        converted.Components[row * type.Columns + column] = value.Components[row * from.Columns + column];
+                }
+                return converted;
+            }
+
+            if (from.GetCount() == type.GetCount())
+            {
+                memcpy(converted.Components, value.Components, sizeof(converted.Components));
+                return converted;
+            }
+
+            Fail(line, "can't convert " + GetTypeName(from) + " to " + GetTypeName(type));
+            return converted;
+        }
+
+        // Brings a and b to the same type for a component by component operation
+        void Unify(Value& a, Value& b, unsigned int line)
+        {
+            if (a.Type == b.Type)
+                return;
+
+            if ((a.Type.GetCount() == 1) || (b.Type.GetCount() == 1))
+            {
+                TypeInfo type = (a.Type.GetCount() == 1) ? b.Type : a.Type;
+                a = Convert(a, type, line);
+                b = Convert(b, type, line);
+                return;
+            }
+
+            if (a.Type.Matrix != b.Type.Matrix)
+            {
+                Fail(line, "can't combine " + GetTypeName(a.Type) + " and " + GetTypeName(b.Type));
+                return;
+            }
+
+            TypeInfo type = MakeType((a.Type.Rows < b.Type.Rows) ? a.Type.Rows : b.Type.Rows,
+                                     (a.Type.Columns < b.Type.Columns) ? a.Type.Columns : b.Type.Columns,
+                                     a.Type.Matrix);
+            a = Convert(a, type, line);
+            b = Convert(b, type, line);
+        }
+
+        Value Binary(CpuShaderOp op, Value a, Value b, unsigned int line)
+        {
+            Unify(a, b, line);
+
+            Value result = MakeValue(a.Type);
+            for (unsigned int component = 0; component < a.Type.GetCount(); component++)
+                result.Components[component] = Emit(op, a.Components[component], b.Components[component]);
+            return result;
+        }
+
+        Value Unary(CpuShaderOp op, const Value& a)
+        {
+            Value result = MakeValue(a.Type);
+            for (unsigned int component = 0; component < a.Type.GetCount(); component++)
+                result.Components[component] = Emit(op, a.Components[component]);
+            return result;
+        }
+
+        Value Negate(const Value& value)
+        {
+            // Negative literals stay literals
+            Value result = MakeValue(value.Type);
+            for (unsigned int component = 0; component < value.Type.GetCount(); component++)
+            {
+                auto literal = mLiteralValues.find(value.Components[component]);
+                result.Components[component] = (literal != mLiteralValues.end())
+                    ? Literal(-literal->second).Components[0]
+                    : Emit(CSO_Subtract, Literal(0.0f).Components[0], value.Components[component]);
+            }
+            return result;
+        }
+
+        // Sum of a[i] * b[i], a multiply then multiply-adds
+        unsigned short Dot(const unsigned short* a, unsigned int aStride, const unsigned short* b, unsigned int bStride, unsigned int count)
+        {
+            unsigned short sum = Emit(CSO_Multiply, a[0], b[0]);
+            for (unsigned int index = 1; index < count; index++)
+                sum = Emit(CSO_MultiplyAdd, a[index * aStride], b[index * bStride], sum);
+            return sum;
+        }
+
+        Value Select(const Value& value, const std::vector<unsigned int>& selection)
+        {
+            Value result = MakeValue(MakeType(1, (unsigned int)selection.size(), false));
+            for (unsigned int component = 0; component < selection.size(); component++)
+                result.Components[component] = value.Components[selection[component]];
+            return result;
+        }
+
+        // xyzw or rgba. A write mask can't name a component twice.
+        bool ParseSwizzle(const TypeInfo& type, const std::string& swizzle, bool writeMask, std::vector<unsigned int>& selection, unsigned int line)
+        {
+            if (mFailed)
+                return false;
+
+            if (type.Matrix)
+                return Fail(line, "matrix swizzles aren't supported");
+
+            const char* sets[2] = { "xyzw", "rgba" };
+            const char* set = (strchr(sets[0], swizzle[0]) != nullptr) ? sets[0] : sets[1];
+
+            if (swizzle.size() > 4)
+                return Fail(line, "'" + swizzle + "' isn't a swizzle");
+
+            for (auto letter : swizzle)
+            {
+                const char* found = strchr(set, letter);
+                unsigned int component = (found != nullptr) ? (unsigned int)(found - set) : 4;
+                if ((letter == 0) || (found == nullptr) || (component >= type.Columns))
+                    return Fail(line, "'" + swizzle + "' isn't a swizzle of " + GetTypeName(type));
+
+                for (auto previous : selection)
+                {
+                    if (writeMask && (previous == component))
+                        return Fail(line, "'" + swizzle + "' writes a component twice");
+                }
+                selection.push_back(component);
+            }
+            return true;
+        }
+
+        Value Construct(const TypeInfo& type, const std::vector<Value>& arguments, unsigned int line)
+        {
+            if ((arguments.size() == 1) && (arguments[0].Type.GetCount() == 1))
+                return Broadcast(arguments[0], type);
+
+            Value result = MakeValue(type);
+            unsigned int count = 0;
+            for (auto& argument : arguments)
+            {
+                for (unsigned int component = 0; component < argument.Type.GetCount(); component++)
+                {
+                    if (count < 16)
+                        result.Components[count] = argument.Components[component];
+                    count++;
+                }
+            }
+
+            if (count != type.GetCount())
+                Fail(line, "wrong number of components for " + GetTypeName(type));
+            return result;
+        }
+
+        bool CheckArguments(const std::string& name, const std::vector<Value>& arguments, unsigned int count, unsigned int line)
+        {
+            if (arguments.size() == count)
+                return true;
+
+            char message[64];
+            snprintf(message, sizeof(message), " takes %u argument%s", count, (count == 1) ? "" : "s");
+            return Fail(line, name + message);
+        }
+
+        Value CallIntrinsic(const std::string& name, const std::vector<Value>& arguments, unsigned int line)
+        {
+            Value failed = MakeValue(MakeType(1, 1, false));
+
+            if (name == "mul")
+                return CheckArguments(name, arguments, 2, line) ? Multiply(arguments[0], arguments[1], line) : failed;
+
+            if ((name == "dot") || (name == "cross") || (name == "min") || (name == "max"))
+            {
+                if (!CheckArguments(name, arguments, 2, line))
+                    return failed;
+
+                Value a = arguments[0];
+                Value b = arguments[1];
+                if ((name == "min") || (name == "max"))
+                    return Binary((name == "min") ? CSO_Min : CSO_Max, a, b, line);
+
+                if (a.Type.Matrix || b.Type.Matrix)
+                {
+                    Fail(line, name + " takes vectors");
+                    return failed;
+                }
+
+                Unify(a, b, line);
+                if (name == "dot")
+                {
+                    Value result = MakeValue(MakeType(1, 1, false));
+                    result.Components[0] = Dot(a.Components, 1, b.Components, 1, a.Type.Columns);
+                    return result;
+                }
+
+                if (a.Type.Columns != 3)
+                {
+                    Fail(line, "cross takes float3s");
+                    return failed;
+                }
+
+                Value result = MakeValue(a.Type);
+                for (unsigned int component = 0; component < 3; component++)
+                {
+                    unsigned int next = (component + 1) % 3;
+                    unsigned int last = (component + 2) % 3;
+                    unsigned short left = Emit(CSO_Multiply, a.Components[next], b.Components[last]);
+                    unsigned short right = Emit(CSO_Multiply, a.Components[last], b.Components[next]);
+                    result.Components[component] = Emit(CSO_Subtract, left, right);
+                }
+                return result;
+            }
+
+            if ((name == "saturate") || (name == "abs") || (name == "sqrt") || (name == "rsqrt"))
+            {
+                if (!CheckArguments(name, arguments, 1, line))
+                    return failed;
+
+                CpuShaderOp op = (name == "saturate") ? CSO_Saturate : (name == "abs") ? CSO_Abs : (name == "sqrt") ? CSO_Sqrt : CSO_ReciprocalSqrt;
+                return Unary(op, arguments[0]);
+            }
+
+            if ((name == "normalize") || (name == "length"))
+            {
+                if (!CheckArguments(name, arguments, 1, line))
+                    return failed;
+
+                const Value& v = arguments[0];
+                if (v.Type.Matrix)
+                {
+                    Fail(line, name + " takes a vector");
+                    return failed;
+                }
+
+                Value lengthSquared = MakeValue(MakeType(1, 1, false));
+                lengthSquared.Components[0] = Dot(v.Components, 1, v.Components, 1, v.Type.Columns);
+                if (name == "length")
+                    return Unary(CSO_Sqrt, lengthSquared);
+
+                return Binary(CSO_Multiply, v, Unary(CSO_ReciprocalSqrt, lengthSquared), line);
+            }
+
+            if (name == "clamp")
+            {
+                if (!CheckArguments(name, arguments, 3, line))
+                    return failed;
+                return Binary(CSO_Min, Binary(CSO_Max, arguments[0], arguments[1], line), arguments[2], line);
+            }
+
+            if (name == "lerp")
+            {
+                if (!CheckArguments(name, arguments, 3, line))
+                    return failed;
+
+                // a + (b - a) * t
+                Value a = arguments[0];
+                Value difference = Binary(CSO_Subtract, arguments[1], a, line);
+                Value t = arguments[2];
+                Unify(difference, t, line);
+                Unify(difference, a, line);
+
+                Value result = MakeValue(difference.Type);
+                for (unsigned int component = 0; component < result.Type.GetCount(); component++)
+                    result.Components[component] = Emit(CSO_MultiplyAdd, difference.Components[component], t.Components[component], a.Components[component]);
+                return result;
+            }
+
+            if (std::find(mFunctions.begin(), mFunctions.end(), name) != mFunctions.end())
+                Fail(line, "calls to '" + name + "' aren't supported - only the entry point is compiled");
+            else
+                Fail(line, "'" + name + "' isn't a function the CPU compiler knows");
+            return failed;
+        }
+
+        // mul(a, b), the matrix product with vectors as rows on the left and columns on the right
+        Value Multiply(const Value& a, const Value& b, unsigned int line)
+        {
+            const TypeInfo& left = a.Type;
+            const TypeInfo& right = b.Type;
+
+            if ((left.GetCount() == 1) || (right.GetCount() == 1))
+                return Binary(CSO_Multiply, a, b, line);
+
+            // As in HLSL, the inner dimension is cut down to the smaller of the two
+            if (!left.Matrix && !right.Matrix)
+            {
+                Value result = MakeValue(MakeType(1, 1, false));
+                unsigned int count = (left.Columns < right.Columns) ? left.Columns : right.Columns;
+                result.Components[0] = Dot(a.Components, 1, b.Components, 1, count);
+                return result;
+            }
+
+            if (!left.Matrix)
+            {
+                // Row vector times matrix
+                unsigned int count = (left.Columns < right.Rows) ? left.Columns : right.Rows;
+                Value result = MakeValue(MakeType(1, right.Columns, false));
+                for (unsigned int column = 0; column < right.Columns; column++)
+                    result.Components[column] = Dot(a.Components, 1, &b.Components[column], right.Columns, count);
+                return result;
+            }
+
+            if (!right.Matrix)
+            {
+                // Matrix times column vector
+                unsigned int count = (left.Columns < right.Columns) ? left.Columns : right.Columns;
+                Value result = MakeValue(MakeType(1, left.Rows, false));
+                for (unsigned int row = 0; row < left.Rows; row++)
+                    result.Components[row] = Dot(&a.Components[row * left.Columns], 1, b.Components, 1, count);
+                return result;
+            }
+
+            unsigned int count = (left.Columns < right.Rows) ? left.Columns : right.Rows;
+            Value result = MakeValue(MakeType(left.Rows, right.Columns, true));
+            for (unsigned int row = 0; row < left.Rows; row++)
+            {
+                for (unsigned int column = 0; column < right.Columns; column++)
+                    result.Components[row * right.Columns + column] = Dot(&a.Components[row * left.Columns], 1, &b.Components[column], right.Columns, count);
+            }
+            return result;
+        }
+
+        // ---- Output ----
+
+        // Explicit registers first, then whatever's used without one takes the lowest free slot
+        template <typename T>
+        void AssignSlots(std::vector<T>& items, bool (*isKind)(const T&), const char* kind)
+        {
+            bool taken[kCpuShaderMaxSlots] = {};
+            for (auto& item : items)
+            {
+                if (!item.Used || !item.ExplicitSlot || !isKind(item))
+                    continue;
+
+                if (taken[item.Slot])
+                    Fail(0, std::string(kind) + " '" + item.Name + "' shares its register with another");
+                taken[item.Slot] = true;
+            }
+
+            for (auto& item : items)
+            {
+                if (!item.Used || item.ExplicitSlot || !isKind(item))
+                    continue;
+
+                unsigned int slot = 0;
+                while ((slot < kCpuShaderMaxSlots) && taken[slot])
+                    slot++;
+
+                if (slot == kCpuShaderMaxSlots)
+                {
+                    Fail(0, std::string("too many ") + kind + "s");
+                    return;
+                }
+
+                item.Slot = slot;
+                taken[slot] = true;
+            }
+        }
+
+        static bool IsBuffer(const ConstantBufferDefinition&) { return true; }
+        static bool IsTexture(const ResourceDefinition& resource) { return resource.Type == SBT_Texture; }
+        static bool IsSampler(const ResourceDefinition& resource) { return resource.Type == SBT_Sampler; }
+
+        void Finish(CpuShaderProgram& program)
+        {
+            AssignSlots(mBuffers, IsBuffer, "cbuffer");
+            AssignSlots(mResources, IsTexture, "texture");
+            AssignSlots(mResources, IsSampler, "sampler");
+            if (mFailed)
+                return;
+
+            for (auto& sample : mSamples)
+                mInstructions[sample.Instruction].Source[2] = (unsigned short)(mResources[sample.Texture].Slot | (mResources[sample.Sampler].Slot << 8));
+
+            program.Clear();
+            program.RegisterCount = mRegisterCount;
+            program.Instructions = mInstructions;
+            program.Inputs = mInputs;
+            program.Outputs = mOutputs;
+
+            for (auto& literal : mLiteralValues)
+            {
+                CpuShaderLiteral programLiteral;
+                programLiteral.Register = literal.first;
+                programLiteral.Value = literal.second;
+                program.Literals.push_back(programLiteral);
+            }
+
+            for (auto& pending : mPendingConstants)
+            {
+                CpuShaderConstant constant;
+                constant.Register = pending.Register;
+                constant.Slot = mBuffers[pending.Buffer].Slot;
+                constant.Offset = pending.Offset;
+                program.Constants.push_back(constant);
+            }
+
+            // Reflection only has what the shader uses, as D3D's does - but every variable in a
+            // buffer that's used
+            ShaderReflection& reflection = program.Reflection;
+            for (unsigned int index = 0; index < mBuffers.size(); index++)
+            {
+                if (!mBuffers[index].Used)
+                    continue;
+
+                ShaderConstantBuffer buffer;
+                buffer.Name = mBuffers[index].Name;
+                buffer.Slot = mBuffers[index].Slot;
+                buffer.Size = mBuffers[index].Size;
+                for (auto& constant : mConstants)
+                {
+                    if (constant.Buffer != index)
+                        continue;
+
+                    ShaderVariable variable;
+                    variable.Name = constant.Name;
+                    variable.Offset = constant.Offset;
+                    variable.Size = constant.Size;
+                    buffer.Variables.push_back(variable);
+                }
+                reflection.ConstantBuffers.push_back(buffer);
+            }
+
+            for (auto& resource : mResources)
+            {
+                if (!resource.Used)
+                    continue;
+
+                ShaderBinding binding;
+                binding.Name = resource.Name;
+                binding.Type = resource.Type;
+                binding.Slot = resource.Slot;
+                binding.Count = 1;
+                reflection.Resources.Bindings.push_back(binding);
+            }
+
+            for (unsigned int index = 0; index < mInputs.size(); index++)
+            {
+                ShaderInput input;
+                input.SemanticName = mInputs[index].SemanticName;
+                input.SemanticIndex = mInputs[index].SemanticIndex;
+                input.Register = index;
+                input.ComponentType = SCT_Float;
+                input.ComponentCount = mInputs[index].ComponentCount;
+                input.SystemValue = IsSystemValue(mInputs[index].SemanticName);
+                reflection.Inputs.push_back(input);
+            }
+        }
+
+    private:
+        const ShaderCompileRequest&                 mRequest;
+        const std::vector<Token>&                   mTokens;
+        std::string&                                mErrors;
+        size_t                                      mPosition;
+        bool                                        mFailed;
+
+        std::vector<StructDefinition>               mStructs;
+        std::vector<ConstantBufferDefinition>       mBuffers;
+        std::vector<ConstantDefinition>             mConstants;
+        std::vector<ResourceDefinition>             mResources;
+        std::vector<std::string>                    mFunctions;     // skipped ones
+
+        bool                                        mCompiledEntryPoint;
+        bool                                        mReturned;
+        int                                         mReturnStruct;
+        TypeInfo                                    mReturnType;
+        std::string                                 mReturnSemantic;
+        std::vector<LocalVariable>                  mLocals;
+
+        unsigned int                                mRegisterCount;
+        std::vector<CpuShaderInstruction>           mInstructions;
+        std::map<unsigned int, unsigned short>      mLiteralRegisters;  // by bit pattern
+        std::map<unsigned short, float>             mLiteralValues;
+        std::vector<PendingConstant>                mPendingConstants;
+        std::vector<PendingSample>                  mSamples;
+        std::vector<CpuShaderAttribute>             mInputs;
+        std::vector<CpuShaderAttribute>             mOutputs;
+    };
+}
+
+const char* CpuShaderCompiler::GetName() const
+{
+    return "cpushader-1";
+}
+
+bool CpuShaderCompiler::Compile(const ShaderCompileRequest& request, const std::string& source,
+                                std::vector<unsigned char>& bytecode, std::string& errors)
+{
+    ASSERT(request.Filename != nullptr);
+    ASSERT(request.EntryPoint != nullptr);
+    ASSERT(request.Profile != nullptr);
+
+    if ((strncmp(request.Profile, "vs_", 3) != 0) && (strncmp(request.Profile, "ps_", 3) != 0))
+    {
+        AddError(errors, request.Filename, 0, std::string("profile '") + request.Profile + "' isn't supported - only vs_* and ps_*");
+        return false;
+    }
+
+    Preprocessor preprocessor(request.Filename, errors);
+    for (unsigned int index = 0; index < request.DefineCount; index++)
+    {
+        const ShaderDefine& define = request.Defines[index];
+        preprocessor.Define(define.Name, (define.Value != nullptr) ? define.Value : "1");
+    }
+
+    std::vector<Token> tokens;
+    if (!preprocessor.Run(source, tokens))
+        return false;
+
+    CpuShaderProgram program;
+    ShaderParser parser(request, tokens, errors);
+    if (!parser.Compile(program))
+        return false;
+
+    bytecode.clear();
+    program.Write(bytecode);
+    return true;
+}
+
+bool CpuShaderCompiler::Reflect(const std::vector<unsigned char>& bytecode, ShaderReflection& reflection)
+{
+    CpuShaderProgram program;
+    if (!program.Read(bytecode.data(), bytecode.size()))
+        return false;
+
+    reflection = program.Reflection;
+    return true;
+}
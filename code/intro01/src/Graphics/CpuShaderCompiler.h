@@ -0,0 +1,29 @@
+///
+/// CpuShaderCompiler.h - Compiles a subset of HLSL for CpuShaderExecutor.
+/// Enough for the shaders we have: cbuffers (with or without packoffset), structs, Texture2D
+/// and SamplerState, and an entry point that's a straight run of declarations, assignments
+/// and a return. Expressions can use the float scalar, vector and matrix types, swizzles,
+/// casts, constructors, + - * /, Sample and the intrinsics mul, dot, cross, normalize,
+/// length, saturate, min, max, clamp, lerp, abs, sqrt and rsqrt. #define, #if, #ifdef,
+/// #ifndef, #elif, #else and #endif are handled, so keyword variants compile as they would
+/// for the GPU. Anything else - branches, loops, helper functions, #include - is an error
+/// that says so, rather than a shader that silently does something different.
+///
+/// It's an IShaderCompiler, so it plugs into the ShaderCache and ShaderPackBuilder like
+/// D3DShaderCompiler does, and its bytecode carries the shader's reflection along with it.
+/// It doesn't touch D3D, so it runs anywhere.
+///
+#pragma once
+
+#include "ShaderCache.h"
+
+class CpuShaderCompiler : public IShaderCompiler
+{
+public:
+    // Profiles are vs_* or ps_*, and request flags are ignored. Safe to call from several
+    // threads at once.
+    virtual const char* GetName() const override;
+    virtual bool Compile(const ShaderCompileRequest& request, const std::string& source,
+                         std::vector<unsigned char>& bytecode, std::string& errors) override;
+    virtual bool Reflect(const std::vector<unsigned char>& bytecode, ShaderReflection& reflection) override;
+};
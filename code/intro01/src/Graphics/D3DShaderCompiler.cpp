@@ -0,0 +1,178 @@
+#include "D3DShaderCompiler.h"
+
+#include <d3d11.h>
+#include <d3d11shader.h>
+#include <d3dcompiler.h>
+
+namespace
+{
+    bool GetBindingType(D3D_SHADER_INPUT_TYPE type, ShaderBindingType& result)
+    {
+        switch (type)
+        {
+        case D3D_SIT_CBUFFER:                       result = SBT_ConstantBuffer; return true;
+        case D3D_SIT_TEXTURE:                       result = SBT_Texture; return true;
+        case D3D_SIT_SAMPLER:                       result = SBT_Sampler; return true;
+        case D3D_SIT_TBUFFER:
+        case D3D_SIT_STRUCTURED:
+        case D3D_SIT_BYTEADDRESS:                   result = SBT_Buffer; return true;
+        case D3D_SIT_UAV_RWTYPED:
+        case D3D_SIT_UAV_RWSTRUCTURED:
+        case D3D_SIT_UAV_RWBYTEADDRESS:
+        case D3D_SIT_UAV_APPEND_STRUCTURED:
+        case D3D_SIT_UAV_CONSUME_STRUCTURED:
+        case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER: result = SBT_UnorderedAccess; return true;
+        default:
+            break;
+        }
+        return false;
+    }
+
+    unsigned int CountComponents(BYTE mask)
+    {
+        unsigned int count = 0;
+        for (; mask != 0; mask >>= 1)
+            count += mask & 1;
+        return count;
+    }
+}
+
+unsigned int D3DShaderCompiler::GetDefaultFlags()
+{
+    unsigned int flags = D3DCOMPILE_ENABLE_STRICTNESS;
+
+#if _DEBUG
+    flags |= D3DCOMPILE_DEBUG;
+#endif
+    return flags;
+}
+
+const char* D3DShaderCompiler::GetName() const
+{
+    // The DLL we link against - a different one can produce different bytecode
+    return D3DCOMPILER_DLL_A;
+}
+
+bool D3DShaderCompiler::Compile(const ShaderCompileRequest& request, const std::string& source,
+                                std::vector<unsigned char>& bytecode, std::string& errors)
+{
+    std::vector<D3D_SHADER_MACRO> macros;
+    for (unsigned int i = 0; i < request.DefineCount; i++)
+    {
+        D3D_SHADER_MACRO macro = { request.Defines[i].Name, request.Defines[i].Value };
+        macros.push_back(macro);
+    }
+    D3D_SHADER_MACRO terminator = { nullptr, nullptr };
+    macros.push_back(terminator);
+
+    ID3DBlob* shaderBlob = nullptr;
+    ID3DBlob* errorBlob = nullptr;
+
+    // The source the cache hashed, not a fresh read of the file, so the key matches what was built
+    HRESULT hr = D3DCompile(source.data(), source.size(), request.Filename,
+                            macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+                            request.EntryPoint, request.Profile,
+                            request.Flags, 0,
+                            &shaderBlob, &errorBlob);
+
+    if (errorBlob != nullptr)
+    {
+        errors.assign((const char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize());
+        errorBlob->Release();
+    }
+
+    bool result = SUCCEEDED(hr) && (shaderBlob != nullptr);
+    if (result)
+    {
+        const unsigned char* data = (const unsigned char*)shaderBlob->GetBufferPointer();
+        bytecode.assign(data, data + shaderBlob->GetBufferSize());
+    }
+
+    if (shaderBlob != nullptr)
+        shaderBlob->Release();
+
+    return result;
+}
+
+bool D3DShaderCompiler::Reflect(const std::vector<unsigned char>& bytecode, ShaderReflection& reflection)
+{
+    reflection.Clear();
+
+    ID3D11ShaderReflection* reflector = nullptr;
+    if (FAILED(D3DReflect(bytecode.data(), bytecode.size(), IID_ID3D11ShaderReflection, (void**)&reflector)))
+        return false;
+
+    D3D11_SHADER_DESC shaderDesc;
+    bool result = SUCCEEDED(reflector->GetDesc(&shaderDesc));
+
+    // Constant buffers come from the bindings, which have the slots - the buffer descs don't
+    for (UINT index = 0; result && (index < shaderDesc.BoundResources); index++)
+    {
+        D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+        result = SUCCEEDED(reflector->GetResourceBindingDesc(index, &bindDesc));
+
+        ShaderBindingType type;
+        if (!result || !GetBindingType(bindDesc.Type, type))
+            continue;
+
+        if (type != SBT_ConstantBuffer)
+        {
+            ShaderBinding binding;
+            binding.Name = bindDesc.Name;
+            binding.Type = type;
+            binding.Slot = bindDesc.BindPoint;
+            binding.Count = bindDesc.BindCount;
+            reflection.Resources.Bindings.push_back(binding);
+            continue;
+        }
+
+        ID3D11ShaderReflectionConstantBuffer* constants = reflector->GetConstantBufferByName(bindDesc.Name);
+        D3D11_SHADER_BUFFER_DESC bufferDesc;
+        result = SUCCEEDED(constants->GetDesc(&bufferDesc));
+        if (!result)
+            break;
+
+        ShaderConstantBuffer buffer;
+        buffer.Name = bufferDesc.Name;
+        buffer.Slot = bindDesc.BindPoint;
+        buffer.Size = bufferDesc.Size;
+        for (UINT variableIndex = 0; result && (variableIndex < bufferDesc.Variables); variableIndex++)
+        {
+            D3D11_SHADER_VARIABLE_DESC variableDesc;
+            result = SUCCEEDED(constants->GetVariableByIndex(variableIndex)->GetDesc(&variableDesc));
+
+            ShaderVariable variable;
+            variable.Name = result ? variableDesc.Name : "";
+            variable.Offset = result ? variableDesc.StartOffset : 0;
+            variable.Size = result ? variableDesc.Size : 0;
+            buffer.Variables.push_back(variable);
+        }
+        reflection.ConstantBuffers.push_back(buffer);
+    }
+
+    for (UINT index = 0; result && (index < shaderDesc.InputParameters); index++)
+    {
+        D3D11_SIGNATURE_PARAMETER_DESC parameterDesc;
+        result = SUCCEEDED(reflector->GetInputParameterDesc(index, &parameterDesc));
+        if (!result)
+            break;
+
+        ShaderInput input;
+        input.SemanticName = parameterDesc.SemanticName;
+        input.SemanticIndex = parameterDesc.SemanticIndex;
+        input.Register = parameterDesc.Register;
+        input.ComponentType = (parameterDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) ? SCT_Int
+                            : (parameterDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) ? SCT_UInt
+                            : SCT_Float;
+        input.ComponentCount = CountComponents(parameterDesc.Mask);
+        input.SystemValue = (parameterDesc.SystemValueType != D3D_NAME_UNDEFINED);
+        reflection.Inputs.push_back(input);
+    }
+
+    reflector->Release();
+
+    if (!result)
+        reflection.Clear();
+
+    return result;
+}
@@ -0,0 +1,19 @@
+///
+/// D3DShaderCompiler.h - IShaderCompiler on top of D3DCompile and D3DReflect.
+/// Includes are resolved by the standard file include handler, relative to the shader's file.
+///
+#pragma once
+
+#include "ShaderCache.h"
+
+class D3DShaderCompiler : public IShaderCompiler
+{
+public:
+    // D3DCOMPILE_ENABLE_STRICTNESS, with D3DCOMPILE_DEBUG in debug builds only
+    static unsigned int GetDefaultFlags();
+
+    virtual const char* GetName() const override;
+    virtual bool Compile(const ShaderCompileRequest& request, const std::string& source,
+                         std::vector<unsigned char>& bytecode, std::string& errors) override;
+    virtual bool Reflect(const std::vector<unsigned char>& bytecode, ShaderReflection& reflection) override;
+};
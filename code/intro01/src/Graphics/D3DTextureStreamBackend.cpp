@@ -0,0 +1,207 @@
+#include "StdAfx.h"
+#include "D3DTextureStreamBackend.h"
+#include "Texture2D.h"
+#include "TextureContainer.h"
+
+#include "utils\Profiler.h"
+#include "utils\assert.h"
+#include "utils\memory.h"
+
+namespace
+{
+    // Touching one byte a page is enough to have the OS read the page in
+    const unsigned int kPageSize = 4096;
+}
+
+D3DTextureStreamBackend::D3DTextureStreamBackend(ID3D11Device* device)
+    : mDevice(device)
+    , mStreamer(nullptr)
+    , mJobs(nullptr)
+{
+    ASSERT(device != nullptr);
+
+    for (unsigned int index = 0; index < kMaxReads; index++)
+        mReads[index].Busy = false;
+}
+
+D3DTextureStreamBackend::~D3DTextureStreamBackend()
+{
+    // The reads point into the mappings
+    for (unsigned int index = 0; index < kMaxReads; index++)
+    {
+        if (mReads[index].Busy && (mJobs != nullptr))
+            mJobs->Wait(&mReads[index].Counter);
+    }
+
+    for (auto& entry : mEntries)
+    {
+        delete entry.Texture;
+        delete entry.Container;
+    }
+}
+
+StreamedTextureId D3DTextureStreamBackend::Add(const char* filepath, std::string& errors)
+{
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Assets);
+    ASSERT(mStreamer != nullptr);
+
+    TextureContainer* container = new TextureContainer();
+    if (!container->Open(filepath, errors))
+    {
+        delete container;
+        return kInvalidStreamedTexture;
+    }
+
+    if (!IsStreamable(*container, mStreamer->GetSettings().TailSize))
+    {
+        errors = std::string(filepath) + ": nothing to stream - load it whole";
+        delete container;
+        return kInvalidStreamedTexture;
+    }
+
+    // Every slice of a mip comes and goes together
+    unsigned long long mipSizes[TextureStreamer::kMaxMips];
+    for (unsigned int mip = 0; mip < container->GetMipCount(); mip++)
+        mipSizes[mip] = container->GetSubresource(mip, 0).Size * container->GetArraySize();
+
+    StreamedTextureId id = mStreamer->Register(container->GetWidth(), container->GetHeight(), mipSizes, container->GetMipCount());
+
+    Texture2D* texture = new Texture2D();
+    if (!texture->Create(mDevice, *container, mStreamer->GetTailMip(id)))
+    {
+        errors = std::string("Unable to create the texture for ") + filepath;
+        mStreamer->Unregister(id);
+        delete texture;
+        delete container;
+        return kInvalidStreamedTexture;
+    }
+
+    if (id >= mEntries.size())
+        mEntries.resize(id + 1);
+    mEntries[id].Container = container;
+    mEntries[id].Texture = texture;
+    return id;
+}
+
+void D3DTextureStreamBackend::Remove(StreamedTextureId id)
+{
+    Entry& entry = mEntries[id];
+    ASSERT(entry.Container != nullptr);
+
+    // A read still in flight comes back as failed, which also frees the id
+    mStreamer->Unregister(id);
+    for (unsigned int index = 0; index < kMaxReads; index++)
+    {
+        Read& read = mReads[index];
+        if (!read.Busy || (read.Texture != id))
+            continue;
+
+        if (mJobs != nullptr)
+            mJobs->Wait(&read.Counter);
+        read.Busy = false;
+        mStreamer->CompleteLoad(id, read.Mip, false);
+    }
+
+    delete entry.Texture;
+    delete entry.Container;
+    entry.Texture = nullptr;
+    entry.Container = nullptr;
+}
+
+void D3DTextureStreamBackend::Pump()
+{
+    PROFILE_FUNCTION();
+
+    for (unsigned int index = 0; index < kMaxReads; index++)
+    {
+        Read& read = mReads[index];
+        if (read.Busy && read.Counter.IsDone())
+        {
+            read.Busy = false;
+            mStreamer->CompleteLoad(read.Texture, read.Mip, true);
+        }
+    }
+}
+
+void D3DTextureStreamBackend::BeginLoad(StreamedTextureId texture, unsigned int mip)
+{
+    Read* read = nullptr;
+    for (unsigned int index = 0; (index < kMaxReads) && (read == nullptr); index++)
+    {
+        if (!mReads[index].Busy)
+            read = &mReads[index];
+    }
+
+    if (read == nullptr)
+    {
+        // More loads than reads - fail this one, so the streamer tries it again later
+        OutputDebugStringA("Out of texture stream reads - raise kMaxReads or lower MaxLoads\n");
+        mStreamer->CompleteLoad(texture, mip, false);
+        return;
+    }
+
+    read->Container = mEntries[texture].Container;
+    read->Texture = texture;
+    read->Mip = mip;
+    read->Busy = true;
+
+    // Queued from the render thread this goes on the job system's shared queue. A job
+    // system of one thread only runs jobs while it's waited on, and nobody waits.
+    if ((mJobs != nullptr) && (mJobs->GetThreadCount() > 1))
+        mJobs->Run(TouchPages, read, 0, 1, &read->Counter);
+    else
+        TouchPages(read, 0, 1);
+}
+
+void D3DTextureStreamBackend::SetResidency(StreamedTextureId texture, unsigned int firstMip)
+{
+    PROFILE_FUNCTION();
+
+    // The pages are in memory by now, so this is a copy and no more
+    Entry& entry = mEntries[texture];
+    if (!entry.Texture->Create(mDevice, *entry.Container, firstMip))
+        OutputDebugStringA("Unable to recreate a streamed texture with its new mips\n");
+}
+
+bool D3DTextureStreamBackend::IsStreamable(const TextureContainer& container, unsigned int tailSize)
+{
+    unsigned int mipCount = container.GetMipCount();
+    if (mipCount > TextureStreamer::kMaxMips)
+        return false;
+
+    unsigned int tailMip = TextureStreamer::ComputeTailMip(container.GetWidth(), container.GetHeight(), mipCount, tailSize);
+    if (tailMip == 0)
+        return false;
+
+    // Any of these can end up the top mip, and D3D wants that whole blocks
+    unsigned int blockSize = GetTextureFormatInfo(container.GetFormat()).BlockSize;
+    for (unsigned int mip = 0; mip <= tailMip; mip++)
+    {
+        const TextureMip& level = container.GetSubresource(mip, 0);
+        if ((level.Width % blockSize != 0) || (level.Height % blockSize != 0))
+            return false;
+    }
+    return true;
+}
+
+void D3DTextureStreamBackend::TouchPages(const void* context, unsigned int begin, unsigned int end)
+{
+    PROFILE_FUNCTION();
+
+    const Read* read = (const Read*)context;
+    const TextureContainer& container = *read->Container;
+
+    unsigned int sum = 0;
+    for (unsigned int slice = 0; slice < container.GetArraySize(); slice++)
+    {
+        const unsigned char* data = container.GetSubresourceData(read->Mip, slice);
+        unsigned long long size = container.GetSubresource(read->Mip, slice).Size;
+        for (unsigned long long offset = 0; offset < size; offset += kPageSize)
+            sum += data[offset];
+    }
+
+    // So the reads aren't optimised away
+    volatile unsigned int touched = sum;
+    (void)touched;
+}
@@ -0,0 +1,82 @@
+///
+/// D3DTextureStreamBackend.h - ITextureStreamBackend for baked DDS and KTX2 files.
+/// Each file stays memory mapped while it's streamed. A read is a job that touches every
+/// page of the mip, so the disk read happens on a worker and the thread running the
+/// streamer only ever copies from memory. D3D11 can't change an immutable texture's mips in place, so a change
+/// of residency recreates the texture from the mapping with the mips it now has - the
+/// Texture2D stays the same object, only its texture and view are replaced.
+///
+#pragma once
+
+#include "TextureStreamer.h"
+#include "utils\JobSystem.h"
+
+#include <string>
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct ID3D11Device;
+class Texture2D;
+class TextureContainer;
+
+class D3DTextureStreamBackend : public ITextureStreamBackend
+{
+public:
+    // Reads in flight at once - keep TextureStreamerSettings::MaxLoads within this. A load
+    // past it fails, and the streamer tries it again later.
+    static const unsigned int kMaxReads = 32;
+
+public:
+    explicit D3DTextureStreamBackend(ID3D11Device* device);
+    virtual ~D3DTextureStreamBackend() override;
+
+    void SetStreamer(TextureStreamer* streamer) { mStreamer = streamer; }
+
+    // Reads run on these threads. Without one they're done in BeginLoad.
+    void SetJobSystem(JobSystem* jobs) { mJobs = jobs; }
+
+    // Maps the file, registers it and creates the texture with just its tail.
+    // kInvalidStreamedTexture if it can't be opened or isn't worth streaming - one with no
+    // mips above the tail, or a block compressed one whose mips aren't all whole blocks.
+    StreamedTextureId Add(const char* filepath, std::string& errors);
+    void Remove(StreamedTextureId texture);
+
+    Texture2D* GetTexture(StreamedTextureId texture) const { return mEntries[texture].Texture; }
+
+    // Hands the reads that have finished to the streamer - call before TextureStreamer::Update
+    void Pump();
+
+    virtual void BeginLoad(StreamedTextureId texture, unsigned int mip) override;
+    virtual void SetResidency(StreamedTextureId texture, unsigned int firstMip) override;
+
+private:
+    struct Entry
+    {
+        TextureContainer*   Container;
+        Texture2D*          Texture;
+    };
+
+    struct Read
+    {
+        JobCounter              Counter;
+        const TextureContainer* Container;
+        StreamedTextureId       Texture;
+        unsigned int            Mip;
+        bool                    Busy;
+    };
+
+    static bool IsStreamable(const TextureContainer& container, unsigned int tailSize);
+
+    // Faults in the pages of one mip, across every array slice
+    static void TouchPages(const void* context, unsigned int begin, unsigned int end);
+
+private:
+    ID3D11Device*           mDevice;
+    TextureStreamer*        mStreamer;
+    JobSystem*              mJobs;
+
+    std::vector<Entry>      mEntries;           // by StreamedTextureId
+    Read                    mReads[kMaxReads];
+};
@@ -0,0 +1,256 @@
+///
+/// DrawBatcher.cpp - Sorts a frame's worth of draws by Material, then Mesh, and packs the
+/// per-instance world matrices into a single dynamic vertex buffer. A material's textures
+/// are bound once for its whole run of draws.
+///
+
+#include "stdafx.h"
+#include "d3d11.h"
+#include "DirectXMath.h"
+
+#include "DrawBatcher.h"
+#include "Mesh.h"
+#include "MaterialLibrary.h"
+#include "Model.h"
+#include "Texture2D.h"
+#include "FrameRingBuffer.h"
+
+#include "utils\assert.h"
+#include "utils\utils.h"
+#include "utils\Profiler.h"
+#include "utils\MemoryTracker.h"
+
+#include <algorithm>
+#include <string.h>
+
+DrawBatcher::DrawBatcher()
+    : mDevice(nullptr),
+      mInstanceBuffer(nullptr),
+      mInstanceRing(nullptr),
+      mMaterials(nullptr),
+      mRingMapped(false),
+      mInstanceCapacity(0),
+      mDrawCallCount(0),
+      mInstanceCount(0),
+      mMaterialChangeCount(0)
+{
+}
+
+DrawBatcher::~DrawBatcher()
+{
+    Shutdown();
+}
+
+bool DrawBatcher::Initialize(ID3D11Device* device, unsigned int instanceCapacity)
+{
+    ASSERT(instanceCapacity != 0);
+
+    mDevice = device;
+    mKeys.reserve(instanceCapacity);
+    mWorldMatrices.reserve(instanceCapacity);
+
+    // No device means nothing will be drawn - see Flush
+    if (device == nullptr)
+        return true;
+
+    return ReserveInstances(instanceCapacity);
+}
+
+void DrawBatcher::Shutdown()
+{
+    SafeRelease(mInstanceBuffer);
+    mInstanceCapacity = 0;
+    mDevice = nullptr;
+}
+
+void DrawBatcher::Submit(Mesh* mesh, MaterialId material, const DirectX::XMMATRIX& world)
+{
+    ASSERT(mesh != nullptr);
+    MEMORY_TAG(MT_Render);
+
+    DrawKey key;
+    key.material = material;
+    key.mesh = mesh;
+    key.instanceIndex = (unsigned int)mWorldMatrices.size();
+    mKeys.push_back(key);
+
+    DirectX::XMFLOAT4X4 worldMatrix;
+    DirectX::XMStoreFloat4x4(&worldMatrix, world);
+    mWorldMatrices.push_back(worldMatrix);
+}
+
+void DrawBatcher::Submit(Model* model, const DirectX::XMMATRIX& world)
+{
+    ASSERT(model != nullptr);
+
+    for (unsigned int index = 0; index < model->GetMeshCount(); index++)
+    {
+        Mesh* mesh = model->GetMesh(index);
+        Submit(mesh, mesh->GetMaterial(), world);
+    }
+}
+
+void DrawBatcher::Flush(ID3D11DeviceContext* context)
+{
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Render);
+
+    mDrawCallCount = 0;
+    mMaterialChangeCount = 0;
+    mInstanceCount = (unsigned int)mKeys.size();
+
+    if (mKeys.empty())
+        return;
+
+    // Group identical Material/Mesh pairs together. Material ids are dense and handed out
+    // in load order, so a material's draws sit together however many models share it.
+    // Submission order breaks ties so the output is stable from frame to frame.
+    std::sort(mKeys.begin(), mKeys.end(), [](const DrawKey& lhs, const DrawKey& rhs)
+    {
+        if (lhs.material != rhs.material)
+            return lhs.material < rhs.material;
+        if (lhs.mesh != rhs.mesh)
+            return lhs.mesh < rhs.mesh;
+        return lhs.instanceIndex < rhs.instanceIndex;
+    });
+
+    // Pack the world matrices in sorted order so each group is a contiguous instance range
+    ID3D11Buffer* instanceBuffer = nullptr;
+    unsigned int baseInstance = 0;
+    if (context != nullptr)
+    {
+        PerInstanceLayout* instances = MapInstances(context, &instanceBuffer, &baseInstance);
+        if (instances == nullptr)
+        {
+            mKeys.clear();
+            mWorldMatrices.clear();
+            return;
+        }
+
+        for (unsigned int index = 0; index < mInstanceCount; index++)
+        {
+            memcpy(&instances[index].World, &mWorldMatrices[mKeys[index].instanceIndex], sizeof(DirectX::XMFLOAT4X4));
+        }
+
+        UnmapInstances(context);
+    }
+
+    // One draw per run of identical keys, and one material bind per run of a material
+    MaterialId boundMaterial = kInvalidMaterial;
+    unsigned int groupStart = 0;
+    while (groupStart < mInstanceCount)
+    {
+        const DrawKey& first = mKeys[groupStart];
+        if ((groupStart == 0) || (first.material != boundMaterial))
+        {
+            BindMaterial(context, first.material);
+            boundMaterial = first.material;
+            mMaterialChangeCount++;
+        }
+
+        unsigned int groupEnd = groupStart + 1;
+        while ((groupEnd < mInstanceCount)
+               && (mKeys[groupEnd].material == first.material)
+               && (mKeys[groupEnd].mesh == first.mesh))
+        {
+            groupEnd++;
+        }
+
+        if (context != nullptr)
+            first.mesh->RenderInstanced(context, instanceBuffer, baseInstance + groupStart, groupEnd - groupStart);
+        mDrawCallCount++;
+
+        groupStart = groupEnd;
+    }
+
+    // Keep the capacity around, so steady state frames don't allocate
+    mKeys.clear();
+    mWorldMatrices.clear();
+}
+
+void DrawBatcher::BindMaterial(ID3D11DeviceContext* context, MaterialId material)
+{
+    if ((context == nullptr) || (mMaterials == nullptr) || (material == kInvalidMaterial))
+        return;
+
+    // Every slot, so an empty one doesn't sample the last material's texture
+    const Material* bound = mMaterials->GetMaterial(material);
+    ID3D11ShaderResourceView* views[MTS_Count];
+    for (unsigned int slot = 0; slot < MTS_Count; slot++)
+    {
+        Texture2D* texture = bound->GetTexture((MaterialTextureSlot)slot);
+        views[slot] = (texture != nullptr) ? texture->GetView() : nullptr;
+    }
+    context->PSSetShaderResources(0, MTS_Count, views);
+}
+
+PerInstanceLayout* DrawBatcher::MapInstances(ID3D11DeviceContext* context, ID3D11Buffer** buffer, unsigned int* baseInstance)
+{
+    unsigned int bytes = mInstanceCount * sizeof(PerInstanceLayout);
+
+    // The ring is aligned to the instance stride, so the offset converts straight to a start instance
+    if (mInstanceRing != nullptr)
+    {
+        unsigned int offset = 0;
+        void* data = mInstanceRing->BeginWrite(bytes, &offset);
+        if (data != nullptr)
+        {
+            ASSERT(offset % sizeof(PerInstanceLayout) == 0);
+            *buffer = mInstanceRing->GetBuffer();
+            *baseInstance = offset / sizeof(PerInstanceLayout);
+            mRingMapped = true;
+            return (PerInstanceLayout*)data;
+        }
+    }
+
+    if (!ReserveInstances(mInstanceCount))
+        return nullptr;
+
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    if (FAILED(context->Map(mInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+        return nullptr;
+
+    *buffer = mInstanceBuffer;
+    *baseInstance = 0;
+    return (PerInstanceLayout*)mappedResource.pData;
+}
+
+void DrawBatcher::UnmapInstances(ID3D11DeviceContext* context)
+{
+    if (mRingMapped)
+        mInstanceRing->EndWrite();
+    else
+        context->Unmap(mInstanceBuffer, 0);
+
+    mRingMapped = false;
+}
+
+bool DrawBatcher::ReserveInstances(unsigned int instanceCount)
+{
+    ASSERT(mDevice != nullptr);
+
+    if ((mInstanceBuffer != nullptr) && (instanceCount <= mInstanceCapacity))
+        return true;
+
+    // Grow in powers of two so a slowly growing scene doesn't recreate the buffer every frame
+    unsigned int capacity = (mInstanceCapacity > 0) ? mInstanceCapacity : 1;
+    while (capacity < instanceCount)
+        capacity *= 2;
+
+    SafeRelease(mInstanceBuffer);
+    mInstanceCapacity = 0;
+
+    D3D11_BUFFER_DESC instanceBufferDesc;
+    ZeroMemory(&instanceBufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+    instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    instanceBufferDesc.ByteWidth = sizeof(PerInstanceLayout) * capacity;
+    instanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    instanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+
+    if (FAILED(mDevice->CreateBuffer(&instanceBufferDesc, nullptr, &mInstanceBuffer)))
+        return false;
+
+    mInstanceCapacity = capacity;
+    return true;
+}
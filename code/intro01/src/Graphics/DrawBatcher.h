@@ -0,0 +1,84 @@
+///
+/// DrawBatcher.h - Collects draw requests for a frame and emits one instanced draw
+/// per unique Mesh/Material pair.
+///
+#pragma once
+
+#include "Material.h"
+
+#include <DirectXMath.h>
+
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Buffer;
+
+struct PerInstanceLayout;
+
+class Mesh;
+class Model;
+class MaterialLibrary;
+class FrameRingBuffer;
+
+class DrawBatcher
+{
+private:
+    // What gets sorted - the world matrices stay put and are gathered after sorting
+    struct DrawKey
+    {
+        MaterialId      material;
+        Mesh*           mesh;
+        unsigned int    instanceIndex;
+    };
+
+public:
+    DrawBatcher();
+    ~DrawBatcher();
+
+    bool Initialize(ID3D11Device* device, unsigned int instanceCapacity);
+    void Shutdown();
+
+    // When set, instance data is written into the frame's vertex ring instead of our own buffer
+    void SetInstanceRing(FrameRingBuffer* ring) { mInstanceRing = ring; }
+
+    // Where material ids are looked up to bind their textures - without one, draws are
+    // still sorted by material but nothing is bound
+    void SetMaterials(const MaterialLibrary* materials) { mMaterials = materials; }
+
+    void Submit(Mesh* mesh, MaterialId material, const DirectX::XMMATRIX& world);
+    void Submit(Model* model, const DirectX::XMMATRIX& world);
+
+    // With a null context the batches are still sorted and counted, but nothing is drawn -
+    // the benchmark runner's null backend relies on this
+    void Flush(ID3D11DeviceContext* context);
+
+    // Stats for the last Flush
+    unsigned int GetDrawCallCount() const { return mDrawCallCount; }
+    unsigned int GetInstanceCount() const { return mInstanceCount; }
+    unsigned int GetMaterialChangeCount() const { return mMaterialChangeCount; }
+
+private:
+    bool ReserveInstances(unsigned int instanceCount);
+    PerInstanceLayout* MapInstances(ID3D11DeviceContext* context, ID3D11Buffer** buffer, unsigned int* baseInstance);
+    void UnmapInstances(ID3D11DeviceContext* context);
+    void BindMaterial(ID3D11DeviceContext* context, MaterialId material);
+
+private:
+    ID3D11Device*                       mDevice;
+    ID3D11Buffer*                       mInstanceBuffer;
+    FrameRingBuffer*                    mInstanceRing;
+    const MaterialLibrary*              mMaterials;
+    bool                                mRingMapped;
+    unsigned int                        mInstanceCapacity;
+
+    std::vector<DrawKey>                mKeys;
+    std::vector<DirectX::XMFLOAT4X4>    mWorldMatrices;
+
+    unsigned int                        mDrawCallCount;
+    unsigned int                        mInstanceCount;
+    unsigned int                        mMaterialChangeCount;
+};
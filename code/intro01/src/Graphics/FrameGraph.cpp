@@ -0,0 +1,352 @@
+///
+/// FrameGraph.cpp - Pass culling, ordering, transient lifetimes and aliasing.
+///
+
+#include "FrameGraph.h"
+
+#include "utils\assert.h"
+#include "utils\Profiler.h"
+#include "utils\MemoryTracker.h"
+
+#include <algorithm>
+#include <string.h>
+
+const unsigned int kUnused = 0xffffffff;
+
+// Plenty for the pass and resource lists of any graph we build
+const size_t kArenaBlockSize = 4 * 1024;
+
+// ======================================================================================
+// FrameGraphBuilder
+// ======================================================================================
+FrameGraphResource FrameGraphBuilder::Create(const char* name, const FrameGraphTextureDesc& desc)
+{
+    FrameGraphResource resource = mGraph->CreateResource(name, desc, nullptr, false);
+    return Write(resource);
+}
+
+FrameGraphResource FrameGraphBuilder::Read(FrameGraphResource resource)
+{
+    ASSERT(resource < mGraph->mResources.size());
+
+    mGraph->mPasses[mPass].Reads.push_back(resource);
+    return resource;
+}
+
+FrameGraphResource FrameGraphBuilder::Write(FrameGraphResource resource)
+{
+    ASSERT(resource < mGraph->mResources.size());
+
+    mGraph->mPasses[mPass].Writes.push_back(resource);
+    mGraph->mResources[resource].Writers.push_back(mPass);
+    return resource;
+}
+
+void FrameGraphBuilder::SideEffect()
+{
+    mGraph->mPasses[mPass].SideEffect = true;
+}
+
+// ======================================================================================
+// FrameGraphResources
+// ======================================================================================
+void* FrameGraphResources::Get(FrameGraphResource resource) const
+{
+    ASSERT(resource < mGraph->mResources.size());
+
+    const FrameGraph::Resource& entry = mGraph->mResources[resource];
+    if (entry.Imported)
+        return entry.External;
+
+    ASSERT(entry.PhysicalIndex != kUnused);
+    return mGraph->mPhysical[entry.PhysicalIndex].Texture;
+}
+
+// ======================================================================================
+// FrameGraph
+// ======================================================================================
+FrameGraph::FrameGraph()
+    : mArena(kArenaBlockSize)
+    , mCompiled(false)
+{
+    memset(&mStats, 0, sizeof(Stats));
+}
+
+FrameGraph::~FrameGraph()
+{
+}
+
+FrameGraphResource FrameGraph::Import(const char* name, const FrameGraphTextureDesc& desc, void* external)
+{
+    return CreateResource(name, desc, external, true);
+}
+
+FrameGraphResource FrameGraph::CreateResource(const char* name, const FrameGraphTextureDesc& desc, void* external, bool imported)
+{
+    ASSERTD(!mCompiled, "FrameGraph: resources can't be added after Compile");
+    MEMORY_TAG(MT_Render);
+
+    Resource resource(&mArena);
+    resource.Name = name;
+    resource.Desc = desc;
+    resource.External = external;
+    resource.Imported = imported;
+    resource.RefCount = 0;
+    resource.FirstUse = kUnused;
+    resource.LastUse = kUnused;
+    resource.PhysicalIndex = kUnused;
+
+    mResources.push_back(resource);
+    return (FrameGraphResource)(mResources.size() - 1);
+}
+
+unsigned int FrameGraph::AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute)
+{
+    ASSERTD(!mCompiled, "FrameGraph: passes can't be added after Compile");
+    MEMORY_TAG(MT_Render);
+
+    Pass pass(&mArena);
+    pass.Name = name;
+    pass.Execute = execute;
+    pass.SideEffect = false;
+    pass.RefCount = 0;
+    pass.Culled = false;
+    mPasses.push_back(pass);
+
+    unsigned int index = (unsigned int)mPasses.size() - 1;
+
+    FrameGraphBuilder builder(this, index);
+    setup(builder);
+
+    return index;
+}
+
+bool FrameGraph::Compile()
+{
+    PROFILE_FUNCTION();
+    MEMORY_TAG(MT_Render);
+
+    CullPasses();
+    if (!SortPasses())
+        return false;
+
+    ComputeLifetimes();
+    AssignPhysical();
+
+    mStats.PassCount = (unsigned int)mPasses.size();
+    mStats.CulledPassCount = mStats.PassCount - (unsigned int)mOrder.size();
+
+    mCompiled = true;
+    return true;
+}
+
+void FrameGraph::CullPasses()
+{
+    // A pass lives as long as something consumes one of its outputs. Imported resources
+    // are consumed by whoever handed them to us.
+    for (auto& pass : mPasses)
+    {
+        pass.RefCount = (unsigned int)pass.Writes.size();
+        pass.Culled = false;
+    }
+
+    for (auto& resource : mResources)
+        resource.RefCount = resource.Imported ? 1 : 0;
+
+    for (auto& pass : mPasses)
+    {
+        for (auto read : pass.Reads)
+            mResources[read].RefCount++;
+    }
+
+    ArenaScope scratch(GetScratchArena());
+    ArenaVector<FrameGraphResource> unreferenced(ArenaAllocator<FrameGraphResource>(scratch.GetArena()));
+
+    // Cull one pass, and queue up any of its inputs nobody else wants
+    auto cull = [&](Pass& pass)
+    {
+        pass.Culled = true;
+        for (auto read : pass.Reads)
+        {
+            if (--mResources[read].RefCount == 0)
+                unreferenced.push_back(read);
+        }
+    };
+
+    // Resources nobody reads first - cull queues the ones it frees itself, and a resource
+    // queued twice would take two references off its writers
+    for (unsigned int index = 0; index < mResources.size(); index++)
+    {
+        if (mResources[index].RefCount == 0)
+            unreferenced.push_back(index);
+    }
+
+    for (auto& pass : mPasses)
+    {
+        if ((pass.RefCount == 0) && !pass.SideEffect)
+            cull(pass);
+    }
+
+    while (!unreferenced.empty())
+    {
+        FrameGraphResource resource = unreferenced.back();
+        unreferenced.pop_back();
+
+        for (auto writer : mResources[resource].Writers)
+        {
+            Pass& pass = mPasses[writer];
+            if (pass.Culled || pass.SideEffect)
+                continue;
+
+            if (--pass.RefCount == 0)
+                cull(pass);
+        }
+    }
+}
+
+bool FrameGraph::SortPasses()
+{
+    // Passes can only read what an earlier pass declared, so declaration order is already a
+    // valid topological order - all that's left is dropping culled passes and checking nobody
+    // reads a transient before it was written.
+    ArenaScope scratch(GetScratchArena());
+    ArenaVector<bool> written(mResources.size(), false, ArenaAllocator<bool>(scratch.GetArena()));
+
+    mOrder.clear();
+    for (unsigned int index = 0; index < mPasses.size(); index++)
+    {
+        const Pass& pass = mPasses[index];
+        if (pass.Culled)
+            continue;
+
+        for (auto read : pass.Reads)
+        {
+            if (!mResources[read].Imported && !written[read])
+            {
+                ASSERTD(false, "FrameGraph: pass reads a transient before anything writes it");
+                return false;
+            }
+        }
+
+        for (auto write : pass.Writes)
+            written[write] = true;
+
+        mOrder.push_back(index);
+    }
+
+    return true;
+}
+
+void FrameGraph::ComputeLifetimes()
+{
+    auto touch = [](Resource& resource, unsigned int position)
+    {
+        if (resource.FirstUse == kUnused)
+            resource.FirstUse = position;
+        resource.LastUse = position;
+    };
+
+    for (unsigned int position = 0; position < mOrder.size(); position++)
+    {
+        Pass& pass = mPasses[mOrder[position]];
+        for (auto read : pass.Reads)
+            touch(mResources[read], position);
+        for (auto write : pass.Writes)
+            touch(mResources[write], position);
+    }
+}
+
+void FrameGraph::AssignPhysical()
+{
+    // Hand out physical textures in order of first use, reusing any compatible texture
+    // whose previous owner is already dead.
+    ArenaScope scratch(GetScratchArena());
+    ArenaVector<FrameGraphResource> transients(ArenaAllocator<FrameGraphResource>(scratch.GetArena()));
+    for (unsigned int index = 0; index < mResources.size(); index++)
+    {
+        if (!mResources[index].Imported && (mResources[index].FirstUse != kUnused))
+            transients.push_back(index);
+    }
+
+    std::sort(transients.begin(), transients.end(), [this](FrameGraphResource lhs, FrameGraphResource rhs)
+    {
+        return mResources[lhs].FirstUse < mResources[rhs].FirstUse;
+    });
+
+    mPhysical.clear();
+    mStats.TransientCount = (unsigned int)transients.size();
+    mStats.TransientBytes = 0;
+    mStats.PhysicalBytes = 0;
+
+    for (auto index : transients)
+    {
+        Resource& resource = mResources[index];
+        mStats.TransientBytes += resource.Desc.SizeInBytes();
+
+        unsigned int slot = kUnused;
+        for (unsigned int candidate = 0; candidate < mPhysical.size(); candidate++)
+        {
+            if (mPhysical[candidate].Desc.Matches(resource.Desc) && (mPhysical[candidate].LastUse < resource.FirstUse))
+            {
+                slot = candidate;
+                break;
+            }
+        }
+
+        if (slot == kUnused)
+        {
+            Physical physical;
+            physical.Desc = resource.Desc;
+            physical.Texture = nullptr;
+            mPhysical.push_back(physical);
+
+            slot = (unsigned int)mPhysical.size() - 1;
+            mStats.PhysicalBytes += resource.Desc.SizeInBytes();
+        }
+
+        mPhysical[slot].LastUse = resource.LastUse;
+        resource.PhysicalIndex = slot;
+    }
+
+    mStats.PhysicalCount = (unsigned int)mPhysical.size();
+}
+
+void FrameGraph::Execute(IFrameGraphAllocator* allocator)
+{
+    PROFILE_FUNCTION();
+    ASSERTD(mCompiled, "FrameGraph: Execute called before Compile");
+    ASSERT(allocator != nullptr || mPhysical.empty());
+
+    for (auto& physical : mPhysical)
+        physical.Texture = allocator->Acquire(physical.Desc);
+
+    FrameGraphResources resources(this);
+    for (auto index : mOrder)
+    {
+        if (mPasses[index].Execute)
+        {
+            PROFILE_SCOPE(mPasses[index].Name);
+            mPasses[index].Execute(resources);
+        }
+    }
+
+    for (auto& physical : mPhysical)
+    {
+        allocator->Release(physical.Texture);
+        physical.Texture = nullptr;
+    }
+}
+
+void FrameGraph::Reset()
+{
+    mPasses.clear();
+    mResources.clear();
+    mPhysical.clear();
+    mOrder.clear();
+
+    // Everything that pointed into the arena is gone now
+    mArena.Reset();
+
+    mCompiled = false;
+    memset(&mStats, 0, sizeof(Stats));
+}
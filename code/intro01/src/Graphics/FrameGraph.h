@@ -0,0 +1,176 @@
+///
+/// FrameGraph.h - Declarative description of a frame's render passes.
+/// Passes declare the resources they read and write. Compile culls passes nobody consumes,
+/// orders what's left, works out the lifetime of every transient texture and lets transients
+/// whose lifetimes don't overlap share the same physical texture.
+///
+/// Nothing in here touches the device - physical textures come from an IFrameGraphAllocator,
+/// so the scheduling can be run and measured without a GPU.
+///
+#pragma once
+
+#include "utils\Arena.h"
+
+#include <functional>
+#include <vector>
+
+typedef unsigned int FrameGraphResource;
+const FrameGraphResource kInvalidFrameGraphResource = 0xffffffff;
+
+struct FrameGraphTextureDesc
+{
+    unsigned int Width;
+    unsigned int Height;
+    unsigned int Format;        // DXGI_FORMAT
+    unsigned int BytesPerPixel;
+    unsigned int BindFlags;     // D3D11_BIND_FLAG
+
+    bool Matches(const FrameGraphTextureDesc& other) const
+    {
+        return (Width == other.Width) && (Height == other.Height) && (Format == other.Format) && (BindFlags == other.BindFlags);
+    }
+
+    unsigned int SizeInBytes() const { return Width * Height * BytesPerPixel; }
+};
+
+// Hands out the physical textures transients are mapped to
+class IFrameGraphAllocator
+{
+public:
+    virtual ~IFrameGraphAllocator() {}
+
+    virtual void* Acquire(const FrameGraphTextureDesc& desc) = 0;
+    virtual void Release(void* texture) = 0;
+};
+
+class FrameGraph;
+
+// Handed to a pass' setup function to declare what it uses
+class FrameGraphBuilder
+{
+    friend class FrameGraph;
+public:
+    FrameGraphResource Create(const char* name, const FrameGraphTextureDesc& desc);
+    FrameGraphResource Read(FrameGraphResource resource);
+    FrameGraphResource Write(FrameGraphResource resource);
+
+    // The pass does something outside the graph - never cull it
+    void SideEffect();
+
+private:
+    FrameGraphBuilder(FrameGraph* graph, unsigned int pass) : mGraph(graph), mPass(pass) {}
+
+private:
+    FrameGraph*     mGraph;
+    unsigned int    mPass;
+};
+
+// Handed to a pass' execute function to look up the physical textures
+class FrameGraphResources
+{
+    friend class FrameGraph;
+public:
+    void* Get(FrameGraphResource resource) const;
+
+private:
+    FrameGraphResources(const FrameGraph* graph) : mGraph(graph) {}
+
+private:
+    const FrameGraph* mGraph;
+};
+
+class FrameGraph
+{
+    friend class FrameGraphBuilder;
+    friend class FrameGraphResources;
+public:
+    typedef std::function<void(FrameGraphBuilder&)>         SetupFunction;
+    typedef std::function<void(const FrameGraphResources&)> ExecuteFunction;
+
+    struct Stats
+    {
+        unsigned int PassCount;
+        unsigned int CulledPassCount;
+        unsigned int TransientCount;
+        unsigned int PhysicalCount;
+        unsigned int TransientBytes;    // if every transient had its own texture
+        unsigned int PhysicalBytes;     // after aliasing
+    };
+
+private:
+    // The per pass and per resource lists live in the graph's arena, which Reset rewinds
+    struct Pass
+    {
+        Pass(LinearArena* arena) : Reads(ArenaAllocator<FrameGraphResource>(arena)), Writes(ArenaAllocator<FrameGraphResource>(arena)) {}
+
+        const char*                         Name;
+        ExecuteFunction                     Execute;
+        ArenaVector<FrameGraphResource>     Reads;
+        ArenaVector<FrameGraphResource>     Writes;
+        bool                                SideEffect;
+
+        unsigned int                        RefCount;
+        bool                                Culled;
+    };
+
+    struct Resource
+    {
+        Resource(LinearArena* arena) : Writers(ArenaAllocator<unsigned int>(arena)) {}
+
+        const char*             Name;
+        FrameGraphTextureDesc   Desc;
+        void*                   External;       // imported resources are never aliased
+        bool                    Imported;
+
+        ArenaVector<unsigned int> Writers;
+        unsigned int            RefCount;
+
+        // Lifetime, as indices into the execution order
+        unsigned int            FirstUse;
+        unsigned int            LastUse;
+        unsigned int            PhysicalIndex;
+    };
+
+    struct Physical
+    {
+        FrameGraphTextureDesc   Desc;
+        unsigned int            LastUse;
+        void*                   Texture;
+    };
+
+public:
+    FrameGraph();
+    ~FrameGraph();
+
+    FrameGraphResource Import(const char* name, const FrameGraphTextureDesc& desc, void* external);
+    unsigned int AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute);
+
+    bool Compile();
+    void Execute(IFrameGraphAllocator* allocator);
+
+    // Drop all the passes and resources, keeping the storage for the next frame
+    void Reset();
+
+    const Stats& GetStats() const { return mStats; }
+    bool IsCulled(unsigned int pass) const { return mPasses[pass].Culled; }
+    const std::vector<unsigned int>& GetExecutionOrder() const { return mOrder; }
+    unsigned int GetPhysicalIndex(FrameGraphResource resource) const { return mResources[resource].PhysicalIndex; }
+
+private:
+    FrameGraphResource CreateResource(const char* name, const FrameGraphTextureDesc& desc, void* external, bool imported);
+
+    void CullPasses();
+    bool SortPasses();
+    void ComputeLifetimes();
+    void AssignPhysical();
+
+private:
+    std::vector<Pass>           mPasses;
+    std::vector<Resource>       mResources;
+    std::vector<Physical>       mPhysical;
+    std::vector<unsigned int>   mOrder;
+
+    LinearArena                 mArena;
+    bool                        mCompiled;
+    Stats                       mStats;
+};
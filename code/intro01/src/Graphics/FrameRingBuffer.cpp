@@ -0,0 +1,215 @@
+///
+/// FrameRingBuffer.cpp - Per-frame linear sub-allocation out of a single dynamic D3D11 buffer.
+///
+
+#include "stdafx.h"
+#include "d3d11_1.h"
+
+#include "FrameRingBuffer.h"
+
+#include "utils\assert.h"
+#include "utils\utils.h"
+
+#include <string.h>
+
+FrameRingBuffer::FrameRingBuffer()
+    : mContext(nullptr),
+      mContext1(nullptr),
+      mBuffer(nullptr),
+      mBytesPerFrame(0),
+      mAlignment(0),
+      mFrameIndex(0),
+      mRegionStart(0),
+      mHead(0),
+      mMapped(false),
+      mFirstMap(true),
+      mAllocationCount(0),
+      mStallCount(0)
+{
+    for (unsigned int index = 0; index < kFrameCount; index++)
+    {
+        mFences[index] = nullptr;
+        mFencePending[index] = false;
+    }
+}
+
+FrameRingBuffer::~FrameRingBuffer()
+{
+    Shutdown();
+}
+
+bool FrameRingBuffer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context, unsigned int bindFlags, unsigned int bytesPerFrame, unsigned int alignment)
+{
+    ASSERT(device != nullptr);
+    ASSERT(context != nullptr);
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    ASSERT(bytesPerFrame % alignment == 0);
+
+    mContext = context;
+    mBytesPerFrame = bytesPerFrame;
+    mAlignment = alignment;
+
+    if (bindFlags & D3D11_BIND_CONSTANT_BUFFER)
+    {
+        // Binding a constant buffer at an offset, and mapping one with NO_OVERWRITE, are both D3D11.1 features
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+        ZeroMemory(&options, sizeof(options));
+        if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))
+            || !options.ConstantBufferOffsetting
+            || !options.MapNoOverwriteOnDynamicConstantBuffer)
+        {
+            return false;
+        }
+
+        if (FAILED(context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&mContext1)))
+            return false;
+    }
+
+    D3D11_BUFFER_DESC bufferDesc;
+    ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+    bufferDesc.BindFlags = bindFlags;
+    bufferDesc.ByteWidth = bytesPerFrame * kFrameCount;
+    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+
+    if (FAILED(device->CreateBuffer(&bufferDesc, nullptr, &mBuffer)))
+        return false;
+
+    D3D11_QUERY_DESC queryDesc;
+    queryDesc.Query = D3D11_QUERY_EVENT;
+    queryDesc.MiscFlags = 0;
+
+    for (unsigned int index = 0; index < kFrameCount; index++)
+    {
+        if (FAILED(device->CreateQuery(&queryDesc, &mFences[index])))
+            return false;
+    }
+
+    mFrameIndex = 0;
+    mRegionStart = 0;
+    mHead = 0;
+    mFirstMap = true;
+
+    return true;
+}
+
+void FrameRingBuffer::Shutdown()
+{
+    if (mMapped)
+        EndWrite();
+
+    for (unsigned int index = 0; index < kFrameCount; index++)
+    {
+        SafeRelease(mFences[index]);
+        mFencePending[index] = false;
+    }
+
+    SafeRelease(mBuffer);
+    SafeRelease(mContext1);
+    mContext = nullptr;
+}
+
+void FrameRingBuffer::BeginFrame()
+{
+    if (mBuffer == nullptr)
+        return;
+
+    mFrameIndex = (mFrameIndex + 1) % kFrameCount;
+    mRegionStart = mFrameIndex * mBytesPerFrame;
+    mHead = mRegionStart;
+    mAllocationCount = 0;
+
+    // Wait for the GPU to be done with the region we're about to reuse. With three regions
+    // in flight this should almost never spin.
+    if (mFencePending[mFrameIndex])
+    {
+        if (mContext->GetData(mFences[mFrameIndex], nullptr, 0, 0) == S_FALSE)
+        {
+            mStallCount++;
+            while (mContext->GetData(mFences[mFrameIndex], nullptr, 0, 0) == S_FALSE)
+            {
+                YieldProcessor();
+            }
+        }
+        mFencePending[mFrameIndex] = false;
+    }
+}
+
+void FrameRingBuffer::EndFrame()
+{
+    if (mBuffer == nullptr)
+        return;
+
+    ASSERTD(!mMapped, "FrameRingBuffer: BeginWrite without a matching EndWrite");
+
+    mContext->End(mFences[mFrameIndex]);
+    mFencePending[mFrameIndex] = true;
+}
+
+void* FrameRingBuffer::BeginWrite(unsigned int size, unsigned int* offset)
+{
+    ASSERT(offset != nullptr);
+    ASSERT(!mMapped);
+
+    if (mBuffer == nullptr)
+        return nullptr;
+
+    unsigned int alignedHead = (mHead + (mAlignment - 1)) & ~(mAlignment - 1);
+    unsigned int alignedSize = (size + (mAlignment - 1)) & ~(mAlignment - 1);
+    if (alignedHead + alignedSize > mRegionStart + mBytesPerFrame)
+    {
+        ASSERTD(false, "FrameRingBuffer: frame region exhausted");
+        return nullptr;
+    }
+
+    // The first map of a dynamic buffer's lifetime has to discard, after that we only
+    // ever write to space the GPU is guaranteed not to be using.
+    D3D11_MAP mapType = mFirstMap ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    if (FAILED(mContext->Map(mBuffer, 0, mapType, 0, &mappedResource)))
+        return nullptr;
+
+    mFirstMap = false;
+    mMapped = true;
+    mHead = alignedHead + alignedSize;
+    mAllocationCount++;
+
+    *offset = alignedHead;
+    return (unsigned char*)mappedResource.pData + alignedHead;
+}
+
+void FrameRingBuffer::EndWrite()
+{
+    ASSERT(mMapped);
+
+    mContext->Unmap(mBuffer, 0);
+    mMapped = false;
+}
+
+bool FrameRingBuffer::Upload(const void* data, unsigned int size, unsigned int* offset)
+{
+    ASSERT(data != nullptr);
+
+    void* dest = BeginWrite(size, offset);
+    if (dest == nullptr)
+        return false;
+
+    memcpy(dest, data, size);
+    EndWrite();
+
+    return true;
+}
+
+void FrameRingBuffer::BindVSConstantBuffer(unsigned int slot, unsigned int offset, unsigned int size)
+{
+    ASSERT(mContext1 != nullptr);
+    ASSERT(offset % kConstantBufferAlignment == 0);
+
+    // Both values are in shader constants (16 bytes), and the count has to be a multiple of 16
+    UINT firstConstant = offset / 16;
+    UINT numConstants = ((size + (kConstantBufferAlignment - 1)) & ~(kConstantBufferAlignment - 1)) / 16;
+
+    mContext1->VSSetConstantBuffers1(slot, 1, &mBuffer, &firstConstant, &numConstants);
+}
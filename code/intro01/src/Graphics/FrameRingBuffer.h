@@ -0,0 +1,71 @@
+///
+/// FrameRingBuffer.h - A large dynamic buffer, carved up per frame with an aligned bump pointer.
+/// The buffer is split into kFrameCount regions, each one fenced so the CPU never writes into
+/// a region the GPU may still be reading from.
+///
+#pragma once
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11DeviceContext1;
+struct ID3D11Buffer;
+struct ID3D11Query;
+
+class FrameRingBuffer
+{
+public:
+    static const unsigned int kFrameCount = 3;
+
+    // D3D11.1 constant buffer offsets are in 16 constants (256 bytes) granularity
+    static const unsigned int kConstantBufferAlignment = 256;
+
+public:
+    FrameRingBuffer();
+    ~FrameRingBuffer();
+
+    bool Initialize(ID3D11Device* device, ID3D11DeviceContext* context, unsigned int bindFlags, unsigned int bytesPerFrame, unsigned int alignment);
+    void Shutdown();
+
+    void BeginFrame();
+    void EndFrame();
+
+    // Reserve space in the current frame's region and map it for writing.
+    // Every successful BeginWrite must be paired with an EndWrite before the data is drawn with.
+    void* BeginWrite(unsigned int size, unsigned int* offset);
+    void EndWrite();
+
+    bool Upload(const void* data, unsigned int size, unsigned int* offset);
+
+    // Only valid for rings created with D3D11_BIND_CONSTANT_BUFFER
+    void BindVSConstantBuffer(unsigned int slot, unsigned int offset, unsigned int size);
+
+    ID3D11Buffer* GetBuffer() const { return mBuffer; }
+
+    // Stats for the frame in flight
+    unsigned int GetBytesAllocated() const { return mHead - mRegionStart; }
+    unsigned int GetAllocationCount() const { return mAllocationCount; }
+    unsigned int GetStallCount() const { return mStallCount; }
+
+private:
+    ID3D11DeviceContext*    mContext;
+    ID3D11DeviceContext1*   mContext1;
+    ID3D11Buffer*           mBuffer;
+    ID3D11Query*            mFences[kFrameCount];
+    bool                    mFencePending[kFrameCount];
+
+    unsigned int            mBytesPerFrame;
+    unsigned int            mAlignment;
+
+    unsigned int            mFrameIndex;
+    unsigned int            mRegionStart;
+    unsigned int            mHead;
+
+    bool                    mMapped;
+    bool                    mFirstMap;
+
+    unsigned int            mAllocationCount;
+    unsigned int            mStallCount;
+};
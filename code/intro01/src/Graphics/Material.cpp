@@ -1,10 +1,22 @@
-#include "StdAfx.h"
 #include "Material.h"
 
-Material::Material()
+#include <string.h>
+
+void MaterialParameters::Reset()
 {
+    memset(this, 0, sizeof(*this));
+    for (unsigned int slot = 0; slot < MTS_Count; slot++)
+        Textures[slot] = kNoTexture;
+}
+
+Material::Material(MaterialId id, const MaterialParameters& parameters)
+    : mId(id)
+    , mParameters(parameters)
+{
+    for (unsigned int slot = 0; slot < MTS_Count; slot++)
+        mTextures[slot] = nullptr;
 }
 
 Material::~Material()
 {
-}
\ No newline at end of file
+}
@@ -1,12 +1,75 @@
+///
+/// Material.h - How a surface looks: its textures, colours and scalars, and the shader
+/// variant that draws them.
+/// Everything that makes one material differ from another lives in MaterialParameters, a
+/// flat block of plain values. Two materials with the same block are the same material,
+/// whichever file they came from, so MaterialLibrary keeps one of each (see
+/// MaterialLibrary.h) and meshes refer to it by id.
+///
 #pragma once
 
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class Texture2D;
+
+typedef unsigned int MaterialId;
+const MaterialId kInvalidMaterial = 0xffffffff;
+
+enum MaterialTextureSlot
+{
+    MTS_Diffuse = 0,            // bound to t0, and so on
+    MTS_Normal,
+    MTS_Specular,
+    MTS_Emissive,
+    MTS_Count
+};
+
+enum MaterialColor
+{
+    MC_Diffuse = 0,
+    MC_Specular,
+    MC_Emissive,
+    MC_Count
+};
+
+enum MaterialScalar
+{
+    MS_Shininess = 0,
+    MS_Opacity,
+    MS_Count
+};
+
+// Compared and hashed as bytes - every field is four bytes so there's no padding, but clear
+// it with Reset before filling it in all the same
+struct MaterialParameters
+{
+    static const unsigned int kNoTexture = 0xffffffff;
+
+    void Reset();
+
+    unsigned int    ShaderVariant;              // keyword mask for basicPS.hlsl (see ColorShader.h)
+    unsigned int    Textures[MTS_Count];        // index into the library's texture names, or kNoTexture
+    float           Colors[MC_Count][4];
+    float           Scalars[MS_Count];
+};
+
 class Material
 {
 public:
-    Material();
+    Material(MaterialId id, const MaterialParameters& parameters);
     ~Material();
 
-private:
+    MaterialId GetId() const { return mId; }
+    const MaterialParameters& GetParameters() const { return mParameters; }
 
-};
+    // Filled in once the textures are loaded - null for an empty slot, or a texture that
+    // couldn't be
+    Texture2D* GetTexture(MaterialTextureSlot slot) const { return mTextures[slot]; }
+    void SetTexture(MaterialTextureSlot slot, Texture2D* texture) { mTextures[slot] = texture; }
 
+private:
+    MaterialId          mId;
+    MaterialParameters  mParameters;
+    Texture2D*          mTextures[MTS_Count];   // owned by the asset manager
+};
@@ -0,0 +1,61 @@
+#include "MaterialLibrary.h"
+#include "ShaderReflection.h"
+
+#include "utils\assert.h"
+
+#include <string.h>
+
+MaterialLibrary::MaterialLibrary()
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+MaterialLibrary::~MaterialLibrary()
+{
+    for (auto material : mMaterials)
+        delete material;
+}
+
+MaterialId MaterialLibrary::Intern(const MaterialParameters& parameters)
+{
+    ++mStats.Requests;
+
+    // A different block under the same hash moves on to the next one - it's vanishingly
+    // rare, but two materials must never merge
+    unsigned long long hash = Hash(parameters);
+    for (;;)
+    {
+        auto found = mMaterialsByHash.find(hash);
+        if (found == mMaterialsByHash.end())
+            break;
+
+        if (memcmp(&mMaterials[found->second]->GetParameters(), &parameters, sizeof(parameters)) == 0)
+            return found->second;
+        ++hash;
+    }
+
+    MaterialId id = (MaterialId)mMaterials.size();
+    mMaterials.push_back(new Material(id, parameters));
+    mMaterialsByHash[hash] = id;
+    ++mStats.Materials;
+    return id;
+}
+
+unsigned int MaterialLibrary::InternTexture(const char* name)
+{
+    ASSERT(name != nullptr);
+
+    auto found = mTexturesByName.find(name);
+    if (found != mTexturesByName.end())
+        return found->second;
+
+    unsigned int texture = (unsigned int)mTextureNames.size();
+    mTextureNames.push_back(name);
+    mTexturesByName[name] = texture;
+    return texture;
+}
+
+unsigned long long MaterialLibrary::Hash(const MaterialParameters& parameters)
+{
+    return HashLayoutBytes(kLayoutHashSeed, &parameters, sizeof(parameters));
+}
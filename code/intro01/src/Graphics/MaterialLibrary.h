@@ -0,0 +1,51 @@
+///
+/// MaterialLibrary.h - One copy of every distinct material, handed out by id.
+/// Intern hashes the parameter block and gives back the id of the material with that block,
+/// making it the first time. Ids are small and dense, in the order materials were first
+/// seen, so they sort draws and index tables directly - and a material repeated across a
+/// hundred model files is still the one id and the one set of bindings.
+///
+/// Texture names are interned the same way, so the parameter block holds an index rather
+/// than a string and stays a flat block.
+///
+#pragma once
+
+#include "Material.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MaterialLibrary
+{
+public:
+    struct Stats
+    {
+        unsigned int    Requests;       // calls to Intern
+        unsigned int    Materials;      // distinct materials made
+    };
+
+public:
+    MaterialLibrary();
+    ~MaterialLibrary();
+
+    MaterialId Intern(const MaterialParameters& parameters);
+
+    // For MaterialParameters::Textures
+    unsigned int InternTexture(const char* name);
+    const char* GetTextureName(unsigned int texture) const { return mTextureNames[texture].c_str(); }
+
+    Material* GetMaterial(MaterialId id) const { return mMaterials[id]; }
+    unsigned int GetMaterialCount() const { return (unsigned int)mMaterials.size(); }
+
+    const Stats& GetStats() const { return mStats; }
+
+    static unsigned long long Hash(const MaterialParameters& parameters);
+
+private:
+    std::vector<Material*>                              mMaterials;
+    std::unordered_map<unsigned long long, MaterialId>  mMaterialsByHash;
+    std::vector<std::string>                            mTextureNames;
+    std::unordered_map<std::string, unsigned int>       mTexturesByName;
+    Stats                                               mStats;
+};
@@ -1,33 +1,59 @@
 #include "StdAfx.h"
 #include "Mesh.h"
 #include "utils\utils.h"
+#include "utils\assert.h"
 
 #include <d3d11.h>
+#include <stddef.h>
+
+const unsigned int kMeshesPerChunk = 256;
+
+static const VertexElement kInstancedMeshElements[] =
+{
+    { "POSITION", 0, VEF_Float3, 0, offsetof(PositionNormalUVLayout, Position), 0 },
+    { "NORMAL",   0, VEF_Float3, 0, offsetof(PositionNormalUVLayout, Normal),   0 },
+    { "TEXCOORD", 0, VEF_Float2, 0, offsetof(PositionNormalUVLayout, UV),       0 },
+    { "WORLD",    0, VEF_Float4, 1, offsetof(PerInstanceLayout, World) + 0 * sizeof(XMFLOAT4), 1 },
+    { "WORLD",    1, VEF_Float4, 1, offsetof(PerInstanceLayout, World) + 1 * sizeof(XMFLOAT4), 1 },
+    { "WORLD",    2, VEF_Float4, 1, offsetof(PerInstanceLayout, World) + 2 * sizeof(XMFLOAT4), 1 },
+    { "WORLD",    3, VEF_Float4, 1, offsetof(PerInstanceLayout, World) + 3 * sizeof(XMFLOAT4), 1 },
+};
+
+const VertexFormat kInstancedMeshFormat = { kInstancedMeshElements, _countof(kInstancedMeshElements) };
+
+DEFINE_POOLED_NEW(Mesh, kMeshesPerChunk)
 
 Mesh::Mesh()
 {
     mIndexBufferData = nullptr;
     mRawVertexData = nullptr;
+    mVertexBuffer = nullptr;
     mIndexBuffer = nullptr;
+    mIndexCount = 0;
+    mMaterial = kInvalidMaterial;
+    mOwnsData = true;
 }
 
 Mesh::~Mesh()
 {
-    if (mIndexBuffer != nullptr)
+    SafeRelease(mIndexBuffer);
+    SafeRelease(mVertexBuffer);
+
+    if (mOwnsData)
     {
-        delete mIndexBuffer;
-        mIndexBuffer = nullptr;
+        delete[] mRawVertexData;
+        delete[] mIndexBufferData;
     }
-
-    delete[] mRawVertexData;
-    delete[] mIndexBufferData;
 }
 
-bool Mesh::Load(PositionNormalUVLayout* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount)
+bool Mesh::Load(ID3D11Device* device, PositionNormalUVLayout* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount, bool ownsData)
 {
+    ASSERT(device != nullptr);
+
     mRawVertexData = vertices;
     mIndexCount = indexCount;
     mIndexBufferData = indices;
+    mOwnsData = ownsData;
 
     D3D11_BUFFER_DESC vertexBufferDesc;
     D3D11_SUBRESOURCE_DATA resourceData;
@@ -41,10 +67,43 @@ bool Mesh::Load(PositionNormalUVLayout* vertices, unsigned int vertexCount, unsi
     vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
 
     resourceData.pSysMem = vertices;
-    return false;
+
+    HRESULT hr = device->CreateBuffer(&vertexBufferDesc, &resourceData, &mVertexBuffer);
+    if (FAILED(hr))
+        return false;
+
+    D3D11_BUFFER_DESC indexBufferDesc;
+    ZeroMemory(&indexBufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+    indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    indexBufferDesc.ByteWidth = sizeof(unsigned int) * indexCount;
+    indexBufferDesc.CPUAccessFlags = 0;
+    indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+
+    resourceData.pSysMem = indices;
+
+    hr = device->CreateBuffer(&indexBufferDesc, &resourceData, &mIndexBuffer);
+    return SUCCEEDED(hr);
 }
 
 void Mesh::Render()
 {
 
 }
+
+void Mesh::RenderInstanced(ID3D11DeviceContext* context, ID3D11Buffer* instanceBuffer, unsigned int startInstance, unsigned int instanceCount)
+{
+    ASSERT(context != nullptr);
+    ASSERT(instanceBuffer != nullptr);
+
+    // Slot 0 is the mesh data, slot 1 the per-instance world matrices
+    ID3D11Buffer* buffers[2] = { mVertexBuffer, instanceBuffer };
+    const UINT strides[2] = { sizeof(PositionNormalUVLayout), sizeof(PerInstanceLayout) };
+    const UINT offsets[2] = { 0, 0 };
+
+    context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+    context->IASetIndexBuffer(mIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    context->DrawIndexedInstanced(mIndexCount, instanceCount, 0, 0, startInstance);
+}
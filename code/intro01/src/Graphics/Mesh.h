@@ -1,6 +1,9 @@
 #pragma once
 
 #include "AssetManagement\IResource.h"
+#include "Material.h"
+#include "VertexFormat.h"
+#include "utils\ObjectPool.h"
 
 #include <DirectXMath.h>
 
@@ -10,6 +13,8 @@ using namespace DirectX;
 // Forward Declarations - so the header file doesn't have to #include anything
 // ======================================================================================
 class ID3D11Buffer;
+struct ID3D11Device;
+struct ID3D11DeviceContext;
 
 // Initial Mesh Layout - Consists of a Postion, Normal and Single Texture UV
 struct PositionNormalUVLayout
@@ -19,15 +24,35 @@ struct PositionNormalUVLayout
     XMFLOAT2 UV;
 };
 
+// Per-instance stream - fed to the input assembler in slot 1 alongside PositionNormalUVLayout
+struct PerInstanceLayout
+{
+    XMFLOAT4X4 World;
+};
+
+// PositionNormalUVLayout in stream 0 and PerInstanceLayout in stream 1, the world matrix a
+// WORLD0-3 row at a time
+extern const VertexFormat kInstancedMeshFormat;
+
 class Mesh : public IResource
 {
+    DECLARE_POOLED_NEW(Mesh)
+
 public:
     Mesh();
     virtual ~Mesh() override;
 
-    bool Load(PositionNormalUVLayout* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount);
+    // With ownsData the mesh deletes the arrays, otherwise they belong to someone else - the
+    // model's block, for meshes made with Model::CreateMesh
+    bool Load(ID3D11Device* device, PositionNormalUVLayout* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount, bool ownsData = true);
 
     void Render();
+    void RenderInstanced(ID3D11DeviceContext* context, ID3D11Buffer* instanceBuffer, unsigned int startInstance, unsigned int instanceCount);
+
+    // An id in the asset manager's MaterialLibrary - kInvalidMaterial draws with whatever
+    // is bound
+    void SetMaterial(MaterialId material) { mMaterial = material; }
+    MaterialId GetMaterial() const { return mMaterial; }
 
 private:
     ID3D11Buffer* mVertexBuffer;
@@ -36,5 +61,7 @@ private:
     PositionNormalUVLayout* mRawVertexData;
     unsigned int* mIndexBufferData;
     unsigned int mIndexCount;
+    MaterialId mMaterial;
+    bool mOwnsData;
 };
 
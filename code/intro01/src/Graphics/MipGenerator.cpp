@@ -0,0 +1,407 @@
+#include "MipGenerator.h"
+#include "TextureData.h"
+
+#include "utils\JobSystem.h"
+#include "utils\SimdMath.h"
+#include "utils\assert.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+    // Rows of the smaller level each job fills. Every band filters a few source rows its
+    // neighbours filter too, so much smaller than this and that starts to cost.
+    const unsigned int kBandRows        = 16;
+
+    // In destination texels either side of the centre, and the window's shape
+    const float kKaiserRadius           = 3.0f;
+    const float kKaiserAlpha            = 4.0f;
+
+    // ======================================================================================
+    // sRGB - decoded from 8 bits through a table, encoded back from 16 bit linear through
+    // another
+    // ======================================================================================
+    struct ColorTables
+    {
+        ColorTables()
+        {
+            for (unsigned int value = 0; value < 256; value++)
+            {
+                float srgb = value / 255.0f;
+                SrgbToLinear[value] = (srgb <= 0.04045f) ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+            }
+
+            for (unsigned int value = 0; value < 65536; value++)
+            {
+                float linear = value / 65535.0f;
+                float srgb = (linear <= 0.0031308f) ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+                LinearToSrgb[value] = (unsigned char)(srgb * 255.0f + 0.5f);
+            }
+        }
+
+        float           SrgbToLinear[256];
+        unsigned char   LinearToSrgb[65536];
+    };
+
+    const ColorTables& GetColorTables()
+    {
+        static const ColorTables tables;
+        return tables;
+    }
+
+    // ======================================================================================
+    // Filters
+    // ======================================================================================
+
+    // Modified Bessel function of the first kind, order zero - the Kaiser window's shape
+    double BesselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (unsigned int k = 1; k < 32; k++)
+        {
+            double half = x / (2.0 * k);
+            term *= half * half;
+            sum += term;
+            if (term < sum * 1e-12)
+                break;
+        }
+        return sum;
+    }
+
+    double Kaiser(double x)
+    {
+        double t = x / kKaiserRadius;
+        if ((t <= -1.0) || (t >= 1.0))
+            return 0.0;
+
+        double sinc = (fabs(x) < 1e-6) ? 1.0 : sin(Math::kPi * x) / (Math::kPi * x);
+        return sinc * BesselI0(kKaiserAlpha * sqrt(1.0 - t * t)) / BesselI0(kKaiserAlpha);
+    }
+
+    // What one axis of a resample reads: TapCount source texels and their weights for each
+    // destination texel, padded out with zero weights so every texel has the same count
+    struct FilterTaps
+    {
+        unsigned int                TapCount;
+        std::vector<unsigned int>   Indices;
+        std::vector<float>          Weights;
+    };
+
+    unsigned int AddressTexel(int index, unsigned int size, bool wrap)
+    {
+        if (wrap)
+            return (unsigned int)(((index % (int)size) + (int)size) % (int)size);
+        return (unsigned int)((index < 0) ? 0 : (index >= (int)size) ? (int)size - 1 : index);
+    }
+
+    void BuildTaps(unsigned int sourceSize, unsigned int size, const MipSettings& settings, FilterTaps& taps)
+    {
+        double scale = (double)sourceSize / size;
+        double radius = (settings.Filter == MF_Kaiser) ? kKaiserRadius * scale : 0.5 * scale;
+
+        taps.TapCount = (unsigned int)ceil(radius * 2.0) + 1;
+        taps.Indices.assign((size_t)size * taps.TapCount, 0);
+        taps.Weights.assign((size_t)size * taps.TapCount, 0.0f);
+
+        for (unsigned int texel = 0; texel < size; texel++)
+        {
+            double centre = (texel + 0.5) * scale;
+            int first = (int)floor(centre - radius);
+
+            // Taps off the edge read the edge texel, or the far side if the texture wraps
+            double total = 0.0;
+            for (unsigned int tap = 0; tap < taps.TapCount; tap++)
+            {
+                int source = first + (int)tap;
+                double weight = 0.0;
+                if (settings.Filter == MF_Kaiser)
+                {
+                    weight = Kaiser((source + 0.5 - centre) / scale);
+                }
+                else
+                {
+                    // How much of the source texel the box covers
+                    double left = std::max((double)source, centre - radius);
+                    double right = std::min((double)source + 1.0, centre + radius);
+                    weight = std::max(right - left, 0.0);
+                }
+
+                size_t slot = (size_t)texel * taps.TapCount + tap;
+                taps.Indices[slot] = AddressTexel(source, sourceSize, settings.Wrap);
+                taps.Weights[slot] = (float)weight;
+                total += weight;
+            }
+
+            // Normalized, so a flat colour stays exactly that colour
+            for (unsigned int tap = 0; tap < taps.TapCount; tap++)
+            {
+                size_t slot = (size_t)texel * taps.TapCount + tap;
+                taps.Weights[slot] = (total != 0.0) ? (float)(taps.Weights[slot] / total) : 0.0f;
+            }
+        }
+    }
+
+    // ======================================================================================
+    // One level from the one above
+    // ======================================================================================
+
+    // The level being read - the 8 bit source for the first step, 16 bit linear after that
+    struct SourceLevel
+    {
+        const unsigned char*    Pixels;
+        unsigned int            Width;
+        unsigned int            Height;
+        unsigned int            RowPitch;
+        bool                    Linear16;
+    };
+
+    // Per thread, so bands don't allocate once they're warmed up
+    struct BandScratch
+    {
+        std::vector<Math::Vec4>     Line;           // a source row in linear float
+        std::vector<Math::Vec4>     Filtered;       // source rows after the horizontal pass
+        std::vector<Math::Vec4>     Accumulated;    // a destination row
+        std::vector<unsigned int>   Rows;           // source row behind each filtered row
+    };
+
+    class LevelFilter
+    {
+    public:
+        LevelFilter(const SourceLevel& source, unsigned int width, unsigned int height, const MipSettings& settings)
+            : mSource(source), mWidth(width), mHeight(height), mSrgb(settings.Srgb), mTables(GetColorTables()),
+              mOutput(nullptr), mOutputPitch(0), mLinear(nullptr)
+        {
+            BuildTaps(source.Width, width, settings, mColumns);
+            BuildTaps(source.Height, height, settings, mRows);
+        }
+
+        // output gets the finished level, linear (if not null) the 16 bit copy the next level is
+        // made from
+        void SetOutput(unsigned char* output, unsigned int outputPitch, unsigned short* linear)
+        {
+            mOutput = output;
+            mOutputPitch = outputPitch;
+            mLinear = linear;
+        }
+
+        unsigned int GetBandCount() const { return (mHeight + kBandRows - 1) / kBandRows; }
+
+        void FilterBand(unsigned int band, BandScratch& scratch) const
+        {
+            unsigned int firstRow = band * kBandRows;
+            unsigned int endRow = std::min(firstRow + kBandRows, mHeight);
+
+            // Every source row the band's vertical taps touch, once each
+            scratch.Rows.clear();
+            for (unsigned int row = firstRow; row < endRow; row++)
+            {
+                for (unsigned int tap = 0; tap < mRows.TapCount; tap++)
+                {
+                    size_t slot = (size_t)row * mRows.TapCount + tap;
+                    if (mRows.Weights[slot] != 0.0f)
+                        scratch.Rows.push_back(mRows.Indices[slot]);
+                }
+            }
+            std::sort(scratch.Rows.begin(), scratch.Rows.end());
+            scratch.Rows.erase(std::unique(scratch.Rows.begin(), scratch.Rows.end()), scratch.Rows.end());
+
+            scratch.Line.resize(mSource.Width);
+            scratch.Filtered.resize(scratch.Rows.size() * mWidth);
+            scratch.Accumulated.resize(mWidth);
+
+            for (unsigned int index = 0; index < scratch.Rows.size(); index++)
+            {
+                LoadRow(scratch.Rows[index], scratch.Line.data());
+                FilterRow(scratch.Line.data(), &scratch.Filtered[(size_t)index * mWidth]);
+            }
+
+            Math::Vector zero = Math::VectorZero();
+            for (unsigned int row = firstRow; row < endRow; row++)
+            {
+                for (unsigned int column = 0; column < mWidth; column++)
+                    Math::VectorStore4(&scratch.Accumulated[column], zero);
+
+                for (unsigned int tap = 0; tap < mRows.TapCount; tap++)
+                {
+                    size_t slot = (size_t)row * mRows.TapCount + tap;
+                    if (mRows.Weights[slot] == 0.0f)
+                        continue;
+
+                    size_t filtered = std::lower_bound(scratch.Rows.begin(), scratch.Rows.end(), mRows.Indices[slot]) - scratch.Rows.begin();
+                    const Math::Vec4* source = &scratch.Filtered[filtered * mWidth];
+                    Math::Vector weight = Math::VectorReplicate(mRows.Weights[slot]);
+
+                    for (unsigned int column = 0; column < mWidth; column++)
+                    {
+                        Math::Vector sum = Math::VectorLoad4(&scratch.Accumulated[column]);
+                        sum = Math::VectorMultiplyAdd(Math::VectorLoad4(&source[column]), weight, sum);
+                        Math::VectorStore4(&scratch.Accumulated[column], sum);
+                    }
+                }
+
+                StoreRow(row, scratch.Accumulated.data());
+            }
+        }
+
+    private:
+        void LoadRow(unsigned int row, Math::Vec4* line) const
+        {
+            const unsigned char* pixels = mSource.Pixels + (size_t)row * mSource.RowPitch;
+            if (mSource.Linear16)
+            {
+                const unsigned short* texels = (const unsigned short*)pixels;
+                Math::Vector scale = Math::VectorReplicate(1.0f / 65535.0f);
+                for (unsigned int column = 0; column < mSource.Width; column++, texels += 4)
+                {
+                    Math::Vector texel = Math::VectorSet(texels[0], texels[1], texels[2], texels[3]);
+                    Math::VectorStore4(&line[column], Math::VectorMultiply(texel, scale));
+                }
+            }
+            else
+            {
+                const float* decode = mTables.SrgbToLinear;
+                const float kByteScale = 1.0f / 255.0f;
+                for (unsigned int column = 0; column < mSource.Width; column++, pixels += 4)
+                {
+                    // Alpha is always linear
+                    line[column].x = mSrgb ? decode[pixels[0]] : pixels[0] * kByteScale;
+                    line[column].y = mSrgb ? decode[pixels[1]] : pixels[1] * kByteScale;
+                    line[column].z = mSrgb ? decode[pixels[2]] : pixels[2] * kByteScale;
+                    line[column].w = pixels[3] * kByteScale;
+                }
+            }
+        }
+
+        void FilterRow(const Math::Vec4* line, Math::Vec4* filtered) const
+        {
+            const unsigned int* indices = mColumns.Indices.data();
+            const float* weights = mColumns.Weights.data();
+            for (unsigned int column = 0; column < mWidth; column++)
+            {
+                Math::Vector sum = Math::VectorZero();
+                for (unsigned int tap = 0; tap < mColumns.TapCount; tap++, indices++, weights++)
+                    sum = Math::VectorMultiplyAdd(Math::VectorLoad4(&line[*indices]), Math::VectorReplicate(*weights), sum);
+                Math::VectorStore4(&filtered[column], sum);
+            }
+        }
+
+        void StoreRow(unsigned int row, const Math::Vec4* accumulated) const
+        {
+            unsigned char* output = mOutput + (size_t)row * mOutputPitch;
+            unsigned short* linear = (mLinear != nullptr) ? mLinear + (size_t)row * mWidth * 4 : nullptr;
+
+            // Kaiser's negative lobes can overshoot, so everything's clamped on the way out
+            Math::Vector zero = Math::VectorZero();
+            Math::Vector one = Math::VectorReplicate(1.0f);
+            Math::Vector scale = Math::VectorReplicate(65535.0f);
+            Math::Vector half = Math::VectorReplicate(0.5f);
+
+            for (unsigned int column = 0; column < mWidth; column++, output += 4)
+            {
+                Math::Vector texel = Math::VectorMin(Math::VectorMax(Math::VectorLoad4(&accumulated[column]), zero), one);
+
+                Math::Vec4 quantized;
+                Math::VectorStore4(&quantized, Math::VectorMultiplyAdd(texel, scale, half));
+                unsigned short channels[4] = { (unsigned short)quantized.x, (unsigned short)quantized.y, (unsigned short)quantized.z, (unsigned short)quantized.w };
+
+                for (unsigned int channel = 0; channel < 4; channel++)
+                {
+                    bool encode = mSrgb && (channel < 3);
+                    output[channel] = encode ? mTables.LinearToSrgb[channels[channel]] : (unsigned char)((channels[channel] * 255u + 32767u) / 65535u);
+                }
+
+                if (linear != nullptr)
+                {
+                    memcpy(linear, channels, sizeof(channels));
+                    linear += 4;
+                }
+            }
+        }
+
+    private:
+        SourceLevel             mSource;
+        unsigned int            mWidth;
+        unsigned int            mHeight;
+        bool                    mSrgb;
+        const ColorTables&      mTables;
+        FilterTaps              mColumns;
+        FilterTaps              mRows;
+
+        unsigned char*          mOutput;
+        unsigned int            mOutputPitch;
+        unsigned short*         mLinear;
+    };
+}
+
+bool GenerateMips(const unsigned char* rgba, unsigned int width, unsigned int height, unsigned int rowPitch,
+                  const MipSettings& settings, JobSystem* jobs, TextureData& texture)
+{
+    ASSERT(rgba != nullptr);
+    ASSERT(rowPitch >= width * 4);
+
+    if (!texture.Allocate(settings.Srgb ? TF_RGBA8_SRGB : TF_RGBA8, width, height, settings.MipCount))
+        return false;
+
+    // Level 0 is the source as it is
+    const TextureMip& top = texture.GetMip(0);
+    for (unsigned int row = 0; row < height; row++)
+        memcpy(texture.GetMipData(0) + (size_t)row * top.RowPitch, rgba + (size_t)row * rowPitch, (size_t)width * 4);
+
+    // One per worker, and the last for the calling thread when it isn't one - ParallelFor runs
+    // bands inline on it too
+    unsigned int threadCount = (jobs != nullptr) ? jobs->GetThreadCount() : 0;
+    std::vector<BandScratch> scratch(threadCount + 1);
+
+    SourceLevel source;
+    source.Pixels = rgba;
+    source.Width = width;
+    source.Height = height;
+    source.RowPitch = rowPitch;
+    source.Linear16 = false;
+
+    // Each level reads the 16 bit copy of the one before, then leaves its own
+    std::vector<unsigned short> previous;
+    std::vector<unsigned short> current;
+
+    for (unsigned int mip = 1; mip < texture.GetMipCount(); mip++)
+    {
+        const TextureMip& level = texture.GetMip(mip);
+        bool last = (mip + 1 == texture.GetMipCount());
+
+        current.resize(last ? 0 : (size_t)level.Width * level.Height * 4);
+
+        LevelFilter filter(source, level.Width, level.Height, settings);
+        filter.SetOutput(texture.GetMipData(mip), level.RowPitch, last ? nullptr : current.data());
+
+        unsigned int bandCount = filter.GetBandCount();
+        if ((jobs != nullptr) && (bandCount > 1))
+        {
+            JobCounter counter;
+            auto filterBand = [&filter, &scratch, jobs, threadCount](unsigned int band)
+            {
+                unsigned int worker = jobs->GetWorkerIndex();
+                filter.FilterBand(band, scratch[(worker != JobSystem::kInvalidWorker) ? worker : threadCount]);
+            };
+
+            jobs->ParallelFor(bandCount, filterBand, &counter, 1);
+            jobs->Wait(&counter);
+        }
+        else
+        {
+            for (unsigned int band = 0; band < bandCount; band++)
+                filter.FilterBand(band, scratch[threadCount]);
+        }
+
+        previous.swap(current);
+        source.Pixels = (const unsigned char*)previous.data();
+        source.Width = level.Width;
+        source.Height = level.Height;
+        source.RowPitch = level.Width * 4 * sizeof(unsigned short);
+        source.Linear16 = true;
+    }
+
+    return true;
+}
@@ -0,0 +1,45 @@
+///
+/// MipGenerator.h - Builds a texture's mip chain on the CPU.
+/// Each level is filtered from the one above it in linear light - sRGB sources are decoded
+/// first and encoded again on the way out, so mips don't darken the way they do when sRGB
+/// values are averaged as they are. Intermediate levels are kept at 16 bits a channel, so
+/// the error doesn't pile up down the chain.
+///
+/// The filter is separable and works on a whole texel per Math::Vector. Levels are cut
+/// into bands of rows and the bands spread over the job system, which is what makes 4K and
+/// 8K sources practical:
+///
+///     MipSettings settings;
+///     settings.Filter = MF_Kaiser;
+///     TextureData texture;
+///     GenerateMips(rgba, width, height, width * 4, settings, &jobs, texture);
+///
+#pragma once
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class JobSystem;
+class TextureData;
+
+enum MipFilter
+{
+    MF_Box = 0,             // the average of the texels underneath - fast, a little soft
+    MF_Kaiser,              // Kaiser windowed sinc - sharper, can ring on hard edges
+};
+
+struct MipSettings
+{
+    MipSettings() : Filter(MF_Box), Srgb(true), Wrap(false), MipCount(0) {}
+
+    MipFilter       Filter;
+    bool            Srgb;           // colour is sRGB encoded - false for normal maps and masks
+    bool            Wrap;           // the texture tiles, so filters wrap around the edges
+    unsigned int    MipCount;       // zero for a full chain
+};
+
+// rgba is 8 bits a channel, rowPitch bytes from row to row. Fills texture with RGBA8, or
+// RGBA8_SRGB if settings.Srgb, level 0 a copy of the source. Without a job system it all
+// runs on the calling thread. False if the size is out of range.
+bool GenerateMips(const unsigned char* rgba, unsigned int width, unsigned int height, unsigned int rowPitch,
+                  const MipSettings& settings, JobSystem* jobs, TextureData& texture);
@@ -2,42 +2,96 @@
 
 #include "Mesh.h"
 #include "Model.h"
-#include "Material.h"
 
 #include "utils\assert.h"
 
+#include <new>
+#include <stdint.h>
+
+const unsigned int kModelsPerChunk = 64;
+
+DEFINE_POOLED_NEW(Model, kModelsPerChunk)
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
 Model::Model()
 {
+    mBlock = nullptr;
     mMeshArray = nullptr;
-    mMaterial = nullptr;
+    mMeshes = nullptr;
+    mVertices = nullptr;
+    mIndices = nullptr;
 
     mMeshCount = 0;
+    mCreatedCount = 0;
+    SetBounds(0.0f, 0.0f, 0.0f, 0.0f);
 }
 
 Model::~Model()
 {
     for (unsigned int index = 0; index < mMeshCount; index++)
     {
-        delete mMeshArray[index];
+        Mesh* mesh = mMeshArray[index];
+        if (IsInBlock(mesh))
+            mesh->~Mesh();
+        else
+            delete mesh;
         mMeshArray[index] = nullptr;
     }
 
-    delete[] mMeshArray;
-    delete mMaterial;
+    delete[] mBlock;
     mMeshCount = 0;
 }
 
-void Model::Initialize(unsigned int meshcount)
+void Model::Initialize(unsigned int meshcount, unsigned int vertexCount, unsigned int indexCount)
 {
     ASSERT(meshcount != 0);
+    ASSERT(mBlock == nullptr);
+
+    // [mesh table][meshes][vertices][indices], the meshes starting on a cache line
+    size_t meshesOffset = AlignUp(sizeof(Mesh*) * meshcount, kCacheLineSize);
+    size_t verticesOffset = AlignUp(meshesOffset + sizeof(Mesh) * meshcount, kCacheLineSize);
+    size_t indicesOffset = AlignUp(verticesOffset + sizeof(PositionNormalUVLayout) * vertexCount, kCacheLineSize);
+    size_t size = indicesOffset + sizeof(unsigned int) * indexCount;
+
+    mBlock = new char[size + kCacheLineSize];
+    char* base = (char*)AlignUp((uintptr_t)mBlock, kCacheLineSize);
+
+    mMeshArray = (Mesh**)base;
+    mMeshes = (Mesh*)(base + meshesOffset);
+    mVertices = (vertexCount > 0) ? (PositionNormalUVLayout*)(base + verticesOffset) : nullptr;
+    mIndices = (indexCount > 0) ? (unsigned int*)(base + indicesOffset) : nullptr;
 
-    mMeshArray = new Mesh*[meshcount];
     for (unsigned int index = 0; index < meshcount; index++)
     {
         mMeshArray[index] = nullptr;
     }
 
     mMeshCount = meshcount;
+    mCreatedCount = 0;
+}
+
+Mesh* Model::CreateMesh()
+{
+    ASSERT(mCreatedCount < mMeshCount);
+
+    // Global placement new - Mesh's own operator new would hide it
+    Mesh* mesh = ::new(&mMeshes[mCreatedCount++]) Mesh();
+    if (!AddMesh(mesh))
+    {
+        mesh->~Mesh();
+        return nullptr;
+    }
+
+    return mesh;
+}
+
+bool Model::IsInBlock(const Mesh* mesh) const
+{
+    return (mesh >= mMeshes) && (mesh < mMeshes + mMeshCount);
 }
 
 bool Model::AddMesh(Mesh* mesh)
@@ -67,3 +121,11 @@ void Model::Render()
         mMeshArray[index]->Render();
     }
 }
+
+void Model::SetBounds(float centerX, float centerY, float centerZ, float radius)
+{
+    mBounds[0] = centerX;
+    mBounds[1] = centerY;
+    mBounds[2] = centerZ;
+    mBounds[3] = radius;
+}
@@ -1,25 +1,55 @@
 #pragma once
 
+#include "utils\ObjectPool.h"
+
 // ======================================================================================
 // Forward Declarations - so the header file doesn't have to #include anything
 // ======================================================================================
 class Mesh;
-class Material;
+struct PositionNormalUVLayout;
 
 class Model
 {
+    DECLARE_POOLED_NEW(Model)
+
 public:
     Model();
     ~Model();
 
-    void Initialize(unsigned int meshcount);
+    // One cache line aligned block holds the mesh table, room for meshcount meshes and the
+    // vertices and indices of all of them, so a model's data sits together in memory
+    void Initialize(unsigned int meshcount, unsigned int vertexCount = 0, unsigned int indexCount = 0);
+
+    // Constructs the next mesh in the model's block - the bulk path MeshResourceLoader uses
+    Mesh* CreateMesh();
+
+    // Adds a mesh made elsewhere. The model deletes it.
     bool AddMesh(Mesh* mesh);
 
+    // The vertexCount vertices and indexCount indices reserved by Initialize
+    PositionNormalUVLayout* GetVertexStorage() const { return mVertices; }
+    unsigned int* GetIndexStorage() const { return mIndices; }
+
     void Render();
 
+    unsigned int GetMeshCount() const { return mMeshCount; }
+    Mesh* GetMesh(unsigned int index) const { return mMeshArray[index]; }
+
+    // Bounding sphere around every mesh, in model space
+    void SetBounds(float centerX, float centerY, float centerZ, float radius);
+    const float* GetBounds() const { return mBounds; }
+
+private:
+    bool IsInBlock(const Mesh* mesh) const;
+
 private:
+    char* mBlock;
     Mesh** mMeshArray;
-    Material* mMaterial;
+    Mesh* mMeshes;
+    PositionNormalUVLayout* mVertices;
+    unsigned int* mIndices;
 
     unsigned int mMeshCount;
+    unsigned int mCreatedCount;
+    float mBounds[4];   // center x, y, z and radius
 };
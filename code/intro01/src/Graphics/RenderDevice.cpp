@@ -3,9 +3,16 @@
 #include "DirectXMath.h"
 #include "VisualGrid.h"
 #include "RenderDevice.h"
+#include "FrameRingBuffer.h"
+#include "TransientTexturePool.h"
+#include "ShaderLayoutCache.h"
 
 #include "utils\Utils.h"
+#include "utils\Profiler.h"
 
+// Sizes of one frame's worth of transient data. Each ring holds FrameRingBuffer::kFrameCount of these.
+const unsigned int kConstantRingBytesPerFrame   = 1024 * 1024;
+const unsigned int kVertexRingBytesPerFrame     = 4 * 1024 * 1024;
 
 struct VS_CONSTANT_BUFFER
 {
@@ -21,11 +28,23 @@ RenderDevice::RenderDevice(void)
     mSwapChain = NULL;
     mBackBuffer = NULL;
     mRenderTargetView = NULL;
+    mConstantBuffer = NULL;
+    mConstantRing = nullptr;
+    mVertexRing = nullptr;
+    mTransientPool = nullptr;
+    mBackBufferTarget = nullptr;
+    mShaderLayouts = nullptr;
 }
 
 
 RenderDevice::~RenderDevice(void)
 {
+    delete mConstantRing;
+    delete mVertexRing;
+    delete mTransientPool;
+    delete mBackBufferTarget;
+    delete mShaderLayouts;
+
     SafeRelease( mRenderTargetView );
     SafeRelease(mConstantBuffer);
     SafeRelease( mBackBuffer );
@@ -98,9 +117,124 @@ bool RenderDevice::Init( HWND _hwnd, UINT _width, UINT _height, BOOL _windowed )
     mHeight = _height;
 
     UpdateViewport();
+    CreateFrameRings();
+    CreateTransientPool();
+    CreateShaderLayouts();
+    return true;
+}
+
+bool RenderDevice::InitHeadless( UINT _width, UINT _height )
+{
+    D3D_FEATURE_LEVEL featureLevels[] =
+    {
+        D3D_FEATURE_LEVEL_11_1,
+        D3D_FEATURE_LEVEL_11_0
+    };
+    UINT numFeatureLevels = ARRAYSIZE(featureLevels);
+
+    UINT creationFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+#if defined(_DEBUG)
+    creationFlags |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+    if(FAILED(D3D11CreateDevice(
+                    nullptr,
+                    D3D_DRIVER_TYPE_WARP,
+                    nullptr,
+                    creationFlags,
+                    featureLevels,
+                    numFeatureLevels,
+                    D3D11_SDK_VERSION,
+                    &mDevice,
+                    NULL,
+                    &mImmediateContext)))
+    {
+        return FALSE;
+    }
+
+    // Stand in for the swap chain's back buffer
+    D3D11_TEXTURE2D_DESC targetDesc;
+    ZeroMemory(&targetDesc, sizeof(targetDesc));
+    targetDesc.Width = _width;
+    targetDesc.Height = _height;
+    targetDesc.MipLevels = 1;
+    targetDesc.ArraySize = 1;
+    targetDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    targetDesc.SampleDesc.Count = 1;
+    targetDesc.Usage = D3D11_USAGE_DEFAULT;
+    targetDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+
+    if (FAILED(mDevice->CreateTexture2D(&targetDesc, NULL, &mBackBuffer)))
+        return FALSE;
+
+    HRESULT hr = mDevice->CreateRenderTargetView(mBackBuffer, NULL, &mRenderTargetView);
+
+    if (FAILED(hr))
+        return FALSE;
+
+    mImmediateContext->OMSetRenderTargets(1, &mRenderTargetView, NULL);
+
+    mWidth = _width;
+    mHeight = _height;
+
+    UpdateViewport();
+    CreateFrameRings();
+    CreateTransientPool();
+    CreateShaderLayouts();
     return true;
 }
 
+void RenderDevice::CreateFrameRings()
+{
+    // Constant data is bound by offset, so every allocation has to start on a 256 byte boundary.
+    mConstantRing = new FrameRingBuffer();
+    if (!mConstantRing->Initialize(mDevice, mImmediateContext, D3D11_BIND_CONSTANT_BUFFER,
+                                   kConstantRingBytesPerFrame, FrameRingBuffer::kConstantBufferAlignment))
+    {
+        // Pre 11.1 runtimes - callers fall back to their own constant buffers
+        delete mConstantRing;
+        mConstantRing = nullptr;
+    }
+
+    // Vertex data is aligned to a 64 byte cache line, which is also the per-instance stride
+    mVertexRing = new FrameRingBuffer();
+    if (!mVertexRing->Initialize(mDevice, mImmediateContext, D3D11_BIND_VERTEX_BUFFER, kVertexRingBytesPerFrame, 64))
+    {
+        delete mVertexRing;
+        mVertexRing = nullptr;
+    }
+}
+
+void RenderDevice::CreateTransientPool()
+{
+    mTransientPool = new TransientTexturePool();
+    mTransientPool->Initialize(mDevice);
+
+    mBackBufferTarget = new FrameGraphTexture();
+    ZeroMemory(mBackBufferTarget, sizeof(FrameGraphTexture));
+}
+
+void RenderDevice::CreateShaderLayouts()
+{
+    mShaderLayouts = new ShaderLayoutCache();
+    mShaderLayouts->Initialize(mDevice);
+}
+
+FrameGraphTexture* RenderDevice::GetBackBufferTarget()
+{
+    // The view is recreated whenever the swap chain resizes
+    mBackBufferTarget->RenderTargetView = mRenderTargetView;
+    return mBackBufferTarget;
+}
+
+void RenderDevice::GetBackBufferDesc(FrameGraphTextureDesc& _desc) const
+{
+    _desc.Width = mWidth;
+    _desc.Height = mHeight;
+    _desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    _desc.BytesPerPixel = 4;
+    _desc.BindFlags = D3D11_BIND_RENDER_TARGET;
+}
+
 void RenderDevice::UpdateViewport()
 {
     D3D11_VIEWPORT viewport;
@@ -134,7 +268,7 @@ void RenderDevice::UpdateViewport()
 
 bool RenderDevice::ResizeSwapchain( HWND _hwnd )
 {
-    if (mImmediateContext == nullptr)
+    if ((mImmediateContext == nullptr) || IsHeadless())
         return false;
 
     RECT rc;
@@ -165,6 +299,10 @@ bool RenderDevice::ResizeSwapchain( HWND _hwnd )
 
     mImmediateContext->OMSetRenderTargets( 1, &mRenderTargetView, NULL );
 
+    // Transients sized for the old back buffer will never match again
+    if (mTransientPool != nullptr)
+        mTransientPool->Purge();
+
     D3D11_VIEWPORT viewport;
     viewport.Width = (FLOAT)mWidth;
     viewport.Height = (FLOAT)mHeight;
@@ -178,10 +316,29 @@ bool RenderDevice::ResizeSwapchain( HWND _hwnd )
 
 void RenderDevice::Present()
 {
+    PROFILE_FUNCTION();
+
     float ClearColor[4] = { 0.0f, 0.125f, 0.1f, 1.0f }; // RGBA
     mImmediateContext->ClearRenderTargetView(mRenderTargetView, ClearColor);
 
-    mSwapChain->Present(0, 0);
+    // Fence off this frame's transient data before handing it to the GPU
+    if (mConstantRing != nullptr)
+        mConstantRing->EndFrame();
+    if (mVertexRing != nullptr)
+        mVertexRing->EndFrame();
+
+    {
+        PROFILE_SCOPE("IDXGISwapChain::Present");
+        if (mSwapChain != NULL)
+            mSwapChain->Present(0, 0);
+        else
+            mImmediateContext->Flush();
+    }
+
+    if (mConstantRing != nullptr)
+        mConstantRing->BeginFrame();
+    if (mVertexRing != nullptr)
+        mVertexRing->BeginFrame();
 }
 
 struct SimpleVertexCombined
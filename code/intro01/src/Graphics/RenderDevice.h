@@ -11,6 +11,11 @@ struct ID3D11Texture2D;
 struct ID3D11RenderTargetView;
 
 class VisualGrid;
+class FrameRingBuffer;
+class TransientTexturePool;
+class ShaderLayoutCache;
+struct FrameGraphTexture;
+struct FrameGraphTextureDesc;
 
 // ======================================================================================
 // Class Definition
@@ -22,6 +27,10 @@ public:
     ~RenderDevice();
 
     bool Init( HWND _hwnd, UINT _width, UINT _height, BOOL _windowed );
+
+    // No window or swap chain - renders into an offscreen target on the WARP software rasterizer
+    bool InitHeadless( UINT _width, UINT _height );
+    bool IsHeadless() const { return mSwapChain == NULL; }
     bool ResizeSwapchain(  HWND _hwnd );
 
     void Present();
@@ -30,8 +39,23 @@ public:
 
     VisualGrid* CreateVisualGrid();
 
+    // Per-frame transient data. Either may be null if the device can't support it.
+    FrameRingBuffer* GetConstantRing() const { return mConstantRing; }
+    FrameRingBuffer* GetVertexRing() const { return mVertexRing; }
+
+    // For the FrameGraph - the back buffer to import, and where transient textures come from
+    FrameGraphTexture* GetBackBufferTarget();
+    void GetBackBufferDesc(FrameGraphTextureDesc& _desc) const;
+    TransientTexturePool* GetTransientPool() const { return mTransientPool; }
+
+    // Input layouts and constant blocks built from shader reflection, shared between shaders
+    ShaderLayoutCache* GetShaderLayouts() const { return mShaderLayouts; }
+
 private:
     void UpdateViewport();
+    void CreateFrameRings();
+    void CreateTransientPool();
+    void CreateShaderLayouts();
 private:
     ID3D11Device*           mDevice;
     ID3D11DeviceContext*    mImmediateContext;
@@ -41,6 +65,14 @@ private:
 
     ID3D11Buffer*           mConstantBuffer;
 
+    FrameRingBuffer*        mConstantRing;
+    FrameRingBuffer*        mVertexRing;
+
+    TransientTexturePool*   mTransientPool;
+    FrameGraphTexture*      mBackBufferTarget;
+
+    ShaderLayoutCache*      mShaderLayouts;
+
     UINT                    mWidth;
     UINT                    mHeight;
 };
@@ -0,0 +1,378 @@
+#include "ShaderCache.h"
+
+#include "utils\assert.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    const unsigned int kBlobMagic   = 0x43444853;   // 'SHDC'
+    const unsigned int kBlobVersion = 2;
+
+    // Sits in front of the bytecode and reflection in every cache file
+    struct BlobHeader
+    {
+        unsigned int        Magic;
+        unsigned int        Version;
+        unsigned long long  Key;
+        unsigned long long  Size;
+        unsigned long long  ReflectionSize;
+        unsigned long long  Checksum;       // of everything after the header, to catch a truncated write
+    };
+
+    const unsigned long long kFnvOffset = 14695981039346656037ULL;
+    const unsigned long long kFnvPrime  = 1099511628211ULL;
+
+    void HashBytes(unsigned long long& hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= kFnvPrime;
+        }
+    }
+
+    // With the terminator, so "ab" + "c" and "a" + "bc" don't hash the same
+    void HashString(unsigned long long& hash, const char* text)
+    {
+        if (text == nullptr)
+            text = "";
+        HashBytes(hash, text, strlen(text) + 1);
+    }
+
+    std::string GetDirectory(const std::string& filename)
+    {
+        size_t slash = filename.find_last_of("\\/");
+        return (slash != std::string::npos) ? filename.substr(0, slash + 1) : std::string();
+    }
+
+    void MakeDirectory(const char* path)
+    {
+#if defined(_WIN32)
+        _mkdir(path);
+#else
+        mkdir(path, 0755);
+#endif
+    }
+
+    // Finds the name in an #include line. Anything else (and comments) is left alone - an
+    // include that's commented out only costs a spurious dependency.
+    bool ParseInclude(const char* line, const char* end, std::string& name)
+    {
+        while ((line < end) && ((*line == ' ') || (*line == '\t')))
+            line++;
+        if ((line == end) || (*line != '#'))
+            return false;
+        line++;
+        while ((line < end) && ((*line == ' ') || (*line == '\t')))
+            line++;
+        if (((size_t)(end - line) < 7) || (strncmp(line, "include", 7) != 0))
+            return false;
+        line += 7;
+        while ((line < end) && ((*line == ' ') || (*line == '\t')))
+            line++;
+        if ((line == end) || ((*line != '"') && (*line != '<')))
+            return false;
+
+        char close = (*line == '"') ? '"' : '>';
+        const char* start = ++line;
+        while ((line < end) && (*line != close))
+            line++;
+        if (line == end)
+            return false;
+
+        name.assign(start, line);
+        return !name.empty();
+    }
+}
+
+ShaderCache::ShaderCache(IShaderCompiler* compiler, const char* directory)
+    : mCompiler(compiler)
+    , mDirectory(directory != nullptr ? directory : "")
+{
+    ASSERT(compiler != nullptr);
+
+    memset(&mStats, 0, sizeof(mStats));
+    if (!mDirectory.empty())
+        MakeDirectory(mDirectory.c_str());
+}
+
+void ShaderCache::AddIncludePath(const char* path)
+{
+    ASSERT(path != nullptr);
+
+    std::string includePath(path);
+    if (!includePath.empty() && (includePath.back() != '\\') && (includePath.back() != '/'))
+        includePath += '/';
+    mIncludePaths.push_back(includePath);
+}
+
+bool ShaderCache::Load(const ShaderCompileRequest& request, std::vector<unsigned char>& bytecode, std::string& errors)
+{
+    ShaderReflection reflection;
+    return Load(request, bytecode, reflection, errors);
+}
+
+bool ShaderCache::Load(const ShaderCompileRequest& request, std::vector<unsigned char>& bytecode, ShaderReflection& reflection, std::string& errors)
+{
+    ASSERT(request.Filename != nullptr);
+    ASSERT(request.EntryPoint != nullptr);
+    ASSERT(request.Profile != nullptr);
+
+    bytecode.clear();
+    reflection.Clear();
+    errors.clear();
+
+    std::string source;
+    unsigned long long key = 0;
+    if (!ComputeKey(request, source, key))
+    {
+        errors = std::string("Unable to read shader ") + request.Filename;
+        return false;
+    }
+
+    if (ReadBlob(key, bytecode, reflection))
+    {
+        mStats.Hits++;
+        return true;
+    }
+
+    mStats.Misses++;
+    if (!mCompiler->Compile(request, source, bytecode, errors) || bytecode.empty())
+    {
+        bytecode.clear();
+        return false;
+    }
+
+    if (!mCompiler->Reflect(bytecode, reflection))
+    {
+        errors += std::string("Unable to reflect ") + request.Filename + "\n";
+        bytecode.clear();
+        return false;
+    }
+
+    mStats.Compiles++;
+    if (!WriteBlob(key, bytecode, reflection))
+        mStats.WriteFailures++;
+
+    return true;
+}
+
+bool ShaderCache::ReadSource(const char* filename, std::string& source)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bool result = (size >= 0);
+    if (result)
+    {
+        source.resize((size_t)size);
+        result = (size == 0) || (fread(&source[0], 1, (size_t)size, file) == (size_t)size);
+    }
+    fclose(file);
+    return result;
+}
+
+unsigned long long ShaderCache::ComputeKey(const ShaderCompileRequest& request)
+{
+    std::string source;
+    unsigned long long key = 0;
+    return ComputeKey(request, source, key) ? key : 0;
+}
+
+bool ShaderCache::ComputeKey(const ShaderCompileRequest& request, std::string& source, unsigned long long& key)
+{
+    if (!ReadSource(request.Filename, source))
+        return false;
+
+    unsigned long long hash = kFnvOffset;
+    HashBytes(hash, &kBlobVersion, sizeof(kBlobVersion));
+    HashString(hash, mCompiler->GetName());
+    HashString(hash, request.EntryPoint);
+    HashString(hash, request.Profile);
+    HashBytes(hash, &request.Flags, sizeof(request.Flags));
+    for (unsigned int i = 0; i < request.DefineCount; i++)
+    {
+        HashString(hash, request.Defines[i].Name);
+        HashString(hash, request.Defines[i].Value);
+    }
+
+    HashBytes(hash, source.data(), source.size());
+
+    std::vector<std::string> visited;
+    visited.push_back(request.Filename);
+    HashIncludes(source, request.Filename, visited, hash);
+
+    // Zero means "couldn't read the file" to callers
+    key = (hash != 0) ? hash : 1;
+    return true;
+}
+
+void ShaderCache::HashIncludes(const std::string& source, const std::string& filename, std::vector<std::string>& visited, unsigned long long& hash)
+{
+    const char* text = source.c_str();
+    const char* end = text + source.size();
+    while (text < end)
+    {
+        const char* lineEnd = (const char*)memchr(text, '\n', (size_t)(end - text));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+
+        std::string name;
+        if (ParseInclude(text, lineEnd, name))
+        {
+            // The name goes in either way, so an include that can't be found still has a
+            // stable key - the compiler will have something to say about it
+            HashString(hash, name.c_str());
+
+            std::string path, contents;
+            if (ResolveInclude(name, filename, path, contents))
+            {
+                bool seen = false;
+                for (auto& previous : visited)
+                    seen = seen || (previous == path);
+
+                if (!seen)
+                {
+                    visited.push_back(path);
+                    HashBytes(hash, contents.data(), contents.size());
+                    HashIncludes(contents, path, visited, hash);
+                }
+            }
+        }
+
+        text = lineEnd + 1;
+    }
+}
+
+bool ShaderCache::ResolveInclude(const std::string& name, const std::string& from, std::string& path, std::string& contents)
+{
+    // Next to the file doing the including first, like the compiler's own include handler
+    path = GetDirectory(from) + name;
+    if (ReadSource(path.c_str(), contents))
+        return true;
+
+    for (auto& includePath : mIncludePaths)
+    {
+        path = includePath + name;
+        if (ReadSource(path.c_str(), contents))
+            return true;
+    }
+    return false;
+}
+
+std::string ShaderCache::GetCachePath(unsigned long long key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.cso", key);
+    // Forward slashes work for the Windows file functions too
+    return mDirectory + "/" + name;
+}
+
+bool ShaderCache::ReadBlob(unsigned long long key, std::vector<unsigned char>& bytecode, ShaderReflection& reflection)
+{
+    if (mDirectory.empty())
+        return false;
+
+    FILE* file = fopen(GetCachePath(key).c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // Header, bytecode and reflection in the one read
+    bool result = (size > (long)sizeof(BlobHeader));
+    if (result)
+    {
+        bytecode.resize((size_t)size);
+        result = (fread(bytecode.data(), 1, (size_t)size, file) == (size_t)size);
+    }
+    fclose(file);
+
+    if (result)
+    {
+        BlobHeader header;
+        memcpy(&header, bytecode.data(), sizeof(header));
+
+        unsigned long long checksum = kFnvOffset;
+        HashBytes(checksum, bytecode.data() + sizeof(header), bytecode.size() - sizeof(header));
+
+        result = (header.Magic == kBlobMagic)
+            && (header.Version == kBlobVersion)
+            && (header.Key == key)
+            && (header.Size <= bytecode.size() - sizeof(header))
+            && (header.ReflectionSize == bytecode.size() - sizeof(header) - header.Size)
+            && (header.Checksum == checksum);
+
+        result = result && reflection.Read(bytecode.data() + sizeof(header) + header.Size, (size_t)header.ReflectionSize);
+        if (result)
+            bytecode.resize(sizeof(header) + (size_t)header.Size);
+    }
+
+    if (result)
+        bytecode.erase(bytecode.begin(), bytecode.begin() + sizeof(BlobHeader));
+    else
+        bytecode.clear();
+
+    return result;
+}
+
+bool ShaderCache::WriteBlob(unsigned long long key, const std::vector<unsigned char>& bytecode, const ShaderReflection& reflection)
+{
+    if (mDirectory.empty())
+        return false;
+
+    std::vector<unsigned char> reflectionData;
+    reflection.Write(reflectionData);
+
+    BlobHeader header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = kBlobMagic;
+    header.Version = kBlobVersion;
+    header.Key = key;
+    header.Size = bytecode.size();
+    header.ReflectionSize = reflectionData.size();
+    header.Checksum = kFnvOffset;
+    HashBytes(header.Checksum, bytecode.data(), bytecode.size());
+    HashBytes(header.Checksum, reflectionData.data(), reflectionData.size());
+
+    // Written to the side and renamed into place, so a reader never sees half a file
+    std::string path = GetCachePath(key);
+    std::string temporary = path + ".tmp";
+
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    bool result = (fwrite(&header, sizeof(header), 1, file) == 1)
+        && (fwrite(bytecode.data(), 1, bytecode.size(), file) == bytecode.size())
+        && (fwrite(reflectionData.data(), 1, reflectionData.size(), file) == reflectionData.size());
+    result = (fclose(file) == 0) && result;
+
+    if (result)
+    {
+        // rename won't replace an existing file on Windows
+        remove(path.c_str());
+        result = (rename(temporary.c_str(), path.c_str()) == 0);
+    }
+
+    if (!result)
+        remove(temporary.c_str());
+
+    return result;
+}
@@ -0,0 +1,112 @@
+///
+/// ShaderCache.h - On disk cache of compiled shader bytecode.
+/// A shader is looked up by a 64 bit key hashed from everything that can change its
+/// bytecode: the source, the source of every file it #includes (recursively), the entry
+/// point, the profile, the compile flags, the defines and the compiler itself. Editing any
+/// of those gives a new key, so a stale blob is never handed back - it just stops being
+/// looked up. On a hit the file is read with a single fread; on a miss the shader goes to
+/// the IShaderCompiler and the result is written out for next time.
+///
+///     D3DShaderCompiler compiler;
+///     ShaderCache cache(&compiler, "shadercache");
+///
+///     ShaderCompileRequest request("assets\\raw\\basicPS.hlsl", "PSMain", "ps_5_0");
+///     std::vector<unsigned char> bytecode;
+///     std::string errors;
+///     if (cache.Load(request, bytecode, errors)) ...
+///
+/// The shader's reflection (see ShaderReflection.h) is stored with its bytecode, so a hit
+/// doesn't have to reflect it again.
+///
+/// Nothing in here touches D3D - the compiler is the only platform specific part, so the
+/// cache runs anywhere with a stand-in compiler.
+///
+#pragma once
+
+#include "ShaderReflection.h"
+
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+    const char* Name;
+    const char* Value;
+};
+
+struct ShaderCompileRequest
+{
+    ShaderCompileRequest(const char* filename = nullptr, const char* entryPoint = nullptr, const char* profile = nullptr)
+        : Filename(filename), EntryPoint(entryPoint), Profile(profile), Flags(0), Defines(nullptr), DefineCount(0) {}
+
+    const char*         Filename;
+    const char*         EntryPoint;
+    const char*         Profile;
+    unsigned int        Flags;          // handed to the compiler as is - D3DCOMPILE_* for D3D
+    const ShaderDefine* Defines;
+    unsigned int        DefineCount;
+};
+
+class IShaderCompiler
+{
+public:
+    virtual ~IShaderCompiler() {}
+
+    // Goes into every key, so bump it (or change the name) when the compiler's output changes
+    virtual const char* GetName() const = 0;
+
+    // source is the file's contents, already read by the cache. Includes are the compiler's
+    // business, resolved relative to request.Filename. Fills in errors on failure, and may
+    // fill them with warnings on success.
+    virtual bool Compile(const ShaderCompileRequest& request, const std::string& source,
+                         std::vector<unsigned char>& bytecode, std::string& errors) = 0;
+
+    // Only called on bytecode this compiler produced
+    virtual bool Reflect(const std::vector<unsigned char>& bytecode, ShaderReflection& reflection) = 0;
+};
+
+class ShaderCache
+{
+public:
+    struct Stats
+    {
+        unsigned int    Hits;
+        unsigned int    Misses;
+        unsigned int    Compiles;       // misses that compiled - failures aren't cached
+        unsigned int    WriteFailures;
+    };
+
+public:
+    // The directory is created if it isn't there. An empty directory turns the disk side off
+    // and everything is compiled.
+    ShaderCache(IShaderCompiler* compiler, const char* directory);
+
+    // Also searched for #include files that aren't next to the file including them
+    void AddIncludePath(const char* path);
+
+    bool Load(const ShaderCompileRequest& request, std::vector<unsigned char>& bytecode, std::string& errors);
+    bool Load(const ShaderCompileRequest& request, std::vector<unsigned char>& bytecode, ShaderReflection& reflection, std::string& errors);
+
+    // 0 if the file can't be read
+    unsigned long long ComputeKey(const ShaderCompileRequest& request);
+
+    const Stats& GetStats() const { return mStats; }
+
+    // Reads a whole file, binary safe
+    static bool ReadSource(const char* filename, std::string& source);
+
+private:
+    bool ComputeKey(const ShaderCompileRequest& request, std::string& source, unsigned long long& key);
+    void HashIncludes(const std::string& source, const std::string& filename, std::vector<std::string>& visited, unsigned long long& hash);
+    bool ResolveInclude(const std::string& name, const std::string& from, std::string& path, std::string& contents);
+
+    std::string GetCachePath(unsigned long long key) const;
+    bool ReadBlob(unsigned long long key, std::vector<unsigned char>& bytecode, ShaderReflection& reflection);
+    bool WriteBlob(unsigned long long key, const std::vector<unsigned char>& bytecode, const ShaderReflection& reflection);
+
+private:
+    IShaderCompiler*            mCompiler;
+    std::string                 mDirectory;
+    std::vector<std::string>    mIncludePaths;
+    Stats                       mStats;
+};
@@ -0,0 +1,185 @@
+///
+/// ShaderLayoutCache.cpp - Building and sharing the objects a shader's reflection asks for.
+///
+
+#include "stdafx.h"
+#include "d3d11.h"
+
+#include "ShaderLayoutCache.h"
+#include "ShaderReflection.h"
+#include "ShaderResource.h"
+#include "ConstantBlock.h"
+#include "VertexFormat.h"
+
+#include "utils\assert.h"
+#include "utils\utils.h"
+#include "utils\memory.h"
+
+#include <string.h>
+#include <vector>
+
+static DXGI_FORMAT GetElementFormat(VertexElementFormat format)
+{
+    switch (format)
+    {
+    case VEF_Float:         return DXGI_FORMAT_R32_FLOAT;
+    case VEF_Float2:        return DXGI_FORMAT_R32G32_FLOAT;
+    case VEF_Float3:        return DXGI_FORMAT_R32G32B32_FLOAT;
+    case VEF_Float4:        return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case VEF_UByte4Norm:    return DXGI_FORMAT_R8G8B8A8_UNORM;
+    default:
+        break;
+    }
+
+    ASSERTD(false, "ShaderLayoutCache: unknown vertex element format");
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+ShaderLayoutCache::ShaderLayoutCache()
+    : mDevice(nullptr)
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+ShaderLayoutCache::~ShaderLayoutCache()
+{
+    Shutdown();
+}
+
+void ShaderLayoutCache::Initialize(ID3D11Device* device)
+{
+    ASSERT(device != nullptr);
+    mDevice = device;
+}
+
+void ShaderLayoutCache::Shutdown()
+{
+    for (auto& entry : mInputLayouts)
+        SafeRelease(entry.second);
+    mInputLayouts.clear();
+
+    for (auto& entry : mConstantBlocks)
+        delete entry.second;
+    mConstantBlocks.clear();
+
+    for (auto& entry : mBindingTables)
+        delete entry.second;
+    mBindingTables.clear();
+
+    mDevice = nullptr;
+}
+
+ID3D11InputLayout* ShaderLayoutCache::GetInputLayout(const ShaderResource* vertexShader, const VertexFormat& format)
+{
+    ASSERT(mDevice != nullptr);
+    ASSERT(vertexShader != nullptr);
+    ASSERT(vertexShader->GetShader() != nullptr);
+
+    const ShaderReflection& reflection = vertexShader->GetReflection();
+
+    // Only the elements the shader reads, in the order it declares them
+    std::vector<D3D11_INPUT_ELEMENT_DESC> elements;
+    for (auto& input : reflection.Inputs)
+    {
+        if (input.SystemValue)
+            continue;
+
+        const VertexElement* match = nullptr;
+        for (unsigned int index = 0; (match == nullptr) && (index < format.ElementCount); index++)
+        {
+            const VertexElement& element = format.Elements[index];
+            if ((element.SemanticIndex == input.SemanticIndex) && (_stricmp(element.Semantic, input.SemanticName.c_str()) == 0))
+                match = &element;
+        }
+
+        if ((match == nullptr) || (input.ComponentType != SCT_Float))
+        {
+            char message[128];
+            sprintf_s(message, "ShaderLayoutCache: the vertex format has no float element for %s%u\n", input.SemanticName.c_str(), input.SemanticIndex);
+            OutputDebugStringA(message);
+            return nullptr;
+        }
+
+        D3D11_INPUT_ELEMENT_DESC desc;
+        desc.SemanticName = match->Semantic;
+        desc.SemanticIndex = match->SemanticIndex;
+        desc.Format = GetElementFormat(match->Format);
+        desc.InputSlot = match->Stream;
+        desc.AlignedByteOffset = match->Offset;
+        desc.InputSlotClass = (match->InstanceStepRate != 0) ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+        desc.InstanceDataStepRate = match->InstanceStepRate;
+        elements.push_back(desc);
+    }
+
+    // The elements and the signature they were validated against
+    unsigned long long key = reflection.GetInputHash();
+    for (auto& element : elements)
+    {
+        unsigned int values[6] = { element.SemanticIndex, (unsigned int)element.Format, element.InputSlot,
+                                   element.AlignedByteOffset, (unsigned int)element.InputSlotClass, element.InstanceDataStepRate };
+        key = HashLayoutString(key, element.SemanticName);
+        key = HashLayoutBytes(key, values, sizeof(values));
+    }
+
+    auto found = mInputLayouts.find(key);
+    if (found != mInputLayouts.end())
+    {
+        mStats.InputLayoutHits++;
+        return found->second;
+    }
+
+    ID3D11InputLayout* layout = nullptr;
+    ID3DBlob* bytecode = vertexShader->GetShader();
+    if (FAILED(mDevice->CreateInputLayout(elements.data(), (UINT)elements.size(), bytecode->GetBufferPointer(), bytecode->GetBufferSize(), &layout)))
+        return nullptr;
+
+    mInputLayouts[key] = layout;
+    mStats.InputLayouts++;
+    return layout;
+}
+
+ConstantBlockSet* ShaderLayoutCache::GetConstantBlocks(const ShaderReflection& reflection)
+{
+    ASSERT(mDevice != nullptr);
+
+    if (reflection.ConstantBuffers.empty())
+        return nullptr;
+
+    unsigned long long key = reflection.GetConstantBufferHash();
+    auto found = mConstantBlocks.find(key);
+    if (found != mConstantBlocks.end())
+    {
+        mStats.ConstantBlockSetHits++;
+        return found->second;
+    }
+
+    ConstantBlockSet* blocks = new ConstantBlockSet();
+    for (auto& buffer : reflection.ConstantBuffers)
+        blocks->AddBlock(buffer);
+
+    if (!blocks->Initialize(mDevice))
+    {
+        delete blocks;
+        return nullptr;
+    }
+
+    mConstantBlocks[key] = blocks;
+    mStats.ConstantBlockSets++;
+    return blocks;
+}
+
+const ShaderBindingTable* ShaderLayoutCache::GetBindingTable(const ShaderReflection& reflection)
+{
+    unsigned long long key = reflection.Resources.GetHash();
+    auto found = mBindingTables.find(key);
+    if (found != mBindingTables.end())
+    {
+        mStats.BindingTableHits++;
+        return found->second;
+    }
+
+    ShaderBindingTable* table = new ShaderBindingTable(reflection.Resources);
+    mBindingTables[key] = table;
+    mStats.BindingTables++;
+    return table;
+}
@@ -0,0 +1,62 @@
+///
+/// ShaderLayoutCache.h - Input layouts, constant blocks and binding tables built from
+/// shader reflection.
+/// Each one is keyed by a hash of the layout it was built from, so shaders that agree on a
+/// layout get the same object back rather than a copy each. The cache owns everything it
+/// hands out - callers never release or delete them.
+///
+#pragma once
+
+#include <unordered_map>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct ID3D11Device;
+struct ID3D11InputLayout;
+struct VertexFormat;
+class ShaderResource;
+class ShaderReflection;
+class ShaderBindingTable;
+class ConstantBlockSet;
+
+class ShaderLayoutCache
+{
+public:
+    struct Stats
+    {
+        unsigned int    InputLayouts;           // created
+        unsigned int    InputLayoutHits;        // handed back from the cache
+        unsigned int    ConstantBlockSets;
+        unsigned int    ConstantBlockSetHits;
+        unsigned int    BindingTables;
+        unsigned int    BindingTableHits;
+    };
+
+public:
+    ShaderLayoutCache();
+    ~ShaderLayoutCache();
+
+    void Initialize(ID3D11Device* device);
+    void Shutdown();
+
+    // The elements of format the vertex shader reads, matched by semantic. Null if the shader
+    // wants something format doesn't have.
+    ID3D11InputLayout* GetInputLayout(const ShaderResource* vertexShader, const VertexFormat& format);
+
+    // Every constant buffer the shader declares, initialized and ready to fill. Shaders with
+    // identical buffers share the set, and so the values in it.
+    ConstantBlockSet* GetConstantBlocks(const ShaderReflection& reflection);
+
+    // Texture, sampler and buffer slots by name
+    const ShaderBindingTable* GetBindingTable(const ShaderReflection& reflection);
+
+    const Stats& GetStats() const { return mStats; }
+
+private:
+    ID3D11Device*                                                   mDevice;
+    std::unordered_map<unsigned long long, ID3D11InputLayout*>     mInputLayouts;
+    std::unordered_map<unsigned long long, ConstantBlockSet*>      mConstantBlocks;
+    std::unordered_map<unsigned long long, ShaderBindingTable*>    mBindingTables;
+    Stats                                                           mStats;
+};
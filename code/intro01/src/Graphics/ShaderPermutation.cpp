@@ -0,0 +1,661 @@
+#include "ShaderPermutation.h"
+
+#include "utils\assert.h"
+#include "utils\JobSystem.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    const unsigned int kPackMagic       = 0x4b415053;   // 'SPAK'
+    const unsigned int kPackVersion     = 2;
+    const unsigned int kEmptySlot       = 0xffffffff;
+    const unsigned int kBytecodeAlign   = 16;
+
+    unsigned int AlignUp(unsigned int value, unsigned int alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    bool IsSpace(char c)
+    {
+        return (c == ' ') || (c == '\t') || (c == '\r');
+    }
+
+    // Splits on spaces and tabs
+    void SplitWords(const char* text, const char* end, std::vector<std::string>& words)
+    {
+        while (text < end)
+        {
+            while ((text < end) && IsSpace(*text))
+                text++;
+            const char* start = text;
+            while ((text < end) && !IsSpace(*text))
+                text++;
+            if (text > start)
+                words.push_back(std::string(start, text));
+        }
+    }
+}
+
+bool ParseShaderKeywords(const std::string& source, std::vector<std::string>& keywords)
+{
+    static const char kTag[] = "@keywords";
+
+    keywords.clear();
+
+    const char* text = source.c_str();
+    const char* end = text + source.size();
+    while (text < end)
+    {
+        const char* lineEnd = (const char*)memchr(text, '\n', (size_t)(end - text));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+
+        const char* line = text;
+        while ((line < lineEnd) && IsSpace(*line))
+            line++;
+        if (((lineEnd - line) > 2) && (line[0] == '/') && (line[1] == '/'))
+        {
+            line += 2;
+            while ((line < lineEnd) && IsSpace(*line))
+                line++;
+            size_t tagLength = sizeof(kTag) - 1;
+            if (((size_t)(lineEnd - line) >= tagLength) && (strncmp(line, kTag, tagLength) == 0))
+            {
+                SplitWords(line + tagLength, lineEnd, keywords);
+                break;
+            }
+        }
+
+        text = lineEnd + 1;
+    }
+
+    if (keywords.size() > kMaxShaderKeywords)
+        return false;
+
+    for (size_t i = 0; i < keywords.size(); i++)
+    {
+        for (size_t j = 0; j < i; j++)
+        {
+            if (keywords[i] == keywords[j])
+                return false;
+        }
+    }
+    return true;
+}
+
+void GetShaderVariantDefines(const std::vector<std::string>& keywords, unsigned int variant, std::vector<ShaderDefine>& defines)
+{
+    defines.clear();
+    for (size_t i = 0; i < keywords.size(); i++)
+    {
+        ShaderDefine define = { keywords[i].c_str(), (variant & (1u << i)) ? "1" : "0" };
+        defines.push_back(define);
+    }
+}
+
+// ======================================================================================
+// ShaderPack - the file is the header, then each of these sections in turn
+// ======================================================================================
+struct ShaderPack::Header
+{
+    unsigned int    Magic;
+    unsigned int    Version;
+    unsigned int    ShaderCount;
+    unsigned int    KeywordCount;
+    unsigned int    SlotCount;          // a power of two
+    unsigned int    VariantCount;
+    unsigned int    StringBytes;        // padded out so the bytecode starts aligned
+    unsigned int    BytecodeBytes;
+};
+
+struct ShaderPack::ShaderRecord
+{
+    unsigned int    Name;               // string offsets
+    unsigned int    EntryPoint;
+    unsigned int    Profile;
+    unsigned int    FirstKeyword;
+    unsigned int    KeywordCount;
+    unsigned int    Padding[3];         // keeps every section a multiple of 16 bytes
+};
+
+struct ShaderPack::Slot
+{
+    unsigned int    Shader;             // kEmptySlot when unused
+    unsigned int    Variant;
+    unsigned int    Offset;             // into the bytecode section
+    unsigned int    Size;
+    unsigned int    ReflectionOffset;   // also into the bytecode section
+    unsigned int    ReflectionSize;
+    unsigned int    Padding[2];
+};
+
+ShaderPack::ShaderPack()
+    : mHeader(nullptr)
+    , mShaders(nullptr)
+    , mKeywords(nullptr)
+    , mSlots(nullptr)
+    , mStrings(nullptr)
+    , mBytecode(nullptr)
+{
+}
+
+bool ShaderPack::Load(const char* filename)
+{
+    ASSERT(filename != nullptr);
+
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    std::vector<unsigned char> data;
+    bool result = (size > 0);
+    if (result)
+    {
+        data.resize((size_t)size);
+        result = (fread(data.data(), 1, (size_t)size, file) == (size_t)size);
+    }
+    fclose(file);
+
+    return result && Load(data);
+}
+
+bool ShaderPack::Load(std::vector<unsigned char>& data)
+{
+    Unload();
+
+    if (data.size() < sizeof(Header))
+        return false;
+
+    const Header* header = (const Header*)data.data();
+    if ((header->Magic != kPackMagic)
+        || (header->Version != kPackVersion)
+        || (header->SlotCount == 0)
+        || ((header->SlotCount & (header->SlotCount - 1)) != 0)
+        || (header->VariantCount > header->SlotCount))
+        return false;
+
+    // Sizes in 64 bits so a corrupt header can't wrap them
+    unsigned long long shaders = sizeof(Header);
+    unsigned long long keywords = shaders + (unsigned long long)header->ShaderCount * sizeof(ShaderRecord);
+    unsigned long long slots = keywords + (((unsigned long long)header->KeywordCount * sizeof(unsigned int) + kBytecodeAlign - 1) & ~(unsigned long long)(kBytecodeAlign - 1));
+    unsigned long long strings = slots + (unsigned long long)header->SlotCount * sizeof(Slot);
+    unsigned long long bytecode = strings + header->StringBytes;
+    unsigned long long end = bytecode + header->BytecodeBytes;
+    if ((end != data.size()) || (header->StringBytes == 0))
+        return false;
+
+    mData.swap(data);
+    const unsigned char* base = mData.data();
+    mHeader = (const Header*)base;
+    mShaders = (const ShaderRecord*)(base + shaders);
+    mKeywords = (const unsigned int*)(base + keywords);
+    mSlots = (const Slot*)(base + slots);
+    mStrings = (const char*)(base + strings);
+    mBytecode = base + bytecode;
+
+    // Check everything points inside the file once, so the lookups don't have to
+    bool valid = (mStrings[mHeader->StringBytes - 1] == 0);
+    for (unsigned int i = 0; valid && (i < mHeader->ShaderCount); i++)
+    {
+        const ShaderRecord& record = mShaders[i];
+        valid = (record.Name < mHeader->StringBytes)
+            && (record.EntryPoint < mHeader->StringBytes)
+            && (record.Profile < mHeader->StringBytes)
+            && (record.KeywordCount <= kMaxShaderKeywords)
+            && ((unsigned long long)record.FirstKeyword + record.KeywordCount <= mHeader->KeywordCount);
+    }
+    for (unsigned int i = 0; valid && (i < mHeader->KeywordCount); i++)
+        valid = (mKeywords[i] < mHeader->StringBytes);
+    unsigned int emptySlots = 0;
+    for (unsigned int i = 0; valid && (i < mHeader->SlotCount); i++)
+    {
+        const Slot& slot = mSlots[i];
+        if (slot.Shader == kEmptySlot)
+            emptySlots++;
+        else
+            valid = (slot.Shader < mHeader->ShaderCount)
+                && ((unsigned long long)slot.Offset + slot.Size <= mHeader->BytecodeBytes)
+                && ((unsigned long long)slot.ReflectionOffset + slot.ReflectionSize <= mHeader->BytecodeBytes);
+    }
+
+    // A probe only stops at an empty slot
+    valid = valid && (emptySlots > 0);
+
+    if (!valid)
+        Unload();
+
+    return valid;
+}
+
+void ShaderPack::Unload()
+{
+    mData.clear();
+    mHeader = nullptr;
+    mShaders = nullptr;
+    mKeywords = nullptr;
+    mSlots = nullptr;
+    mStrings = nullptr;
+    mBytecode = nullptr;
+}
+
+int ShaderPack::FindShader(const char* name, const char* entryPoint) const
+{
+    ASSERT(name != nullptr);
+    ASSERT(entryPoint != nullptr);
+
+    for (unsigned int i = 0; i < GetShaderCount(); i++)
+    {
+        if ((strcmp(GetString(mShaders[i].Name), name) == 0)
+            && (strcmp(GetString(mShaders[i].EntryPoint), entryPoint) == 0))
+            return (int)i;
+    }
+    return kInvalidShader;
+}
+
+const char* ShaderPack::GetProfile(int shader) const
+{
+    ASSERT((shader >= 0) && ((unsigned int)shader < GetShaderCount()));
+    return GetString(mShaders[shader].Profile);
+}
+
+unsigned int ShaderPack::GetKeywordCount(int shader) const
+{
+    ASSERT((shader >= 0) && ((unsigned int)shader < GetShaderCount()));
+    return mShaders[shader].KeywordCount;
+}
+
+const char* ShaderPack::GetKeyword(int shader, unsigned int keyword) const
+{
+    ASSERT(keyword < GetKeywordCount(shader));
+    return GetString(mKeywords[mShaders[shader].FirstKeyword + keyword]);
+}
+
+unsigned int ShaderPack::GetKeywordMask(int shader, const char* keyword) const
+{
+    ASSERT(keyword != nullptr);
+
+    for (unsigned int i = 0; i < GetKeywordCount(shader); i++)
+    {
+        if (strcmp(GetKeyword(shader, i), keyword) == 0)
+            return 1u << i;
+    }
+    return 0;
+}
+
+bool ShaderPack::FindVariant(int shader, unsigned int variant, const void** bytecode, size_t* size, ShaderReflection* reflection) const
+{
+    ASSERT(bytecode != nullptr);
+    ASSERT(size != nullptr);
+
+    if ((mHeader == nullptr) || (shader < 0))
+        return false;
+
+    // Linear probing in a table that's never more than half full
+    unsigned int mask = mHeader->SlotCount - 1;
+    for (unsigned int index = HashVariant((unsigned int)shader, variant) & mask; ; index = (index + 1) & mask)
+    {
+        const Slot& slot = mSlots[index];
+        if (slot.Shader == kEmptySlot)
+            return false;
+
+        if ((slot.Shader == (unsigned int)shader) && (slot.Variant == variant))
+        {
+            *bytecode = mBytecode + slot.Offset;
+            *size = slot.Size;
+            return (reflection == nullptr) || reflection->Read(mBytecode + slot.ReflectionOffset, slot.ReflectionSize);
+        }
+    }
+}
+
+unsigned int ShaderPack::GetShaderCount() const
+{
+    return (mHeader != nullptr) ? mHeader->ShaderCount : 0;
+}
+
+unsigned int ShaderPack::GetVariantCount() const
+{
+    return (mHeader != nullptr) ? mHeader->VariantCount : 0;
+}
+
+unsigned int ShaderPack::HashVariant(unsigned int shader, unsigned int variant)
+{
+    // murmur3's finalizer over both halves
+    unsigned int hash = (shader * 0x9e3779b1u) ^ variant;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+const char* ShaderPack::GetString(unsigned int offset) const
+{
+    return mStrings + offset;
+}
+
+// ======================================================================================
+// ShaderPackBuilder
+// ======================================================================================
+ShaderPackBuilder::ShaderPackBuilder(IShaderCompiler* compiler, const char* cacheDirectory, unsigned int flags)
+    : mCompiler(compiler)
+    , mCacheDirectory(cacheDirectory != nullptr ? cacheDirectory : "")
+    , mFlags(flags)
+{
+    ASSERT(compiler != nullptr);
+}
+
+bool ShaderPackBuilder::LoadManifest(const char* filename, std::string& errors)
+{
+    ASSERT(filename != nullptr);
+
+    std::string manifest;
+    if (!ShaderCache::ReadSource(filename, manifest))
+    {
+        errors += std::string("Unable to read ") + filename + "\n";
+        return false;
+    }
+
+    std::string directory(filename);
+    size_t slash = directory.find_last_of("\\/");
+    directory = (slash != std::string::npos) ? directory.substr(0, slash + 1) : std::string();
+
+    bool result = true;
+    const char* text = manifest.c_str();
+    const char* end = text + manifest.size();
+    unsigned int lineNumber = 0;
+    while (text < end)
+    {
+        const char* lineEnd = (const char*)memchr(text, '\n', (size_t)(end - text));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+        lineNumber++;
+
+        const char* comment = (const char*)memchr(text, '#', (size_t)(lineEnd - text));
+        std::vector<std::string> words;
+        SplitWords(text, (comment != nullptr) ? comment : lineEnd, words);
+
+        if (!words.empty())
+        {
+            if (words.size() < 3)
+            {
+                char message[64];
+                snprintf(message, sizeof(message), "(%u): expected <file> <entry point> <profile>\n", lineNumber);
+                errors += filename + std::string(message);
+                result = false;
+            }
+            else
+            {
+                std::vector<std::string> variants(words.begin() + 3, words.end());
+                std::string path = directory + words[0];
+                result = AddShader(words[0].c_str(), path.c_str(), words[1].c_str(), words[2].c_str(), variants, errors) && result;
+            }
+        }
+
+        text = lineEnd + 1;
+    }
+    return result;
+}
+
+bool ShaderPackBuilder::AddShader(const char* name, const char* path, const char* entryPoint, const char* profile,
+                                  const std::vector<std::string>& variants, std::string& errors)
+{
+    ASSERT(name != nullptr);
+    ASSERT(path != nullptr);
+    ASSERT(entryPoint != nullptr);
+    ASSERT(profile != nullptr);
+
+    for (auto& existing : mShaders)
+    {
+        if ((existing.Name == name) && (existing.EntryPoint == entryPoint))
+        {
+            errors += std::string(name) + ": " + entryPoint + " is listed twice\n";
+            return false;
+        }
+    }
+
+    Shader shader;
+    shader.Name = name;
+    shader.Path = path;
+    shader.EntryPoint = entryPoint;
+    shader.Profile = profile;
+
+    std::string source;
+    if (!ShaderCache::ReadSource(path, source))
+    {
+        errors += std::string("Unable to read ") + path + "\n";
+        return false;
+    }
+    if (!ParseShaderKeywords(source, shader.Keywords))
+    {
+        errors += std::string(path) + ": bad @keywords line - repeated, or more than 16\n";
+        return false;
+    }
+
+    std::vector<unsigned int> masks;
+    if (variants.empty())
+    {
+        for (unsigned int mask = 0; mask < (1u << shader.Keywords.size()); mask++)
+            masks.push_back(mask);
+    }
+    for (auto& variant : variants)
+    {
+        unsigned int mask = 0;
+        if (variant != "-")
+        {
+            size_t start = 0;
+            while (start <= variant.size())
+            {
+                size_t plus = variant.find('+', start);
+                if (plus == std::string::npos)
+                    plus = variant.size();
+                std::string keyword = variant.substr(start, plus - start);
+
+                unsigned int bit = 0;
+                for (size_t i = 0; i < shader.Keywords.size(); i++)
+                {
+                    if (shader.Keywords[i] == keyword)
+                        bit = 1u << i;
+                }
+                if (bit == 0)
+                {
+                    errors += std::string(path) + ": no keyword called '" + keyword + "'\n";
+                    return false;
+                }
+
+                mask |= bit;
+                start = plus + 1;
+            }
+        }
+
+        bool listed = false;
+        for (auto existing : masks)
+            listed = listed || (existing == mask);
+        if (!listed)
+            masks.push_back(mask);
+    }
+
+    unsigned int shaderIndex = (unsigned int)mShaders.size();
+    mShaders.push_back(shader);
+    for (auto mask : masks)
+    {
+        Variant entry;
+        entry.Shader = shaderIndex;
+        entry.Mask = mask;
+        entry.Compiled = false;
+        entry.CacheHit = false;
+        mVariants.push_back(entry);
+    }
+    return true;
+}
+
+ShaderPackBuilder::Result ShaderPackBuilder::Build(JobSystem* jobs, std::string& errors)
+{
+    unsigned int threadCount = (jobs != nullptr) ? jobs->GetThreadCount() : 0;
+
+    // One cache per thread - the cache isn't shared, the directory is. The last is for the
+    // calling thread when it isn't a worker.
+    std::vector<ShaderCache*> caches;
+    for (unsigned int i = 0; i <= threadCount; i++)
+        caches.push_back(new ShaderCache(mCompiler, mCacheDirectory.c_str()));
+
+    if (jobs != nullptr)
+    {
+        JobCounter counter;
+        auto compile = [this, jobs, &caches, threadCount](unsigned int index)
+        {
+            unsigned int worker = jobs->GetWorkerIndex();
+            CompileVariant(*caches[(worker != JobSystem::kInvalidWorker) ? worker : threadCount], mVariants[index]);
+        };
+
+        // A variant each - compiles are long and uneven, so let them be stolen one at a time
+        jobs->ParallelFor((unsigned int)mVariants.size(), compile, &counter, 1);
+        jobs->Wait(&counter);
+    }
+    else
+    {
+        for (auto& variant : mVariants)
+            CompileVariant(*caches[threadCount], variant);
+    }
+
+    for (auto cache : caches)
+        delete cache;
+
+    Result result;
+    memset(&result, 0, sizeof(result));
+    for (auto& variant : mVariants)
+    {
+        result.Variants++;
+        if (variant.CacheHit)
+            result.CacheHits++;
+
+        if (!variant.Compiled)
+        {
+            const Shader& shader = mShaders[variant.Shader];
+            char mask[16];
+            snprintf(mask, sizeof(mask), "0x%x", variant.Mask);
+            errors += shader.Path + " " + shader.EntryPoint + " variant " + mask + " failed:\n" + variant.Errors + "\n";
+            result.Failures++;
+        }
+    }
+    return result;
+}
+
+void ShaderPackBuilder::CompileVariant(ShaderCache& cache, Variant& variant)
+{
+    const Shader& shader = mShaders[variant.Shader];
+
+    std::vector<ShaderDefine> defines;
+    GetShaderVariantDefines(shader.Keywords, variant.Mask, defines);
+
+    ShaderCompileRequest request(shader.Path.c_str(), shader.EntryPoint.c_str(), shader.Profile.c_str());
+    request.Flags = mFlags;
+    request.Defines = defines.data();
+    request.DefineCount = (unsigned int)defines.size();
+
+    unsigned int hits = cache.GetStats().Hits;
+    variant.Compiled = cache.Load(request, variant.Bytecode, variant.Reflection, variant.Errors);
+    variant.CacheHit = (cache.GetStats().Hits != hits);
+}
+
+bool ShaderPackBuilder::Write(const char* filename) const
+{
+    ASSERT(filename != nullptr);
+
+    std::vector<char> strings;
+    auto addString = [&strings](const std::string& text) -> unsigned int
+    {
+        unsigned int offset = (unsigned int)strings.size();
+        strings.insert(strings.end(), text.c_str(), text.c_str() + text.size() + 1);
+        return offset;
+    };
+
+    std::vector<ShaderPack::ShaderRecord> records;
+    std::vector<unsigned int> keywords;
+    for (auto& shader : mShaders)
+    {
+        ShaderPack::ShaderRecord record;
+        record.Name = addString(shader.Name);
+        record.EntryPoint = addString(shader.EntryPoint);
+        record.Profile = addString(shader.Profile);
+        record.FirstKeyword = (unsigned int)keywords.size();
+        record.KeywordCount = (unsigned int)shader.Keywords.size();
+        memset(record.Padding, 0, sizeof(record.Padding));
+        records.push_back(record);
+
+        for (auto& keyword : shader.Keywords)
+            keywords.push_back(addString(keyword));
+    }
+    if (strings.empty())
+        strings.push_back(0);
+    strings.resize(AlignUp((unsigned int)strings.size(), kBytecodeAlign), 0);
+    keywords.resize(AlignUp((unsigned int)keywords.size() * sizeof(unsigned int), kBytecodeAlign) / sizeof(unsigned int), 0);
+
+    // At most half full, so a miss stops at an empty slot quickly
+    unsigned int variantCount = 0;
+    for (auto& variant : mVariants)
+        variantCount += variant.Compiled ? 1 : 0;
+    unsigned int slotCount = 16;
+    while (slotCount < variantCount * 2)
+        slotCount *= 2;
+
+    ShaderPack::Slot empty = { kEmptySlot, 0, 0, 0, 0, 0, { 0, 0 } };
+    std::vector<ShaderPack::Slot> slots(slotCount, empty);
+    std::vector<unsigned char> bytecode;
+    for (auto& variant : mVariants)
+    {
+        if (!variant.Compiled)
+            continue;
+
+        unsigned int index = ShaderPack::HashVariant(variant.Shader, variant.Mask) & (slotCount - 1);
+        while (slots[index].Shader != kEmptySlot)
+            index = (index + 1) & (slotCount - 1);
+
+        slots[index].Shader = variant.Shader;
+        slots[index].Variant = variant.Mask;
+        slots[index].Offset = (unsigned int)bytecode.size();
+        slots[index].Size = (unsigned int)variant.Bytecode.size();
+
+        bytecode.insert(bytecode.end(), variant.Bytecode.begin(), variant.Bytecode.end());
+        bytecode.resize(AlignUp((unsigned int)bytecode.size(), kBytecodeAlign), 0);
+
+        // The reflection follows its bytecode
+        slots[index].ReflectionOffset = (unsigned int)bytecode.size();
+        variant.Reflection.Write(bytecode);
+        slots[index].ReflectionSize = (unsigned int)bytecode.size() - slots[index].ReflectionOffset;
+        bytecode.resize(AlignUp((unsigned int)bytecode.size(), kBytecodeAlign), 0);
+    }
+
+    ShaderPack::Header header;
+    header.Magic = kPackMagic;
+    header.Version = kPackVersion;
+    header.ShaderCount = (unsigned int)records.size();
+    header.KeywordCount = 0;
+    for (auto& shader : mShaders)
+        header.KeywordCount += (unsigned int)shader.Keywords.size();
+    header.SlotCount = slotCount;
+    header.VariantCount = variantCount;
+    header.StringBytes = (unsigned int)strings.size();
+    header.BytecodeBytes = (unsigned int)bytecode.size();
+
+    FILE* file = fopen(filename, "wb");
+    if (file == nullptr)
+        return false;
+
+    bool result = (fwrite(&header, sizeof(header), 1, file) == 1)
+        && (records.empty() || (fwrite(records.data(), sizeof(ShaderPack::ShaderRecord), records.size(), file) == records.size()))
+        && (keywords.empty() || (fwrite(keywords.data(), sizeof(unsigned int), keywords.size(), file) == keywords.size()))
+        && (fwrite(slots.data(), sizeof(ShaderPack::Slot), slots.size(), file) == slots.size())
+        && (fwrite(strings.data(), 1, strings.size(), file) == strings.size())
+        && (bytecode.empty() || (fwrite(bytecode.data(), 1, bytecode.size(), file) == bytecode.size()));
+    result = (fclose(file) == 0) && result;
+
+    return result;
+}
@@ -0,0 +1,155 @@
+///
+/// ShaderPermutation.h - Keyword driven shader variants and the pack they're shipped in.
+/// A shader lists its feature keywords on a comment line of its own:
+///
+///     // @keywords DIFFUSE_TEXTURE LIGHTING
+///
+/// and a variant is a bitmask over them, in the order they're listed - bit 0 is the first
+/// keyword. Every keyword is defined for every variant, to 1 when its bit is set and 0 when
+/// it isn't, so the shader tests them with #if.
+///
+/// Variants are compiled offline by shadertool into a ShaderPack. At runtime picking one is
+/// a hash and a probe or two into a flat table - nothing is compiled:
+///
+///     int shader = pack.FindShader("basicPS.hlsl", "PSMain");
+///     unsigned int variant = pack.GetKeywordMask(shader, "LIGHTING");
+///     const void* bytecode; size_t size;
+///     if (pack.FindVariant(shader, variant, &bytecode, &size)) ...
+///
+#pragma once
+
+#include "ShaderCache.h"
+
+#include <string>
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class JobSystem;
+
+static const unsigned int kMaxShaderKeywords = 16;
+
+// The keywords from the source's "// @keywords" line, if it has one. False if it lists more
+// than kMaxShaderKeywords or the same one twice.
+bool ParseShaderKeywords(const std::string& source, std::vector<std::string>& keywords);
+
+// One define per keyword for the variant. The defines point into keywords.
+void GetShaderVariantDefines(const std::vector<std::string>& keywords, unsigned int variant, std::vector<ShaderDefine>& defines);
+
+// Read only view of a pack file, loaded with a single read
+class ShaderPack
+{
+public:
+    static const int kInvalidShader = -1;
+
+public:
+    ShaderPack();
+
+    bool Load(const char* filename);
+    bool Load(std::vector<unsigned char>& data);      // takes the contents
+    void Unload();
+
+    bool IsLoaded() const { return mHeader != nullptr; }
+
+    // Shaders are named as they were in the manifest. Not for the hot path - look shaders
+    // up once and keep the index.
+    int FindShader(const char* name, const char* entryPoint) const;
+
+    const char* GetProfile(int shader) const;
+    unsigned int GetKeywordCount(int shader) const;
+    const char* GetKeyword(int shader, unsigned int keyword) const;
+
+    // The bit for the named keyword, or 0 if the shader doesn't have it
+    unsigned int GetKeywordMask(int shader, const char* keyword) const;
+
+    // False if that variant wasn't built. Reading the reflection as well allocates, so leave
+    // it null on the hot path.
+    bool FindVariant(int shader, unsigned int variant, const void** bytecode, size_t* size, ShaderReflection* reflection = nullptr) const;
+
+    unsigned int GetShaderCount() const;
+    unsigned int GetVariantCount() const;
+
+private:
+    struct Header;
+    struct ShaderRecord;
+    struct Slot;
+
+    friend class ShaderPackBuilder;
+
+    static unsigned int HashVariant(unsigned int shader, unsigned int variant);
+    const char* GetString(unsigned int offset) const;
+
+private:
+    std::vector<unsigned char>  mData;
+    const Header*               mHeader;
+    const ShaderRecord*         mShaders;
+    const unsigned int*         mKeywords;      // string offsets
+    const Slot*                 mSlots;
+    const char*                 mStrings;
+    const unsigned char*        mBytecode;
+};
+
+// Compiles every variant a manifest asks for and writes them out as a ShaderPack
+class ShaderPackBuilder
+{
+public:
+    struct Result
+    {
+        unsigned int    Variants;
+        unsigned int    Failures;
+        unsigned int    CacheHits;      // variants the ShaderCache already had
+    };
+
+public:
+    // Misses are compiled with compiler, which has to be safe to call from several threads
+    // at once. Compiled variants also go into the shader cache in cacheDirectory, so a
+    // rebuild only compiles what's changed.
+    ShaderPackBuilder(IShaderCompiler* compiler, const char* cacheDirectory, unsigned int flags);
+
+    // Lines of "<file> <entry point> <profile> [variant ...]", relative to the manifest.
+    // A variant is keywords joined with '+', or '-' for none of them; no variants means
+    // every combination of the shader's keywords. Blank lines and '#' comments are skipped.
+    bool LoadManifest(const char* filename, std::string& errors);
+
+    // variants empty means every combination
+    bool AddShader(const char* name, const char* path, const char* entryPoint, const char* profile,
+                   const std::vector<std::string>& variants, std::string& errors);
+
+    // Spread over the job system's threads when there is one
+    Result Build(JobSystem* jobs, std::string& errors);
+
+    bool Write(const char* filename) const;
+
+    unsigned int GetVariantCount() const { return (unsigned int)mVariants.size(); }
+
+private:
+    struct Shader
+    {
+        std::string                 Name;
+        std::string                 Path;
+        std::string                 EntryPoint;
+        std::string                 Profile;
+        std::vector<std::string>    Keywords;
+    };
+
+    struct Variant
+    {
+        unsigned int                Shader;
+        unsigned int                Mask;
+        std::vector<unsigned char>  Bytecode;
+        ShaderReflection            Reflection;
+        std::string                 Errors;
+        bool                        Compiled;
+        bool                        CacheHit;
+    };
+
+    void CompileVariant(ShaderCache& cache, Variant& variant);
+
+private:
+    IShaderCompiler*        mCompiler;
+    std::string             mCacheDirectory;
+    unsigned int            mFlags;
+    std::vector<Shader>     mShaders;
+    std::vector<Variant>    mVariants;
+};
@@ -0,0 +1,254 @@
+#include "ShaderReflection.h"
+
+#include <string.h>
+
+namespace
+{
+    const unsigned int kReflectionVersion = 1;
+
+    void WriteUInt(std::vector<unsigned char>& data, unsigned int value)
+    {
+        const unsigned char* bytes = (const unsigned char*)&value;
+        data.insert(data.end(), bytes, bytes + sizeof(value));
+    }
+
+    void WriteString(std::vector<unsigned char>& data, const std::string& text)
+    {
+        WriteUInt(data, (unsigned int)text.size());
+        data.insert(data.end(), text.begin(), text.end());
+    }
+
+    // Walks the data, failing (and staying failed) at the first read past the end
+    class Reader
+    {
+    public:
+        Reader(const unsigned char* data, size_t size) : mData(data), mEnd(data + size), mFailed(false) {}
+
+        bool Failed() const { return mFailed; }
+        bool AtEnd() const { return mData == mEnd; }
+
+        unsigned int ReadUInt()
+        {
+            unsigned int value = 0;
+            if (Has(sizeof(value)))
+            {
+                memcpy(&value, mData, sizeof(value));
+                mData += sizeof(value);
+            }
+            return value;
+        }
+
+        std::string ReadString()
+        {
+            unsigned int length = ReadUInt();
+            std::string text;
+            if (Has(length))
+            {
+                text.assign((const char*)mData, length);
+                mData += length;
+            }
+            return text;
+        }
+
+        // Counts are checked against what's left, so a corrupt count can't ask for a huge vector
+        unsigned int ReadCount(size_t minimumSize)
+        {
+            unsigned int count = ReadUInt();
+            if (!Has((size_t)count * minimumSize))
+                count = 0;
+            return count;
+        }
+
+    private:
+        bool Has(size_t size)
+        {
+            mFailed = mFailed || ((size_t)(mEnd - mData) < size);
+            return !mFailed;
+        }
+
+    private:
+        const unsigned char*    mData;
+        const unsigned char*    mEnd;
+        bool                    mFailed;
+    };
+}
+
+unsigned long long HashLayoutBytes(unsigned long long hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+unsigned long long HashLayoutString(unsigned long long hash, const char* text)
+{
+    // The terminator too, so neighbouring strings can't run together
+    return HashLayoutBytes(hash, text, strlen(text) + 1);
+}
+
+unsigned int ShaderBindingTable::FindSlot(const char* name, ShaderBindingType type) const
+{
+    for (auto& binding : Bindings)
+    {
+        if ((binding.Type == type) && (binding.Name == name))
+            return binding.Slot;
+    }
+    return kInvalidSlot;
+}
+
+unsigned long long ShaderBindingTable::GetHash() const
+{
+    unsigned long long hash = kLayoutHashSeed;
+    for (auto& binding : Bindings)
+    {
+        unsigned int values[3] = { (unsigned int)binding.Type, binding.Slot, binding.Count };
+        hash = HashLayoutString(hash, binding.Name.c_str());
+        hash = HashLayoutBytes(hash, values, sizeof(values));
+    }
+    return hash;
+}
+
+void ShaderReflection::Clear()
+{
+    ConstantBuffers.clear();
+    Resources.Bindings.clear();
+    Inputs.clear();
+}
+
+const ShaderConstantBuffer* ShaderReflection::FindConstantBuffer(const char* name) const
+{
+    for (auto& buffer : ConstantBuffers)
+    {
+        if (buffer.Name == name)
+            return &buffer;
+    }
+    return nullptr;
+}
+
+unsigned long long ShaderReflection::GetInputHash() const
+{
+    unsigned long long hash = kLayoutHashSeed;
+    for (auto& input : Inputs)
+    {
+        unsigned int values[5] = { input.SemanticIndex, input.Register, (unsigned int)input.ComponentType, input.ComponentCount, input.SystemValue ? 1u : 0u };
+        hash = HashLayoutString(hash, input.SemanticName.c_str());
+        hash = HashLayoutBytes(hash, values, sizeof(values));
+    }
+    return hash;
+}
+
+unsigned long long ShaderReflection::GetConstantBufferHash() const
+{
+    unsigned long long hash = kLayoutHashSeed;
+    for (auto& buffer : ConstantBuffers)
+    {
+        unsigned int values[3] = { buffer.Slot, buffer.Size, (unsigned int)buffer.Variables.size() };
+        hash = HashLayoutString(hash, buffer.Name.c_str());
+        hash = HashLayoutBytes(hash, values, sizeof(values));
+
+        for (auto& variable : buffer.Variables)
+        {
+            unsigned int placement[2] = { variable.Offset, variable.Size };
+            hash = HashLayoutString(hash, variable.Name.c_str());
+            hash = HashLayoutBytes(hash, placement, sizeof(placement));
+        }
+    }
+    return hash;
+}
+
+void ShaderReflection::Write(std::vector<unsigned char>& data) const
+{
+    WriteUInt(data, kReflectionVersion);
+
+    WriteUInt(data, (unsigned int)ConstantBuffers.size());
+    for (auto& buffer : ConstantBuffers)
+    {
+        WriteString(data, buffer.Name);
+        WriteUInt(data, buffer.Slot);
+        WriteUInt(data, buffer.Size);
+        WriteUInt(data, (unsigned int)buffer.Variables.size());
+        for (auto& variable : buffer.Variables)
+        {
+            WriteString(data, variable.Name);
+            WriteUInt(data, variable.Offset);
+            WriteUInt(data, variable.Size);
+        }
+    }
+
+    WriteUInt(data, (unsigned int)Resources.Bindings.size());
+    for (auto& binding : Resources.Bindings)
+    {
+        WriteString(data, binding.Name);
+        WriteUInt(data, (unsigned int)binding.Type);
+        WriteUInt(data, binding.Slot);
+        WriteUInt(data, binding.Count);
+    }
+
+    WriteUInt(data, (unsigned int)Inputs.size());
+    for (auto& input : Inputs)
+    {
+        WriteString(data, input.SemanticName);
+        WriteUInt(data, input.SemanticIndex);
+        WriteUInt(data, input.Register);
+        WriteUInt(data, (unsigned int)input.ComponentType);
+        WriteUInt(data, input.ComponentCount);
+        WriteUInt(data, input.SystemValue ? 1 : 0);
+    }
+}
+
+bool ShaderReflection::Read(const unsigned char* data, size_t size)
+{
+    Clear();
+
+    Reader reader(data, size);
+    if (reader.ReadUInt() != kReflectionVersion)
+        return false;
+
+    unsigned int bufferCount = reader.ReadCount(4 * sizeof(unsigned int));
+    ConstantBuffers.resize(bufferCount);
+    for (auto& buffer : ConstantBuffers)
+    {
+        buffer.Name = reader.ReadString();
+        buffer.Slot = reader.ReadUInt();
+        buffer.Size = reader.ReadUInt();
+        buffer.Variables.resize(reader.ReadCount(3 * sizeof(unsigned int)));
+        for (auto& variable : buffer.Variables)
+        {
+            variable.Name = reader.ReadString();
+            variable.Offset = reader.ReadUInt();
+            variable.Size = reader.ReadUInt();
+        }
+    }
+
+    unsigned int bindingCount = reader.ReadCount(4 * sizeof(unsigned int));
+    Resources.Bindings.resize(bindingCount);
+    for (auto& binding : Resources.Bindings)
+    {
+        binding.Name = reader.ReadString();
+        binding.Type = (ShaderBindingType)reader.ReadUInt();
+        binding.Slot = reader.ReadUInt();
+        binding.Count = reader.ReadUInt();
+    }
+
+    unsigned int inputCount = reader.ReadCount(6 * sizeof(unsigned int));
+    Inputs.resize(inputCount);
+    for (auto& input : Inputs)
+    {
+        input.SemanticName = reader.ReadString();
+        input.SemanticIndex = reader.ReadUInt();
+        input.Register = reader.ReadUInt();
+        input.ComponentType = (ShaderComponentType)reader.ReadUInt();
+        input.ComponentCount = reader.ReadUInt();
+        input.SystemValue = (reader.ReadUInt() != 0);
+    }
+
+    bool result = !reader.Failed() && reader.AtEnd();
+    if (!result)
+        Clear();
+
+    return result;
+}
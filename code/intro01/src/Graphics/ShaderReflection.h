@@ -0,0 +1,102 @@
+///
+/// ShaderReflection.h - What a compiled shader expects to be given.
+/// Constant buffer layouts, resource bindings and vertex inputs, pulled out of the bytecode
+/// once when it's compiled and stored alongside it in the ShaderCache and ShaderPack. That's
+/// what input layouts, constant blocks and binding tables are built from, so none of them
+/// are written out by hand to match a shader.
+///
+/// Each part has a hash of its layout. Shaders whose layouts hash the same can share the
+/// objects built from them (see ShaderLayoutCache).
+///
+#pragma once
+
+#include <string>
+#include <vector>
+
+enum ShaderBindingType
+{
+    SBT_ConstantBuffer = 0,
+    SBT_Texture,
+    SBT_Sampler,
+    SBT_Buffer,             // structured and byte address buffers
+    SBT_UnorderedAccess,
+};
+
+enum ShaderComponentType
+{
+    SCT_Float = 0,
+    SCT_Int,
+    SCT_UInt,
+};
+
+struct ShaderVariable
+{
+    std::string     Name;
+    unsigned int    Offset;         // bytes from the start of the buffer
+    unsigned int    Size;
+};
+
+struct ShaderConstantBuffer
+{
+    std::string                 Name;
+    unsigned int                Slot;
+    unsigned int                Size;
+    std::vector<ShaderVariable> Variables;
+};
+
+struct ShaderBinding
+{
+    std::string         Name;
+    ShaderBindingType   Type;
+    unsigned int        Slot;
+    unsigned int        Count;      // more than one for arrays
+};
+
+struct ShaderInput
+{
+    std::string         SemanticName;
+    unsigned int        SemanticIndex;
+    unsigned int        Register;
+    ShaderComponentType ComponentType;
+    unsigned int        ComponentCount;
+    bool                SystemValue;    // SV_VertexID and friends - not fed from a vertex buffer
+};
+
+// Resource slots by name - textures, samplers and buffers, but not constant buffers
+class ShaderBindingTable
+{
+public:
+    static const unsigned int kInvalidSlot = 0xffffffff;
+
+    std::vector<ShaderBinding>  Bindings;
+
+    unsigned int FindSlot(const char* name, ShaderBindingType type) const;
+    unsigned long long GetHash() const;
+};
+
+class ShaderReflection
+{
+public:
+    std::vector<ShaderConstantBuffer>   ConstantBuffers;
+    ShaderBindingTable                  Resources;
+    std::vector<ShaderInput>            Inputs;
+
+public:
+    void Clear();
+    bool IsEmpty() const { return ConstantBuffers.empty() && Resources.Bindings.empty() && Inputs.empty(); }
+
+    const ShaderConstantBuffer* FindConstantBuffer(const char* name) const;
+
+    unsigned long long GetInputHash() const;
+    unsigned long long GetConstantBufferHash() const;     // every buffer, names included
+
+    // Appends to data. Read fails on anything truncated or malformed.
+    void Write(std::vector<unsigned char>& data) const;
+    bool Read(const unsigned char* data, size_t size);
+};
+
+// FNV-1a, for combining layout hashes
+unsigned long long HashLayoutBytes(unsigned long long hash, const void* data, size_t size);
+unsigned long long HashLayoutString(unsigned long long hash, const char* text);
+
+static const unsigned long long kLayoutHashSeed = 14695981039346656037ULL;
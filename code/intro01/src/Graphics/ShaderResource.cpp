@@ -1,4 +1,9 @@
 #include "ShaderResource.h"
+#include "ShaderCache.h"
+#include "ShaderPermutation.h"
+#include "D3DShaderCompiler.h"
+
+#include "utils\utils.h"
 
 #include <d3d11.h>
 #include <d3dcompiler.h>
@@ -16,38 +21,41 @@ ShaderResource::~ShaderResource()
 {
 }
 
-bool ShaderResource::LoadShader(const char* filename, const char* shadermodel, const char* entrypoint)
+bool ShaderResource::LoadShader(ShaderCache* cache, const char* filename, const char* shadermodel, const char* entrypoint, unsigned int variant)
 {
-    bool result = false;
-    wchar_t buffer[256];
-    mbstowcs(buffer, filename, 255);
-    ID3DBlob* errorBlob = nullptr;
-
-    HRESULT hr = D3DCompileFromFile(buffer, 0,
-                                    D3D_COMPILE_STANDARD_FILE_INCLUDE,
-                                    entrypoint, shadermodel,
-                                    (D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_DEBUG),
-                                    0,
-                                    &mShaderBuffer, &errorBlob);
-
-    if (CheckHRESULT(hr, errorBlob)) result = true;
-
-    return result;
+    // Every keyword is defined, whichever variant this is
+    std::string source;
+    std::vector<std::string> keywords;
+    std::vector<ShaderDefine> defines;
+    if (ShaderCache::ReadSource(filename, source) && ParseShaderKeywords(source, keywords))
+        GetShaderVariantDefines(keywords, variant, defines);
+
+    ShaderCompileRequest request(filename, entrypoint, shadermodel);
+    request.Flags = D3DShaderCompiler::GetDefaultFlags();
+    request.Defines = defines.data();
+    request.DefineCount = (unsigned int)defines.size();
+
+    std::vector<unsigned char> bytecode;
+    ShaderReflection reflection;
+    std::string errors;
+    bool result = cache->Load(request, bytecode, reflection, errors);
+
+    if (!errors.empty())
+        OutputDebugStringA(errors.c_str());
+
+    return result && LoadBytecode(bytecode.data(), bytecode.size(), reflection);
 }
 
-bool ShaderResource::CheckHRESULT(HRESULT &hr, ID3DBlob * &errorBlob)
+bool ShaderResource::LoadBytecode(const void* bytecode, size_t size, const ShaderReflection& reflection)
 {
-    bool result = true;
-    if (FAILED(hr))
-    {
-        if (errorBlob)
-        {
-            OutputDebugStringA((char*)errorBlob->GetBufferPointer());
-            errorBlob->Release();
-            errorBlob = nullptr;
-        }
-        result = false;
-    }
+    mReflection = reflection;
+
+    // Everything downstream wants a blob
+    SafeRelease(mShaderBuffer);
+    bool result = SUCCEEDED(D3DCreateBlob(size, &mShaderBuffer));
+    if (result)
+        memcpy(mShaderBuffer->GetBufferPointer(), bytecode, size);
+
     return result;
 }
 
@@ -1,20 +1,32 @@
 #pragma once
 
+#include "ShaderReflection.h"
+
 #include <d3dcompiler.h>
 
+class ShaderCache;
+
 class ShaderResource
 {
 public:
     ShaderResource();
     ~ShaderResource();
 
-    bool LoadShader(const char* filename, const char* shadermodel, const char* entrypoint);
+    // Through the cache, so only a shader that's changed since it was last built gets compiled.
+    // variant is a mask over the shader's @keywords (see ShaderPermutation.h).
+    bool LoadShader(ShaderCache* cache, const char* filename, const char* shadermodel, const char* entrypoint, unsigned int variant = 0);
+
+    // Already compiled - out of a ShaderPack
+    bool LoadBytecode(const void* bytecode, size_t size, const ShaderReflection& reflection);
     ID3DBlob* const GetShader() const { return mShaderBuffer; }
 
+    // Inputs, constant buffers and bindings, as the compiler saw them
+    const ShaderReflection& GetReflection() const { return mReflection; }
+
 private:
-    bool CheckHRESULT(HRESULT &hr, ID3DBlob * &errorBlob);
     void OutputShaderErrorMessage(ID3DBlob* _errorMsg, HWND _hwnd, WCHAR* _shaderFilename);
 
 private:
     ID3DBlob* mShaderBuffer;
+    ShaderReflection mReflection;
 };
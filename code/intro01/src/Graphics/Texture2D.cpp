@@ -1,11 +1,140 @@
 #include "StdAfx.h"
 #include "Texture2D.h"
+#include "TextureContainer.h"
+#include "utils\utils.h"
+#include "utils\assert.h"
 
+#include <d3d11.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    DXGI_FORMAT GetDxgiFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+        case TF_RGBA8:          return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case TF_RGBA8_SRGB:     return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        case TF_BC1:            return DXGI_FORMAT_BC1_UNORM;
+        case TF_BC1_SRGB:       return DXGI_FORMAT_BC1_UNORM_SRGB;
+        case TF_BC3:            return DXGI_FORMAT_BC3_UNORM;
+        case TF_BC3_SRGB:       return DXGI_FORMAT_BC3_UNORM_SRGB;
+        case TF_BC5:            return DXGI_FORMAT_BC5_UNORM;
+        case TF_BC7:            return DXGI_FORMAT_BC7_UNORM;
+        case TF_BC7_SRGB:       return DXGI_FORMAT_BC7_UNORM_SRGB;
+        default:
+            break;
+        }
+        return DXGI_FORMAT_UNKNOWN;
+    }
+}
 
 Texture2D::Texture2D()
+    : mFormat(TF_Unknown)
+    , mWidth(0)
+    , mHeight(0)
+    , mMipCount(0)
+    , mArraySize(0)
+    , mTexture(nullptr)
+    , mView(nullptr)
 {
 }
 
 Texture2D::~Texture2D()
 {
-}
\ No newline at end of file
+    Release();
+}
+
+bool Texture2D::Create(ID3D11Device* device, TextureData& data)
+{
+    ASSERT(device != nullptr);
+    ASSERT(!data.IsEmpty());
+
+    Release();
+    mData.Clear();
+    std::swap(mData, data);
+
+    mFormat = mData.GetFormat();
+    mWidth = mData.GetWidth();
+    mHeight = mData.GetHeight();
+    mMipCount = mData.GetMipCount();
+    mArraySize = 1;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> mips(mMipCount);
+    for (unsigned int mip = 0; mip < mMipCount; mip++)
+    {
+        mips[mip].pSysMem = mData.GetMipData(mip);
+        mips[mip].SysMemPitch = mData.GetMip(mip).RowPitch;
+        mips[mip].SysMemSlicePitch = 0;
+    }
+
+    return CreateResources(device, mips.data());
+}
+
+bool Texture2D::Create(ID3D11Device* device, const TextureContainer& container, unsigned int firstMip)
+{
+    ASSERT(device != nullptr);
+    ASSERT(firstMip < container.GetMipCount());
+
+    Release();
+    mData.Clear();
+
+    mFormat = container.GetFormat();
+    mWidth = std::max(container.GetWidth() >> firstMip, 1u);
+    mHeight = std::max(container.GetHeight() >> firstMip, 1u);
+    mMipCount = container.GetMipCount() - firstMip;
+    mArraySize = container.GetArraySize();
+
+    // D3D wants them slice by slice, mips in order within each
+    std::vector<D3D11_SUBRESOURCE_DATA> subresources(mMipCount * mArraySize);
+    for (unsigned int slice = 0; slice < mArraySize; slice++)
+    {
+        for (unsigned int mip = 0; mip < mMipCount; mip++)
+        {
+            D3D11_SUBRESOURCE_DATA& subresource = subresources[slice * mMipCount + mip];
+            subresource.pSysMem = container.GetSubresourceData(firstMip + mip, slice);
+            subresource.SysMemPitch = container.GetSubresource(firstMip + mip, slice).RowPitch;
+            subresource.SysMemSlicePitch = 0;
+        }
+    }
+
+    return CreateResources(device, subresources.data());
+}
+
+bool Texture2D::CreateResources(ID3D11Device* device, const D3D11_SUBRESOURCE_DATA* subresources)
+{
+    DXGI_FORMAT format = GetDxgiFormat(mFormat);
+    if (format == DXGI_FORMAT_UNKNOWN)
+        return false;
+
+    D3D11_TEXTURE2D_DESC textureDesc;
+    ZeroMemory(&textureDesc, sizeof(textureDesc));
+    textureDesc.Width = mWidth;
+    textureDesc.Height = mHeight;
+    textureDesc.MipLevels = mMipCount;
+    textureDesc.ArraySize = mArraySize;
+    textureDesc.Format = format;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    HRESULT hr = device->CreateTexture2D(&textureDesc, subresources, &mTexture);
+    if (SUCCEEDED(hr))
+        hr = device->CreateShaderResourceView(mTexture, nullptr, &mView);
+
+    if (FAILED(hr))
+    {
+        Release();
+        return false;
+    }
+
+    return true;
+}
+
+void Texture2D::Release()
+{
+    SafeRelease(mView);
+    SafeRelease(mTexture);
+}
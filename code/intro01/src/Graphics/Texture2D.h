@@ -1,11 +1,62 @@
+///
+/// Texture2D.h - A 2D texture (or texture array) on the GPU, and the pixels it was made from.
+/// The texture is created immutable with every mip at once, so there's no upload step and
+/// no staging copy - D3D copies the mips straight out of the TextureData, or out of the
+/// mapped file for a baked DDS or KTX2. A streamed texture is recreated whenever its mips
+/// change (see D3DTextureStreamBackend.h).
+///
 #pragma once
 
-class Texture2D
+#include "AssetManagement\IResource.h"
+#include "TextureData.h"
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct ID3D11Device;
+struct ID3D11Texture2D;
+struct ID3D11ShaderResourceView;
+struct D3D11_SUBRESOURCE_DATA;
+class TextureContainer;
+
+class Texture2D : public IResource
 {
 public:
     Texture2D();
-    ~Texture2D();
+    virtual ~Texture2D() override;
+
+    // Takes data's pixels (data is left empty) and creates the texture and its view from them
+    bool Create(ID3D11Device* device, TextureData& data);
+
+    // Straight from the container's mapping - nothing's kept, so the container can be closed
+    // once this returns. firstMip leaves the larger mips out, for streaming - the texture is
+    // then the size of that mip.
+    bool Create(ID3D11Device* device, const TextureContainer& container, unsigned int firstMip = 0);
+
+    void Release();
+
+    ID3D11Texture2D* GetTexture() const { return mTexture; }
+    ID3D11ShaderResourceView* GetView() const { return mView; }
+
+    // Empty for textures made from a container
+    const TextureData& GetData() const { return mData; }
+
+    TextureFormat GetFormat() const { return mFormat; }
+    unsigned int GetWidth() const { return mWidth; }
+    unsigned int GetHeight() const { return mHeight; }
+    unsigned int GetMipCount() const { return mMipCount; }
+    unsigned int GetArraySize() const { return mArraySize; }
 
 private:
+    bool CreateResources(ID3D11Device* device, const D3D11_SUBRESOURCE_DATA* subresources);
 
+private:
+    TextureData                 mData;
+    TextureFormat               mFormat;
+    unsigned int                mWidth;
+    unsigned int                mHeight;
+    unsigned int                mMipCount;
+    unsigned int                mArraySize;
+    ID3D11Texture2D*            mTexture;
+    ID3D11ShaderResourceView*   mView;
 };
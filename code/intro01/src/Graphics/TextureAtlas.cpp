@@ -0,0 +1,225 @@
+#include "TextureAtlas.h"
+#include "MipGenerator.h"
+
+#include "utils\Profiler.h"
+#include "utils\assert.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    // Rectangles start on a block boundary, so a BC block never holds two textures
+    const unsigned int kBlockAlignment = 4;
+
+    // UVs this far outside [0, 1] are still taken as the edge
+    const float kUVTolerance = 1.0f / 4096.0f;
+
+    // Copies the top mip into the page and smears its edge texels out over the gutter
+    void Blit(const TextureData& source, unsigned int padding, unsigned char* page, unsigned int pageSize, unsigned int x, unsigned int y)
+    {
+        const TextureMip& mip = source.GetMip(0);
+        const unsigned char* pixels = source.GetMipData(0);
+        int width = (int)mip.Width;
+        int height = (int)mip.Height;
+        int gutter = (int)padding;
+
+        for (int row = -gutter; row < height + gutter; ++row)
+        {
+            int sourceRow = std::min(std::max(row, 0), height - 1);
+            const unsigned char* sourceLine = pixels + (size_t)sourceRow * mip.RowPitch;
+            unsigned char* line = page + ((size_t)(y + row) * pageSize + x) * 4;
+
+            for (int column = -gutter; column < 0; ++column)
+                memcpy(line + column * 4, sourceLine, 4);
+            memcpy(line, sourceLine, (size_t)width * 4);
+            for (int column = width; column < width + gutter; ++column)
+                memcpy(line + column * 4, sourceLine + (width - 1) * 4, 4);
+        }
+    }
+
+    // As many mips as the gutter keeps clean - at mip m a bilinear tap reaches 2^m texels
+    // of the top level past the rectangle
+    unsigned int GetAtlasMipCount(unsigned int padding)
+    {
+        unsigned int mipCount = 1;
+        while ((2u << (mipCount - 1)) <= padding)
+            ++mipCount;
+        return mipCount;
+    }
+}
+
+bool TextureAtlas::Build(const AtlasSource* sources, unsigned int count, const TextureAtlasSettings& settings, JobSystem* jobs,
+                         std::string& errors)
+{
+    PROFILE_FUNCTION();
+
+    mPages.clear();
+    mNames.clear();
+    mEntries.clear();
+    memset(&mStats, 0, sizeof(mStats));
+
+    // Only what fits, in one colour space - the first texture's
+    std::vector<unsigned int> packed;
+    std::vector<AtlasSize> sizes;
+    bool srgb = false;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const TextureData& texture = *sources[i].Texture;
+        bool isRgba = (texture.GetFormat() == TF_RGBA8) || (texture.GetFormat() == TF_RGBA8_SRGB);
+        bool isSrgb = (texture.GetFormat() == TF_RGBA8_SRGB);
+        if (packed.empty())
+            srgb = isSrgb;
+
+        if (!isRgba || (isSrgb != srgb) || (texture.GetWidth() > settings.MaxSourceSize) || (texture.GetHeight() > settings.MaxSourceSize))
+        {
+            ++mStats.Skipped;
+            continue;
+        }
+
+        AtlasSize size = { texture.GetWidth(), texture.GetHeight() };
+        sizes.push_back(size);
+        packed.push_back(i);
+    }
+
+    if (packed.empty())
+    {
+        errors = "None of the textures can go in an atlas - they're too big or not RGBA8";
+        return false;
+    }
+
+    AtlasPackSettings packSettings;
+    packSettings.PageWidth = settings.PageSize;
+    packSettings.PageHeight = settings.PageSize;
+    packSettings.Padding = settings.Padding;
+    packSettings.Alignment = kBlockAlignment;
+    packSettings.Heuristic = settings.Heuristic;
+
+    std::vector<AtlasPlacement> placements;
+    unsigned int pageCount = PackAtlas(sizes.data(), (unsigned int)sizes.size(), packSettings, placements);
+
+    std::vector<std::vector<unsigned char>> pixels(pageCount);
+    for (auto& page : pixels)
+        page.assign((size_t)settings.PageSize * settings.PageSize * 4, 0);
+
+    float scale = 1.0f / (float)settings.PageSize;
+    unsigned long long usedTexels = 0;
+    for (size_t i = 0; i < packed.size(); ++i)
+    {
+        const AtlasSource& source = sources[packed[i]];
+        const AtlasPlacement& placement = placements[i];
+        if (placement.Page == AtlasPlacement::kNotPacked)
+        {
+            ++mStats.Skipped;
+            continue;
+        }
+
+        Blit(*source.Texture, settings.Padding, pixels[placement.Page].data(), settings.PageSize, placement.X, placement.Y);
+
+        AtlasEntry entry;
+        entry.Page = placement.Page;
+        entry.U = placement.X * scale;
+        entry.V = placement.Y * scale;
+        entry.Width = sizes[i].Width * scale;
+        entry.Height = sizes[i].Height * scale;
+
+        std::string key = GetKey(source.Name);
+        if (mEntries.find(key) == mEntries.end())
+            mNames.push_back(key);
+        mEntries[key] = entry;
+
+        usedTexels += (unsigned long long)sizes[i].Width * sizes[i].Height;
+        ++mStats.Packed;
+    }
+
+    MipSettings mipSettings;
+    mipSettings.Srgb = srgb;
+    mipSettings.MipCount = GetAtlasMipCount(settings.Padding);
+
+    mPages.resize(pageCount);
+    for (unsigned int page = 0; page < pageCount; ++page)
+    {
+        if (!GenerateMips(pixels[page].data(), settings.PageSize, settings.PageSize, settings.PageSize * 4, mipSettings, jobs, mPages[page]))
+        {
+            errors = "The atlas page size is out of range";
+            mPages.clear();
+            mEntries.clear();
+            mNames.clear();
+            return false;
+        }
+
+        if ((settings.Compression.Format != BF_None) && CanBlockCompress(settings.PageSize, settings.PageSize))
+        {
+            TextureData compressed;
+            if (CompressTexture(mPages[page], settings.Compression, jobs, compressed, nullptr))
+                std::swap(mPages[page], compressed);
+        }
+    }
+
+    mStats.Occupancy = (double)usedTexels / ((double)pageCount * settings.PageSize * settings.PageSize);
+    return true;
+}
+
+const AtlasEntry* TextureAtlas::Find(const char* name) const
+{
+    auto found = mEntries.find(GetKey(name));
+    return (found != mEntries.end()) ? &found->second : nullptr;
+}
+
+bool TextureAtlas::WriteLookupTable(const char* filename) const
+{
+    FILE* file = fopen(filename, "w");
+    if (file == nullptr)
+        return false;
+
+    // The name goes last, so it can have spaces in it
+    bool result = fprintf(file, "# page u v width height name\n") > 0;
+    for (const std::string& name : mNames)
+    {
+        const AtlasEntry& entry = mEntries.find(name)->second;
+        result = result && (fprintf(file, "%u %.8f %.8f %.8f %.8f %s\n", entry.Page, entry.U, entry.V, entry.Width, entry.Height, name.c_str()) > 0);
+    }
+
+    result = (fclose(file) == 0) && result;
+    return result;
+}
+
+std::string TextureAtlas::GetKey(const char* name)
+{
+    ASSERT(name != nullptr);
+
+    const char* start = name;
+    for (const char* c = name; *c != '\0'; ++c)
+    {
+        if ((*c == '\\') || (*c == '/'))
+            start = c + 1;
+    }
+
+    std::string key(start);
+    for (auto& c : key)
+        c = (char)tolower((unsigned char)c);
+    return key;
+}
+
+bool RemapUVs(const AtlasEntry& entry, float* uvs, size_t stride, unsigned int count)
+{
+    ASSERT(uvs != nullptr || count == 0);
+
+    unsigned char* base = (unsigned char*)uvs;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const float* uv = (const float*)(base + i * stride);
+        if ((uv[0] < -kUVTolerance) || (uv[0] > 1.0f + kUVTolerance) || (uv[1] < -kUVTolerance) || (uv[1] > 1.0f + kUVTolerance))
+            return false;
+    }
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float* uv = (float*)(base + i * stride);
+        uv[0] = entry.U + std::min(std::max(uv[0], 0.0f), 1.0f) * entry.Width;
+        uv[1] = entry.V + std::min(std::max(uv[1], 0.0f), 1.0f) * entry.Height;
+    }
+    return true;
+}
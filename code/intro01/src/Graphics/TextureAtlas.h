@@ -0,0 +1,107 @@
+///
+/// TextureAtlas.h - Merges small textures into a few big ones at import time.
+/// Every draw that samples a different texture needs its own bind, and so breaks a batch.
+/// With the small textures - UI, glyphs, decals, props - packed into atlas pages, the meshes
+/// that use them share a page instead, once their UVs are moved into the texture's
+/// rectangle on it.
+///
+/// Each texture is copied in with a gutter of its own edge texels around it, so filtering
+/// and the smaller mips don't bleed its neighbours in. The gutter is what limits the mips -
+/// an atlas gets as many as its padding covers, no more. Rectangles start on a 4 texel
+/// boundary so block compression never mixes two textures in a block.
+///
+///     std::vector<AtlasSource> sources = ...;     // name and RGBA8 pixels of each texture
+///     TextureAtlas atlas;
+///     atlas.Build(sources.data(), (unsigned int)sources.size(), settings, &jobs, errors);
+///     const AtlasEntry* entry = atlas.Find("button.png");
+///     RemapUVs(*entry, &vertices[0].UV.x, sizeof(vertices[0]), vertexCount);
+///
+/// Textures that tile can't be atlased - their UVs run past the edge of the rectangle.
+///
+#pragma once
+
+#include "AtlasPacker.h"
+#include "BlockCompressor.h"
+#include "TextureData.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class JobSystem;
+
+struct AtlasSource
+{
+    const char*         Name;           // looked up by file name, whatever the directory
+    const TextureData*  Texture;        // RGBA8 or RGBA8_SRGB - only the top mip is used
+};
+
+struct TextureAtlasSettings
+{
+    TextureAtlasSettings() : PageSize(2048), Padding(4), MaxSourceSize(512), Heuristic(SH_BottomLeft) { Compression.Format = BF_BC7; }
+
+    unsigned int        PageSize;
+    unsigned int        Padding;            // gutter texels - 4 keeps three mips clean
+    unsigned int        MaxSourceSize;      // anything bigger stays a texture of its own
+    SkylineHeuristic    Heuristic;
+    CompressionSettings Compression;
+};
+
+// Where a texture ended up. UVs are in the page's [0, 1], the rectangle without its gutter.
+struct AtlasEntry
+{
+    unsigned int    Page;
+    float           U;
+    float           V;
+    float           Width;
+    float           Height;
+};
+
+class TextureAtlas
+{
+public:
+    struct Stats
+    {
+        unsigned int    Packed;
+        unsigned int    Skipped;            // too big, or not RGBA8
+        double          Occupancy;          // texels of textures over texels of pages
+    };
+
+public:
+    // Replaces anything built before. False if none of the sources could be packed.
+    bool Build(const AtlasSource* sources, unsigned int count, const TextureAtlasSettings& settings, JobSystem* jobs,
+               std::string& errors);
+
+    // Null if the texture isn't in the atlas
+    const AtlasEntry* Find(const char* name) const;
+
+    // Pages go by "name#0", "name#1" and so on
+    void SetName(const char* name) { mName = name; }
+    std::string GetPageName(unsigned int page) const { return mName + "#" + std::to_string(page); }
+
+    unsigned int GetPageCount() const { return (unsigned int)mPages.size(); }
+    TextureData& GetPage(unsigned int page) { return mPages[page]; }
+    const Stats& GetStats() const { return mStats; }
+
+    // One line a texture - name, page and UV rectangle - for tools and anything that looks
+    // textures up at run time without the atlas itself
+    bool WriteLookupTable(const char* filename) const;
+
+    // The file name, lower case - what Find matches on
+    static std::string GetKey(const char* name);
+
+private:
+    std::string                                     mName;
+    std::vector<TextureData>                        mPages;
+    std::vector<std::string>                        mNames;         // in build order, for the lookup table
+    std::unordered_map<std::string, AtlasEntry>     mEntries;
+    Stats                                           mStats;
+};
+
+// Moves UVs from the texture's own [0, 1] into its rectangle on the page. uvs points at the
+// first vertex's U, stride is the bytes between vertices. False, and nothing changed, if any
+// UV is outside [0, 1] - the texture tiles and can't come from an atlas.
+bool RemapUVs(const AtlasEntry& entry, float* uvs, size_t stride, unsigned int count);
@@ -0,0 +1,249 @@
+#include "TextureCache.h"
+#include "ShaderCache.h"
+#include "TextureData.h"
+
+#include "utils\assert.h"
+#include "utils\Profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    const unsigned int kBlobMagic   = 0x43584554;   // 'TEXC'
+    const unsigned int kBlobVersion = 2;
+
+    // Sits in front of the texture in every cache file
+    struct BlobHeader
+    {
+        unsigned int        Magic;
+        unsigned int        Version;
+        unsigned long long  Key;
+        unsigned long long  Size;
+        unsigned long long  Checksum;       // of everything after the header, to catch a truncated write
+        double              Psnr;           // zero if the texture isn't compressed
+    };
+
+    const unsigned long long kFnvOffset = 14695981039346656037ULL;
+    const unsigned long long kFnvPrime  = 1099511628211ULL;
+
+    void HashBytes(unsigned long long& hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= kFnvPrime;
+        }
+    }
+
+    void HashUInt(unsigned long long& hash, unsigned int value)
+    {
+        HashBytes(hash, &value, sizeof(value));
+    }
+
+    void MakeDirectory(const char* path)
+    {
+#if defined(_WIN32)
+        _mkdir(path);
+#else
+        mkdir(path, 0755);
+#endif
+    }
+}
+
+TextureCache::TextureCache(IImageDecoder* decoder, const char* directory)
+    : mDecoder(decoder)
+    , mDirectory(directory != nullptr ? directory : "")
+{
+    ASSERT(decoder != nullptr);
+
+    memset(&mStats, 0, sizeof(mStats));
+    if (!mDirectory.empty())
+        MakeDirectory(mDirectory.c_str());
+}
+
+bool TextureCache::Load(const char* filename, const TextureImportSettings& settings, JobSystem* jobs, TextureData& texture,
+                        std::string& errors, TextureImportReport* report)
+{
+    PROFILE_FUNCTION();
+    ASSERT(filename != nullptr);
+
+    texture.Clear();
+    errors.clear();
+
+    TextureImportReport unused;
+    if (report == nullptr)
+        report = &unused;
+    memset(report, 0, sizeof(*report));
+
+    std::string source;
+    if (!ShaderCache::ReadSource(filename, source))
+    {
+        errors = std::string("Unable to read texture ") + filename;
+        return false;
+    }
+
+    unsigned long long key = ComputeKey(settings, source);
+    if (ReadBlob(key, texture, report->Psnr))
+    {
+        mStats.Hits++;
+        report->FromCache = true;
+        report->Compressed = (GetTextureFormatInfo(texture.GetFormat()).BlockSize > 1);
+        return true;
+    }
+
+    mStats.Misses++;
+
+    std::vector<unsigned char> rgba;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    {
+        PROFILE_SCOPE("DecodeImage");
+        if (!mDecoder->Decode(source, rgba, width, height, errors))
+        {
+            errors = std::string(filename) + ": " + errors;
+            return false;
+        }
+    }
+
+    // The source can be let go of before the mips are built - it's the bigger of the two
+    std::string().swap(source);
+
+    {
+        PROFILE_SCOPE("GenerateMips");
+        if (!GenerateMips(rgba.data(), width, height, width * 4, settings.Mips, jobs, texture))
+        {
+            errors = std::string(filename) + ": the image is too big, or empty";
+            return false;
+        }
+    }
+
+    // Sizes D3D won't take compressed are left as they are, rather than failing the load
+    if ((settings.Compression.Format != BF_None) && CanBlockCompress(width, height))
+    {
+        PROFILE_SCOPE("CompressTexture");
+        TextureData compressed;
+        if (!CompressTexture(texture, settings.Compression, jobs, compressed, &report->Psnr))
+        {
+            errors = std::string(filename) + ": block compression failed";
+            return false;
+        }
+        texture = std::move(compressed);
+        report->Compressed = true;
+    }
+
+    mStats.Imports++;
+    if (!WriteBlob(key, texture, report->Psnr))
+        mStats.WriteFailures++;
+
+    return true;
+}
+
+unsigned long long TextureCache::ComputeKey(const TextureImportSettings& settings, const std::string& source) const
+{
+    // The settings a field at a time, so padding doesn't get in
+    unsigned long long hash = kFnvOffset;
+    HashBytes(hash, &kBlobVersion, sizeof(kBlobVersion));
+    HashBytes(hash, mDecoder->GetName(), strlen(mDecoder->GetName()) + 1);
+    HashUInt(hash, (unsigned int)settings.Mips.Filter);
+    HashUInt(hash, settings.Mips.Srgb ? 1 : 0);
+    HashUInt(hash, settings.Mips.Wrap ? 1 : 0);
+    HashUInt(hash, settings.Mips.MipCount);
+    HashUInt(hash, (unsigned int)settings.Compression.Format);
+    HashUInt(hash, (unsigned int)settings.Compression.Quality);
+    HashBytes(hash, source.data(), source.size());
+    return hash;
+}
+
+std::string TextureCache::GetCachePath(unsigned long long key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.tex", key);
+    // Forward slashes work for the Windows file functions too
+    return mDirectory + "/" + name;
+}
+
+bool TextureCache::ReadBlob(unsigned long long key, TextureData& texture, double& psnr)
+{
+    if (mDirectory.empty())
+        return false;
+
+    PROFILE_FUNCTION();
+
+    std::string blob;
+    if (!ShaderCache::ReadSource(GetCachePath(key).c_str(), blob) || (blob.size() < sizeof(BlobHeader)))
+        return false;
+
+    BlobHeader header;
+    memcpy(&header, blob.data(), sizeof(header));
+
+    const unsigned char* body = (const unsigned char*)blob.data() + sizeof(header);
+    size_t bodySize = blob.size() - sizeof(header);
+
+    unsigned long long checksum = kFnvOffset;
+    HashBytes(checksum, body, bodySize);
+
+    if ((header.Magic != kBlobMagic)
+        || (header.Version != kBlobVersion)
+        || (header.Key != key)
+        || (header.Size != bodySize)
+        || (header.Checksum != checksum)
+        || !texture.Read(body, bodySize))
+        return false;
+
+    psnr = header.Psnr;
+    return true;
+}
+
+bool TextureCache::WriteBlob(unsigned long long key, const TextureData& texture, double psnr)
+{
+    if (mDirectory.empty())
+        return false;
+
+    PROFILE_FUNCTION();
+
+    std::vector<unsigned char> body;
+    texture.Write(body);
+
+    BlobHeader header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = kBlobMagic;
+    header.Version = kBlobVersion;
+    header.Key = key;
+    header.Size = body.size();
+    header.Checksum = kFnvOffset;
+    HashBytes(header.Checksum, body.data(), body.size());
+    header.Psnr = psnr;
+
+    // Written to the side and renamed into place, so a reader never sees half a file
+    std::string path = GetCachePath(key);
+    std::string temporary = path + ".tmp";
+
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    bool result = (fwrite(&header, sizeof(header), 1, file) == 1)
+        && (fwrite(body.data(), 1, body.size(), file) == body.size());
+    result = (fclose(file) == 0) && result;
+
+    if (result)
+    {
+        // rename won't replace an existing file on Windows
+        remove(path.c_str());
+        result = (rename(temporary.c_str(), path.c_str()) == 0);
+    }
+
+    if (!result)
+        remove(temporary.c_str());
+
+    return result;
+}
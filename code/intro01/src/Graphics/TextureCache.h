@@ -0,0 +1,95 @@
+///
+/// TextureCache.h - Imported textures, kept on disk ready to upload.
+/// Importing decodes the source image and builds its mip chain, which for a 4K or 8K image
+/// is far more work than reading the result back. So the result is stored under a key made
+/// from the source file's contents, the import settings and the decoder, and the next load
+/// of the same file with the same settings is one read:
+///
+///     TextureCache cache(&decoder, "texturecache");
+///     TextureImportSettings settings;
+///     TextureData texture;
+///     if (!cache.Load("assets/raw/brick.png", settings, &jobs, texture, errors)) ...
+///
+/// Editing the image or changing the settings changes the key, so there's nothing to
+/// invalidate by hand. Block compression happens on import too, after the mips are built,
+/// so the cache holds the BC texture and the PSNR it came out at.
+///
+#pragma once
+
+#include "BlockCompressor.h"
+#include "MipGenerator.h"
+
+#include <string>
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class JobSystem;
+class TextureData;
+
+struct TextureImportSettings
+{
+    // Compressed to BC7 unless asked otherwise - RGBA8 is four times the memory
+    TextureImportSettings() { Compression.Format = BF_BC7; }
+
+    MipSettings         Mips;
+    CompressionSettings Compression;
+};
+
+// What a load came back with - from the cache or not
+struct TextureImportReport
+{
+    bool            FromCache;
+    bool            Compressed;     // false when the size ruled compression out (see CanBlockCompress)
+    double          Psnr;           // of the compressed mips against the ones they came from
+};
+
+class IImageDecoder
+{
+public:
+    virtual ~IImageDecoder() {}
+
+    // Goes into every key, so bump it (or change the name) when the decoder's output changes
+    virtual const char* GetName() const = 0;
+
+    // contents is the whole file. Fills rgba with width * height texels, 8 bits a channel,
+    // top row first and tightly packed.
+    virtual bool Decode(const std::string& contents, std::vector<unsigned char>& rgba,
+                        unsigned int& width, unsigned int& height, std::string& errors) = 0;
+};
+
+class TextureCache
+{
+public:
+    struct Stats
+    {
+        unsigned int    Hits;
+        unsigned int    Misses;
+        unsigned int    Imports;        // misses that imported - failures aren't cached
+        unsigned int    WriteFailures;
+    };
+
+public:
+    // The directory is created if it isn't there. An empty directory turns the disk side off
+    // and everything is imported.
+    TextureCache(IImageDecoder* decoder, const char* directory);
+
+    // Mips are built, and blocks compressed, on the job system's threads if there is one
+    bool Load(const char* filename, const TextureImportSettings& settings, JobSystem* jobs, TextureData& texture,
+              std::string& errors, TextureImportReport* report = nullptr);
+
+    const Stats& GetStats() const { return mStats; }
+
+private:
+    unsigned long long ComputeKey(const TextureImportSettings& settings, const std::string& source) const;
+
+    std::string GetCachePath(unsigned long long key) const;
+    bool ReadBlob(unsigned long long key, TextureData& texture, double& psnr);
+    bool WriteBlob(unsigned long long key, const TextureData& texture, double psnr);
+
+private:
+    IImageDecoder*  mDecoder;
+    std::string     mDirectory;
+    Stats           mStats;
+};
@@ -0,0 +1,436 @@
+#include "TextureContainer.h"
+
+#include "utils\Profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    const unsigned int kMaxTextureSize  = 16384;    // D3D11's limits
+    const unsigned int kMaxArraySize    = 2048;
+
+    unsigned int MakeFourCC(char a, char b, char c, char d)
+    {
+        return (unsigned int)(unsigned char)a | ((unsigned int)(unsigned char)b << 8)
+            | ((unsigned int)(unsigned char)c << 16) | ((unsigned int)(unsigned char)d << 24);
+    }
+
+    // ==================================================================================
+    // DDS
+    // ==================================================================================
+    const unsigned int kDdsFlagMipMapCount      = 0x20000;
+    const unsigned int kDdsPixelAlpha           = 0x1;
+    const unsigned int kDdsPixelFourCC          = 0x4;
+    const unsigned int kDdsPixelRgb             = 0x40;
+    const unsigned int kDdsCaps2CubeMap         = 0x200;
+    const unsigned int kDdsCaps2Volume          = 0x200000;
+    const unsigned int kDdsMiscTextureCube      = 0x4;
+    const unsigned int kDdsDimensionTexture2D   = 3;
+
+    struct DdsPixelFormat
+    {
+        unsigned int    Size;
+        unsigned int    Flags;
+        unsigned int    FourCC;
+        unsigned int    RgbBitCount;
+        unsigned int    RedMask;
+        unsigned int    GreenMask;
+        unsigned int    BlueMask;
+        unsigned int    AlphaMask;
+    };
+
+    struct DdsHeader
+    {
+        unsigned int    Magic;              // 'DDS '
+        unsigned int    Size;
+        unsigned int    Flags;
+        unsigned int    Height;
+        unsigned int    Width;
+        unsigned int    PitchOrLinearSize;
+        unsigned int    Depth;
+        unsigned int    MipMapCount;
+        unsigned int    Reserved1[11];
+        DdsPixelFormat  PixelFormat;
+        unsigned int    Caps;
+        unsigned int    Caps2;
+        unsigned int    Caps3;
+        unsigned int    Caps4;
+        unsigned int    Reserved2;
+    };
+
+    // Follows the header when the FourCC is 'DX10'
+    struct DdsHeaderDx10
+    {
+        unsigned int    DxgiFormat;
+        unsigned int    ResourceDimension;
+        unsigned int    MiscFlag;
+        unsigned int    ArraySize;
+        unsigned int    MiscFlags2;
+    };
+
+    struct FormatCode
+    {
+        unsigned int    Code;
+        TextureFormat   Format;
+    };
+
+    const FormatCode kDxgiFormats[] =
+    {
+        { 28, TF_RGBA8 },           // DXGI_FORMAT_R8G8B8A8_UNORM
+        { 29, TF_RGBA8_SRGB },      // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+        { 71, TF_BC1 },             // DXGI_FORMAT_BC1_UNORM
+        { 72, TF_BC1_SRGB },
+        { 77, TF_BC3 },             // DXGI_FORMAT_BC3_UNORM
+        { 78, TF_BC3_SRGB },
+        { 83, TF_BC5 },             // DXGI_FORMAT_BC5_UNORM
+        { 98, TF_BC7 },             // DXGI_FORMAT_BC7_UNORM
+        { 99, TF_BC7_SRGB },
+    };
+
+    // ==================================================================================
+    // KTX2
+    // ==================================================================================
+    const unsigned char kKtx2Identifier[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+    struct Ktx2Header
+    {
+        unsigned char       Identifier[12];
+        unsigned int        VkFormat;
+        unsigned int        TypeSize;
+        unsigned int        PixelWidth;
+        unsigned int        PixelHeight;
+        unsigned int        PixelDepth;
+        unsigned int        LayerCount;
+        unsigned int        FaceCount;
+        unsigned int        LevelCount;
+        unsigned int        SupercompressionScheme;
+        unsigned int        DfdByteOffset;
+        unsigned int        DfdByteLength;
+        unsigned int        KvdByteOffset;
+        unsigned int        KvdByteLength;
+        unsigned long long  SgdByteOffset;
+        unsigned long long  SgdByteLength;
+    };
+
+    // One per mip, following the header
+    struct Ktx2Level
+    {
+        unsigned long long  ByteOffset;
+        unsigned long long  ByteLength;
+        unsigned long long  UncompressedByteLength;
+    };
+
+    const FormatCode kVkFormats[] =
+    {
+        { 37,  TF_RGBA8 },          // VK_FORMAT_R8G8B8A8_UNORM
+        { 43,  TF_RGBA8_SRGB },     // VK_FORMAT_R8G8B8A8_SRGB
+        { 131, TF_BC1 },            // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        { 132, TF_BC1_SRGB },
+        { 133, TF_BC1 },            // VK_FORMAT_BC1_RGBA_UNORM_BLOCK - D3D doesn't tell them apart
+        { 134, TF_BC1_SRGB },
+        { 137, TF_BC3 },            // VK_FORMAT_BC3_UNORM_BLOCK
+        { 138, TF_BC3_SRGB },
+        { 141, TF_BC5 },            // VK_FORMAT_BC5_UNORM_BLOCK
+        { 145, TF_BC7 },            // VK_FORMAT_BC7_UNORM_BLOCK
+        { 146, TF_BC7_SRGB },
+    };
+
+    template <size_t Count>
+    TextureFormat FindFormat(const FormatCode (&codes)[Count], unsigned int code)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            if (codes[i].Code == code)
+                return codes[i].Format;
+        }
+        return TF_Unknown;
+    }
+
+    std::string Describe(const char* message, unsigned int value)
+    {
+        char text[128];
+        snprintf(text, sizeof(text), message, value);
+        return text;
+    }
+}
+
+TextureContainer::TextureContainer()
+    : mData(nullptr)
+    , mSize(0)
+    , mFormat(TF_Unknown)
+    , mWidth(0)
+    , mHeight(0)
+    , mMipCount(0)
+    , mArraySize(0)
+{
+}
+
+bool TextureContainer::Open(const char* filename, std::string& errors)
+{
+    PROFILE_FUNCTION();
+
+    Close();
+    if (!mFile.Open(filename))
+    {
+        errors = std::string("Unable to map ") + filename;
+        return false;
+    }
+
+    if (!Parse(mFile.GetData(), mFile.GetSize(), errors))
+    {
+        errors = std::string(filename) + ": " + errors;
+        return false;
+    }
+
+    return true;
+}
+
+void TextureContainer::Close()
+{
+    mData = nullptr;
+    mSize = 0;
+    mFormat = TF_Unknown;
+    mWidth = 0;
+    mHeight = 0;
+    mMipCount = 0;
+    mArraySize = 0;
+    mSubresources.clear();
+    mFile.Close();
+}
+
+bool TextureContainer::Parse(const unsigned char* data, size_t size, std::string& errors)
+{
+    errors.clear();
+    mData = data;
+    mSize = size;
+
+    bool result = false;
+    if ((size >= sizeof(kKtx2Identifier)) && (memcmp(data, kKtx2Identifier, sizeof(kKtx2Identifier)) == 0))
+        result = ParseKtx2(errors);
+    else if ((size >= 4) && (memcmp(data, "DDS ", 4) == 0))
+        result = ParseDds(errors);
+    else
+        errors = "not a DDS or KTX2 file";
+
+    result = result && CheckBounds(errors);
+    if (!result)
+        Close();
+    return result;
+}
+
+bool TextureContainer::ParseDds(std::string& errors)
+{
+    DdsHeader header;
+    if (mSize < sizeof(header))
+    {
+        errors = "the DDS header is cut short";
+        return false;
+    }
+    memcpy(&header, mData, sizeof(header));
+
+    if ((header.Size != sizeof(DdsHeader) - sizeof(header.Magic)) || (header.PixelFormat.Size != sizeof(DdsPixelFormat)))
+    {
+        errors = "the DDS header is malformed";
+        return false;
+    }
+
+    if (header.Caps2 & (kDdsCaps2CubeMap | kDdsCaps2Volume))
+    {
+        errors = "cube maps and volume textures aren't supported";
+        return false;
+    }
+
+    unsigned long long offset = sizeof(header);
+    unsigned int arraySize = 1;
+    TextureFormat format = TF_Unknown;
+    const DdsPixelFormat& pixelFormat = header.PixelFormat;
+
+    if ((pixelFormat.Flags & kDdsPixelFourCC) && (pixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0')))
+    {
+        DdsHeaderDx10 extended;
+        if (mSize < offset + sizeof(extended))
+        {
+            errors = "the DX10 header is cut short";
+            return false;
+        }
+        memcpy(&extended, mData + offset, sizeof(extended));
+        offset += sizeof(extended);
+
+        if ((extended.ResourceDimension != kDdsDimensionTexture2D) || (extended.MiscFlag & kDdsMiscTextureCube))
+        {
+            errors = "only 2D textures and texture arrays are supported";
+            return false;
+        }
+
+        format = FindFormat(kDxgiFormats, extended.DxgiFormat);
+        if (format == TF_Unknown)
+        {
+            errors = Describe("DXGI format %u isn't supported", extended.DxgiFormat);
+            return false;
+        }
+        arraySize = extended.ArraySize;
+    }
+    else if (pixelFormat.Flags & kDdsPixelFourCC)
+    {
+        if (pixelFormat.FourCC == MakeFourCC('D', 'X', 'T', '1'))
+            format = TF_BC1;
+        else if (pixelFormat.FourCC == MakeFourCC('D', 'X', 'T', '5'))
+            format = TF_BC3;
+        else if ((pixelFormat.FourCC == MakeFourCC('A', 'T', 'I', '2')) || (pixelFormat.FourCC == MakeFourCC('B', 'C', '5', 'U')))
+            format = TF_BC5;
+        else
+        {
+            errors = Describe("FourCC 0x%08x isn't supported", pixelFormat.FourCC);
+            return false;
+        }
+    }
+    else if ((pixelFormat.Flags & kDdsPixelRgb) && (pixelFormat.Flags & kDdsPixelAlpha) && (pixelFormat.RgbBitCount == 32)
+             && (pixelFormat.RedMask == 0x000000ff) && (pixelFormat.GreenMask == 0x0000ff00)
+             && (pixelFormat.BlueMask == 0x00ff0000) && (pixelFormat.AlphaMask == 0xff000000))
+        format = TF_RGBA8;
+    else
+    {
+        errors = "the pixel format isn't supported - only RGBA8 and BC1/BC3/BC5/BC7";
+        return false;
+    }
+
+    unsigned int mipCount = ((header.Flags & kDdsFlagMipMapCount) && (header.MipMapCount > 0)) ? header.MipMapCount : 1;
+    if (!Layout(format, header.Width, header.Height, mipCount, arraySize, errors))
+        return false;
+
+    // Each slice's mips follow one another, largest first
+    for (unsigned int slice = 0; slice < mArraySize; slice++)
+    {
+        for (unsigned int mip = 0; mip < mMipCount; mip++)
+        {
+            TextureMip& subresource = mSubresources[slice * mMipCount + mip];
+            subresource.Offset = offset;
+            offset += subresource.Size;
+        }
+    }
+
+    return true;
+}
+
+bool TextureContainer::ParseKtx2(std::string& errors)
+{
+    Ktx2Header header;
+    if (mSize < sizeof(header))
+    {
+        errors = "the KTX2 header is cut short";
+        return false;
+    }
+    memcpy(&header, mData, sizeof(header));
+
+    if (header.SupercompressionScheme != 0)
+    {
+        errors = Describe("supercompression scheme %u isn't supported - bake the texture without it", header.SupercompressionScheme);
+        return false;
+    }
+
+    if ((header.PixelHeight == 0) || (header.PixelDepth != 0) || (header.FaceCount != 1))
+    {
+        errors = "only 2D textures and texture arrays are supported";
+        return false;
+    }
+
+    TextureFormat format = FindFormat(kVkFormats, header.VkFormat);
+    if (format == TF_Unknown)
+    {
+        errors = Describe("Vulkan format %u isn't supported", header.VkFormat);
+        return false;
+    }
+
+    // A level count of zero asks the loader to make the mips - there's only the one here
+    unsigned int mipCount = (header.LevelCount > 0) ? header.LevelCount : 1;
+    unsigned int arraySize = (header.LayerCount > 0) ? header.LayerCount : 1;
+    if (!Layout(format, header.PixelWidth, header.PixelHeight, mipCount, arraySize, errors))
+        return false;
+
+    if (mSize < sizeof(header) + (unsigned long long)mMipCount * sizeof(Ktx2Level))
+    {
+        errors = "the KTX2 level index is cut short";
+        return false;
+    }
+
+    // Each mip's slices are packed together, wherever the level index puts the mip
+    for (unsigned int mip = 0; mip < mMipCount; mip++)
+    {
+        Ktx2Level level;
+        memcpy(&level, mData + sizeof(header) + mip * sizeof(Ktx2Level), sizeof(level));
+
+        unsigned long long sliceSize = mSubresources[mip].Size;
+        if (level.ByteLength != sliceSize * mArraySize)
+        {
+            errors = Describe("mip %u isn't the size its format and dimensions make it", mip);
+            return false;
+        }
+
+        for (unsigned int slice = 0; slice < mArraySize; slice++)
+            mSubresources[slice * mMipCount + mip].Offset = level.ByteOffset + slice * sliceSize;
+    }
+
+    return true;
+}
+
+bool TextureContainer::Layout(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount, unsigned int arraySize,
+                              std::string& errors)
+{
+    if ((width == 0) || (height == 0) || (width > kMaxTextureSize) || (height > kMaxTextureSize))
+    {
+        errors = "the texture is empty, or bigger than 16384 on a side";
+        return false;
+    }
+
+    if ((mipCount > GetTextureMipCount(width, height)) || (arraySize == 0) || (arraySize > kMaxArraySize))
+    {
+        errors = "the mip count or array size is out of range";
+        return false;
+    }
+
+    // D3D11 won't create a block compressed texture that isn't whole blocks at the top
+    const TextureFormatInfo& info = GetTextureFormatInfo(format);
+    if ((width % info.BlockSize != 0) || (height % info.BlockSize != 0))
+    {
+        errors = "block compressed textures have to be a multiple of 4 on a side";
+        return false;
+    }
+
+    mFormat = format;
+    mWidth = width;
+    mHeight = height;
+    mMipCount = mipCount;
+    mArraySize = arraySize;
+    mSubresources.resize((size_t)mipCount * arraySize);
+
+    for (unsigned int mip = 0; mip < mipCount; mip++)
+    {
+        TextureMip level;
+        level.Offset = 0;
+        level.Width = (width >> mip) ? (width >> mip) : 1;
+        level.Height = (height >> mip) ? (height >> mip) : 1;
+        level.RowPitch = ((level.Width + info.BlockSize - 1) / info.BlockSize) * info.BytesPerBlock;
+        level.RowCount = (level.Height + info.BlockSize - 1) / info.BlockSize;
+        level.Size = (unsigned long long)level.RowPitch * level.RowCount;
+
+        for (unsigned int slice = 0; slice < arraySize; slice++)
+            mSubresources[slice * mipCount + mip] = level;
+    }
+
+    return true;
+}
+
+bool TextureContainer::CheckBounds(std::string& errors) const
+{
+    for (const TextureMip& subresource : mSubresources)
+    {
+        // Written so neither side can overflow
+        if ((subresource.Offset > mSize) || (subresource.Size > mSize - subresource.Offset))
+        {
+            errors = "the file is cut short - the pixels run past the end of it";
+            return false;
+        }
+    }
+    return true;
+}
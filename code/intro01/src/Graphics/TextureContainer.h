@@ -0,0 +1,68 @@
+///
+/// TextureContainer.h - Reads baked textures out of DDS and KTX2 files, in place.
+/// The file is memory mapped and its header checked, and after that every mip of every
+/// array slice is a pointer into the mapping - no decode, no copy, nothing allocated for the
+/// pixels. Creating the GPU texture then hands those pointers straight to D3D, so loading a
+/// baked texture costs what reading it does.
+///
+///     TextureContainer container;
+///     if (!container.Open("assets/baked/brick.ktx2", errors)) ...
+///     const unsigned char* pixels = container.GetSubresourceData(mip, slice);
+///
+/// Only 2D textures and arrays in the formats TextureData knows are taken - no cube maps,
+/// volumes or supercompressed KTX2.
+///
+#pragma once
+
+#include "TextureData.h"
+#include "utils\MappedFile.h"
+
+#include <string>
+#include <vector>
+
+class TextureContainer
+{
+public:
+    TextureContainer();
+
+    // Maps the file and parses it. The pointers are good until the container is closed or
+    // destroyed.
+    bool Open(const char* filename, std::string& errors);
+    void Close();
+
+    // For a file that's already in memory - data has to outlive the container
+    bool Parse(const unsigned char* data, size_t size, std::string& errors);
+
+    TextureFormat GetFormat() const { return mFormat; }
+    unsigned int GetWidth() const { return mWidth; }
+    unsigned int GetHeight() const { return mHeight; }
+    unsigned int GetMipCount() const { return mMipCount; }
+    unsigned int GetArraySize() const { return mArraySize; }
+
+    // Offset is from the start of the file. Rows are packed at the format's natural pitch,
+    // the same as TextureData's.
+    const TextureMip& GetSubresource(unsigned int mip, unsigned int slice) const { return mSubresources[slice * mMipCount + mip]; }
+    const unsigned char* GetSubresourceData(unsigned int mip, unsigned int slice) const { return mData + GetSubresource(mip, slice).Offset; }
+
+private:
+    bool ParseDds(std::string& errors);
+    bool ParseKtx2(std::string& errors);
+
+    // Checks the shape and sizes every subresource. The offsets are left to the caller - DDS
+    // keeps a slice's mips together, KTX2 a mip's slices.
+    bool Layout(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount, unsigned int arraySize,
+                std::string& errors);
+    bool CheckBounds(std::string& errors) const;
+
+private:
+    MappedFile                  mFile;
+    const unsigned char*        mData;
+    size_t                      mSize;
+
+    TextureFormat               mFormat;
+    unsigned int                mWidth;
+    unsigned int                mHeight;
+    unsigned int                mMipCount;
+    unsigned int                mArraySize;
+    std::vector<TextureMip>     mSubresources;      // mips of slice 0, then slice 1, ...
+};
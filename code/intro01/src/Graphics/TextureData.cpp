@@ -0,0 +1,151 @@
+#include "TextureData.h"
+
+#include <string.h>
+
+namespace
+{
+    const unsigned int kTextureMagic        = 0x44584554;   // 'TEXD'
+    const unsigned int kTextureVersion      = 1;
+    const unsigned int kMaxTextureSize      = 16384;        // D3D11's limit
+    const unsigned int kMipAlignment        = 16;
+
+    const TextureFormatInfo kFormatInfo[TF_Count] =
+    {
+        { "unknown",        1, 0,  false },
+        { "rgba8",          1, 4,  false },
+        { "rgba8_srgb",     1, 4,  true },
+        { "bc1",            4, 8,  false },
+        { "bc1_srgb",       4, 8,  true },
+        { "bc3",            4, 16, false },
+        { "bc3_srgb",       4, 16, true },
+        { "bc5",            4, 16, false },
+        { "bc7",            4, 16, false },
+        { "bc7_srgb",       4, 16, true },
+    };
+
+    // The pixels follow it
+    struct TextureHeader
+    {
+        unsigned int        Magic;
+        unsigned int        Version;
+        unsigned int        Format;
+        unsigned int        Width;
+        unsigned int        Height;
+        unsigned int        MipCount;
+        unsigned long long  Size;
+    };
+}
+
+const TextureFormatInfo& GetTextureFormatInfo(TextureFormat format)
+{
+    return kFormatInfo[((unsigned int)format < TF_Count) ? format : TF_Unknown];
+}
+
+unsigned int GetTextureMipCount(unsigned int width, unsigned int height)
+{
+    unsigned int largest = (width > height) ? width : height;
+    unsigned int count = 1;
+    while (largest > 1)
+    {
+        largest >>= 1;
+        count++;
+    }
+    return count;
+}
+
+TextureData::TextureData()
+    : mFormat(TF_Unknown)
+    , mWidth(0)
+    , mHeight(0)
+{
+}
+
+bool TextureData::Allocate(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount)
+{
+    Clear();
+
+    unsigned int fullCount = GetTextureMipCount(width, height);
+    if ((format == TF_Unknown) || ((unsigned int)format >= TF_Count)
+        || (width == 0) || (height == 0) || (width > kMaxTextureSize) || (height > kMaxTextureSize)
+        || (mipCount > fullCount))
+        return false;
+
+    if (mipCount == 0)
+        mipCount = fullCount;
+
+    const TextureFormatInfo& info = GetTextureFormatInfo(format);
+    mFormat = format;
+    mWidth = width;
+    mHeight = height;
+    mMips.resize(mipCount);
+
+    unsigned long long offset = 0;
+    for (unsigned int mip = 0; mip < mipCount; mip++)
+    {
+        TextureMip& level = mMips[mip];
+        level.Width = (width >> mip) ? (width >> mip) : 1;
+        level.Height = (height >> mip) ? (height >> mip) : 1;
+
+        // Block compressed levels smaller than a block still take a whole one
+        unsigned int blocksAcross = (level.Width + info.BlockSize - 1) / info.BlockSize;
+        level.RowCount = (level.Height + info.BlockSize - 1) / info.BlockSize;
+        level.RowPitch = blocksAcross * info.BytesPerBlock;
+        level.Size = (unsigned long long)level.RowPitch * level.RowCount;
+
+        level.Offset = offset;
+        offset = (offset + level.Size + kMipAlignment - 1) & ~(unsigned long long)(kMipAlignment - 1);
+    }
+
+    mPixels.resize((size_t)offset);
+    return true;
+}
+
+void TextureData::Clear()
+{
+    mFormat = TF_Unknown;
+    mWidth = 0;
+    mHeight = 0;
+    mMips.clear();
+    mPixels.clear();
+}
+
+void TextureData::Write(std::vector<unsigned char>& data) const
+{
+    TextureHeader header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = kTextureMagic;
+    header.Version = kTextureVersion;
+    header.Format = mFormat;
+    header.Width = mWidth;
+    header.Height = mHeight;
+    header.MipCount = (unsigned int)mMips.size();
+    header.Size = mPixels.size();
+
+    const unsigned char* bytes = (const unsigned char*)&header;
+    data.insert(data.end(), bytes, bytes + sizeof(header));
+    data.insert(data.end(), mPixels.begin(), mPixels.end());
+}
+
+bool TextureData::Read(const unsigned char* data, size_t size)
+{
+    Clear();
+
+    TextureHeader header;
+    if ((data == nullptr) || (size < sizeof(header)))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+    if ((header.Magic != kTextureMagic) || (header.Version != kTextureVersion) || (header.MipCount == 0))
+        return false;
+
+    // The layout is worked out again rather than trusted, so it has to come to the same size
+    if (!Allocate((TextureFormat)header.Format, header.Width, header.Height, header.MipCount)
+        || (header.Size != mPixels.size()) || (size - sizeof(header) != header.Size))
+    {
+        Clear();
+        return false;
+    }
+
+    memcpy(mPixels.data(), data + sizeof(header), mPixels.size());
+    return true;
+}
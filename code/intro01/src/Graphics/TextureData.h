@@ -0,0 +1,85 @@
+///
+/// TextureData.h - A texture's pixels, laid out the way the GPU takes them.
+/// Every mip level sits in the one block, largest first, each starting on a 16 byte boundary
+/// with its rows packed at the format's natural pitch. That's what D3D11_SUBRESOURCE_DATA
+/// wants, so creating the texture hands the mips straight over, and it's what the texture
+/// cache stores, so a cached texture loads with a single read and no conversion.
+///
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+enum TextureFormat
+{
+    TF_Unknown = 0,
+    TF_RGBA8,
+    TF_RGBA8_SRGB,
+    TF_BC1,                 // RGB, 4 bits a texel
+    TF_BC1_SRGB,
+    TF_BC3,                 // RGBA, 8 bits a texel
+    TF_BC3_SRGB,
+    TF_BC5,                 // two channels, 8 bits a texel - normal maps
+    TF_BC7,                 // RGB or RGBA, 8 bits a texel, the best quality of the lot
+    TF_BC7_SRGB,
+
+    TF_Count
+};
+
+struct TextureFormatInfo
+{
+    const char*     Name;
+    unsigned int    BlockSize;          // texels across (and down) a block - 1 if uncompressed
+    unsigned int    BytesPerBlock;
+    bool            Srgb;
+};
+
+const TextureFormatInfo& GetTextureFormatInfo(TextureFormat format);
+
+// Down to 1x1
+unsigned int GetTextureMipCount(unsigned int width, unsigned int height);
+
+struct TextureMip
+{
+    unsigned long long  Offset;         // bytes from the start of the pixels
+    unsigned int        Width;
+    unsigned int        Height;
+    unsigned int        RowPitch;       // bytes from one row of blocks to the next
+    unsigned int        RowCount;       // rows of blocks
+    unsigned long long  Size;
+};
+
+class TextureData
+{
+public:
+    TextureData();
+
+    // Lays out mipCount levels (zero for a full chain) and sizes the pixels to fit. The
+    // contents are left for the caller to fill.
+    bool Allocate(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount = 0);
+    void Clear();
+
+    bool IsEmpty() const { return mPixels.empty(); }
+
+    TextureFormat GetFormat() const { return mFormat; }
+    unsigned int GetWidth() const { return mWidth; }
+    unsigned int GetHeight() const { return mHeight; }
+    unsigned int GetMipCount() const { return (unsigned int)mMips.size(); }
+    const TextureMip& GetMip(unsigned int mip) const { return mMips[mip]; }
+
+    unsigned char* GetMipData(unsigned int mip) { return mPixels.data() + mMips[mip].Offset; }
+    const unsigned char* GetMipData(unsigned int mip) const { return mPixels.data() + mMips[mip].Offset; }
+
+    unsigned long long GetSize() const { return mPixels.size(); }
+
+    // Appends to data. Read fails on anything truncated or malformed.
+    void Write(std::vector<unsigned char>& data) const;
+    bool Read(const unsigned char* data, size_t size);
+
+private:
+    TextureFormat               mFormat;
+    unsigned int                mWidth;
+    unsigned int                mHeight;
+    std::vector<TextureMip>     mMips;
+    std::vector<unsigned char>  mPixels;
+};
@@ -0,0 +1,302 @@
+#include "TextureStreamer.h"
+
+#include "utils\Profiler.h"
+#include "utils\assert.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+    struct Candidate
+    {
+        float               Value;
+        StreamedTextureId   Texture;
+    };
+
+    bool MoreValuable(const Candidate& a, const Candidate& b)
+    {
+        return a.Value > b.Value;
+    }
+
+    unsigned int MipSize(unsigned int size, unsigned int mip)
+    {
+        return std::max(size >> mip, 1u);
+    }
+}
+
+TextureStreamer::TextureStreamer(ITextureStreamBackend* backend, const TextureStreamerSettings& settings)
+    : mBackend(backend)
+    , mSettings(settings)
+    , mFrame(0)
+    , mLoadsInFlight(0)
+{
+    ASSERT(backend != nullptr);
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+StreamedTextureId TextureStreamer::Register(unsigned int width, unsigned int height, const unsigned long long* mipSizes, unsigned int mipCount)
+{
+    ASSERT(mipCount > 0 && mipCount <= kMaxMips);
+
+    StreamedTextureId id;
+    if (mFreeIds.empty())
+    {
+        id = (StreamedTextureId)mTextures.size();
+        mTextures.push_back(TextureState());
+    }
+    else
+    {
+        id = mFreeIds.back();
+        mFreeIds.pop_back();
+    }
+
+    TextureState& texture = mTextures[id];
+    memset(&texture, 0, sizeof(texture));
+    texture.Size = std::max(width, height);
+    texture.MipCount = mipCount;
+    for (unsigned int mip = 0; mip < mipCount; ++mip)
+        texture.MipSizes[mip] = mipSizes[mip];
+
+    texture.TailMip = ComputeTailMip(width, height, mipCount, mSettings.TailSize);
+
+    texture.ResidentMip = texture.TailMip;
+    texture.WantedMip = texture.TailMip;
+    texture.LoadingMip = kNoMip;
+    texture.LastSeenFrame = mFrame;
+    texture.Registered = true;
+
+    for (unsigned int mip = texture.TailMip; mip < mipCount; ++mip)
+        mStats.ResidentBytes += mipSizes[mip];
+    mStats.PeakResidentBytes = std::max(mStats.PeakResidentBytes, mStats.ResidentBytes);
+    return id;
+}
+
+void TextureStreamer::Unregister(StreamedTextureId id)
+{
+    TextureState& texture = mTextures[id];
+    ASSERT(texture.Registered);
+
+    for (unsigned int mip = texture.ResidentMip; mip < texture.MipCount; ++mip)
+        mStats.ResidentBytes -= texture.MipSizes[mip];
+    texture.Registered = false;
+
+    // A read in flight still has to come back before the id can be handed out again
+    if (texture.LoadingMip == kNoMip)
+        Release(id);
+}
+
+void TextureStreamer::ReportScreenSize(StreamedTextureId id, float pixels)
+{
+    TextureState& texture = mTextures[id];
+    texture.ScreenSize = std::max(texture.ScreenSize, pixels);
+}
+
+void TextureStreamer::CompleteLoad(StreamedTextureId id, unsigned int mip, bool succeeded)
+{
+    TextureState& texture = mTextures[id];
+    ASSERT(texture.LoadingMip == mip);
+
+    texture.LoadingMip = kNoMip;
+    mStats.PendingBytes -= texture.MipSizes[mip];
+    --mLoadsInFlight;
+
+    if (!texture.Registered)
+    {
+        Release(id);
+        return;
+    }
+
+    if (!succeeded)
+    {
+        ++mStats.LoadsFailed;
+        texture.RetryFrame = mFrame + mSettings.RetryFrames;
+        return;
+    }
+
+    // Nothing evicts a texture with a read in flight, so this is always the next mip up
+    ASSERT(mip + 1 == texture.ResidentMip);
+    texture.ResidentMip = mip;
+    mStats.ResidentBytes += texture.MipSizes[mip];
+    mStats.PeakResidentBytes = std::max(mStats.PeakResidentBytes, mStats.ResidentBytes);
+    ++mStats.LoadsCompleted;
+
+    mBackend->SetResidency(id, mip);
+}
+
+void TextureStreamer::Update()
+{
+    PROFILE_FUNCTION();
+
+    ++mFrame;
+    mStats.MissingMips = 0;
+    mStats.VisibleTextures = 0;
+
+    std::vector<Candidate> loads;
+    std::vector<Candidate> evictions;
+
+    for (StreamedTextureId id = 0; id < (StreamedTextureId)mTextures.size(); ++id)
+    {
+        TextureState& texture = mTextures[id];
+        if (!texture.Registered)
+            continue;
+
+        if (texture.ScreenSize > 0.0f)
+        {
+            texture.LastSeenFrame = mFrame;
+            texture.LastScreenSize = texture.ScreenSize;
+            texture.WantedMip = ComputeWantedMip(texture.Size, texture.Size, texture.ScreenSize, mSettings.MipBias, texture.TailMip);
+
+            ++mStats.VisibleTextures;
+            if (texture.ResidentMip > texture.WantedMip)
+                mStats.MissingMips += texture.ResidentMip - texture.WantedMip;
+        }
+        else if (mFrame - texture.LastSeenFrame > mSettings.KeepFrames)
+        {
+            texture.WantedMip = texture.TailMip;
+        }
+        texture.ScreenSize = 0.0f;
+
+        // One read at a time a texture, and it pins what's resident until it's back
+        if (texture.LoadingMip != kNoMip)
+            continue;
+
+        if (texture.WantedMip < texture.ResidentMip && mFrame >= texture.RetryFrame)
+        {
+            Candidate load = { Magnification(texture, texture.ResidentMip), id };
+            loads.push_back(load);
+        }
+        if (texture.ResidentMip < texture.TailMip)
+        {
+            Candidate eviction = { EvictionValue(texture), id };
+            evictions.push_back(eviction);
+        }
+    }
+
+    // The most magnified textures load first, and the cheapest mips to lose sit on top of
+    // a min-heap
+    std::sort(loads.begin(), loads.end(), MoreValuable);
+    std::make_heap(evictions.begin(), evictions.end(), MoreValuable);
+
+    std::vector<Candidate> victims;
+    unsigned long long used = mStats.ResidentBytes + mStats.PendingBytes;
+
+    for (size_t i = 0; i < loads.size() && mLoadsInFlight < mSettings.MaxLoads; ++i)
+    {
+        const Candidate& load = loads[i];
+        TextureState& texture = mTextures[load.Texture];
+        unsigned int mip = texture.ResidentMip - 1;
+        unsigned long long bytes = texture.MipSizes[mip];
+
+        // Pick what would have to go first, and only evict if it makes room - freeing
+        // memory for a load that still doesn't fit would just have it read back next frame
+        victims.clear();
+        unsigned long long freed = 0;
+        while (used - freed + bytes > mSettings.BudgetBytes && !evictions.empty() && evictions.front().Value < load.Value)
+        {
+            std::pop_heap(evictions.begin(), evictions.end(), MoreValuable);
+            Candidate victim = evictions.back();
+            evictions.pop_back();
+
+            const TextureState& other = mTextures[victim.Texture];
+            if (victim.Texture == load.Texture || other.LoadingMip != kNoMip)
+                continue;
+
+            victims.push_back(victim);
+            freed += other.MipSizes[other.ResidentMip];
+        }
+
+        if (used - freed + bytes > mSettings.BudgetBytes)
+        {
+            for (size_t v = 0; v < victims.size(); ++v)
+            {
+                evictions.push_back(victims[v]);
+                std::push_heap(evictions.begin(), evictions.end(), MoreValuable);
+            }
+            continue;
+        }
+
+        for (size_t v = 0; v < victims.size(); ++v)
+        {
+            StreamedTextureId victim = victims[v].Texture;
+            used -= mTextures[victim].MipSizes[mTextures[victim].ResidentMip];
+            Evict(victim);
+
+            // The mip under it can go too, for a bigger load
+            if (mTextures[victim].ResidentMip < mTextures[victim].TailMip)
+            {
+                Candidate next = { EvictionValue(mTextures[victim]), victim };
+                evictions.push_back(next);
+                std::push_heap(evictions.begin(), evictions.end(), MoreValuable);
+            }
+        }
+
+        texture.LoadingMip = mip;
+        used += bytes;
+        mStats.PendingBytes += bytes;
+        ++mStats.LoadsIssued;
+        ++mLoadsInFlight;
+
+        mBackend->BeginLoad(load.Texture, mip);
+    }
+}
+
+unsigned int TextureStreamer::ComputeWantedMip(unsigned int width, unsigned int height, float pixels, float bias, unsigned int tailMip)
+{
+    if (pixels <= 0.0f)
+        return tailMip;
+
+    float level = log2f((float)std::max(width, height) / pixels) + bias;
+    if (level <= 0.0f)
+        return 0;
+    return std::min((unsigned int)level, tailMip);
+}
+
+unsigned int TextureStreamer::ComputeTailMip(unsigned int width, unsigned int height, unsigned int mipCount, unsigned int tailSize)
+{
+    unsigned int size = std::max(width, height);
+    for (unsigned int mip = 0; mip < mipCount; ++mip)
+    {
+        if (MipSize(size, mip) <= tailSize)
+            return mip;
+    }
+    return mipCount - 1;
+}
+
+float TextureStreamer::ProjectSphere(float distance, float radius, float pixelScale)
+{
+    // Inside the sphere it covers the screen, and it shouldn't jump there
+    return 2.0f * radius * pixelScale / std::max(distance, radius);
+}
+
+float TextureStreamer::Magnification(const TextureState& texture, unsigned int mip)
+{
+    return texture.LastScreenSize / (float)MipSize(texture.Size, mip);
+}
+
+float TextureStreamer::EvictionValue(const TextureState& texture) const
+{
+    // Mips nothing wants go before anything else, the longest unseen first
+    if (texture.ResidentMip < texture.WantedMip)
+        return -1.0f - (float)(mFrame - texture.LastSeenFrame);
+
+    return Magnification(texture, texture.ResidentMip + 1);
+}
+
+void TextureStreamer::Evict(StreamedTextureId id)
+{
+    TextureState& texture = mTextures[id];
+    ASSERT(texture.ResidentMip < texture.TailMip && texture.LoadingMip == kNoMip);
+
+    mStats.ResidentBytes -= texture.MipSizes[texture.ResidentMip];
+    ++texture.ResidentMip;
+    ++mStats.Evictions;
+
+    mBackend->SetResidency(id, texture.ResidentMip);
+}
+
+void TextureStreamer::Release(StreamedTextureId id)
+{
+    mFreeIds.push_back(id);
+}
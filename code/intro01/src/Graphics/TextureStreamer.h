@@ -0,0 +1,146 @@
+///
+/// TextureStreamer.h - Decides which mips of which textures are resident, within a budget.
+/// Every texture keeps its smallest mips (the tail) resident from the start. Above that,
+/// culling reports how big each texture is on screen, that picks the mip it wants, and
+/// the streamer loads the missing mips one at a time, smallest first, in the background.
+/// When the budget is full a load only goes ahead if it's worth more than the mips it
+/// would push out - a mip is worth how magnified the texture would look without it, and
+/// mips nothing wants any more go first.
+///
+/// The streamer only schedules. Reading mips and building GPU textures is the backend's
+/// job, which keeps the scheduling testable without a device (see
+/// TextureStreamingSimulation.h):
+///
+///     TextureStreamer streamer(&backend, settings);
+///     StreamedTextureId id = streamer.Register(width, height, mipSizes, mipCount);
+///     ...
+///     streamer.ReportScreenSize(id, pixels);      // from culling, each frame
+///     backend.Pump();                             // finished reads -> CompleteLoad
+///     streamer.Update();
+///
+#pragma once
+
+#include <vector>
+
+typedef unsigned int StreamedTextureId;
+const StreamedTextureId kInvalidStreamedTexture = 0xffffffff;
+
+class ITextureStreamBackend
+{
+public:
+    virtual ~ITextureStreamBackend() {}
+
+    // Start reading one mip in the background. The backend reports back through
+    // TextureStreamer::CompleteLoad, on the thread that calls Update.
+    virtual void BeginLoad(StreamedTextureId texture, unsigned int mip) = 0;
+
+    // firstMip and everything smaller is what's resident now - grow or trim the GPU copy
+    virtual void SetResidency(StreamedTextureId texture, unsigned int firstMip) = 0;
+};
+
+struct TextureStreamerSettings
+{
+    TextureStreamerSettings() : BudgetBytes(256ULL << 20), TailSize(64), MaxLoads(8), MipBias(0.0f), KeepFrames(30), RetryFrames(60) {}
+
+    unsigned long long  BudgetBytes;
+    unsigned int        TailSize;       // mips this size and smaller stay resident
+    unsigned int        MaxLoads;       // reads in flight at once
+    float               MipBias;        // positive trades detail for memory
+    unsigned int        KeepFrames;     // frames an unseen texture keeps wanting what it last wanted
+    unsigned int        RetryFrames;    // frames before a failed read is tried again
+};
+
+class TextureStreamer
+{
+public:
+    static const unsigned int kMaxMips = 15;        // 16384 down to 1
+
+    struct Stats
+    {
+        unsigned long long  ResidentBytes;
+        unsigned long long  PendingBytes;           // in reads in flight - counted against the budget too
+        unsigned long long  PeakResidentBytes;
+        unsigned long long  LoadsIssued;
+        unsigned long long  LoadsCompleted;
+        unsigned long long  LoadsFailed;
+        unsigned long long  Evictions;
+        unsigned int        MissingMips;            // wanted but not resident, over the textures seen last frame
+        unsigned int        VisibleTextures;
+    };
+
+public:
+    TextureStreamer(ITextureStreamBackend* backend, const TextureStreamerSettings& settings);
+
+    // mipSizes is the bytes in each mip, largest first. The tail is taken to be resident
+    // from here on - the backend creates the texture with it once this returns.
+    StreamedTextureId Register(unsigned int width, unsigned int height, const unsigned long long* mipSizes, unsigned int mipCount);
+    void Unregister(StreamedTextureId texture);
+
+    // Pixels across the largest thing using the texture this frame. The biggest report wins.
+    void ReportScreenSize(StreamedTextureId texture, float pixels);
+
+    void CompleteLoad(StreamedTextureId texture, unsigned int mip, bool succeeded);
+
+    // Once a frame, after the reports and completions - settles what every texture wants,
+    // evicts what has to go and starts the loads that are worth it
+    void Update();
+
+    void SetBudget(unsigned long long bytes) { mSettings.BudgetBytes = bytes; }
+    const TextureStreamerSettings& GetSettings() const { return mSettings; }
+
+    unsigned int GetResidentMip(StreamedTextureId texture) const { return mTextures[texture].ResidentMip; }
+    unsigned int GetWantedMip(StreamedTextureId texture) const { return mTextures[texture].WantedMip; }
+    unsigned int GetTailMip(StreamedTextureId texture) const { return mTextures[texture].TailMip; }
+    bool IsLoading(StreamedTextureId texture) const { return mTextures[texture].LoadingMip != kNoMip; }
+
+    const Stats& GetStats() const { return mStats; }
+
+    // The mip that puts about one texel under each pixel when the texture spans pixels on
+    // screen - which assumes it covers the object once
+    static unsigned int ComputeWantedMip(unsigned int width, unsigned int height, float pixels, float bias, unsigned int tailMip);
+
+    // The largest mip no bigger than tailSize, or the smallest there is
+    static unsigned int ComputeTailMip(unsigned int width, unsigned int height, unsigned int mipCount, unsigned int tailSize);
+
+    // The size a bounding sphere projects to, in pixels. pixelScale is the viewport height
+    // over 2 tan(fovY / 2).
+    static float ProjectSphere(float distance, float radius, float pixelScale);
+
+private:
+    static const unsigned int kNoMip = 0xffffffff;
+
+    struct TextureState
+    {
+        unsigned long long  MipSizes[kMaxMips];
+        unsigned int        Size;                   // the larger side
+        unsigned int        MipCount;
+        unsigned int        TailMip;
+        unsigned int        ResidentMip;            // this and every smaller mip are resident
+        unsigned int        WantedMip;
+        unsigned int        LoadingMip;
+        unsigned int        LastSeenFrame;
+        unsigned int        RetryFrame;
+        float               ScreenSize;             // reported since the last Update
+        float               LastScreenSize;
+        bool                Registered;
+    };
+
+    // How magnified the texture looks on screen with mip as its most detailed
+    static float Magnification(const TextureState& texture, unsigned int mip);
+
+    // What the texture's top mip is worth keeping - less than zero if nothing wants it
+    float EvictionValue(const TextureState& texture) const;
+
+    void Evict(StreamedTextureId texture);
+    void Release(StreamedTextureId texture);
+
+private:
+    ITextureStreamBackend*      mBackend;
+    TextureStreamerSettings     mSettings;
+    Stats                       mStats;
+    unsigned int                mFrame;
+    unsigned int                mLoadsInFlight;
+
+    std::vector<TextureState>       mTextures;
+    std::vector<StreamedTextureId>  mFreeIds;
+};
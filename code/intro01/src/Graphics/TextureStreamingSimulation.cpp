@@ -0,0 +1,276 @@
+///
+/// TextureStreamingSimulation.cpp - Runs the texture streamer with no GPU and no files.
+///
+
+#include "TextureStreamingSimulation.h"
+
+#include "utils\SimdMath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock SimulationClock;
+
+namespace
+{
+    struct SimulatedTexture
+    {
+        unsigned int        Size;
+        unsigned int        MipCount;
+        unsigned long long  MipSizes[TextureStreamer::kMaxMips];
+    };
+
+    struct SimulatedObject
+    {
+        float               X, Y, Z;
+        float               Radius;
+        StreamedTextureId   Texture;
+    };
+
+    // A disk that reads one thing at a time at a fixed rate, with a fixed delay on top, and
+    // a record of what the GPU would be holding
+    class SimulatedBackend : public ITextureStreamBackend
+    {
+    public:
+        SimulatedBackend(const std::vector<SimulatedTexture>& textures, unsigned int latencyFrames, unsigned long long bytesPerFrame)
+            : mTextures(textures)
+            , mStreamer(nullptr)
+            , mLatencyFrames(latencyFrames)
+            , mBytesPerFrame((double)bytesPerFrame)
+            , mDiskFreeAt(0.0)
+            , mFrame(0)
+            , mResidentBytes(0)
+            , mBytesRead(0)
+            , mViolations(0)
+        {
+        }
+
+        void SetStreamer(TextureStreamer* streamer) { mStreamer = streamer; }
+
+        // The streamer has just registered the texture with its tail resident
+        void AddTexture(StreamedTextureId texture, unsigned int tailMip)
+        {
+            if (texture >= mResidentMips.size())
+                mResidentMips.resize(texture + 1);
+            mResidentMips[texture] = tailMip;
+
+            const SimulatedTexture& simulated = mTextures[texture];
+            for (unsigned int mip = tailMip; mip < simulated.MipCount; ++mip)
+                mResidentBytes += simulated.MipSizes[mip];
+        }
+
+        void Pump(unsigned int frame)
+        {
+            mFrame = frame;
+
+            // Completing a read can't start another, so the list is safe to walk
+            size_t kept = 0;
+            for (size_t i = 0; i < mReads.size(); ++i)
+            {
+                if (mReads[i].ReadyFrame <= frame)
+                    mStreamer->CompleteLoad(mReads[i].Texture, mReads[i].Mip, true);
+                else
+                    mReads[kept++] = mReads[i];
+            }
+            mReads.resize(kept);
+        }
+
+        virtual void BeginLoad(StreamedTextureId texture, unsigned int mip) override
+        {
+            if (mip + 1 != mResidentMips[texture])
+                ++mViolations;
+
+            // Reads queue up behind each other on the disk
+            unsigned long long bytes = mTextures[texture].MipSizes[mip];
+            double start = std::max(mDiskFreeAt, (double)mFrame);
+            mDiskFreeAt = start + (double)bytes / mBytesPerFrame;
+            mBytesRead += bytes;
+
+            Read read = { texture, mip, (unsigned int)ceil(mDiskFreeAt) + mLatencyFrames };
+            mReads.push_back(read);
+        }
+
+        virtual void SetResidency(StreamedTextureId texture, unsigned int firstMip) override
+        {
+            // One mip at a time, loaded or evicted
+            unsigned int& resident = mResidentMips[texture];
+            const SimulatedTexture& simulated = mTextures[texture];
+            if (firstMip + 1 == resident)
+                mResidentBytes += simulated.MipSizes[firstMip];
+            else if (firstMip == resident + 1)
+                mResidentBytes -= simulated.MipSizes[resident];
+            else
+                ++mViolations;
+            resident = firstMip;
+        }
+
+        unsigned long long GetResidentBytes() const { return mResidentBytes; }
+        unsigned long long GetBytesRead() const { return mBytesRead; }
+        unsigned int GetViolations() const { return mViolations; }
+        void AddViolation() { ++mViolations; }
+
+    private:
+        struct Read
+        {
+            StreamedTextureId   Texture;
+            unsigned int        Mip;
+            unsigned int        ReadyFrame;
+        };
+
+        const std::vector<SimulatedTexture>&    mTextures;
+        TextureStreamer*                        mStreamer;
+        unsigned int                            mLatencyFrames;
+        double                                  mBytesPerFrame;
+        double                                  mDiskFreeAt;        // in frames
+        unsigned int                            mFrame;
+
+        std::vector<unsigned int>               mResidentMips;
+        std::vector<Read>                       mReads;
+        unsigned long long                      mResidentBytes;
+        unsigned long long                      mBytesRead;
+        unsigned int                            mViolations;
+    };
+
+    unsigned int NextRandom(unsigned int& seed)
+    {
+        seed = seed * 1664525 + 1013904223;
+        return seed >> 8;
+    }
+
+    float RandomRange(unsigned int& seed, float low, float high)
+    {
+        return low + (high - low) * (float)NextRandom(seed) / (float)(1 << 24);
+    }
+
+    // BC7 - 16 bytes a 4x4 block
+    void BuildTexture(unsigned int size, SimulatedTexture& texture)
+    {
+        texture.Size = size;
+        texture.MipCount = 0;
+        for (unsigned int mipSize = size; ; mipSize /= 2)
+        {
+            unsigned long long blocks = (mipSize + 3) / 4;
+            texture.MipSizes[texture.MipCount++] = blocks * blocks * 16;
+            if (mipSize == 1)
+                break;
+        }
+    }
+}
+
+bool RunTextureStreamingSimulation(const TextureStreamingSimulationSettings& settings, TextureStreamingSimulationResult& result)
+{
+    memset(&result, 0, sizeof(result));
+    unsigned int seed = settings.Seed;
+
+    // Mostly small textures and a few big ones, the way real content goes
+    static const unsigned int kSizes[] = { 256, 512, 512, 1024, 1024, 1024, 2048, 2048, 4096 };
+    std::vector<SimulatedTexture> textures(settings.TextureCount);
+    for (auto& texture : textures)
+    {
+        BuildTexture(kSizes[NextRandom(seed) % (sizeof(kSizes) / sizeof(kSizes[0]))], texture);
+        for (unsigned int mip = 0; mip < texture.MipCount; ++mip)
+            result.FullBytes += texture.MipSizes[mip];
+    }
+
+    SimulatedBackend backend(textures, settings.LatencyFrames, settings.BytesPerFrame);
+    TextureStreamer streamer(&backend, settings.Streamer);
+    backend.SetStreamer(&streamer);
+
+    // Nothing's been unregistered, so the ids come out in order
+    for (unsigned int i = 0; i < settings.TextureCount; ++i)
+    {
+        StreamedTextureId id = streamer.Register(textures[i].Size, textures[i].Size, textures[i].MipSizes, textures[i].MipCount);
+        backend.AddTexture(id, streamer.GetTailMip(id));
+    }
+
+    std::vector<SimulatedObject> objects(settings.ObjectCount);
+    for (auto& object : objects)
+    {
+        object.X = RandomRange(seed, 0.0f, settings.FieldSize);
+        object.Y = RandomRange(seed, 0.0f, 3.0f);
+        object.Z = RandomRange(seed, 0.0f, settings.FieldSize);
+        object.Radius = RandomRange(seed, 0.5f, 4.0f);
+        object.Texture = NextRandom(seed) % settings.TextureCount;
+    }
+
+    float tanHalfY = tanf(Math::ToRadians(settings.FovY) * 0.5f);
+    float tanHalfX = tanHalfY * settings.Aspect;
+    float pixelScale = settings.ViewportHeight / (2.0f * tanHalfY);
+
+    // The camera circles the field, looking along the way it's going and now and then
+    // turning its head, so what it sees keeps changing
+    float centre = settings.FieldSize * 0.5f;
+    float orbit = settings.FieldSize * 0.35f;
+
+    double visibleTotal = 0.0;
+    double missingTotal = 0.0;
+    unsigned int sharpFrames = 0;
+    SimulationClock::duration updateTime(0);
+
+    for (unsigned int frame = 0; frame < settings.FrameCount; ++frame)
+    {
+        float angle = (float)frame * settings.CameraSpeed / orbit;
+        float eyeX = centre + orbit * cosf(angle);
+        float eyeY = 2.0f;
+        float eyeZ = centre + orbit * sinf(angle);
+        float heading = angle + Math::kPi * 0.5f + 0.8f * sinf((float)frame * 0.01f);
+        float forwardX = cosf(heading);
+        float forwardZ = sinf(heading);
+
+        // A cull, and the screen size of whatever survives it
+        for (auto& object : objects)
+        {
+            float dx = object.X - eyeX;
+            float dy = object.Y - eyeY;
+            float dz = object.Z - eyeZ;
+            float depth = dx * forwardX + dz * forwardZ;
+            float across = dx * forwardZ - dz * forwardX;
+            if ((depth < -object.Radius) || (depth > settings.FarZ + object.Radius))
+                continue;
+            if ((fabsf(across) > depth * tanHalfX + object.Radius * sqrtf(1.0f + tanHalfX * tanHalfX))
+                || (fabsf(dy) > depth * tanHalfY + object.Radius * sqrtf(1.0f + tanHalfY * tanHalfY)))
+                continue;
+
+            float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+            streamer.ReportScreenSize(object.Texture, TextureStreamer::ProjectSphere(distance, object.Radius, pixelScale));
+        }
+
+        backend.Pump(frame);
+
+        SimulationClock::time_point start = SimulationClock::now();
+        streamer.Update();
+        updateTime += SimulationClock::now() - start;
+
+        const TextureStreamer::Stats& stats = streamer.GetStats();
+        unsigned long long committed = stats.ResidentBytes + stats.PendingBytes;
+        if ((committed > settings.Streamer.BudgetBytes) || (stats.ResidentBytes != backend.GetResidentBytes()))
+            backend.AddViolation();
+
+        result.PeakCommittedBytes = std::max(result.PeakCommittedBytes, committed);
+        visibleTotal += stats.VisibleTextures;
+        missingTotal += stats.MissingMips;
+        if (stats.MissingMips == 0)
+            ++sharpFrames;
+    }
+
+    const TextureStreamer::Stats& stats = streamer.GetStats();
+    result.Frames = settings.FrameCount;
+    result.BudgetBytes = settings.Streamer.BudgetBytes;
+    result.PeakResidentBytes = stats.PeakResidentBytes;
+    result.BytesRead = backend.GetBytesRead();
+    result.LoadsIssued = stats.LoadsIssued;
+    result.LoadsCompleted = stats.LoadsCompleted;
+    result.Evictions = stats.Evictions;
+
+    double frames = (settings.FrameCount > 0) ? (double)settings.FrameCount : 1.0;
+    result.AverageVisibleTextures = visibleTotal / frames;
+    result.AverageMissingMips = missingTotal / frames;
+    result.SharpFrames = sharpFrames / frames;
+    result.UpdateMicroseconds = std::chrono::duration<double, std::micro>(updateTime).count() / frames;
+    result.Violations = backend.GetViolations();
+
+    return result.Violations == 0;
+}
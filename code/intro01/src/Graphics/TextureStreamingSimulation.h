@@ -0,0 +1,60 @@
+///
+/// TextureStreamingSimulation.h - Runs the texture streamer with no GPU and no files.
+/// A camera flies through a field of objects, each using one of a set of BC7 textures,
+/// and what it sees each frame is fed to a TextureStreamer the way culling would. The
+/// backend stands in for a disk with a fixed latency and bandwidth and keeps its own
+/// record of what's resident, so every frame can be checked: the budget is never exceeded,
+/// mips only come and go one at a time, and the streamer's byte counts agree with the
+/// backend's. The benchmark runner reports the results; nothing here prints.
+///
+#pragma once
+
+#include "TextureStreamer.h"
+
+struct TextureStreamingSimulationSettings
+{
+    TextureStreamingSimulationSettings()
+        : TextureCount(512), ObjectCount(4096), FrameCount(1200), FieldSize(400.0f), CameraSpeed(0.5f)
+        , ViewportHeight(1080.0f), FovY(60.0f), Aspect(16.0f / 9.0f), FarZ(300.0f)
+        , LatencyFrames(3), BytesPerFrame(8ULL << 20), Seed(1234)
+    {
+        Streamer.BudgetBytes = 96ULL << 20;
+    }
+
+    unsigned int            TextureCount;       // 256 to 4096 square
+    unsigned int            ObjectCount;
+    unsigned int            FrameCount;
+    float                   FieldSize;          // objects are scattered over a square this wide
+    float                   CameraSpeed;        // units a frame
+    float                   ViewportHeight;
+    float                   FovY;               // degrees
+    float                   Aspect;
+    float                   FarZ;
+    unsigned int            LatencyFrames;      // from a read starting to it landing
+    unsigned long long      BytesPerFrame;      // the disk's bandwidth
+    unsigned int            Seed;
+    TextureStreamerSettings Streamer;
+};
+
+struct TextureStreamingSimulationResult
+{
+    unsigned int        Frames;
+    unsigned long long  BudgetBytes;
+    unsigned long long  FullBytes;              // every mip of every texture
+    unsigned long long  PeakResidentBytes;
+    unsigned long long  PeakCommittedBytes;     // resident plus in flight
+    unsigned long long  BytesRead;
+    unsigned long long  LoadsIssued;
+    unsigned long long  LoadsCompleted;
+    unsigned long long  Evictions;
+
+    double              AverageVisibleTextures;
+    double              AverageMissingMips;     // a frame, over the textures it sees
+    double              SharpFrames;            // the fraction with nothing missing
+    double              UpdateMicroseconds;     // TextureStreamer::Update, a frame
+
+    unsigned int        Violations;             // should be zero - see above
+};
+
+// True if the run had no violations
+bool RunTextureStreamingSimulation(const TextureStreamingSimulationSettings& settings, TextureStreamingSimulationResult& result);
@@ -0,0 +1,132 @@
+///
+/// TransientTexturePool.cpp - Pooled D3D11 textures for the FrameGraph.
+///
+
+#include "stdafx.h"
+#include "d3d11.h"
+
+#include "TransientTexturePool.h"
+
+#include "utils\assert.h"
+#include "utils\utils.h"
+
+TransientTexturePool::TransientTexturePool()
+    : mDevice(nullptr)
+{
+}
+
+TransientTexturePool::~TransientTexturePool()
+{
+    for (auto entry : mEntries)
+    {
+        ReleaseEntry(entry);
+        delete entry;
+    }
+    mEntries.clear();
+}
+
+void TransientTexturePool::Initialize(ID3D11Device* device)
+{
+    ASSERT(device != nullptr);
+    mDevice = device;
+}
+
+void* TransientTexturePool::Acquire(const FrameGraphTextureDesc& desc)
+{
+    for (auto entry : mEntries)
+    {
+        if (!entry->InUse && entry->Desc.Matches(desc))
+        {
+            entry->InUse = true;
+            return &entry->Views;
+        }
+    }
+
+    Entry* entry = new Entry();
+    if (!CreateEntry(desc, entry))
+    {
+        ReleaseEntry(entry);
+        delete entry;
+        return nullptr;
+    }
+
+    entry->InUse = true;
+    mEntries.push_back(entry);
+    return &entry->Views;
+}
+
+void TransientTexturePool::Release(void* texture)
+{
+    for (auto entry : mEntries)
+    {
+        if (&entry->Views == texture)
+        {
+            entry->InUse = false;
+            return;
+        }
+    }
+}
+
+void TransientTexturePool::Purge()
+{
+    unsigned int kept = 0;
+    for (unsigned int index = 0; index < mEntries.size(); index++)
+    {
+        Entry* entry = mEntries[index];
+        if (entry->InUse)
+        {
+            mEntries[kept++] = entry;
+            continue;
+        }
+
+        ReleaseEntry(entry);
+        delete entry;
+    }
+    mEntries.resize(kept);
+}
+
+bool TransientTexturePool::CreateEntry(const FrameGraphTextureDesc& desc, Entry* entry)
+{
+    ASSERT(mDevice != nullptr);
+
+    entry->Desc = desc;
+    entry->InUse = false;
+    ZeroMemory(&entry->Views, sizeof(FrameGraphTexture));
+
+    D3D11_TEXTURE2D_DESC textureDesc;
+    ZeroMemory(&textureDesc, sizeof(textureDesc));
+    textureDesc.Width = desc.Width;
+    textureDesc.Height = desc.Height;
+    textureDesc.MipLevels = 1;
+    textureDesc.ArraySize = 1;
+    textureDesc.Format = (DXGI_FORMAT)desc.Format;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = desc.BindFlags;
+
+    if (FAILED(mDevice->CreateTexture2D(&textureDesc, nullptr, &entry->Views.Texture)))
+        return false;
+
+    // Create whichever views the bind flags allow
+    if ((desc.BindFlags & D3D11_BIND_RENDER_TARGET)
+        && FAILED(mDevice->CreateRenderTargetView(entry->Views.Texture, nullptr, &entry->Views.RenderTargetView)))
+        return false;
+
+    if ((desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)
+        && FAILED(mDevice->CreateShaderResourceView(entry->Views.Texture, nullptr, &entry->Views.ShaderResourceView)))
+        return false;
+
+    if ((desc.BindFlags & D3D11_BIND_DEPTH_STENCIL)
+        && FAILED(mDevice->CreateDepthStencilView(entry->Views.Texture, nullptr, &entry->Views.DepthStencilView)))
+        return false;
+
+    return true;
+}
+
+void TransientTexturePool::ReleaseEntry(Entry* entry)
+{
+    SafeRelease(entry->Views.DepthStencilView);
+    SafeRelease(entry->Views.ShaderResourceView);
+    SafeRelease(entry->Views.RenderTargetView);
+    SafeRelease(entry->Views.Texture);
+}
@@ -0,0 +1,61 @@
+///
+/// TransientTexturePool.h - D3D11 backing for the FrameGraph's transient textures.
+/// Textures are pooled by description and handed back out on later frames, so a steady
+/// frame graph creates nothing after its first frame.
+///
+#pragma once
+
+#include "FrameGraph.h"
+
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+struct ID3D11Device;
+struct ID3D11Texture2D;
+struct ID3D11RenderTargetView;
+struct ID3D11ShaderResourceView;
+struct ID3D11DepthStencilView;
+
+// What a pass gets back from FrameGraphResources::Get
+struct FrameGraphTexture
+{
+    ID3D11Texture2D*            Texture;
+    ID3D11RenderTargetView*     RenderTargetView;
+    ID3D11ShaderResourceView*   ShaderResourceView;
+    ID3D11DepthStencilView*     DepthStencilView;
+};
+
+class TransientTexturePool : public IFrameGraphAllocator
+{
+private:
+    struct Entry
+    {
+        FrameGraphTextureDesc   Desc;
+        FrameGraphTexture       Views;
+        bool                    InUse;
+    };
+
+public:
+    TransientTexturePool();
+    virtual ~TransientTexturePool() override;
+
+    void Initialize(ID3D11Device* device);
+
+    virtual void* Acquire(const FrameGraphTextureDesc& desc) override;
+    virtual void Release(void* texture) override;
+
+    // Free everything that isn't currently handed out - eg. after the back buffer changes size
+    void Purge();
+
+    unsigned int GetTextureCount() const { return (unsigned int)mEntries.size(); }
+
+private:
+    bool CreateEntry(const FrameGraphTextureDesc& desc, Entry* entry);
+    static void ReleaseEntry(Entry* entry);
+
+private:
+    ID3D11Device*           mDevice;
+    std::vector<Entry*>     mEntries;
+};
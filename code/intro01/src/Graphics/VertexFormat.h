@@ -0,0 +1,31 @@
+///
+/// VertexFormat.h - What's in a vertex buffer, described once next to the vertex struct.
+/// Input layouts are built by matching a vertex shader's reflected inputs against this by
+/// semantic (see ShaderLayoutCache), so only the elements the shader reads make it in.
+///
+#pragma once
+
+enum VertexElementFormat
+{
+    VEF_Float = 0,
+    VEF_Float2,
+    VEF_Float3,
+    VEF_Float4,
+    VEF_UByte4Norm,
+};
+
+struct VertexElement
+{
+    const char*         Semantic;
+    unsigned int        SemanticIndex;
+    VertexElementFormat Format;
+    unsigned int        Stream;             // input assembler slot
+    unsigned int        Offset;             // bytes into the stream's vertex
+    unsigned int        InstanceStepRate;   // 0 for per vertex data
+};
+
+struct VertexFormat
+{
+    const VertexElement*    Elements;
+    unsigned int            ElementCount;
+};
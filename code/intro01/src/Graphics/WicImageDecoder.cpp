@@ -0,0 +1,116 @@
+#include "WicImageDecoder.h"
+
+#include "utils\utils.h"
+
+#include <windows.h>
+#include <wincodec.h>
+#include <stdio.h>
+
+namespace
+{
+    // Same limit as TextureData - and it keeps the byte counts below inside a UINT
+    const unsigned int kMaxImageSize = 16384;
+
+    std::string DescribeFailure(const char* what, HRESULT hr)
+    {
+        char message[128];
+        snprintf(message, sizeof(message), "%s failed (0x%08x)", what, (unsigned int)hr);
+        return message;
+    }
+}
+
+const char* WicImageDecoder::GetName() const
+{
+    return "wic-1";
+}
+
+bool WicImageDecoder::Decode(const std::string& contents, std::vector<unsigned char>& rgba,
+                             unsigned int& width, unsigned int& height, std::string& errors)
+{
+    rgba.clear();
+    width = 0;
+    height = 0;
+
+    // Imports can run on any thread, so COM is brought up here. RPC_E_CHANGED_MODE means the
+    // thread already has it, the other way - that's fine, and isn't ours to undo.
+    HRESULT init = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    IWICImagingFactory* factory = nullptr;
+    IWICStream* stream = nullptr;
+    IWICBitmapDecoder* decoder = nullptr;
+    IWICBitmapFrameDecode* frame = nullptr;
+    IWICFormatConverter* converter = nullptr;
+
+    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+    if (FAILED(hr))
+        errors = DescribeFailure("Creating the WIC factory", hr);
+
+    if (SUCCEEDED(hr))
+    {
+        hr = factory->CreateStream(&stream);
+        if (SUCCEEDED(hr))
+            hr = stream->InitializeFromMemory((BYTE*)contents.data(), (DWORD)contents.size());
+        if (FAILED(hr))
+            errors = DescribeFailure("Creating the image stream", hr);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = factory->CreateDecoderFromStream(stream, nullptr, WICDecodeMetadataCacheOnDemand, &decoder);
+        if (SUCCEEDED(hr))
+            hr = decoder->GetFrame(0, &frame);
+        if (FAILED(hr))
+            errors = DescribeFailure("Decoding the image (is it a format WIC knows?)", hr);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        // Whatever the file holds - palettes, 16 bit, greyscale - comes out as 8 bit RGBA
+        hr = factory->CreateFormatConverter(&converter);
+        if (SUCCEEDED(hr))
+            hr = converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+        if (FAILED(hr))
+            errors = DescribeFailure("Converting the image to RGBA", hr);
+    }
+
+    UINT frameWidth = 0;
+    UINT frameHeight = 0;
+    if (SUCCEEDED(hr))
+    {
+        hr = converter->GetSize(&frameWidth, &frameHeight);
+        if (SUCCEEDED(hr) && ((frameWidth == 0) || (frameHeight == 0) || (frameWidth > kMaxImageSize) || (frameHeight > kMaxImageSize)))
+        {
+            hr = E_FAIL;
+            errors = "The image is empty, or bigger than 16384 on a side";
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        UINT stride = frameWidth * 4;
+        UINT size = stride * frameHeight;
+        rgba.resize(size);
+        hr = converter->CopyPixels(nullptr, stride, size, rgba.data());
+        if (SUCCEEDED(hr))
+        {
+            width = frameWidth;
+            height = frameHeight;
+        }
+        else
+        {
+            rgba.clear();
+            errors = DescribeFailure("Reading the pixels", hr);
+        }
+    }
+
+    SafeRelease(converter);
+    SafeRelease(frame);
+    SafeRelease(decoder);
+    SafeRelease(stream);
+    SafeRelease(factory);
+
+    if (SUCCEEDED(init))
+        CoUninitialize();
+
+    return SUCCEEDED(hr);
+}
@@ -0,0 +1,18 @@
+///
+/// WicImageDecoder.h - Decodes images with the Windows Imaging Component.
+/// WIC handles PNG, JPEG, BMP, TIFF and GIF out of the box (and anything else with a codec
+/// installed), so the texture importer doesn't carry a decoder of its own.
+///
+#pragma once
+
+#include "TextureCache.h"
+
+class WicImageDecoder : public IImageDecoder
+{
+public:
+    virtual const char* GetName() const override;
+
+    // Only the first frame of animated or multi-page images
+    virtual bool Decode(const std::string& contents, std::vector<unsigned char>& rgba,
+                        unsigned int& width, unsigned int& height, std::string& errors) override;
+};
@@ -6,31 +6,32 @@
 #include "AssetManagement\AssetManager.h"
 #include "Resource.h"
 
-//==============================================
-// TODO:
-//   Eventually move this off into a separate utility library
-//   We output any caught memory leaks here.
-//   See details here: https://msdn.microsoft.com/en-us/library/x98tx3cf.aspx
-#if defined(DEBUG) || defined(_DEBUG)
-#define _CRTDBG_MAP_ALLOC
-#define _CRTDBG_MAP_ALLOC_NEW
-#include <stdlib.h>
-#include "crtdbg.h"
-#endif
-//==============================================
-
 #include "utils\utils.h"
-#include "utils\memory.h"
+#include "utils\Profiler.h"
+#include "utils\FrameTelemetry.h"
+#include "utils\JobSystem.h"
+#include "utils\MemoryTracker.h"
+#include "utils\SimdMathDirectX.h"
 
 #include "D3D11.h"
 #include "DirectXMath.h"
 
+#include <atomic>
+#include <math.h>
+
 #include "Graphics\RenderDevice.h"
 #include "Graphics\VisualGrid.h"
 #include "Graphics\Model.h"
 #include "Graphics\ColorShader.h"
+#include "Graphics\DrawBatcher.h"
+#include "Graphics\FrameGraph.h"
+#include "Graphics\TextureStreamer.h"
+#include "Graphics\TransientTexturePool.h"
 
 #include "Camera.h"
+#include "FramePipeline.h"
+
+#include "utils\memory.h"
 
 //--------------------------------------------------------------------------------------
 // Forward declarations
@@ -49,6 +50,17 @@ Camera*         gCamera         = nullptr;
 AssetManager*   gAssetManager   = nullptr;
 HINSTANCE       gHInst          = nullptr;
 HWND            gHWnd	        = nullptr;
+FramePipeline   gFramePipeline;
+JobSystem       gJobs;
+
+// Per stage frame times - simulate on this thread, render and present on the render thread
+FrameTelemetry  gTelemetry;
+unsigned int    gSimulateStage  = gTelemetry.AddStage("simulate");
+unsigned int    gRenderStage    = gTelemetry.AddStage("render");
+unsigned int    gPresentStage   = gTelemetry.AddStage("present");
+
+// Set from WndProc, picked up by the render thread - it owns the device context
+std::atomic<bool> gResizePending(false);
 
 
 int APIENTRY wWinMain(_In_      HINSTANCE hInstance,
@@ -59,11 +71,9 @@ int APIENTRY wWinMain(_In_      HINSTANCE hInstance,
     UNREFERENCED_PARAMETER(hPrevInstance);
     UNREFERENCED_PARAMETER(lpCmdLine);
 
-    // Enable run-time memory check for debug builds.
-    // Again, this should live in a separate library
-#if defined(DEBUG) | defined(_DEBUG)
-    _CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
-#endif
+    // Anything allocated from here on and still around once the statics are gone gets
+    // reported, with its call site where we have one
+    MemoryTracker::ReportLeaksAtExit();
 
     if (FAILED(InitWindow(hInstance, nCmdShow)))
         return 0;
@@ -75,13 +85,86 @@ int APIENTRY wWinMain(_In_      HINSTANCE hInstance,
     MSG msg = {0};
 
     Model* model = gAssetManager->GetModel("lte-orb.fbx");
-    ShaderResource* psShader = gAssetManager->GetShader("basicPS.hlsl");
-    ShaderResource* vsShader = gAssetManager->GetShader("basicVS.hlsl");
+    ShaderResource* psShader = gAssetManager->GetShader("basicPS.hlsl", BPS_Default);
+    ShaderResource* vsShader = gAssetManager->GetShader("instancedVS.hlsl");
     ColorShader colorShader;
-    colorShader.InitShader(gRenderDevice.GetDevice(), gHWnd, vsShader, psShader);
+    colorShader.InitShader(gRenderDevice.GetDevice(), gHWnd, gRenderDevice.GetShaderLayouts(), vsShader, psShader);
+
+    DrawBatcher drawBatcher;
+    drawBatcher.Initialize(gRenderDevice.GetDevice(), 256);
+    drawBatcher.SetInstanceRing(gRenderDevice.GetVertexRing());
+    drawBatcher.SetMaterials(gAssetManager->GetMaterialLibrary());
 
-    DirectX::XMMATRIX world, view, projection;
-    projection  = DirectX::XMMatrixPerspectiveFovLH( DirectX::XMConvertToRadians(45.0f), 800.0f/600.0f, 0.1f, 100.0f );
+    FrameGraph frameGraph;
+    FrameGraphTextureDesc backBufferDesc;
+
+    DirectX::XMMATRIX world;
+    world = DirectX::XMMatrixIdentity();
+
+    // Runs on the render thread, one snapshot behind the simulation. Everything it needs
+    // comes out of the snapshot.
+    auto renderFrame = [&](const RenderSnapshot& snapshot)
+    {
+        MEMORY_TAG(MT_Render);
+
+        // Closed before the present starts, so the two stages don't overlap
+        {
+            FrameTelemetry::ScopedSample renderSample(gTelemetry, gRenderStage);
+
+            if (gResizePending.exchange(false))
+            {
+                PROFILE_SCOPE("ResizeSwapchain");
+                gRenderDevice.ResizeSwapchain(gHWnd);
+            }
+
+            // Reloaded textures are swapped in and streamed ones recreated as their mips come
+            // and go, so this happens here, before anything draws with them
+            {
+                PROFILE_SCOPE("UpdateTextures");
+                gAssetManager->ApplyTextureChanges();
+                for (auto& item : snapshot.Items)
+                    gAssetManager->ReportScreenSize(item.model, item.screenSize);
+                gAssetManager->UpdateStreaming();
+            }
+
+            DirectX::XMMATRIX view = DirectX::XMLoadFloat4x4(&snapshot.View);
+            DirectX::XMMATRIX projection = DirectX::XMLoadFloat4x4(&snapshot.Projection);
+
+            // Describe the frame, then let the graph decide what actually runs
+            frameGraph.Reset();
+            gRenderDevice.GetBackBufferDesc(backBufferDesc);
+            FrameGraphResource backBuffer = frameGraph.Import("BackBuffer", backBufferDesc, gRenderDevice.GetBackBufferTarget());
+
+            frameGraph.AddPass("Scene",
+                [&](FrameGraphBuilder& builder)
+                {
+                    builder.Write(backBuffer);
+                },
+                [&](const FrameGraphResources& resources)
+                {
+                    ID3D11DeviceContext* context = gRenderDevice.GetDeviceContext();
+                    FrameGraphTexture* target = (FrameGraphTexture*)resources.Get(backBuffer);
+                    context->OMSetRenderTargets(1, &target->RenderTargetView, NULL);
+
+                    colorShader.Render(context, world, view, projection);
+                    {
+                        PROFILE_SCOPE("DrawBatcher::Submit");
+                        for (auto& item : snapshot.Items)
+                            drawBatcher.Submit(item.model, DirectX::XMLoadFloat4x4(&item.world));
+                    }
+                    drawBatcher.Flush(context);
+                });
+
+            if (frameGraph.Compile())
+                frameGraph.Execute(gRenderDevice.GetTransientPool());
+        }
+
+        FrameTelemetry::ScopedSample presentSample(gTelemetry, gPresentStage);
+        gRenderDevice.Present();
+    };
+
+    PROFILE_THREAD_NAME("Main");
+    gFramePipeline.Start(renderFrame);
 
     while (WM_QUIT != msg.message)
     {
@@ -93,22 +176,46 @@ int APIENTRY wWinMain(_In_      HINSTANCE hInstance,
         }
         else
         {
+            // Simulate the next frame while the render thread draws the last one
+            PROFILE_SCOPE("SimulateFrame");
+            gTelemetry.BeginFrame();
+            FrameTelemetry::ScopedSample sample(gTelemetry, gSimulateStage);
+            MEMORY_TAG(MT_Scene);
+
+            RenderSnapshot* snapshot = gFramePipeline.BeginFrame();
+
             gCamera->Render();
-            view = gCamera->GetViewMatrix();
-            projection = gCamera->GetProjMatrix();
-            colorShader.Render(gRenderDevice.GetDeviceContext(), world, view, projection);
-            model->Render();
-            gRenderDevice.Present();
+            snapshot->SetCamera(Math::ToXMMatrix(gCamera->GetViewMatrix()), Math::ToXMMatrix(gCamera->GetProjMatrix()));
+            // How big the model is on screen, for texture streaming - it sits at the origin
+            RECT client;
+            GetClientRect(gHWnd, &client);
+            const float* bounds = model->GetBounds();
+            Math::Vec3 eye = gCamera->GetPosition();
+            float dx = bounds[0] - eye.x;
+            float dy = bounds[1] - eye.y;
+            float dz = bounds[2] - eye.z;
+            float screenSize = TextureStreamer::ProjectSphere(sqrtf(dx * dx + dy * dy + dz * dz), bounds[3],
+                                                             gCamera->GetPixelScale((float)(client.bottom - client.top)));
+            snapshot->Add(model, DirectX::XMMatrixIdentity(), screenSize);
+
+            gFramePipeline.EndFrame(snapshot);
+            MemoryTracker::EndFrame();
         }
     }
 
+    gFramePipeline.Stop();
+
+    // Open in about:tracing or ui.perfetto.dev
+    PROFILE_WRITE_TRACE("intro01_trace.json");
+
+    gTelemetry.WriteCsv("intro01_telemetry.csv");
+    gTelemetry.WriteJson("intro01_telemetry.json");
+
     delete gVisualGrid;
     delete gAssetManager;
     delete gCamera;
 
-#if defined(DEBUG) | defined(_DEBUG)
-    _CrtDumpMemoryLeaks();
-#endif
+    gJobs.Shutdown();
 
     return (int)msg.wParam;
 }
@@ -168,13 +275,21 @@ HRESULT InitResources( void )
     gCamera->SetPosition(1.0f, 1.0f, 1.0f);
 
 
+    // Texture imports make their mips and compress on these, and streamed textures read on
+    // them. This thread is worker 0.
+    gJobs.Initialize();
+
     gAssetManager = new AssetManager();
-    gAssetManager->Initialize();
+    gAssetManager->Initialize(gRenderDevice.GetDevice());
+    gAssetManager->SetJobSystem(&gJobs);
     if (!gAssetManager->AddPath("assets\\raw")) 
         return E_FAIL;
     gAssetManager->LoadModel("lte-orb.fbx");
-    gAssetManager->LoadShader("basicPS.hlsl", "ps_5_0", "PSMain");
-    gAssetManager->LoadShader("basicVS.hlsl", "vs_5_0", "VSMain");
+
+    // Built by shadertool - without it the shaders are compiled (or come out of the cache)
+    gAssetManager->LoadShaderPack("shaders.pack");
+    gAssetManager->LoadShader("basicPS.hlsl", "ps_5_0", "PSMain", BPS_Default);
+    gAssetManager->LoadShader("instancedVS.hlsl", "vs_5_0", "VSMain");
 
     return S_OK;
 }
@@ -187,7 +302,9 @@ LRESULT CALLBACK WndProc( HWND _hWnd, UINT _msg, WPARAM _wParam, LPARAM _lParam
     switch(_msg)
     {
     case WM_PAINT:
-        gRenderDevice.Present();
+        // The render thread presents while the pipeline is running
+        if (!gFramePipeline.IsRunning())
+            gRenderDevice.Present();
         break;
 
     case WM_DESTROY:
@@ -207,7 +324,13 @@ LRESULT CALLBACK WndProc( HWND _hWnd, UINT _msg, WPARAM _wParam, LPARAM _lParam
         break;
 
     case WM_SIZE:
-        gRenderDevice.ResizeSwapchain(_hWnd);
+        if ((gCamera != nullptr) && (HIWORD(_lParam) > 0))
+            gCamera->SetAspect((float)LOWORD(_lParam) / (float)HIWORD(_lParam));
+
+        if (gFramePipeline.IsRunning())
+            gResizePending = true;
+        else
+            gRenderDevice.ResizeSwapchain(_hWnd);
         break;
 
     default:
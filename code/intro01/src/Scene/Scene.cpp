@@ -1,13 +1,97 @@
 #include "Scene.h"
+#include "SceneNode.h"
+#include "Graphics\DrawBatcher.h"
+#include "Graphics\TextureStreamer.h"
 #include "utils\assert.h"
 #include "utils\utils.h"
+#include "utils\MemoryTracker.h"
+#include "utils\SimdMathDirectX.h"
+
+#include <math.h>
 
 
 Scene::Scene()
 {
+    MEMORY_TAG(MT_Scene);
+    mRoot = new SceneNode();
 }
 
 
 Scene::~Scene()
 {
+    // The root owns the whole tree
+    delete mRoot;
+    mRoot = nullptr;
+    mNodes.clear();
+}
+
+SceneNode* Scene::CreateNode(SceneNode* parent, Model* model, const DirectX::XMMATRIX& local)
+{
+    MEMORY_TAG(MT_Scene);
+
+    if (parent == nullptr)
+        parent = mRoot;
+
+    SceneNode* node = new SceneNode();
+    node->SetModel(model);
+    node->SetLocalTransform(local);
+    parent->AddChild(node);
+
+    // Parents always exist before their children, so creation order is update order
+    mNodes.push_back(node);
+    return node;
+}
+
+void Scene::Update()
+{
+    mRoot->UpdateWorld();
+    for (auto node : mNodes)
+        node->UpdateWorld();
+}
+
+void Scene::Cull(const DirectX::XMMATRIX& viewProjection, std::vector<SceneNode*>& visible) const
+{
+    Math::Frustum frustum;
+    Math::FrustumFromMatrix(Math::FromXMMatrix(viewProjection), false, frustum);
+    Cull(frustum, visible);
+}
+
+void Scene::Cull(const Math::Frustum& frustum, std::vector<SceneNode*>& visible) const
+{
+    MEMORY_TAG(MT_Scene);
+
+    visible.clear();
+    for (auto node : mNodes)
+    {
+        if (node->GetModel() == nullptr)
+            continue;
+
+        const DirectX::XMFLOAT4& bounds = node->GetWorldBounds();
+        if (Math::FrustumIntersectsSphere(frustum, Math::VectorSet(bounds.x, bounds.y, bounds.z, 1.0f), bounds.w))
+            visible.push_back(node);
+    }
+}
+
+void Scene::Cull(const Math::Frustum& frustum, const Math::Vec3& eye, float pixelScale,
+                 std::vector<SceneNode*>& visible, std::vector<float>& screenSizes) const
+{
+    Cull(frustum, visible);
+
+    MEMORY_TAG(MT_Scene);
+
+    screenSizes.resize(visible.size());
+    for (size_t index = 0; index < visible.size(); index++)
+    {
+        const DirectX::XMFLOAT4& bounds = visible[index]->GetWorldBounds();
+        float dx = bounds.x - eye.x;
+        float dy = bounds.y - eye.y;
+        float dz = bounds.z - eye.z;
+        screenSizes[index] = TextureStreamer::ProjectSphere(sqrtf(dx * dx + dy * dy + dz * dz), bounds.w, pixelScale);
+    }
+}
+
+void Scene::Submit(const std::vector<SceneNode*>& visible, DrawBatcher& batcher)
+{
+    for (auto node : visible)
+        batcher.Submit(node->GetModel(), node->GetWorldTransform());
 }
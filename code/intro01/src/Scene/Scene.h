@@ -1,11 +1,48 @@
 #pragma once
+
+#include <DirectXMath.h>
+
+#include <vector>
+
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class SceneNode;
+class Model;
+class DrawBatcher;
+namespace Math { struct Frustum; struct Vec3; }
+
 class Scene
 {
 public:
     Scene();
     ~Scene();
 
-    void Add(Scene* child);
-    void Remove(Scene* child);
-};
+    SceneNode* GetRoot() const { return mRoot; }
+
+    // New node under parent (the root if null), owned by the scene
+    SceneNode* CreateNode(SceneNode* parent, Model* model, const DirectX::XMMATRIX& local);
+
+    // Recompute every world transform. Nodes are kept parent first, so this is one pass.
+    void Update();
 
+    // Every node with a model whose bounds touch the view frustum
+    void Cull(const DirectX::XMMATRIX& viewProjection, std::vector<SceneNode*>& visible) const;
+
+    // The same with the planes already worked out - Camera::GetFrustum keeps them cached
+    void Cull(const Math::Frustum& frustum, std::vector<SceneNode*>& visible) const;
+
+    // And how many pixels across each visible node's bounds are, in the same order - what
+    // texture streaming wants from culling. pixelScale comes from Camera::GetPixelScale.
+    void Cull(const Math::Frustum& frustum, const Math::Vec3& eye, float pixelScale,
+              std::vector<SceneNode*>& visible, std::vector<float>& screenSizes) const;
+
+    static void Submit(const std::vector<SceneNode*>& visible, DrawBatcher& batcher);
+
+    unsigned int GetNodeCount() const { return (unsigned int)mNodes.size(); }
+    SceneNode* GetNode(unsigned int index) const { return mNodes[index]; }
+
+private:
+    SceneNode*                  mRoot;
+    std::vector<SceneNode*>     mNodes;     // every node but the root, parents before children
+};
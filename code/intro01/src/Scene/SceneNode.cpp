@@ -1,17 +1,72 @@
 #include "SceneNode.h"
+#include "Graphics\Model.h"
+#include "utils\assert.h"
 #include "utils\utils.h"
 
+#include <math.h>
+
 
 const size_t kINITIAL_CHILD_COUNT = 4;
+const unsigned int kNODES_PER_CHUNK = 256;
+
+
+DEFINE_POOLED_NEW(SceneNode, kNODES_PER_CHUNK)
 
 
 SceneNode::SceneNode()
+    : mParent(nullptr)
+    , mModel(nullptr)
 {
     mChildren.reserve(kINITIAL_CHILD_COUNT);
+
+    DirectX::XMStoreFloat4x4(&mLocal, DirectX::XMMatrixIdentity());
+    DirectX::XMStoreFloat4x4(&mWorld, DirectX::XMMatrixIdentity());
+    mWorldBounds = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
 }
 
 
 SceneNode::~SceneNode()
 {
+    for (auto child : mChildren)
+        delete child;
+    mChildren.clear();
+}
+
+void SceneNode::AddChild(SceneNode* child)
+{
+    ASSERT(child != nullptr);
+    ASSERT(child->mParent == nullptr);
+
+    child->mParent = this;
+    mChildren.push_back(child);
+}
+
+void SceneNode::SetLocalTransform(const DirectX::XMMATRIX& local)
+{
+    DirectX::XMStoreFloat4x4(&mLocal, local);
 }
 
+void SceneNode::UpdateWorld()
+{
+    DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&mLocal);
+    if (mParent != nullptr)
+        world = DirectX::XMMatrixMultiply(world, DirectX::XMLoadFloat4x4(&mParent->mWorld));
+
+    DirectX::XMStoreFloat4x4(&mWorld, world);
+
+    if (mModel == nullptr)
+        return;
+
+    // Move the model's sphere into world space. The radius grows with the largest scale axis.
+    const float* bounds = mModel->GetBounds();
+    DirectX::XMVECTOR center = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(bounds[0], bounds[1], bounds[2], 1.0f), world);
+
+    float scaleX = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[0]));
+    float scaleY = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[1]));
+    float scaleZ = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[2]));
+    float largest = (scaleX > scaleY) ? scaleX : scaleY;
+    largest = (largest > scaleZ) ? largest : scaleZ;
+    float scale = sqrtf(largest);
+
+    DirectX::XMStoreFloat4(&mWorldBounds, DirectX::XMVectorSetW(center, bounds[3] * scale));
+}
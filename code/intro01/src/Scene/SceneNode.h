@@ -1,14 +1,50 @@
 #pragma once
 
+#include "utils\ObjectPool.h"
+
+#include <DirectXMath.h>
+
 #include <vector>
 
+// ======================================================================================
+// Forward Declarations - so the header file doesn't have to #include anything
+// ======================================================================================
+class Model;
+
 class SceneNode
 {
+    DECLARE_POOLED_NEW(SceneNode)
+
 public:
     SceneNode();
     ~SceneNode();
 
+    // Takes ownership of the child
+    void AddChild(SceneNode* child);
+
+    void SetLocalTransform(const DirectX::XMMATRIX& local);
+    DirectX::XMMATRIX GetLocalTransform() const { return DirectX::XMLoadFloat4x4(&mLocal); }
+    DirectX::XMMATRIX GetWorldTransform() const { return DirectX::XMLoadFloat4x4(&mWorld); }
+
+    void SetModel(Model* model) { mModel = model; }
+    Model* GetModel() const { return mModel; }
+
+    SceneNode* GetParent() const { return mParent; }
+
+    // Recompute the world transform and bounds from the parent's, which must be current
+    void UpdateWorld();
+
+    // World space bounding sphere - center x, y, z and radius
+    const DirectX::XMFLOAT4& GetWorldBounds() const { return mWorldBounds; }
+
 public:
-    std::vector<SceneNode> mChildren;
-};
+    std::vector<SceneNode*> mChildren;
+
+private:
+    SceneNode*              mParent;
+    Model*                  mModel;
 
+    DirectX::XMFLOAT4X4     mLocal;
+    DirectX::XMFLOAT4X4     mWorld;
+    DirectX::XMFLOAT4       mWorldBounds;
+};
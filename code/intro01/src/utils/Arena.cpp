@@ -0,0 +1,190 @@
+///
+/// Arena.cpp - Linear allocators for transient data.
+///
+
+#include "Arena.h"
+
+#include "utils\assert.h"
+
+#include <stdint.h>
+
+// Scratch arenas start small - most threads barely touch them
+const size_t kScratchBlockSize = 256 * 1024;
+
+// Block headers are padded so the data after them starts aligned
+const size_t kBlockHeaderSize = 64;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// ======================================================================================
+// LinearArena
+// ======================================================================================
+LinearArena::LinearArena(size_t blockSize)
+    : mFirst(nullptr)
+    , mCurrent(nullptr)
+    , mUsedBefore(0)
+    , mBlockSize(blockSize)
+    , mPeak(0)
+    , mBlockAllocations(0)
+{
+}
+
+LinearArena::~LinearArena()
+{
+    Release();
+}
+
+LinearArena::Block* LinearArena::CreateBlock(size_t size)
+{
+    char* memory = new char[kBlockHeaderSize + size];
+    if (memory == nullptr)
+        return nullptr;
+
+    Block* block = (Block*)memory;
+    block->Next = nullptr;
+    block->Size = size;
+    block->Used = 0;
+
+    mBlockAllocations++;
+    return block;
+}
+
+void* LinearArena::Fit(Block* block, size_t size, size_t alignment)
+{
+    uintptr_t data = (uintptr_t)block + kBlockHeaderSize;
+    uintptr_t start = AlignUp(data + block->Used, alignment);
+    if (start + size > data + block->Size)
+        return nullptr;
+
+    block->Used = (start + size) - data;
+    return (void*)start;
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+    ASSERT((alignment & (alignment - 1)) == 0);
+
+    void* result = (mCurrent != nullptr) ? Fit(mCurrent, size, alignment) : nullptr;
+
+    // Move on through any spare blocks left after a Rewind, then chain a new one on
+    while (result == nullptr)
+    {
+        Block* next = (mCurrent != nullptr) ? mCurrent->Next : mFirst;
+        if (next == nullptr)
+        {
+            size_t needed = size + alignment;
+            next = CreateBlock((needed > mBlockSize) ? needed : mBlockSize);
+            if (next == nullptr)
+                return nullptr;
+
+            if (mCurrent != nullptr)
+                mCurrent->Next = next;
+            else
+                mFirst = next;
+        }
+
+        if (mCurrent != nullptr)
+            mUsedBefore += mCurrent->Used;
+
+        mCurrent = next;
+        mCurrent->Used = 0;
+        result = Fit(mCurrent, size, alignment);
+    }
+
+    size_t used = mUsedBefore + mCurrent->Used;
+    mPeak = (used > mPeak) ? used : mPeak;
+    return result;
+}
+
+LinearArena::Marker LinearArena::GetMarker() const
+{
+    Marker marker;
+    marker.Block = mCurrent;
+    marker.Used = (mCurrent != nullptr) ? mCurrent->Used : 0;
+    marker.UsedBefore = mUsedBefore;
+    return marker;
+}
+
+void LinearArena::Rewind(const Marker& marker)
+{
+    // Blocks past the marker stay chained on as spares
+    mCurrent = (Block*)marker.Block;
+    mUsedBefore = marker.UsedBefore;
+    if (mCurrent != nullptr)
+        mCurrent->Used = marker.Used;
+}
+
+void LinearArena::Reset()
+{
+    if ((mFirst != nullptr) && (mFirst->Next != nullptr))
+    {
+        // Outgrew the first block - swap the chain for one block that holds the lot
+        size_t capacity = GetCapacity();
+        Release();
+
+        mFirst = CreateBlock(capacity);
+        mBlockSize = (capacity > mBlockSize) ? capacity : mBlockSize;
+    }
+
+    mCurrent = nullptr;
+    mUsedBefore = 0;
+}
+
+void LinearArena::Release()
+{
+    Block* block = mFirst;
+    while (block != nullptr)
+    {
+        Block* next = block->Next;
+        delete[] (char*)block;
+        block = next;
+    }
+
+    mFirst = nullptr;
+    mCurrent = nullptr;
+    mUsedBefore = 0;
+}
+
+size_t LinearArena::GetCapacity() const
+{
+    size_t capacity = 0;
+    for (Block* block = mFirst; block != nullptr; block = block->Next)
+        capacity += block->Size;
+    return capacity;
+}
+
+unsigned int LinearArena::GetBlockCount() const
+{
+    unsigned int count = 0;
+    for (Block* block = mFirst; block != nullptr; block = block->Next)
+        count++;
+    return count;
+}
+
+// ======================================================================================
+// FrameArena
+// ======================================================================================
+FrameArena::FrameArena(size_t blockSize)
+    : mFrame(0)
+{
+    for (auto& arena : mArenas)
+        arena.SetBlockSize(blockSize);
+}
+
+void FrameArena::BeginFrame()
+{
+    mFrame = (mFrame + 1) % kFrameCount;
+    mArenas[mFrame].Reset();
+}
+
+// ======================================================================================
+// Scratch
+// ======================================================================================
+LinearArena& GetScratchArena()
+{
+    static thread_local LinearArena scratch(kScratchBlockSize);
+    return scratch;
+}
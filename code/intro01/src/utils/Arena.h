@@ -0,0 +1,177 @@
+///
+/// Arena.h - Linear allocators for transient data.
+/// A LinearArena hands out memory by bumping a pointer and frees it all at once, by
+/// rewinding to a marker or resetting. When a block fills up another is chained on; the
+/// next Reset folds them all into one block big enough for the lot, so once the arena has
+/// seen its worst frame it never goes back to the heap.
+///
+///     FrameArena          - one arena per frame in flight, reset as the frame comes round again
+///     GetScratchArena()   - a per thread arena for temporaries, used with an ArenaScope
+///     ArenaAllocator      - lets standard containers live in an arena
+///
+///     ArenaScope scratch(GetScratchArena());
+///     ArenaVector<unsigned int> indices(ArenaAllocator<unsigned int>(scratch.GetArena()));
+///
+/// Nothing in an arena gets its destructor run - only put things in there that don't need one,
+/// or containers that are destroyed before the arena is rewound.
+///
+#pragma once
+
+#include <stddef.h>
+#include <type_traits>
+#include <vector>
+
+class LinearArena
+{
+public:
+    static const size_t kDefaultBlockSize   = 64 * 1024;
+    static const size_t kDefaultAlignment   = 16;
+
+    // Where the arena was up to - hand it back to Rewind to free everything allocated since
+    struct Marker
+    {
+        void*   Block;
+        size_t  Used;
+        size_t  UsedBefore;
+    };
+
+private:
+    struct Block
+    {
+        Block*  Next;
+        size_t  Size;
+        size_t  Used;
+    };
+
+public:
+    // The first block isn't allocated until something is allocated from the arena
+    LinearArena(size_t blockSize = kDefaultBlockSize);
+    ~LinearArena();
+
+    void* Allocate(size_t size, size_t alignment = kDefaultAlignment);
+
+    template <typename T>
+    T* AllocateArray(size_t count) { return (T*)Allocate(count * sizeof(T), alignof(T)); }
+
+    Marker GetMarker() const;
+    void Rewind(const Marker& marker);
+
+    // Frees everything. Overflow blocks are merged into one here, never mid-frame.
+    void Reset();
+
+    // Gives every block back to the heap
+    void Release();
+
+    // Size of the blocks allocated from now on
+    void SetBlockSize(size_t blockSize) { mBlockSize = blockSize; }
+
+    size_t GetUsed() const { return (mCurrent != nullptr) ? mUsedBefore + mCurrent->Used : 0; }
+    size_t GetCapacity() const;
+    size_t GetPeak() const { return mPeak; }
+    unsigned int GetBlockCount() const;
+
+    // Blocks allocated since the arena was created - should stop climbing once it has warmed up
+    unsigned long long GetBlockAllocations() const { return mBlockAllocations; }
+
+private:
+    LinearArena(const LinearArena&);
+    LinearArena& operator=(const LinearArena&);
+
+    Block* CreateBlock(size_t size);
+    static void* Fit(Block* block, size_t size, size_t alignment);
+
+private:
+    Block*              mFirst;
+    Block*              mCurrent;
+    size_t              mUsedBefore;        // bytes used in the blocks before mCurrent
+    size_t              mBlockSize;
+    size_t              mPeak;
+    unsigned long long  mBlockAllocations;
+};
+
+// Rewinds the arena to wherever it was when the scope was opened
+class ArenaScope
+{
+public:
+    ArenaScope(LinearArena& arena) : mArena(arena), mMarker(arena.GetMarker()) {}
+    ~ArenaScope() { mArena.Rewind(mMarker); }
+
+    LinearArena* GetArena() const { return &mArena; }
+
+private:
+    ArenaScope(const ArenaScope&);
+    ArenaScope& operator=(const ArenaScope&);
+
+private:
+    LinearArena&        mArena;
+    LinearArena::Marker mMarker;
+};
+
+// One arena per frame in flight. Memory from Allocate stays valid until BeginFrame has been
+// called kFrameCount more times - long enough for the render thread to consume it.
+class FrameArena
+{
+public:
+    static const unsigned int kFrameCount = 2;
+
+    FrameArena(size_t blockSize = LinearArena::kDefaultBlockSize);
+
+    // Moves on to the next frame's arena and resets it
+    void BeginFrame();
+
+    void* Allocate(size_t size, size_t alignment = LinearArena::kDefaultAlignment) { return mArenas[mFrame].Allocate(size, alignment); }
+    LinearArena* GetArena() { return &mArenas[mFrame]; }
+
+private:
+    LinearArena     mArenas[kFrameCount];
+    unsigned int    mFrame;
+};
+
+// This thread's scratch arena. Always open an ArenaScope on it - whoever called you may
+// have live allocations in it too.
+LinearArena& GetScratchArena();
+
+// Standard allocator on top of an arena. Deallocation does nothing - the memory comes back
+// when the arena is rewound. Without an arena it falls back to the global heap.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator() : mArena(nullptr) {}
+    ArenaAllocator(LinearArena* arena) : mArena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : mArena(other.GetArena()) {}
+
+    T* allocate(size_t count)
+    {
+        if (mArena == nullptr)
+            return (T*)::operator new(count * sizeof(T));
+        return mArena->AllocateArray<T>(count);
+    }
+
+    void deallocate(T* pointer, size_t)
+    {
+        if (mArena == nullptr)
+            ::operator delete(pointer);
+    }
+
+    LinearArena* GetArena() const { return mArena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return mArena == other.GetArena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return mArena != other.GetArena(); }
+
+private:
+    LinearArena* mArena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
@@ -0,0 +1,249 @@
+///
+/// FrameTelemetry.cpp - Per stage frame time statistics.
+///
+
+#include "FrameTelemetry.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Bucket 0 ends at kBucketStart, each bucket after that is kBucketGrowth times wider.
+// 80 buckets reach a bit over three seconds.
+const double kBucketStart   = 0.05;
+const double kBucketGrowth  = 1.15;
+
+FrameTelemetry::FrameTelemetry()
+    : mStageCount(0)
+    , mFrameStarted(false)
+{
+    memset(mStages, 0, sizeof(mStages));
+    AddStage("frame");
+}
+
+unsigned int FrameTelemetry::AddStage(const char* name)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mStageCount == kMaxStages)
+        return kInvalidStage;
+
+    mStages[mStageCount].Name = name;
+    return mStageCount++;
+}
+
+void FrameTelemetry::BeginFrame()
+{
+    Clock::time_point now = Clock::now();
+    if (mFrameStarted)
+        Record(kFrameStage, std::chrono::duration<double, std::milli>(now - mFrameStart).count());
+
+    mFrameStart = now;
+    mFrameStarted = true;
+}
+
+void FrameTelemetry::Record(unsigned int stage, double milliseconds)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (stage >= mStageCount)
+        return;
+
+    Stage& entry = mStages[stage];
+    entry.History[entry.Next] = milliseconds;
+    entry.Next = (entry.Next + 1) % kHistoryFrames;
+    entry.Count++;
+    entry.Total += milliseconds;
+    entry.Last = milliseconds;
+    entry.Max = (milliseconds > entry.Max) ? milliseconds : entry.Max;
+    entry.Buckets[GetBucket(milliseconds)]++;
+}
+
+double FrameTelemetry::GetBucketLimit(unsigned int bucket)
+{
+    return kBucketStart * pow(kBucketGrowth, (double)bucket);
+}
+
+unsigned int FrameTelemetry::GetBucket(double milliseconds)
+{
+    if (milliseconds <= kBucketStart)
+        return 0;
+
+    double bucket = ceil(log(milliseconds / kBucketStart) / log(kBucketGrowth));
+    return (bucket >= kBucketCount - 1) ? kBucketCount - 1 : (unsigned int)bucket;
+}
+
+FrameTelemetry::Stats FrameTelemetry::GetStats(unsigned int stage) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return GetStatsLocked(stage);
+}
+
+FrameTelemetry::Stats FrameTelemetry::GetStatsLocked(unsigned int stage) const
+{
+    Stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (stage >= mStageCount)
+        return stats;
+
+    const Stage& entry = mStages[stage];
+    stats.Count = entry.Count;
+    if (entry.Count == 0)
+        return stats;
+
+    stats.Last = entry.Last;
+    stats.Mean = entry.Total / entry.Count;
+    stats.Max = entry.Max;
+
+    // Nearest rank, reported as the upper edge of the bucket it lands in - never past the max
+    double percentiles[3] = { 0.50, 0.90, 0.99 };
+    double* results[3] = { &stats.P50, &stats.P90, &stats.P99 };
+
+    for (unsigned int index = 0; index < 3; index++)
+    {
+        unsigned long long rank = (unsigned long long)ceil(percentiles[index] * entry.Count);
+        unsigned long long seen = 0;
+        for (unsigned int bucket = 0; bucket < kBucketCount; bucket++)
+        {
+            seen += entry.Buckets[bucket];
+            if (seen >= rank)
+            {
+                double limit = GetBucketLimit(bucket);
+                *results[index] = (limit < entry.Max) ? limit : entry.Max;
+                break;
+            }
+        }
+    }
+
+    return stats;
+}
+
+FrameTelemetry::Stats FrameTelemetry::GetRecentStats(unsigned int stage) const
+{
+    Stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (stage >= mStageCount)
+        return stats;
+
+    double samples[kHistoryFrames];
+    unsigned int count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        const Stage& entry = mStages[stage];
+        count = (entry.Count < kHistoryFrames) ? (unsigned int)entry.Count : kHistoryFrames;
+        memcpy(samples, entry.History, count * sizeof(double));
+        stats.Last = entry.Last;
+    }
+
+    stats.Count = count;
+    if (count == 0)
+        return stats;
+
+    std::sort(samples, samples + count);
+
+    double total = 0.0;
+    for (unsigned int index = 0; index < count; index++)
+        total += samples[index];
+
+    stats.Mean = total / count;
+    stats.Max = samples[count - 1];
+    stats.P50 = samples[(unsigned int)ceil(0.50 * count) - 1];
+    stats.P90 = samples[(unsigned int)ceil(0.90 * count) - 1];
+    stats.P99 = samples[(unsigned int)ceil(0.99 * count) - 1];
+
+    return stats;
+}
+
+void FrameTelemetry::Reset()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    for (unsigned int index = 0; index < mStageCount; index++)
+    {
+        const char* name = mStages[index].Name;
+        memset(&mStages[index], 0, sizeof(Stage));
+        mStages[index].Name = name;
+    }
+
+    mFrameStarted = false;
+}
+
+bool FrameTelemetry::WriteCsv(const char* filename) const
+{
+    FILE* file = fopen(filename, "w");
+    if (file == nullptr)
+        return false;
+
+    // Summary table, then the histogram with a column per stage
+    fprintf(file, "stage,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,recent_p50_ms,recent_p90_ms,recent_p99_ms,recent_max_ms\n");
+    for (unsigned int stage = 0; stage < mStageCount; stage++)
+    {
+        Stats stats = GetStats(stage);
+        Stats recent = GetRecentStats(stage);
+        fprintf(file, "%s,%llu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", mStages[stage].Name, stats.Count,
+                stats.Mean, stats.P50, stats.P90, stats.P99, stats.Max, recent.P50, recent.P90, recent.P99, recent.Max);
+    }
+
+    fprintf(file, "\nbucket_limit_ms");
+    for (unsigned int stage = 0; stage < mStageCount; stage++)
+        fprintf(file, ",%s", mStages[stage].Name);
+    fprintf(file, "\n");
+
+    std::lock_guard<std::mutex> lock(mLock);
+    for (unsigned int bucket = 0; bucket < kBucketCount; bucket++)
+    {
+        fprintf(file, "%.4f", GetBucketLimit(bucket));
+        for (unsigned int stage = 0; stage < mStageCount; stage++)
+            fprintf(file, ",%llu", mStages[stage].Buckets[bucket]);
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+    return true;
+}
+
+static void WriteJsonStats(FILE* file, const FrameTelemetry::Stats& stats)
+{
+    fprintf(file, "{\"count\":%llu,\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p90_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f}",
+            stats.Count, stats.Mean, stats.P50, stats.P90, stats.P99, stats.Max);
+}
+
+bool FrameTelemetry::WriteJson(const char* filename) const
+{
+    FILE* file = fopen(filename, "w");
+    if (file == nullptr)
+        return false;
+
+    fprintf(file, "{\n  \"stages\": [\n");
+    for (unsigned int stage = 0; stage < mStageCount; stage++)
+    {
+        fprintf(file, "    {\n      \"name\": \"%s\",\n      \"run\": ", mStages[stage].Name);
+        WriteJsonStats(file, GetStats(stage));
+        fprintf(file, ",\n      \"recent\": ");
+        WriteJsonStats(file, GetRecentStats(stage));
+
+        // Only the buckets that have something in them
+        fprintf(file, ",\n      \"histogram\": [");
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+
+            bool first = true;
+            for (unsigned int bucket = 0; bucket < kBucketCount; bucket++)
+            {
+                unsigned long long count = mStages[stage].Buckets[bucket];
+                if (count == 0)
+                    continue;
+
+                fprintf(file, "%s{\"limit_ms\":%.4f,\"count\":%llu}", first ? "" : ",", GetBucketLimit(bucket), count);
+                first = false;
+            }
+        }
+        fprintf(file, "]\n    }%s\n", (stage + 1 < mStageCount) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    fclose(file);
+    return true;
+}
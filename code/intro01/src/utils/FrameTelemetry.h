@@ -0,0 +1,115 @@
+///
+/// FrameTelemetry.h - Per stage frame time statistics.
+/// Every sample goes into two places: a ring holding the last kHistoryFrames samples, which
+/// gives exact percentiles for recent frames, and a log spaced histogram covering the whole
+/// run, which gives percentiles to within one bucket (about 15%) without keeping every
+/// sample. Averages hide hitches - look at p99 and max.
+///
+///     unsigned int update = telemetry.AddStage("update");
+///     ...
+///     telemetry.BeginFrame();
+///     {
+///         FrameTelemetry::ScopedSample sample(telemetry, update);
+///         Update();
+///     }
+///
+/// Samples can be recorded from any thread.
+///
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+class FrameTelemetry
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const unsigned int kMaxStages        = 16;
+    static const unsigned int kHistoryFrames    = 1024;
+    static const unsigned int kBucketCount      = 80;
+
+    // Stage 0 is always there - the time from one BeginFrame to the next
+    static const unsigned int kFrameStage       = 0;
+    static const unsigned int kInvalidStage     = 0xffffffff;
+
+    // All in milliseconds
+    struct Stats
+    {
+        unsigned long long  Count;
+        double              Last;
+        double              Mean;
+        double              P50;
+        double              P90;
+        double              P99;
+        double              Max;
+    };
+
+    // Times a stage from construction to destruction
+    class ScopedSample
+    {
+    public:
+        ScopedSample(FrameTelemetry& telemetry, unsigned int stage) : mTelemetry(telemetry), mStage(stage), mStart(Clock::now()) {}
+        ~ScopedSample() { mTelemetry.Record(mStage, std::chrono::duration<double, std::milli>(Clock::now() - mStart).count()); }
+
+    private:
+        FrameTelemetry&     mTelemetry;
+        unsigned int        mStage;
+        Clock::time_point   mStart;
+    };
+
+private:
+    struct Stage
+    {
+        const char*         Name;
+        double              History[kHistoryFrames];
+        unsigned int        Next;
+        unsigned long long  Count;
+        double              Total;
+        double              Last;
+        double              Max;
+        unsigned long long  Buckets[kBucketCount];
+    };
+
+public:
+    FrameTelemetry();
+
+    // The name has to outlive the telemetry. Returns kInvalidStage once kMaxStages are in use.
+    unsigned int AddStage(const char* name);
+    unsigned int GetStageCount() const { return mStageCount; }
+    const char* GetStageName(unsigned int stage) const { return mStages[stage].Name; }
+
+    // Records the frame stage
+    void BeginFrame();
+
+    void Record(unsigned int stage, double milliseconds);
+
+    // Since the start of the run, percentiles from the histogram
+    Stats GetStats(unsigned int stage) const;
+
+    // Exact, over the last kHistoryFrames samples
+    Stats GetRecentStats(unsigned int stage) const;
+
+    // Clears every sample, keeping the stages
+    void Reset();
+
+    bool WriteCsv(const char* filename) const;
+    bool WriteJson(const char* filename) const;
+
+    // Upper edge of a histogram bucket. The last bucket also holds everything above it.
+    static double GetBucketLimit(unsigned int bucket);
+
+private:
+    static unsigned int GetBucket(double milliseconds);
+
+    Stats GetStatsLocked(unsigned int stage) const;
+
+private:
+    Stage                   mStages[kMaxStages];
+    unsigned int            mStageCount;
+
+    bool                    mFrameStarted;
+    Clock::time_point       mFrameStart;
+
+    mutable std::mutex      mLock;
+};
@@ -0,0 +1,497 @@
+///
+/// JobSystem.cpp - Work stealing job scheduler.
+///
+
+#include "JobSystem.h"
+
+#include "utils\assert.h"
+#include "utils\Profiler.h"
+
+#include <chrono>
+
+// Which worker the current thread is, and whose
+static thread_local unsigned int        tWorkerIndex    = JobSystem::kInvalidWorker;
+static thread_local const JobSystem*    tJobSystem      = nullptr;
+
+// How many times an idle worker looks for work before it goes to sleep
+const unsigned int kIdleSpinCount = 64;
+
+// ======================================================================================
+// JobDeque
+// Follows "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013)
+// ======================================================================================
+JobDeque::JobDeque()
+    : mTop(0)
+    , mBottom(0)
+{
+    for (unsigned int index = 0; index < kCapacity; index++)
+        mJobs[index].store(nullptr, std::memory_order_relaxed);
+}
+
+bool JobDeque::Push(Job* job)
+{
+    long long bottom = mBottom.load(std::memory_order_relaxed);
+    long long top = mTop.load(std::memory_order_acquire);
+
+    if (bottom - top >= (long long)kCapacity)
+        return false;
+
+    // Release so a thief that sees the new bottom also sees the job's contents
+    mJobs[bottom & (kCapacity - 1)].store(job, std::memory_order_relaxed);
+    mBottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* JobDeque::Pop()
+{
+    long long bottom = mBottom.load(std::memory_order_relaxed) - 1;
+    mBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long top = mTop.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Empty
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = mJobs[bottom & (kCapacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // Last job - race any thieves for it
+        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+Job* JobDeque::Steal()
+{
+    long long top = mTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long bottom = mBottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+        return nullptr;
+
+    Job* job = mJobs[top & (kCapacity - 1)].load(std::memory_order_relaxed);
+    if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return job;
+}
+
+bool JobDeque::IsEmpty() const
+{
+    return mTop.load(std::memory_order_relaxed) >= mBottom.load(std::memory_order_relaxed);
+}
+
+// ======================================================================================
+// JobSystem
+// ======================================================================================
+JobSystem::JobSystem()
+    : mThreadCount(0)
+    , mInjectedCount(0)
+    , mRunning(false)
+    , mSleeping(0)
+{
+}
+
+JobSystem::~JobSystem()
+{
+    Shutdown();
+}
+
+bool JobSystem::Initialize(unsigned int threadCount)
+{
+    ASSERT(mThreadCount == 0);
+
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+
+    mThreadCount = threadCount;
+    for (unsigned int index = 0; index < mThreadCount; index++)
+    {
+        Worker* worker = new Worker();
+        worker->JobPool = new Job[kJobPoolSize];
+        worker->NextJob = 0;
+        worker->Random = 0x9e3779b9u * (index + 1);
+        worker->JobsExecuted = 0;
+        worker->Steals = 0;
+        worker->FailedSteals = 0;
+        worker->InlineJobs = 0;
+        mWorkers.push_back(worker);
+    }
+
+    // The calling thread is worker 0
+    tWorkerIndex = 0;
+    tJobSystem = this;
+
+    mRunning = true;
+    for (unsigned int index = 1; index < mThreadCount; index++)
+        mThreads.push_back(std::thread(&JobSystem::WorkerMain, this, index));
+
+    return true;
+}
+
+void JobSystem::Shutdown()
+{
+    if (mThreadCount == 0)
+        return;
+
+    mRunning = false;
+    {
+        std::lock_guard<std::mutex> lock(mSleepLock);
+        mSleepSignal.notify_all();
+    }
+
+    for (auto& thread : mThreads)
+        thread.join();
+    mThreads.clear();
+
+    for (auto worker : mWorkers)
+    {
+        delete[] worker->JobPool;
+        delete worker;
+    }
+    mWorkers.clear();
+
+    // Like anything left on the deques, injected jobs nobody got to are dropped
+    mInjected.clear();
+    mInjectedCount = 0;
+
+    if (tJobSystem == this)
+    {
+        tWorkerIndex = kInvalidWorker;
+        tJobSystem = nullptr;
+    }
+
+    mThreadCount = 0;
+}
+
+unsigned int JobSystem::GetWorkerIndex() const
+{
+    return (tJobSystem == this) ? tWorkerIndex : kInvalidWorker;
+}
+
+void JobSystem::Run(JobFunction function, const void* context, unsigned int begin, unsigned int end,
+                    JobCounter* counter, JobCounter* dependency)
+{
+    Job job = { function, context, begin, end, counter, 0 };
+
+    if (counter != nullptr)
+        counter->Value.fetch_add(1);
+
+    if ((dependency != nullptr) && HoldUntilDone(dependency, job))
+        return;
+
+    unsigned int index = GetWorkerIndex();
+    if (index != kInvalidWorker)
+    {
+        Push(mWorkers[index], job);
+        return;
+    }
+
+    // Not one of our threads, so there's no deque to push to. With no workers besides the
+    // one that called Initialize, nothing is sure to take it off the shared queue.
+    if (mThreadCount > 1)
+    {
+        Inject(job);
+        return;
+    }
+
+    function(context, begin, end);
+    if (counter != nullptr)
+        counter->Value.fetch_sub(1);
+}
+
+void JobSystem::RunSplit(JobFunction function, const void* context, unsigned int count, JobCounter* counter, unsigned int grain)
+{
+    // The function object lives on the caller's stack, so the caller has to wait on the counter
+    ASSERT(counter != nullptr);
+
+    if (count == 0)
+        return;
+
+    // Not one of our threads, or before Initialize - there's no deque to push to, and no
+    // thread count to pick a grain from
+    unsigned int index = GetWorkerIndex();
+    if ((index == kInvalidWorker) || (mThreadCount == 0))
+    {
+        function(context, 0, count);
+        return;
+    }
+
+    // Aim for a handful of ranges per thread - enough to balance the load without the
+    // scheduling costing more than the work
+    if (grain == 0)
+    {
+        grain = count / (mThreadCount * 8);
+        if (grain == 0)
+            grain = 1;
+    }
+
+    Job job = { function, context, 0, count, counter, grain };
+    counter->Value.fetch_add(1);
+    Push(mWorkers[index], job);
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+    unsigned int index = GetWorkerIndex();
+
+    while (!counter->IsDone())
+    {
+        Job* job = (index != kInvalidWorker) ? FindJob(mWorkers[index]) : nullptr;
+        if (job != nullptr)
+            Execute(mWorkers[index], job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+JobSystem::Stats JobSystem::GetStats() const
+{
+    Stats stats = { 0, 0, 0, 0 };
+    for (auto worker : mWorkers)
+    {
+        stats.JobsExecuted += worker->JobsExecuted.load(std::memory_order_relaxed);
+        stats.Steals += worker->Steals.load(std::memory_order_relaxed);
+        stats.FailedSteals += worker->FailedSteals.load(std::memory_order_relaxed);
+        stats.InlineJobs += worker->InlineJobs.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void JobSystem::ResetStats()
+{
+    for (auto worker : mWorkers)
+    {
+        worker->JobsExecuted = 0;
+        worker->Steals = 0;
+        worker->FailedSteals = 0;
+        worker->InlineJobs = 0;
+    }
+}
+
+Job* JobSystem::AllocateJob(Worker* worker)
+{
+    Job* job = &worker->JobPool[worker->NextJob & (kJobPoolSize - 1)];
+    worker->NextJob++;
+    return job;
+}
+
+void JobSystem::Push(Worker* worker, const Job& job)
+{
+    Job* queued = AllocateJob(worker);
+    *queued = job;
+
+    if (!worker->Deque.Push(queued))
+    {
+        // Deque is full - doing it now is better than waiting for room
+        worker->InlineJobs.fetch_add(1, std::memory_order_relaxed);
+        Execute(worker, queued);
+        return;
+    }
+
+    WakeWorkers();
+}
+
+void JobSystem::Execute(Worker* worker, Job* job)
+{
+    // Lazy binary splitting: hand the top half back to the deque for someone to steal,
+    // keep going with the bottom half
+    while ((job->Grain > 0) && (job->End - job->Begin > job->Grain))
+    {
+        unsigned int middle = job->Begin + ((job->End - job->Begin) / 2);
+        Job half = { job->Function, job->Context, middle, job->End, job->Counter, job->Grain };
+        job->End = middle;
+
+        if (half.Counter != nullptr)
+            half.Counter->Value.fetch_add(1);
+        Push(worker, half);
+    }
+
+    job->Function(job->Context, job->Begin, job->End);
+    worker->JobsExecuted.fetch_add(1, std::memory_order_relaxed);
+
+    Finish(worker, job->Counter);
+}
+
+void JobSystem::Finish(Worker* worker, JobCounter* counter)
+{
+    if (counter == nullptr)
+        return;
+
+    int value = counter->Value.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        if (value & JobCounter::kLockBit)
+        {
+            // Someone is adding a continuation
+            std::this_thread::yield();
+            value = counter->Value.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (value > 1)
+        {
+            if (counter->Value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel))
+                return;
+            continue;
+        }
+
+        // Last job - swap the count for the lock bit so we can take the continuations
+        if (counter->Value.compare_exchange_weak(value, JobCounter::kLockBit, std::memory_order_acq_rel))
+            break;
+    }
+
+    std::vector<Job> continuations;
+    continuations.swap(counter->Continuations);
+
+    // Waiters may free the counter as soon as this lands
+    counter->Value.store(0, std::memory_order_release);
+
+    for (auto& continuation : continuations)
+        Push(worker, continuation);
+}
+
+bool JobSystem::HoldUntilDone(JobCounter* dependency, const Job& job)
+{
+    int value = dependency->Value.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        if (value == 0)
+            return false;
+
+        if (value & JobCounter::kLockBit)
+        {
+            std::this_thread::yield();
+            value = dependency->Value.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (dependency->Value.compare_exchange_weak(value, value | JobCounter::kLockBit, std::memory_order_acquire))
+            break;
+    }
+
+    // Finish can't take the list while the lock bit is set
+    dependency->Continuations.push_back(job);
+    dependency->Value.fetch_and(~JobCounter::kLockBit, std::memory_order_release);
+    return true;
+}
+
+Job* JobSystem::FindJob(Worker* worker)
+{
+    Job* job = worker->Deque.Pop();
+    if (job != nullptr)
+        return job;
+
+    job = TakeInjected(worker);
+    if (job != nullptr)
+        return job;
+
+    if (mThreadCount < 2)
+        return nullptr;
+
+    // Start at a random victim so thieves spread out
+    worker->Random ^= worker->Random << 13;
+    worker->Random ^= worker->Random >> 17;
+    worker->Random ^= worker->Random << 5;
+
+    unsigned int start = worker->Random % mThreadCount;
+    for (unsigned int attempt = 0; attempt < mThreadCount; attempt++)
+    {
+        Worker* victim = mWorkers[(start + attempt) % mThreadCount];
+        if (victim == worker)
+            continue;
+
+        job = victim->Deque.Steal();
+        if (job != nullptr)
+        {
+            worker->Steals.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    worker->FailedSteals.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void JobSystem::Inject(const Job& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mInjectedLock);
+        mInjected.push_back(job);
+        mInjectedCount.fetch_add(1, std::memory_order_release);
+    }
+
+    WakeWorkers();
+}
+
+Job* JobSystem::TakeInjected(Worker* worker)
+{
+    // Checked without the lock - the queue is empty nearly all the time
+    if (mInjectedCount.load(std::memory_order_acquire) == 0)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(mInjectedLock);
+    if (mInjected.empty())
+        return nullptr;
+
+    // Oldest first. It moves into the worker's own pool, as if the worker had queued it.
+    Job* job = AllocateJob(worker);
+    *job = mInjected.front();
+    mInjected.erase(mInjected.begin());
+    mInjectedCount.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::WorkerMain(unsigned int index)
+{
+    tWorkerIndex = index;
+    tJobSystem = this;
+    PROFILE_THREAD_NAME("Job Worker");
+
+    Worker* worker = mWorkers[index];
+    unsigned int idle = 0;
+
+    while (mRunning.load(std::memory_order_relaxed))
+    {
+        Job* job = FindJob(worker);
+        if (job != nullptr)
+        {
+            Execute(worker, job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < kIdleSpinCount)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Nothing to do for a while - sleep until something is pushed. The timeout covers
+        // a push that lands between the last look and the wait.
+        mSleeping.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(mSleepLock);
+            if (mRunning.load())
+                mSleepSignal.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        mSleeping.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void JobSystem::WakeWorkers()
+{
+    if (mSleeping.load(std::memory_order_relaxed) > 0)
+        mSleepSignal.notify_one();
+}
@@ -0,0 +1,175 @@
+///
+/// JobSystem.h - Work stealing job scheduler.
+/// Every thread owns a Chase-Lev deque: it pushes and pops its own jobs from the bottom
+/// while idle threads steal from the top. The thread that calls Initialize is worker 0
+/// and does work whenever it waits on a counter, so it never just sits blocked. Other
+/// threads can queue jobs too - those go on a shared queue the workers take from.
+///
+/// Jobs are a function pointer plus a context pointer and a [begin, end) range - enough
+/// for asset import, transform updates, culling and command recording without any
+/// allocation per job.
+///
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct JobCounter;
+
+typedef void (*JobFunction)(const void* context, unsigned int begin, unsigned int end);
+
+struct Job
+{
+    JobFunction     Function;
+    const void*     Context;
+    unsigned int    Begin;
+    unsigned int    End;
+    JobCounter*     Counter;        // decremented once the job has run
+    unsigned int    Grain;          // ParallelFor jobs split themselves down to this size
+};
+
+// Counts outstanding jobs. Jobs queued with a dependency are held on that counter until
+// it drops to zero. Only reuse a counter once everything waiting on it has been released.
+struct JobCounter
+{
+    // Set in Value while Continuations is being touched. The count can't reach zero until
+    // it clears, so once a waiter sees zero nobody will touch the counter again.
+    static const int kLockBit = 1 << 30;
+
+    JobCounter() : Value(0) {}
+
+    bool IsDone() const { return Value.load(std::memory_order_acquire) == 0; }
+
+    std::atomic<int>    Value;
+    std::vector<Job>    Continuations;
+};
+
+// Chase-Lev deque. The owner pushes and pops the bottom, anyone can steal the top.
+class JobDeque
+{
+public:
+    static const unsigned int kCapacity = 4096;     // power of two
+
+    JobDeque();
+
+    bool Push(Job* job);
+    Job* Pop();
+    Job* Steal();
+
+    bool IsEmpty() const;
+
+private:
+    // Top and bottom are written by different threads - keep them on different cache lines
+    std::atomic<long long>  mTop;
+    char                    mPadTop[64 - sizeof(std::atomic<long long>)];
+    std::atomic<long long>  mBottom;
+    char                    mPadBottom[64 - sizeof(std::atomic<long long>)];
+    std::atomic<Job*>       mJobs[kCapacity];
+};
+
+class JobSystem
+{
+public:
+    struct Stats
+    {
+        unsigned long long  JobsExecuted;
+        unsigned long long  Steals;
+        unsigned long long  FailedSteals;
+        unsigned long long  InlineJobs;     // ran on the spot because a deque or job pool was full
+    };
+
+public:
+    JobSystem();
+    ~JobSystem();
+
+    // threadCount includes the calling thread. Zero uses every hardware thread.
+    bool Initialize(unsigned int threadCount = 0);
+    void Shutdown();
+
+    // Queue a job on the calling thread's deque, or on the shared queue from a thread that
+    // isn't a worker. With a dependency, the job is held back until that counter reaches zero.
+    void Run(JobFunction function, const void* context, unsigned int begin, unsigned int end,
+             JobCounter* counter, JobCounter* dependency = nullptr);
+
+    // Calls function(index) for every index in [0, count). The range splits itself in half
+    // whenever it's bigger than the grain, so idle threads always have something to steal.
+    // A grain of zero picks one from the count and the number of threads.
+    template <typename Function>
+    void ParallelFor(unsigned int count, const Function& function, JobCounter* counter, unsigned int grain = 0);
+
+    // The untyped half of ParallelFor
+    void RunSplit(JobFunction function, const void* context, unsigned int count, JobCounter* counter, unsigned int grain);
+
+    // Does queued work until the counter reaches zero
+    void Wait(JobCounter* counter);
+
+    unsigned int GetThreadCount() const { return mThreadCount; }
+    Stats GetStats() const;
+    void ResetStats();
+
+    // Index of the calling thread, or kInvalidWorker if it isn't one of ours
+    static const unsigned int kInvalidWorker = 0xffffffff;
+    unsigned int GetWorkerIndex() const;
+
+private:
+    // A thread can't have more than this many of its own jobs queued or running at once
+    static const unsigned int kJobPoolSize = JobDeque::kCapacity * 2;
+
+    struct Worker
+    {
+        JobDeque                                Deque;
+        Job*                                    JobPool;        // ring of kJobPoolSize jobs handed out by AllocateJob
+        unsigned int                            NextJob;
+        unsigned int                            Random;         // picks steal victims
+        std::atomic<unsigned long long>         JobsExecuted;
+        std::atomic<unsigned long long>         Steals;
+        std::atomic<unsigned long long>         FailedSteals;
+        std::atomic<unsigned long long>         InlineJobs;
+    };
+
+    Job* AllocateJob(Worker* worker);
+    void Push(Worker* worker, const Job& job);
+    void Execute(Worker* worker, Job* job);
+    void Finish(Worker* worker, JobCounter* counter);
+    bool HoldUntilDone(JobCounter* dependency, const Job& job);
+    Job* FindJob(Worker* worker);
+
+    void Inject(const Job& job);
+    Job* TakeInjected(Worker* worker);
+
+    void WorkerMain(unsigned int index);
+    void WakeWorkers();
+
+    template <typename Function>
+    static void ParallelForJob(const void* context, unsigned int begin, unsigned int end)
+    {
+        const Function& function = *(const Function*)context;
+        for (unsigned int index = begin; index < end; index++)
+            function(index);
+    }
+
+private:
+    std::vector<Worker*>        mWorkers;
+    std::vector<std::thread>    mThreads;
+    unsigned int                mThreadCount;
+
+    // Jobs queued from threads that aren't workers
+    std::vector<Job>            mInjected;
+    std::atomic<unsigned int>   mInjectedCount;
+    std::mutex                  mInjectedLock;
+
+    std::atomic<bool>           mRunning;
+    std::atomic<unsigned int>   mSleeping;
+    std::mutex                  mSleepLock;
+    std::condition_variable     mSleepSignal;
+};
+
+template <typename Function>
+void JobSystem::ParallelFor(unsigned int count, const Function& function, JobCounter* counter, unsigned int grain)
+{
+    RunSplit(&ParallelForJob<Function>, &function, count, counter, grain);
+}
@@ -0,0 +1,161 @@
+///
+/// JobSystemBenchmark.cpp - Microbenchmarks for the JobSystem.
+///
+
+#include "JobSystemBenchmark.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <thread>
+
+typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+const unsigned int kSpawnJobCount       = 100000;
+const unsigned int kStealIterations     = 2000;
+const unsigned int kParallelForItems    = 1 << 20;
+
+static double SecondsSince(BenchmarkClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+}
+
+static void EmptyJob(const void*, unsigned int, unsigned int)
+{
+}
+
+// A few hundred cycles of arithmetic per item - roughly a transform update
+static void WorkItem(float* data, unsigned int index)
+{
+    float value = data[index];
+    for (unsigned int step = 0; step < 32; step++)
+        value = sqrtf(value * value + 1.0f) * 0.5f;
+    data[index] = value;
+}
+
+struct StealContext
+{
+    BenchmarkClock::time_point  Pushed;
+    std::atomic<long long>      Latency;
+};
+
+static void StealJob(const void* context, unsigned int, unsigned int)
+{
+    StealContext* steal = (StealContext*)context;
+    steal->Latency = std::chrono::duration_cast<std::chrono::nanoseconds>(BenchmarkClock::now() - steal->Pushed).count();
+}
+
+static double MeasureSpawn(JobSystem& jobs)
+{
+    JobCounter counter;
+    BenchmarkClock::time_point start = BenchmarkClock::now();
+
+    for (unsigned int index = 0; index < kSpawnJobCount; index++)
+    {
+        jobs.Run(&EmptyJob, nullptr, 0, 0, &counter);
+
+        // Don't let the deque fill up and turn this into a test of the inline path
+        if ((index & 1023) == 1023)
+            jobs.Wait(&counter);
+    }
+    jobs.Wait(&counter);
+
+    return SecondsSince(start) * 1e9 / kSpawnJobCount;
+}
+
+static double MeasureSteal(JobSystem& jobs)
+{
+    if (jobs.GetThreadCount() < 2)
+        return 0.0;
+
+    StealContext context;
+    double total = 0.0;
+
+    for (unsigned int iteration = 0; iteration < kStealIterations; iteration++)
+    {
+        JobCounter counter;
+        context.Latency = -1;
+        context.Pushed = BenchmarkClock::now();
+        jobs.Run(&StealJob, &context, 0, 0, &counter);
+
+        // Don't help - the only way the job runs is if another worker steals it
+        while (!counter.IsDone())
+            std::this_thread::yield();
+
+        total += (double)context.Latency.load();
+    }
+
+    return total / kStealIterations;
+}
+
+static double MeasureThroughput(JobSystem& jobs)
+{
+    JobCounter counter;
+    BenchmarkClock::time_point start = BenchmarkClock::now();
+
+    // Each job spawns nothing, so every thread is just draining and stealing
+    jobs.ParallelFor(kSpawnJobCount, [](unsigned int) {}, &counter, 1);
+    jobs.Wait(&counter);
+
+    return kSpawnJobCount / SecondsSince(start);
+}
+
+static double MeasureParallelFor(JobSystem& jobs, std::vector<float>& data, double& serialSeconds)
+{
+    for (unsigned int index = 0; index < kParallelForItems; index++)
+        data[index] = (float)index;
+
+    if (serialSeconds == 0.0)
+    {
+        BenchmarkClock::time_point start = BenchmarkClock::now();
+        for (unsigned int index = 0; index < kParallelForItems; index++)
+            WorkItem(data.data(), index);
+        serialSeconds = SecondsSince(start);
+    }
+
+    float* items = data.data();
+    JobCounter counter;
+    BenchmarkClock::time_point start = BenchmarkClock::now();
+
+    jobs.ParallelFor(kParallelForItems, [items](unsigned int index) { WorkItem(items, index); }, &counter);
+    jobs.Wait(&counter);
+
+    return SecondsSince(start);
+}
+
+void RunJobSystemBenchmarks(unsigned int maxThreads, std::vector<JobSystemBenchmarkResult>& results)
+{
+    if (maxThreads == 0)
+        maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0)
+        maxThreads = 1;
+
+    std::vector<float> data(kParallelForItems);
+    double serialSeconds = 0.0;
+
+    for (unsigned int threadCount = 1; ; threadCount *= 2)
+    {
+        if (threadCount > maxThreads)
+            threadCount = maxThreads;
+
+        JobSystem jobs;
+        jobs.Initialize(threadCount);
+
+        JobSystemBenchmarkResult result;
+        result.ThreadCount = threadCount;
+        result.SpawnNanoseconds = MeasureSpawn(jobs);
+        result.StealNanoseconds = MeasureSteal(jobs);
+        result.JobsPerSecond = MeasureThroughput(jobs);
+
+        double parallelSeconds = MeasureParallelFor(jobs, data, serialSeconds);
+        result.ItemsPerSecond = kParallelForItems / parallelSeconds;
+        result.ParallelForSpeedup = serialSeconds / parallelSeconds;
+
+        jobs.Shutdown();
+        results.push_back(result);
+
+        if (threadCount == maxThreads)
+            break;
+    }
+}
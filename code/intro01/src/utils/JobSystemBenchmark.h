@@ -0,0 +1,22 @@
+///
+/// JobSystemBenchmark.h - Microbenchmarks for the JobSystem.
+/// Measures spawn overhead, steal latency and parallel-for throughput at a range of
+/// thread counts. The benchmark runner reports the results; nothing here prints.
+///
+#pragma once
+
+#include <vector>
+
+struct JobSystemBenchmarkResult
+{
+    unsigned int    ThreadCount;
+
+    double          SpawnNanoseconds;       // queueing and running one empty job, per job
+    double          StealNanoseconds;       // from a push on one thread to the job starting on another
+    double          JobsPerSecond;          // empty jobs through the whole system
+    double          ItemsPerSecond;         // ParallelFor over a small fixed workload
+    double          ParallelForSpeedup;     // against the same loop run serially
+};
+
+// Runs the suite at 1, 2, 4 ... threads up to maxThreads (zero means every hardware thread)
+void RunJobSystemBenchmarks(unsigned int maxThreads, std::vector<JobSystemBenchmarkResult>& results);
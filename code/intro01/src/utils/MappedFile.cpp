@@ -0,0 +1,112 @@
+///
+/// MappedFile.cpp - A read-only view of a whole file, mapped into memory.
+///
+
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : mData(nullptr)
+    , mSize(0)
+#if defined(_WIN32)
+    , mFile(INVALID_HANDLE_VALUE)
+    , mMapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const char* filename)
+{
+    Close();
+
+    mFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size) || (size.QuadPart == 0) || ((unsigned long long)size.QuadPart > (size_t)-1))
+    {
+        Close();
+        return false;
+    }
+
+    mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping != nullptr)
+        mData = (const unsigned char*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (mData == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    mSize = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr)
+        UnmapViewOfFile(mData);
+    if (mMapping != nullptr)
+        CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+
+    mData = nullptr;
+    mSize = 0;
+    mMapping = nullptr;
+    mFile = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const char* filename)
+{
+    Close();
+
+    int file = open(filename, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    if ((fstat(file, &status) == 0) && (status.st_size > 0))
+    {
+        void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            mData = (const unsigned char*)data;
+            mSize = (size_t)status.st_size;
+        }
+    }
+
+    // The mapping keeps the file alive on its own
+    close(file);
+    return mData != nullptr;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr)
+        munmap((void*)mData, mSize);
+
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
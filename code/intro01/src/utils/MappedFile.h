@@ -0,0 +1,43 @@
+///
+/// MappedFile.h - A read-only view of a whole file, mapped into memory.
+/// Nothing is read up front - pages come in from the file cache as they're touched - so
+/// handing out pointers into the file costs nothing and there's no copy to keep around.
+///
+///     MappedFile file;
+///     if (file.Open("assets/baked/brick.dds"))
+///         Parse(file.GetData(), file.GetSize());
+///
+#pragma once
+
+#include <stddef.h>
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Fails on a missing or empty file. Opening again closes the last one.
+    bool Open(const char* filename);
+    void Close();
+
+    bool IsOpen() const { return mData != nullptr; }
+
+    // Valid until the file is closed
+    const unsigned char* GetData() const { return mData; }
+    size_t GetSize() const { return mSize; }
+
+private:
+    // Not copyable - the mapping belongs to one object
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+private:
+    const unsigned char*    mData;
+    size_t                  mSize;
+
+#if defined(_WIN32)
+    void*                   mFile;
+    void*                   mMapping;
+#endif
+};
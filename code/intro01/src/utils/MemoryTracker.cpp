@@ -0,0 +1,399 @@
+///
+/// MemoryTracker.cpp - Tracking global allocator.
+///
+
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+// Construct this file's statics before anybody else's and destroy them after, so the exit
+// leak report only sees what the program really left behind
+#if defined(_MSC_VER)
+#pragma warning(disable: 4073)
+#pragma init_seg(lib)
+#define EXIT_REPORT_PRIORITY
+#elif defined(__GNUC__)
+#define EXIT_REPORT_PRIORITY __attribute__((init_priority(101)))
+#else
+#define EXIT_REPORT_PRIORITY
+#endif
+
+static const char* const kTagNames[MT_Count] = { "general", "assets", "meshes", "scene", "render" };
+
+static thread_local MemoryTag tTag = MT_General;
+
+const char* MemoryTracker::GetTagName(MemoryTag tag)
+{
+    return (tag < MT_Count) ? kTagNames[tag] : "unknown";
+}
+
+MemoryTag MemoryTracker::GetTag()
+{
+    return tTag;
+}
+
+MemoryTag MemoryTracker::SetTag(MemoryTag tag)
+{
+    MemoryTag previous = tTag;
+    tTag = tag;
+    return previous;
+}
+
+#if USING(TRACK_ALLOCATIONS)
+
+// Leak lines written before the report just gives totals
+const unsigned int kMaxLeakLines = 256;
+
+struct AllocationHeader
+{
+    AllocationHeader*   Prev;
+    AllocationHeader*   Next;
+    const char*         File;
+    void*               Block;          // what malloc returned - before the header when over-aligned
+    size_t              Size;
+    unsigned long long  Serial;
+    int                 Line;
+    MemoryTag           Tag;
+};
+
+// Keeps the allocation itself 16 byte aligned
+const size_t kHeaderSize = (sizeof(AllocationHeader) + 15) & ~(size_t)15;
+
+struct TagCounters
+{
+    std::atomic<unsigned long long> LiveBytes;
+    std::atomic<unsigned long long> PeakBytes;
+    std::atomic<unsigned long long> LiveAllocations;
+    std::atomic<unsigned long long> Allocations;
+    std::atomic<unsigned long long> Frees;
+    std::atomic<unsigned long long> AllocatedBytes;
+    std::atomic<unsigned long long> FrameAllocations;
+    std::atomic<unsigned long long> FrameBytes;
+    std::atomic<unsigned long long> LastFrameAllocations;
+    std::atomic<unsigned long long> LastFrameBytes;
+};
+
+// All of this is constant initialised - operator new can run before any constructor has
+static TagCounters                      sCounters[MT_Count];
+static std::atomic<unsigned long long>  sLiveBytes(0);
+static std::atomic<unsigned long long>  sPeakBytes(0);
+static std::atomic<unsigned long long>  sSerial(0);
+
+// Guards the list of live allocations. A spin lock rather than a mutex, since it has to
+// work before static constructors run.
+static std::atomic_flag                 sListLock = ATOMIC_FLAG_INIT;
+static AllocationHeader*                sLiveList = nullptr;
+
+static std::atomic<bool>                sReportAtExit(false);
+static std::atomic<unsigned long long>  sExitMark(0);
+
+static void LockList()
+{
+    while (sListLock.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+static void UnlockList()
+{
+    sListLock.clear(std::memory_order_release);
+}
+
+static void WriteReportLine(const char* line)
+{
+    fputs(line, stderr);
+#if defined(_WIN32)
+    OutputDebugStringA(line);
+#endif
+}
+
+static void UpdatePeak(std::atomic<unsigned long long>& peak, unsigned long long value)
+{
+    unsigned long long current = peak.load(std::memory_order_relaxed);
+    while ((value > current) && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+// alignment is a power of two. Null if malloc fails.
+static void* TrackedAllocate(size_t size, size_t alignment, const char* file, int line)
+{
+    // Up to 16 the header keeps the alignment. Past that there's slack to slide the
+    // allocation up to the next boundary, with the header just in front of it.
+    size_t slack = (alignment > 16) ? alignment : 0;
+    char* block = (char*)malloc(kHeaderSize + slack + size);
+    if (block == nullptr)
+        return nullptr;
+
+    char* allocation = block + kHeaderSize;
+    if (slack > 0)
+        allocation = (char*)(((uintptr_t)allocation + alignment - 1) & ~(uintptr_t)(alignment - 1));
+
+    AllocationHeader* header = (AllocationHeader*)(allocation - kHeaderSize);
+    MemoryTag tag = tTag;
+    header->Block = block;
+    header->File = file;
+    header->Line = line;
+    header->Size = size;
+    header->Tag = tag;
+    header->Serial = sSerial.fetch_add(1, std::memory_order_relaxed);
+
+    TagCounters& counters = sCounters[tag];
+    counters.Allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    counters.FrameAllocations.fetch_add(1, std::memory_order_relaxed);
+    counters.FrameBytes.fetch_add(size, std::memory_order_relaxed);
+    counters.LiveAllocations.fetch_add(1, std::memory_order_relaxed);
+    UpdatePeak(counters.PeakBytes, counters.LiveBytes.fetch_add(size, std::memory_order_relaxed) + size);
+    UpdatePeak(sPeakBytes, sLiveBytes.fetch_add(size, std::memory_order_relaxed) + size);
+
+    LockList();
+    header->Prev = nullptr;
+    header->Next = sLiveList;
+    if (sLiveList != nullptr)
+        sLiveList->Prev = header;
+    sLiveList = header;
+    UnlockList();
+
+    return allocation;
+}
+
+// Throwing new never returns null - the new handler gets a chance to free something up,
+// and without one there's nothing for it but to stop
+static void* TrackedAllocateOrFail(size_t size, size_t alignment, const char* file, int line)
+{
+    for (;;)
+    {
+        void* pointer = TrackedAllocate(size, alignment, file, line);
+        if (pointer != nullptr)
+            return pointer;
+
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+        {
+            WriteReportLine("MemoryTracker: out of memory\n");
+            abort();
+        }
+        handler();
+    }
+}
+
+static void TrackedFree(void* pointer)
+{
+    if (pointer == nullptr)
+        return;
+
+    AllocationHeader* header = (AllocationHeader*)((char*)pointer - kHeaderSize);
+
+    LockList();
+    if (header->Prev != nullptr)
+        header->Prev->Next = header->Next;
+    else
+        sLiveList = header->Next;
+    if (header->Next != nullptr)
+        header->Next->Prev = header->Prev;
+    UnlockList();
+
+    TagCounters& counters = sCounters[header->Tag];
+    counters.Frees.fetch_add(1, std::memory_order_relaxed);
+    counters.LiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+    counters.LiveBytes.fetch_sub(header->Size, std::memory_order_relaxed);
+    sLiveBytes.fetch_sub(header->Size, std::memory_order_relaxed);
+
+    free(header->Block);
+}
+
+MemoryTracker::Stats MemoryTracker::GetStats(MemoryTag tag)
+{
+    const TagCounters& counters = sCounters[tag];
+
+    Stats stats;
+    stats.LiveBytes = counters.LiveBytes.load(std::memory_order_relaxed);
+    stats.PeakBytes = counters.PeakBytes.load(std::memory_order_relaxed);
+    stats.LiveAllocations = counters.LiveAllocations.load(std::memory_order_relaxed);
+    stats.Allocations = counters.Allocations.load(std::memory_order_relaxed);
+    stats.Frees = counters.Frees.load(std::memory_order_relaxed);
+    stats.AllocatedBytes = counters.AllocatedBytes.load(std::memory_order_relaxed);
+    stats.FrameAllocations = counters.LastFrameAllocations.load(std::memory_order_relaxed);
+    stats.FrameBytes = counters.LastFrameBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+MemoryTracker::Stats MemoryTracker::GetTotals()
+{
+    Stats totals = {};
+    for (unsigned int tag = 0; tag < MT_Count; tag++)
+    {
+        Stats stats = GetStats((MemoryTag)tag);
+        totals.LiveBytes += stats.LiveBytes;
+        totals.LiveAllocations += stats.LiveAllocations;
+        totals.Allocations += stats.Allocations;
+        totals.Frees += stats.Frees;
+        totals.AllocatedBytes += stats.AllocatedBytes;
+        totals.FrameAllocations += stats.FrameAllocations;
+        totals.FrameBytes += stats.FrameBytes;
+    }
+
+    // The tags peak at different times - this is the real one
+    totals.PeakBytes = sPeakBytes.load(std::memory_order_relaxed);
+    return totals;
+}
+
+void MemoryTracker::EndFrame()
+{
+    for (auto& counters : sCounters)
+    {
+        counters.LastFrameAllocations.store(counters.FrameAllocations.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        counters.LastFrameBytes.store(counters.FrameBytes.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+unsigned long long MemoryTracker::GetMark()
+{
+    return sSerial.load(std::memory_order_relaxed);
+}
+
+unsigned long long MemoryTracker::ReportLeaks(unsigned long long mark)
+{
+    unsigned long long leaks[MT_Count] = {};
+    unsigned long long bytes[MT_Count] = {};
+    unsigned long long total = 0;
+    char line[512];
+
+    // Nothing in here can call operator new - we're holding the list lock
+    LockList();
+    for (AllocationHeader* header = sLiveList; header != nullptr; header = header->Next)
+    {
+        if (header->Serial < mark)
+            continue;
+
+        if (total < kMaxLeakLines)
+        {
+            if (header->File != nullptr)
+                snprintf(line, sizeof(line), "%s(%d): leaked %llu bytes [%s] #%llu\n", header->File, header->Line,
+                         (unsigned long long)header->Size, kTagNames[header->Tag], header->Serial);
+            else
+                snprintf(line, sizeof(line), "(no call site): leaked %llu bytes [%s] #%llu\n",
+                         (unsigned long long)header->Size, kTagNames[header->Tag], header->Serial);
+            WriteReportLine(line);
+        }
+
+        leaks[header->Tag]++;
+        bytes[header->Tag] += header->Size;
+        total++;
+    }
+    UnlockList();
+
+    if (total > kMaxLeakLines)
+    {
+        snprintf(line, sizeof(line), "... and %llu more\n", total - kMaxLeakLines);
+        WriteReportLine(line);
+    }
+
+    for (unsigned int tag = 0; tag < MT_Count; tag++)
+    {
+        if (leaks[tag] == 0)
+            continue;
+
+        snprintf(line, sizeof(line), "MemoryTracker: %llu leaks, %llu bytes [%s]\n", leaks[tag], bytes[tag], kTagNames[tag]);
+        WriteReportLine(line);
+    }
+
+    if (total == 0)
+        WriteReportLine("MemoryTracker: no leaks\n");
+
+    return total;
+}
+
+void MemoryTracker::ReportLeaksAtExit()
+{
+    sExitMark = GetMark();
+    sReportAtExit = true;
+}
+
+struct ExitLeakReport
+{
+    ~ExitLeakReport()
+    {
+        if (sReportAtExit)
+            MemoryTracker::ReportLeaks(sExitMark);
+    }
+};
+
+static ExitLeakReport sExitLeakReport EXIT_REPORT_PRIORITY;
+
+void* operator new(size_t size)                                     { return TrackedAllocateOrFail(size, 0, nullptr, 0); }
+void* operator new[](size_t size)                                   { return TrackedAllocateOrFail(size, 0, nullptr, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept     { return TrackedAllocate(size, 0, nullptr, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept   { return TrackedAllocate(size, 0, nullptr, 0); }
+void* operator new(size_t size, const char* file, int line)         { return TrackedAllocateOrFail(size, 0, file, line); }
+void* operator new[](size_t size, const char* file, int line)       { return TrackedAllocateOrFail(size, 0, file, line); }
+
+void operator delete(void* pointer) noexcept                                { TrackedFree(pointer); }
+void operator delete[](void* pointer) noexcept                              { TrackedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept                        { TrackedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept                      { TrackedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept         { TrackedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept       { TrackedFree(pointer); }
+void operator delete(void* pointer, const char*, int) noexcept              { TrackedFree(pointer); }
+void operator delete[](void* pointer, const char*, int) noexcept            { TrackedFree(pointer); }
+
+#if defined(__cpp_aligned_new)
+
+// Over-aligned types - SIMD members and the like - come through these, and must be freed
+// through the tracker like everything else
+void* operator new(size_t size, std::align_val_t alignment)                                     { return TrackedAllocateOrFail(size, (size_t)alignment, nullptr, 0); }
+void* operator new[](size_t size, std::align_val_t alignment)                                   { return TrackedAllocateOrFail(size, (size_t)alignment, nullptr, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept     { return TrackedAllocate(size, (size_t)alignment, nullptr, 0); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept   { return TrackedAllocate(size, (size_t)alignment, nullptr, 0); }
+
+void operator delete(void* pointer, std::align_val_t) noexcept                              { TrackedFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept                            { TrackedFree(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept                      { TrackedFree(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept                    { TrackedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept       { TrackedFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept     { TrackedFree(pointer); }
+
+#endif // defined(__cpp_aligned_new)
+
+#else
+
+MemoryTracker::Stats MemoryTracker::GetStats(MemoryTag)
+{
+    Stats stats = {};
+    return stats;
+}
+
+MemoryTracker::Stats MemoryTracker::GetTotals()
+{
+    Stats stats = {};
+    return stats;
+}
+
+void MemoryTracker::EndFrame()
+{
+}
+
+unsigned long long MemoryTracker::GetMark()
+{
+    return 0;
+}
+
+unsigned long long MemoryTracker::ReportLeaks(unsigned long long)
+{
+    return 0;
+}
+
+void MemoryTracker::ReportLeaksAtExit()
+{
+}
+
+#endif // USING(TRACK_ALLOCATIONS)
@@ -0,0 +1,102 @@
+///
+/// MemoryTracker.h - Tracking global allocator.
+/// Replaces the global operator new and delete. Every allocation carries a small header
+/// with its size, the subsystem tag that was active when it was made and, for code that
+/// includes utils\memory.h, the file and line of the new. That gives live bytes, peaks and
+/// per frame counts for each subsystem, plus a leak report with call sites - on any
+/// platform, not just the MSVC debug CRT.
+///
+/// Tags are per thread and scoped:
+///
+///     {
+///         MEMORY_TAG(MT_Meshes);
+///         model = meshLoader.Load(device, scene);
+///     }
+///
+/// Tracking is on in Debug builds, and off otherwise - every allocation goes through one
+/// lock for the live list. Define TRACK_ALLOCATIONS as ON or OFF to choose for yourself.
+///
+#pragma once
+
+#include "utils\utils.h"
+
+#if !defined(TRACK_ALLOCATIONS)
+#if defined(_DEBUG)
+#define TRACK_ALLOCATIONS ON
+#else
+#define TRACK_ALLOCATIONS OFF
+#endif
+#endif
+
+enum MemoryTag
+{
+    MT_General = 0,
+    MT_Assets,
+    MT_Meshes,
+    MT_Scene,
+    MT_Render,
+
+    MT_Count
+};
+
+class MemoryTracker
+{
+public:
+    struct Stats
+    {
+        unsigned long long  LiveBytes;
+        unsigned long long  PeakBytes;
+        unsigned long long  LiveAllocations;
+        unsigned long long  Allocations;        // since the start of the run
+        unsigned long long  Frees;
+        unsigned long long  AllocatedBytes;
+        unsigned long long  FrameAllocations;   // during the last frame EndFrame closed
+        unsigned long long  FrameBytes;
+    };
+
+public:
+    static const char* GetTagName(MemoryTag tag);
+
+    static MemoryTag GetTag();
+    static MemoryTag SetTag(MemoryTag tag);     // returns the previous tag
+
+    static Stats GetStats(MemoryTag tag);
+    static Stats GetTotals();
+
+    // Closes the current frame's counts and starts the next
+    static void EndFrame();
+
+    // Writes every live allocation made since mark (see GetMark) to stderr and the
+    // debugger. Returns how many there were.
+    static unsigned long long ReportLeaks(unsigned long long mark = 0);
+    static unsigned long long GetMark();
+
+    // Runs ReportLeaks once static destructors are done, like _CRTDBG_LEAK_CHECK_DF
+    static void ReportLeaksAtExit();
+};
+
+class MemoryTagScope
+{
+public:
+    MemoryTagScope(MemoryTag tag) : mPrevious(MemoryTracker::SetTag(tag)) {}
+    ~MemoryTagScope() { MemoryTracker::SetTag(mPrevious); }
+
+private:
+    MemoryTag mPrevious;
+};
+
+#define MEMORY_TAG_CONCAT_INNER(a, b)   a##b
+#define MEMORY_TAG_CONCAT(a, b)         MEMORY_TAG_CONCAT_INNER(a, b)
+#define MEMORY_TAG(tag)                 MemoryTagScope MEMORY_TAG_CONCAT(memoryTag, __LINE__)(tag)
+
+#if USING(TRACK_ALLOCATIONS)
+
+#include <stddef.h>
+
+// Used by DEBUG_NEW to record the call site
+void* operator new(size_t size, const char* file, int line);
+void* operator new[](size_t size, const char* file, int line);
+void operator delete(void* pointer, const char* file, int line) noexcept;
+void operator delete[](void* pointer, const char* file, int line) noexcept;
+
+#endif // USING(TRACK_ALLOCATIONS)
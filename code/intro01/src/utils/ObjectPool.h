@@ -0,0 +1,249 @@
+///
+/// ObjectPool.h - Fixed size pools for objects we make a lot of.
+/// Objects live in chunks of slots, each slot padded out to a cache line so objects used by
+/// different threads never share one. Freed slots go on an intrusive free list and are
+/// handed out again before a new chunk is allocated, so creating and destroying objects
+/// doesn't fragment the heap.
+///
+/// DECLARE_POOLED_NEW(Type) gives a class its own operator new and delete that go through
+/// Type::GetPool(), so plain new and delete use the pool:
+///
+///     class SceneNode
+///     {
+///         DECLARE_POOLED_NEW(SceneNode)
+///         ...
+///     };
+///
+///     DEFINE_POOLED_NEW(SceneNode, kNodesPerChunk)      // in SceneNode.cpp
+///
+/// The pool itself takes a lock. A thread that makes a lot of objects can hold an
+/// ObjectPool::Cache, which keeps a few free slots for it and only goes to the pool in batches.
+///
+#pragma once
+
+#include "utils\assert.h"
+
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+const size_t kCacheLineSize = 64;
+
+template <typename T>
+class ObjectPool
+{
+private:
+    struct FreeSlot
+    {
+        FreeSlot* Next;
+    };
+
+public:
+    static const size_t kSlotSize = ((sizeof(T) > sizeof(FreeSlot) ? sizeof(T) : sizeof(FreeSlot)) + kCacheLineSize - 1) & ~(kCacheLineSize - 1);
+
+    // A thread's own stash of free slots. Must be destroyed before the pool.
+    class Cache
+    {
+    public:
+        static const unsigned int kCapacity = 32;
+
+        Cache(ObjectPool& pool) : mPool(pool), mCount(0) {}
+        ~Cache() { mPool.FreeBatch(mSlots, mCount); }
+
+        void* Allocate()
+        {
+            if (mCount == 0)
+                mCount = mPool.AllocateBatch(mSlots, kCapacity / 2);
+            return (mCount > 0) ? mSlots[--mCount] : nullptr;
+        }
+
+        void Free(void* pointer)
+        {
+            if (mCount == kCapacity)
+            {
+                mPool.FreeBatch(mSlots + kCapacity / 2, kCapacity / 2);
+                mCount = kCapacity / 2;
+            }
+            mSlots[mCount++] = pointer;
+        }
+
+        template <typename... Args>
+        T* Create(Args&&... args)
+        {
+            void* slot = Allocate();
+            return (slot != nullptr) ? ::new(slot) T(std::forward<Args>(args)...) : nullptr;
+        }
+
+        void Destroy(T* object)
+        {
+            if (object == nullptr)
+                return;
+            object->~T();
+            Free(object);
+        }
+
+    private:
+        Cache(const Cache&);
+        Cache& operator=(const Cache&);
+
+    private:
+        ObjectPool&     mPool;
+        void*           mSlots[kCapacity];
+        unsigned int    mCount;
+    };
+
+public:
+    ObjectPool(unsigned int slotsPerChunk = 256)
+        : mFreeList(nullptr)
+        , mSlotsPerChunk(slotsPerChunk)
+        , mLiveCount(0)
+        , mCapacity(0)
+    {
+        ASSERT(slotsPerChunk > 0);
+    }
+
+    // Slots still in use are freed along with their chunk, without being destroyed
+    ~ObjectPool()
+    {
+        for (auto chunk : mChunks)
+            delete[] chunk;
+    }
+
+    void* Allocate()
+    {
+        void* slot = nullptr;
+        AllocateBatch(&slot, 1);
+        return slot;
+    }
+
+    void Free(void* pointer)
+    {
+        if (pointer != nullptr)
+            FreeBatch(&pointer, 1);
+    }
+
+    template <typename... Args>
+    T* Create(Args&&... args)
+    {
+        void* slot = Allocate();
+        return (slot != nullptr) ? ::new(slot) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    void Destroy(T* object)
+    {
+        if (object == nullptr)
+            return;
+        object->~T();
+        Free(object);
+    }
+
+    // Fills slots with up to count free slots, returns how many it managed
+    unsigned int AllocateBatch(void** slots, unsigned int count)
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        unsigned int allocated = 0;
+        while (allocated < count)
+        {
+            if ((mFreeList == nullptr) && !AddChunk())
+                break;
+
+            slots[allocated++] = mFreeList;
+            mFreeList = mFreeList->Next;
+        }
+
+        mLiveCount += allocated;
+        return allocated;
+    }
+
+    void FreeBatch(void** slots, unsigned int count)
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        for (unsigned int index = 0; index < count; index++)
+        {
+            FreeSlot* slot = (FreeSlot*)slots[index];
+            slot->Next = mFreeList;
+            mFreeList = slot;
+        }
+
+        mLiveCount -= count;
+    }
+
+    unsigned int GetLiveCount() const { return mLiveCount; }
+    unsigned int GetCapacity() const { return mCapacity; }
+    unsigned int GetChunkCount() const { return (unsigned int)mChunks.size(); }
+
+private:
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator=(const ObjectPool&);
+
+    bool AddChunk()
+    {
+        char* chunk = new char[mSlotsPerChunk * kSlotSize + kCacheLineSize];
+        if (chunk == nullptr)
+            return false;
+        mChunks.push_back(chunk);
+
+        // Thread the new slots onto the free list in address order
+        char* first = (char*)(((uintptr_t)chunk + kCacheLineSize - 1) & ~(uintptr_t)(kCacheLineSize - 1));
+        for (unsigned int index = mSlotsPerChunk; index > 0; index--)
+        {
+            FreeSlot* slot = (FreeSlot*)(first + (index - 1) * kSlotSize);
+            slot->Next = mFreeList;
+            mFreeList = slot;
+        }
+
+        mCapacity += mSlotsPerChunk;
+        return true;
+    }
+
+private:
+    std::mutex          mLock;
+    FreeSlot*           mFreeList;
+    std::vector<char*>  mChunks;
+    unsigned int        mSlotsPerChunk;
+    unsigned int        mLiveCount;
+    unsigned int        mCapacity;
+};
+
+// Routes new and delete for Type through Type::GetPool(). DECLARE_POOLED_NEW goes in the class,
+// DEFINE_POOLED_NEW in its .cpp - which mustn't include utils\memory.h, or its new macro mangles
+// the definitions. Anything that isn't exactly a Type, a derived class say, goes to the global
+// heap. The file and line overloads are there for utils\memory.h.
+#define DECLARE_POOLED_NEW(Type)                                                \
+    public:                                                                     \
+        static ObjectPool<Type>& GetPool();                                     \
+        static void* operator new(size_t size);                                 \
+        static void* operator new(size_t size, const char* file, int line);     \
+        static void operator delete(void* pointer, size_t size);                \
+        static void operator delete(void* pointer, const char* file, int line);
+
+#define DEFINE_POOLED_NEW(Type, slotsPerChunk)                                  \
+    ObjectPool<Type>& Type::GetPool()                                           \
+    {                                                                           \
+        static ObjectPool<Type> pool(slotsPerChunk);                            \
+        return pool;                                                            \
+    }                                                                           \
+    void* Type::operator new(size_t size)                                       \
+    {                                                                           \
+        return (size == sizeof(Type)) ? GetPool().Allocate() : ::operator new(size); \
+    }                                                                           \
+    void* Type::operator new(size_t size, const char*, int)                     \
+    {                                                                           \
+        return Type::operator new(size);                                        \
+    }                                                                           \
+    void Type::operator delete(void* pointer, size_t size)                      \
+    {                                                                           \
+        if (size == sizeof(Type))                                               \
+            GetPool().Free(pointer);                                            \
+        else                                                                    \
+            ::operator delete(pointer);                                         \
+    }                                                                           \
+    void Type::operator delete(void* pointer, const char*, int)                 \
+    {                                                                           \
+        Type::operator delete(pointer, sizeof(Type));                           \
+    }
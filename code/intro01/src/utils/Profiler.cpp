@@ -0,0 +1,230 @@
+///
+/// Profiler.cpp - Scoped CPU profiler.
+///
+
+#include "Profiler.h"
+
+#if USING(ENABLE_PROFILER)
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_RDTSC ON
+#else
+#define PROFILER_RDTSC OFF
+#endif
+
+// Events each thread can hold before it starts dropping them
+const unsigned int kEventsPerThread = 1 << 16;
+
+// Threads that can record. Events from any more than that are dropped.
+const unsigned int kMaxThreads      = 64;
+
+struct ProfileEvent
+{
+    const char*         Name;
+    unsigned long long  Start;
+    unsigned long long  End;
+};
+
+// Written only by its own thread. Count is published with release so the exporter
+// never sees an event before it's filled in.
+struct ProfileThreadBuffer
+{
+    std::atomic<unsigned int>       Count;
+    std::atomic<unsigned long long> Dropped;
+    unsigned int                    ThreadIndex;
+    const char*                     Name;
+    ProfileEvent                    Events[kEventsPerThread];
+};
+
+static std::mutex                           sRegistryLock;
+static ProfileThreadBuffer*                 sBuffers[kMaxThreads];
+static unsigned int                         sBufferCount = 0;
+static std::atomic<unsigned long long>      sDroppedThreadEvents(0);
+static thread_local ProfileThreadBuffer*    tBuffer = nullptr;
+
+typedef std::chrono::steady_clock ProfilerClock;
+
+// The first timestamp taken, in both clocks - used to turn ticks into microseconds
+struct ProfilerEpoch
+{
+    ProfilerEpoch()
+    {
+        Time = ProfilerClock::now();
+        Ticks = Profiler::Now();
+    }
+
+    ProfilerClock::time_point   Time;
+    unsigned long long          Ticks;
+};
+
+static ProfilerEpoch& GetEpoch()
+{
+    static ProfilerEpoch epoch;
+    return epoch;
+}
+
+static ProfileThreadBuffer* GetThreadBuffer()
+{
+    if (tBuffer != nullptr)
+        return tBuffer;
+
+    GetEpoch();
+
+    // First event on this thread - the only time recording touches the lock
+    std::lock_guard<std::mutex> lock(sRegistryLock);
+    if (sBufferCount == kMaxThreads)
+        return nullptr;
+
+    // Straight from malloc and never freed, so the profiler doesn't show up in the
+    // allocation counts or the leak report
+    void* memory = malloc(sizeof(ProfileThreadBuffer));
+    if (memory == nullptr)
+        return nullptr;
+
+    ProfileThreadBuffer* buffer = ::new(memory) ProfileThreadBuffer();
+    buffer->Count = 0;
+    buffer->Dropped = 0;
+    buffer->Name = nullptr;
+    buffer->ThreadIndex = sBufferCount;
+    sBuffers[sBufferCount++] = buffer;
+
+    tBuffer = buffer;
+    return buffer;
+}
+
+unsigned long long Profiler::Now()
+{
+#if USING(PROFILER_RDTSC)
+    return __rdtsc();
+#else
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(ProfilerClock::now().time_since_epoch()).count();
+#endif
+}
+
+void Profiler::Record(const char* name, unsigned long long start, unsigned long long end)
+{
+    ProfileThreadBuffer* buffer = GetThreadBuffer();
+    if (buffer == nullptr)
+    {
+        sDroppedThreadEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    unsigned int index = buffer->Count.load(std::memory_order_relaxed);
+    if (index >= kEventsPerThread)
+    {
+        buffer->Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ProfileEvent& event = buffer->Events[index];
+    event.Name = name;
+    event.Start = start;
+    event.End = end;
+
+    buffer->Count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ProfileThreadBuffer* buffer = GetThreadBuffer();
+    if (buffer != nullptr)
+        buffer->Name = name;
+}
+
+void Profiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(sRegistryLock);
+    for (unsigned int index = 0; index < sBufferCount; index++)
+    {
+        ProfileThreadBuffer* buffer = sBuffers[index];
+        buffer->Count.store(0, std::memory_order_release);
+        buffer->Dropped = 0;
+    }
+
+    sDroppedThreadEvents = 0;
+}
+
+unsigned long long Profiler::GetDroppedEventCount()
+{
+    std::lock_guard<std::mutex> lock(sRegistryLock);
+
+    unsigned long long dropped = sDroppedThreadEvents.load(std::memory_order_relaxed);
+    for (unsigned int index = 0; index < sBufferCount; index++)
+        dropped += sBuffers[index]->Dropped.load(std::memory_order_relaxed);
+
+    return dropped;
+}
+
+static void WriteJsonString(FILE* file, const char* value)
+{
+    fputc('"', file);
+    for (const char* character = value; *character != 0; character++)
+    {
+        if ((*character == '"') || (*character == '\\'))
+            fputc('\\', file);
+        fputc(*character, file);
+    }
+    fputc('"', file);
+}
+
+bool Profiler::WriteChromeTrace(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == nullptr)
+        return false;
+
+    // How many ticks make a microsecond, measured over the whole run
+    ProfilerEpoch& epoch = GetEpoch();
+    unsigned long long ticks = Now() - epoch.Ticks;
+    double microseconds = std::chrono::duration<double, std::micro>(ProfilerClock::now() - epoch.Time).count();
+    double ticksPerMicrosecond = (microseconds > 0.0) ? ticks / microseconds : 1000.0;
+    if (ticksPerMicrosecond <= 0.0)
+        ticksPerMicrosecond = 1000.0;
+
+    std::lock_guard<std::mutex> lock(sRegistryLock);
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool first = true;
+
+    for (unsigned int bufferIndex = 0; bufferIndex < sBufferCount; bufferIndex++)
+    {
+        ProfileThreadBuffer* buffer = sBuffers[bufferIndex];
+        if (buffer->Name != nullptr)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer->ThreadIndex);
+            WriteJsonString(file, buffer->Name);
+            fputs("}}", file);
+            first = false;
+        }
+
+        unsigned int count = buffer->Count.load(std::memory_order_acquire);
+        for (unsigned int index = 0; index < count; index++)
+        {
+            const ProfileEvent& event = buffer->Events[index];
+
+            // Complete events - Chrome works the nesting out from the times
+            double start = (double)(long long)(event.Start - epoch.Ticks) / ticksPerMicrosecond;
+            double duration = (double)(event.End - event.Start) / ticksPerMicrosecond;
+
+            fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+            WriteJsonString(file, event.Name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", buffer->ThreadIndex, start, duration);
+            first = false;
+        }
+    }
+
+    fputs("\n]}\n", file);
+    fclose(file);
+    return true;
+}
+
+#endif // USING(ENABLE_PROFILER)
@@ -0,0 +1,75 @@
+///
+/// Profiler.h - Scoped CPU profiler.
+/// Zones are timed on the stack and written to a buffer owned by the recording thread, so
+/// recording never takes a lock. WriteChromeTrace dumps everything as Chrome trace event
+/// JSON - load it in about:tracing or ui.perfetto.dev.
+///
+/// Zone names must be string literals (or otherwise live forever) - only the pointer is kept.
+///
+///     void Thing()
+///     {
+///         PROFILE_FUNCTION();
+///         ...
+///         {
+///             PROFILE_SCOPE("Thing::Inner");
+///             ...
+///         }
+///     }
+///
+/// Define ENABLE_PROFILER as OFF and every macro compiles to nothing.
+///
+#pragma once
+
+#include "utils\utils.h"
+
+#if !defined(ENABLE_PROFILER)
+#define ENABLE_PROFILER ON
+#endif
+
+#if USING(ENABLE_PROFILER)
+
+class Profiler
+{
+public:
+    // Raw timestamp - rdtsc where we have it, the steady clock otherwise
+    static unsigned long long Now();
+
+    static void Record(const char* name, unsigned long long start, unsigned long long end);
+    static void SetThreadName(const char* name);
+
+    static bool WriteChromeTrace(const char* filename);
+
+    // Throws away everything recorded so far. Only call it while no other thread is recording.
+    static void Reset();
+
+    // Events that didn't fit in their thread's buffer
+    static unsigned long long GetDroppedEventCount();
+};
+
+class ProfileZone
+{
+public:
+    ProfileZone(const char* name) : mName(name), mStart(Profiler::Now()) {}
+    ~ProfileZone() { Profiler::Record(mName, mStart, Profiler::Now()); }
+
+private:
+    const char*         mName;
+    unsigned long long  mStart;
+};
+
+#define PROFILE_CONCAT_INNER(a, b)      a##b
+#define PROFILE_CONCAT(a, b)            PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name)             ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION()              PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name)       Profiler::SetThreadName(name)
+#define PROFILE_WRITE_TRACE(filename)   Profiler::WriteChromeTrace(filename)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD_NAME(name)
+#define PROFILE_WRITE_TRACE(filename)
+
+#endif // USING(ENABLE_PROFILER)
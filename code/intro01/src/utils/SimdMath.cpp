@@ -0,0 +1,470 @@
+///
+/// SimdMath.cpp - Portable vector, matrix and quaternion math.
+///
+
+#include "SimdMath.h"
+
+#if USING(SIMD_MATH_AVX2)
+#include <immintrin.h>
+
+// Without FMA in the build, a multiply and an add do the same job
+#if defined(__FMA__) || defined(_MSC_VER)
+#define SIMD_MATH_FMA256(a, b, c)   _mm256_fmadd_ps(a, b, c)
+#else
+#define SIMD_MATH_FMA256(a, b, c)   _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#endif
+#endif
+
+namespace Math
+{
+
+const char* GetBackendName()
+{
+#if USING(SIMD_MATH_AVX2)
+    return "sse2+avx2";
+#elif USING(SIMD_MATH_SSE2)
+    return "sse2";
+#elif USING(SIMD_MATH_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+// ======================================================================================
+// Matrices
+// ======================================================================================
+Mat4 MatrixRotationX(float angle)
+{
+    float sine = sinf(angle);
+    float cosine = cosf(angle);
+
+    return MatrixSet(1.0f, 0.0f,    0.0f,   0.0f,
+                     0.0f, cosine,  sine,   0.0f,
+                     0.0f, -sine,   cosine, 0.0f,
+                     0.0f, 0.0f,    0.0f,   1.0f);
+}
+
+Mat4 MatrixRotationY(float angle)
+{
+    float sine = sinf(angle);
+    float cosine = cosf(angle);
+
+    return MatrixSet(cosine, 0.0f, -sine,  0.0f,
+                     0.0f,   1.0f, 0.0f,   0.0f,
+                     sine,   0.0f, cosine, 0.0f,
+                     0.0f,   0.0f, 0.0f,   1.0f);
+}
+
+Mat4 MatrixRotationZ(float angle)
+{
+    float sine = sinf(angle);
+    float cosine = cosf(angle);
+
+    return MatrixSet(cosine, sine,   0.0f, 0.0f,
+                     -sine,  cosine, 0.0f, 0.0f,
+                     0.0f,   0.0f,   1.0f, 0.0f,
+                     0.0f,   0.0f,   0.0f, 1.0f);
+}
+
+Mat4 MatrixRotationRollPitchYaw(float pitch, float yaw, float roll)
+{
+    // RotationZ(roll) * RotationX(pitch) * RotationY(yaw), multiplied out
+    float sp = sinf(pitch), cp = cosf(pitch);
+    float sy = sinf(yaw),   cy = cosf(yaw);
+    float sr = sinf(roll),  cr = cosf(roll);
+
+    return MatrixSet(cr * cy + sr * sp * sy, sr * cp, sr * sp * cy - cr * sy, 0.0f,
+                     cr * sp * sy - sr * cy, cr * cp, sr * sy + cr * sp * cy, 0.0f,
+                     cp * sy,                -sp,     cp * cy,                0.0f,
+                     0.0f,                   0.0f,    0.0f,                   1.0f);
+}
+
+Mat4 MatrixRotationQuaternion(Quat q)
+{
+    float x = VectorGetX(q), y = VectorGetY(q), z = VectorGetZ(q), w = VectorGetW(q);
+    float xx = x * x, yy = y * y, zz = z * z;
+    float xy = x * y, xz = x * z, yz = y * z;
+    float xw = x * w, yw = y * w, zw = z * w;
+
+    return MatrixSet(1.0f - 2.0f * (yy + zz), 2.0f * (xy + zw),        2.0f * (xz - yw),        0.0f,
+                     2.0f * (xy - zw),        1.0f - 2.0f * (xx + zz), 2.0f * (yz + xw),        0.0f,
+                     2.0f * (xz + yw),        2.0f * (yz - xw),        1.0f - 2.0f * (xx + yy), 0.0f,
+                     0.0f,                    0.0f,                    0.0f,                    1.0f);
+}
+
+Mat4 MatrixLookToLH(Vector eye, Vector direction, Vector up)
+{
+    Vector axisZ = Vector3Normalize(direction);
+    Vector axisX = Vector3Normalize(Vector3Cross(up, axisZ));
+    Vector axisY = Vector3Cross(axisZ, axisX);
+
+    Vector negativeEye = VectorNegate(eye);
+    float offsetX = VectorGetX(Vector3Dot(axisX, negativeEye));
+    float offsetY = VectorGetX(Vector3Dot(axisY, negativeEye));
+    float offsetZ = VectorGetX(Vector3Dot(axisZ, negativeEye));
+
+    // The camera's axes are the columns
+    Mat4 result;
+    result.r[0] = VectorSetW(axisX, offsetX);
+    result.r[1] = VectorSetW(axisY, offsetY);
+    result.r[2] = VectorSetW(axisZ, offsetZ);
+    result.r[3] = VectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+    return MatrixTranspose(result);
+}
+
+Mat4 MatrixLookAtLH(Vector eye, Vector focus, Vector up)
+{
+    return MatrixLookToLH(eye, VectorSubtract(focus, eye), up);
+}
+
+Mat4 MatrixInverse(const Mat4& m, float* determinant)
+{
+    Float4x4 source;
+    MatrixStore(&source, m);
+    const float* a = &source.m[0][0];
+
+    // Cofactors, transposed as we go
+    float inverse[16];
+    inverse[0]  =  a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+    inverse[4]  = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+    inverse[8]  =  a[4] * a[9]  * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+    inverse[12] = -a[4] * a[9]  * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+    inverse[1]  = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+    inverse[5]  =  a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+    inverse[9]  = -a[0] * a[9]  * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+    inverse[13] =  a[0] * a[9]  * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+    inverse[2]  =  a[1] * a[6]  * a[15] - a[1] * a[7]  * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7]  - a[13] * a[3] * a[6];
+    inverse[6]  = -a[0] * a[6]  * a[15] + a[0] * a[7]  * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7]  + a[12] * a[3] * a[6];
+    inverse[10] =  a[0] * a[5]  * a[15] - a[0] * a[7]  * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7]  - a[12] * a[3] * a[5];
+    inverse[14] = -a[0] * a[5]  * a[14] + a[0] * a[6]  * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6]  + a[12] * a[2] * a[5];
+    inverse[3]  = -a[1] * a[6]  * a[11] + a[1] * a[7]  * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9]  * a[2] * a[7]  + a[9]  * a[3] * a[6];
+    inverse[7]  =  a[0] * a[6]  * a[11] - a[0] * a[7]  * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8]  * a[2] * a[7]  - a[8]  * a[3] * a[6];
+    inverse[11] = -a[0] * a[5]  * a[11] + a[0] * a[7]  * a[9]  + a[4] * a[1] * a[11] - a[4] * a[3] * a[9]  - a[8]  * a[1] * a[7]  + a[8]  * a[3] * a[5];
+    inverse[15] =  a[0] * a[5]  * a[10] - a[0] * a[6]  * a[9]  - a[4] * a[1] * a[10] + a[4] * a[2] * a[9]  + a[8]  * a[1] * a[6]  - a[8]  * a[2] * a[5];
+
+    float det = a[0] * inverse[0] + a[1] * inverse[4] + a[2] * inverse[8] + a[3] * inverse[12];
+    if (determinant != nullptr)
+        *determinant = det;
+
+    if (fabsf(det) < FLT_MIN)
+    {
+        if (determinant != nullptr)
+            *determinant = 0.0f;
+        return MatrixIdentity();
+    }
+
+    Float4x4 result;
+    float scale = 1.0f / det;
+    for (unsigned int index = 0; index < 16; index++)
+        (&result.m[0][0])[index] = inverse[index] * scale;
+
+    return MatrixLoad(&result);
+}
+
+Mat4 MatrixRigidInverse(const Mat4& m)
+{
+    // The rotation's inverse is its transpose, and the translation gets undone by it
+    Mat4 rotation = m;
+    rotation.r[3] = VectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+    rotation = MatrixTranspose(rotation);
+
+    Vector translation = VectorNegate(Vector3TransformNormal(m.r[3], rotation));
+    rotation.r[3] = VectorSetW(translation, 1.0f);
+    return rotation;
+}
+
+Mat4 MatrixPerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ)
+{
+    float height = 1.0f / tanf(fovY * 0.5f);
+    float width = height / aspect;
+    float range = isinf(farZ) ? 1.0f : farZ / (farZ - nearZ);
+
+    return MatrixSet(width, 0.0f,   0.0f,            0.0f,
+                     0.0f,  height, 0.0f,            0.0f,
+                     0.0f,  0.0f,   range,           1.0f,
+                     0.0f,  0.0f,   -range * nearZ,  0.0f);
+}
+
+Mat4 MatrixPerspectiveFovReversedLH(float fovY, float aspect, float nearZ, float farZ)
+{
+    float height = 1.0f / tanf(fovY * 0.5f);
+    float width = height / aspect;
+
+    // depth = (z * range + offset) / z, which is one at nearZ and zero at farZ
+    float range = isinf(farZ) ? 0.0f : nearZ / (nearZ - farZ);
+    float offset = isinf(farZ) ? nearZ : -farZ * range;
+
+    return MatrixSet(width, 0.0f,   0.0f,   0.0f,
+                     0.0f,  height, 0.0f,   0.0f,
+                     0.0f,  0.0f,   range,  1.0f,
+                     0.0f,  0.0f,   offset, 0.0f);
+}
+
+// ======================================================================================
+// Quaternions
+// ======================================================================================
+Quat QuaternionMultiply(Quat a, Quat b)
+{
+    // The Hamilton product b * a, so a's rotation happens first
+    float ax = VectorGetX(a), ay = VectorGetY(a), az = VectorGetZ(a), aw = VectorGetW(a);
+    float bx = VectorGetX(b), by = VectorGetY(b), bz = VectorGetZ(b), bw = VectorGetW(b);
+
+    return VectorSet(bw * ax + bx * aw + by * az - bz * ay,
+                     bw * ay - bx * az + by * aw + bz * ax,
+                     bw * az + bx * ay - by * ax + bz * aw,
+                     bw * aw - bx * ax - by * ay - bz * az);
+}
+
+Quat QuaternionRotationAxis(Vector axis, float angle)
+{
+    Vector normal = Vector3Normalize(axis);
+    return VectorSetW(VectorScale(normal, sinf(angle * 0.5f)), cosf(angle * 0.5f));
+}
+
+Quat QuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+{
+    float sp = sinf(pitch * 0.5f), cp = cosf(pitch * 0.5f);
+    float sy = sinf(yaw * 0.5f),   cy = cosf(yaw * 0.5f);
+    float sr = sinf(roll * 0.5f),  cr = cosf(roll * 0.5f);
+
+    return VectorSet(cr * sp * cy + sr * cp * sy,
+                     cr * cp * sy - sr * sp * cy,
+                     sr * cp * cy - cr * sp * sy,
+                     cr * cp * cy + sr * sp * sy);
+}
+
+Quat QuaternionSlerp(Quat a, Quat b, float t)
+{
+    float cosine = VectorGetX(Vector4Dot(a, b));
+
+    // q and -q are the same rotation - go the short way round
+    if (cosine < 0.0f)
+    {
+        b = VectorNegate(b);
+        cosine = -cosine;
+    }
+
+    if (cosine > 0.9995f)
+        return QuaternionNormalize(VectorLerp(a, b, t));
+
+    float angle = acosf(cosine);
+    float sine = sinf(angle);
+    float weightA = sinf((1.0f - t) * angle) / sine;
+    float weightB = sinf(t * angle) / sine;
+
+    return VectorMultiplyAdd(a, VectorReplicate(weightA), VectorScale(b, weightB));
+}
+
+// ======================================================================================
+// Frustums
+// ======================================================================================
+static Vector NormalizePlane(Vector plane)
+{
+    float length = VectorGetX(Vector3Length(plane));
+    if (length < FLT_EPSILON)
+        return VectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+    return VectorScale(plane, 1.0f / length);
+}
+
+void FrustumFromMatrix(const Mat4& viewProjection, bool reversedZ, Frustum& frustum)
+{
+    // Clip space is -w <= x, y <= w and 0 <= z <= w. The columns of the matrix are the
+    // rows of its transpose.
+    Mat4 columns = MatrixTranspose(viewProjection);
+
+    frustum.Planes[FP_Left] = VectorAdd(columns.r[3], columns.r[0]);
+    frustum.Planes[FP_Right] = VectorSubtract(columns.r[3], columns.r[0]);
+    frustum.Planes[FP_Bottom] = VectorAdd(columns.r[3], columns.r[1]);
+    frustum.Planes[FP_Top] = VectorSubtract(columns.r[3], columns.r[1]);
+
+    // z >= 0 is the near plane normally, and the far one with reversed depth
+    Vector zeroPlane = columns.r[2];
+    Vector onePlane = VectorSubtract(columns.r[3], columns.r[2]);
+    frustum.Planes[FP_Near] = reversedZ ? onePlane : zeroPlane;
+    frustum.Planes[FP_Far] = reversedZ ? zeroPlane : onePlane;
+
+    for (unsigned int plane = 0; plane < FP_Count; plane++)
+        frustum.Planes[plane] = NormalizePlane(frustum.Planes[plane]);
+}
+
+// ======================================================================================
+// Batches
+// ======================================================================================
+#if USING(SIMD_MATH_SSE2)
+
+// Four points at once. Three loads hold x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3, which get
+// shuffled into x0-3, y0-3 and z0-3, transformed a component at a time and shuffled back.
+static void TransformPointsSSE(const __m128 columns[12], const Vec3* input, Vec3* output)
+{
+    const float* source = &input->x;
+    __m128 a = _mm_loadu_ps(source);
+    __m128 b = _mm_loadu_ps(source + 4);
+    __m128 c = _mm_loadu_ps(source + 8);
+
+    __m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+
+    __m128 resultX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, columns[0]), _mm_mul_ps(y, columns[1])), _mm_add_ps(_mm_mul_ps(z, columns[2]), columns[3]));
+    __m128 resultY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, columns[4]), _mm_mul_ps(y, columns[5])), _mm_add_ps(_mm_mul_ps(z, columns[6]), columns[7]));
+    __m128 resultZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, columns[8]), _mm_mul_ps(y, columns[9])), _mm_add_ps(_mm_mul_ps(z, columns[10]), columns[11]));
+
+    float* destination = &output->x;
+    _mm_storeu_ps(destination, _mm_shuffle_ps(_mm_shuffle_ps(resultX, resultY, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(resultZ, resultX, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(destination + 4, _mm_shuffle_ps(_mm_shuffle_ps(resultY, resultZ, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(resultX, resultY, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(destination + 8, _mm_shuffle_ps(_mm_shuffle_ps(resultZ, resultX, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(resultY, resultZ, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+#endif
+
+#if USING(SIMD_MATH_AVX2)
+
+// Both 128 bit halves set to the same row
+static __m256 BroadcastRow(const Vector& row)
+{
+    return _mm256_broadcast_ps(&row);
+}
+
+static __m256 LoadPair(const float* low, const float* high)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+}
+
+static void StorePair(float* low, float* high, __m256 value)
+{
+    _mm_storeu_ps(low, _mm256_castps256_ps128(value));
+    _mm_storeu_ps(high, _mm256_extractf128_ps(value, 1));
+}
+
+// TransformPointsSSE twice over - points 0-3 in the low halves and 4-7 in the high ones.
+// The shuffles work within each half, so they're the same ones.
+static void TransformPointsAVX(const __m256 columns[12], const Vec3* input, Vec3* output)
+{
+    const float* source = &input->x;
+    __m256 a = LoadPair(source, source + 12);
+    __m256 b = LoadPair(source + 4, source + 16);
+    __m256 c = LoadPair(source + 8, source + 20);
+
+    __m256 x = _mm256_shuffle_ps(a, _mm256_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    __m256 y = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 z = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+
+    __m256 resultX = SIMD_MATH_FMA256(x, columns[0], SIMD_MATH_FMA256(y, columns[1], SIMD_MATH_FMA256(z, columns[2], columns[3])));
+    __m256 resultY = SIMD_MATH_FMA256(x, columns[4], SIMD_MATH_FMA256(y, columns[5], SIMD_MATH_FMA256(z, columns[6], columns[7])));
+    __m256 resultZ = SIMD_MATH_FMA256(x, columns[8], SIMD_MATH_FMA256(y, columns[9], SIMD_MATH_FMA256(z, columns[10], columns[11])));
+
+    float* destination = &output->x;
+    StorePair(destination, destination + 12, _mm256_shuffle_ps(_mm256_shuffle_ps(resultX, resultY, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_shuffle_ps(resultZ, resultX, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+    StorePair(destination + 4, destination + 16, _mm256_shuffle_ps(_mm256_shuffle_ps(resultY, resultZ, _MM_SHUFFLE(1, 1, 1, 1)), _mm256_shuffle_ps(resultX, resultY, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+    StorePair(destination + 8, destination + 20, _mm256_shuffle_ps(_mm256_shuffle_ps(resultZ, resultX, _MM_SHUFFLE(3, 3, 2, 2)), _mm256_shuffle_ps(resultY, resultZ, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// Two rows transformed at once - one in each half of rows
+static __m256 TransformPair(__m256 rows, const __m256 matrix[4])
+{
+    __m256 result = _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(3, 3, 3, 3)), matrix[3]);
+    result = SIMD_MATH_FMA256(_mm256_permute_ps(rows, _MM_SHUFFLE(2, 2, 2, 2)), matrix[2], result);
+    result = SIMD_MATH_FMA256(_mm256_permute_ps(rows, _MM_SHUFFLE(1, 1, 1, 1)), matrix[1], result);
+    return SIMD_MATH_FMA256(_mm256_permute_ps(rows, _MM_SHUFFLE(0, 0, 0, 0)), matrix[0], result);
+}
+
+#endif
+
+void TransformPoints(const Mat4& m, const Vec3* input, Vec3* output, unsigned int count)
+{
+    unsigned int index = 0;
+
+#if USING(SIMD_MATH_SSE2)
+    // Every element of the top three rows of m's columns, each one replicated - output x is
+    // x * [0] + y * [1] + z * [2] + [3] and so on
+    Float4x4 stored;
+    MatrixStore(&stored, m);
+
+#if USING(SIMD_MATH_AVX2)
+    __m256 wideColumns[12];
+    for (unsigned int column = 0; column < 3; column++)
+    {
+        for (unsigned int row = 0; row < 4; row++)
+            wideColumns[column * 4 + row] = _mm256_set1_ps(stored.m[row][column]);
+    }
+
+    for (; index + 8 <= count; index += 8)
+        TransformPointsAVX(wideColumns, &input[index], &output[index]);
+#endif
+
+    __m128 columns[12];
+    for (unsigned int column = 0; column < 3; column++)
+    {
+        for (unsigned int row = 0; row < 4; row++)
+            columns[column * 4 + row] = _mm_set1_ps(stored.m[row][column]);
+    }
+
+    for (; index + 4 <= count; index += 4)
+        TransformPointsSSE(columns, &input[index], &output[index]);
+#endif
+
+    for (; index < count; index++)
+    {
+        Vector point = VectorLoad3(&input[index]);
+        Vector result = VectorMultiplyAdd(VectorSplatZ(point), m.r[2], m.r[3]);
+        result = VectorMultiplyAdd(VectorSplatY(point), m.r[1], result);
+        result = VectorMultiplyAdd(VectorSplatX(point), m.r[0], result);
+        VectorStore3(&output[index], result);
+    }
+}
+
+void TransformVectors(const Mat4& m, const Vec4* input, Vec4* output, unsigned int count)
+{
+    unsigned int index = 0;
+
+#if USING(SIMD_MATH_AVX2)
+    __m256 matrix[4] = { BroadcastRow(m.r[0]), BroadcastRow(m.r[1]), BroadcastRow(m.r[2]), BroadcastRow(m.r[3]) };
+    for (; index + 2 <= count; index += 2)
+    {
+        __m256 vectors = _mm256_loadu_ps(&input[index].x);
+        _mm256_storeu_ps(&output[index].x, TransformPair(vectors, matrix));
+    }
+#endif
+
+    for (; index < count; index++)
+        VectorStore4(&output[index], Vector4Transform(VectorLoad4(&input[index]), m));
+}
+
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* output, unsigned int count)
+{
+    for (unsigned int index = 0; index < count; index++)
+    {
+#if USING(SIMD_MATH_AVX2)
+        __m256 matrix[4] = { BroadcastRow(b[index].r[0]), BroadcastRow(b[index].r[1]), BroadcastRow(b[index].r[2]), BroadcastRow(b[index].r[3]) };
+        __m256 rows01 = TransformPair(_mm256_loadu_ps((const float*)&a[index].r[0]), matrix);
+        __m256 rows23 = TransformPair(_mm256_loadu_ps((const float*)&a[index].r[2]), matrix);
+        _mm256_storeu_ps((float*)&output[index].r[0], rows01);
+        _mm256_storeu_ps((float*)&output[index].r[2], rows23);
+#else
+        output[index] = MatrixMultiply(a[index], b[index]);
+#endif
+    }
+}
+
+void MultiplyMatrices(const Mat4* local, const Mat4& parent, Mat4* output, unsigned int count)
+{
+#if USING(SIMD_MATH_AVX2)
+    __m256 matrix[4] = { BroadcastRow(parent.r[0]), BroadcastRow(parent.r[1]), BroadcastRow(parent.r[2]), BroadcastRow(parent.r[3]) };
+    for (unsigned int index = 0; index < count; index++)
+    {
+        __m256 rows01 = TransformPair(_mm256_loadu_ps((const float*)&local[index].r[0]), matrix);
+        __m256 rows23 = TransformPair(_mm256_loadu_ps((const float*)&local[index].r[2]), matrix);
+        _mm256_storeu_ps((float*)&output[index].r[0], rows01);
+        _mm256_storeu_ps((float*)&output[index].r[2], rows23);
+    }
+#else
+    // Hoisted out of the loop, the parent stays in registers
+    Mat4 matrix = parent;
+    for (unsigned int index = 0; index < count; index++)
+        output[index] = MatrixMultiply(local[index], matrix);
+#endif
+}
+
+} // namespace Math
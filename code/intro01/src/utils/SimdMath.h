@@ -0,0 +1,574 @@
+///
+/// SimdMath.h - Portable vector, matrix and quaternion math.
+/// The conventions are DirectXMath's: row vectors, row major matrices, left handed view and
+/// projection, and quaternions stored x, y, z, w. Code written against DirectXMath moves over
+/// almost line for line - XMVectorAdd is Math::VectorAdd, XMMatrixLookAtLH is
+/// Math::MatrixLookAtLH and so on - and builds anywhere, not just on Windows.
+///
+/// Vec3, Vec4 and Float4x4 are for storage. Vector and Mat4 are what the math works on, and
+/// live in SIMD registers:
+///
+///     Math::Vector position = Math::VectorLoad3(&node.Position);
+///     Math::Mat4 world = Math::MatrixMultiply(local, parentWorld);
+///     Math::VectorStore3(&node.WorldPosition, Math::Vector3TransformCoord(position, world));
+///
+/// The backend is picked from the compiler's target - SSE2 on x86 and x64, NEON on ARM64 and
+/// plain floats anywhere else. The batch functions at the bottom also have an AVX2 path for
+/// builds with AVX2 turned on. Define SIMD_MATH_FORCE_SCALAR to use plain floats everywhere.
+///
+#pragma once
+
+#include "utils\utils.h"
+
+#include <float.h>
+#include <math.h>
+
+#if !defined(SIMD_MATH_FORCE_SCALAR) && (defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define SIMD_MATH_SSE2      ON
+#define SIMD_MATH_NEON      OFF
+#define SIMD_MATH_SCALAR    OFF
+#elif !defined(SIMD_MATH_FORCE_SCALAR) && (defined(__aarch64__) || defined(_M_ARM64))
+#define SIMD_MATH_SSE2      OFF
+#define SIMD_MATH_NEON      ON
+#define SIMD_MATH_SCALAR    OFF
+#else
+#define SIMD_MATH_SSE2      OFF
+#define SIMD_MATH_NEON      OFF
+#define SIMD_MATH_SCALAR    ON
+#endif
+
+#if USING(SIMD_MATH_SSE2) && defined(__AVX2__)
+#define SIMD_MATH_AVX2      ON
+#else
+#define SIMD_MATH_AVX2      OFF
+#endif
+
+#if USING(SIMD_MATH_SSE2)
+#include <emmintrin.h>
+#elif USING(SIMD_MATH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace Math
+{
+
+const float kPi = 3.14159265358979f;
+
+inline float ToRadians(float degrees) { return degrees * (kPi / 180.0f); }
+
+// ======================================================================================
+// Storage types
+// ======================================================================================
+struct Vec3
+{
+    float x, y, z;
+};
+
+struct Vec4
+{
+    float x, y, z, w;
+};
+
+// Same layout as XMFLOAT4X4
+struct Float4x4
+{
+    float m[4][4];
+};
+
+// ======================================================================================
+// Register types
+// ======================================================================================
+#if USING(SIMD_MATH_SSE2)
+typedef __m128 Vector;
+#elif USING(SIMD_MATH_NEON)
+typedef float32x4_t Vector;
+#else
+struct alignas(16) Vector
+{
+    float f[4];
+};
+#endif
+
+// Quaternions are x, y, z, w in a Vector, w being the real part
+typedef Vector Quat;
+
+struct alignas(16) Mat4
+{
+    Vector r[4];
+};
+
+// Name of the backend this build uses - "sse2", "sse2+avx2", "neon" or "scalar"
+const char* GetBackendName();
+
+// ======================================================================================
+// Vector basics - one version per backend
+// ======================================================================================
+#if USING(SIMD_MATH_SSE2)
+
+inline Vector VectorZero() { return _mm_setzero_ps(); }
+inline Vector VectorSet(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+inline Vector VectorReplicate(float value) { return _mm_set1_ps(value); }
+
+inline Vector VectorLoad3(const Vec3* source)
+{
+    // Vec3 is only four byte aligned, and this load doesn't mind
+    __m128 xy = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)&source->x));
+    __m128 z = _mm_load_ss(&source->z);
+    return _mm_movelh_ps(xy, z);
+}
+
+inline Vector VectorLoad4(const Vec4* source) { return _mm_loadu_ps(&source->x); }
+
+inline void VectorStore3(Vec3* destination, Vector v)
+{
+    _mm_storel_pi((__m64*)&destination->x, v);
+    _mm_store_ss(&destination->z, _mm_movehl_ps(v, v));
+}
+
+inline void VectorStore4(Vec4* destination, Vector v) { _mm_storeu_ps(&destination->x, v); }
+
+inline float VectorGetX(Vector v) { return _mm_cvtss_f32(v); }
+inline float VectorGetY(Vector v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+inline float VectorGetZ(Vector v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))); }
+inline float VectorGetW(Vector v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+inline Vector VectorSplatX(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+inline Vector VectorSplatY(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)); }
+inline Vector VectorSplatZ(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)); }
+inline Vector VectorSplatW(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+inline Vector VectorSetW(Vector v, float w)
+{
+    // z, w of the result from (v.z, w) - x, y stay put
+    __m128 zw = _mm_unpacklo_ps(_mm_movehl_ps(v, v), _mm_set_ss(w));
+    return _mm_movelh_ps(v, zw);
+}
+
+inline Vector VectorAdd(Vector a, Vector b) { return _mm_add_ps(a, b); }
+inline Vector VectorSubtract(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+inline Vector VectorMultiply(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+inline Vector VectorDivide(Vector a, Vector b) { return _mm_div_ps(a, b); }
+inline Vector VectorMultiplyAdd(Vector a, Vector b, Vector c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline Vector VectorScale(Vector v, float scale) { return _mm_mul_ps(v, _mm_set1_ps(scale)); }
+inline Vector VectorNegate(Vector v) { return _mm_sub_ps(_mm_setzero_ps(), v); }
+inline Vector VectorMin(Vector a, Vector b) { return _mm_min_ps(a, b); }
+inline Vector VectorMax(Vector a, Vector b) { return _mm_max_ps(a, b); }
+inline Vector VectorSqrt(Vector v) { return _mm_sqrt_ps(v); }
+
+// Dot products come back in every component
+inline Vector Vector4Dot(Vector a, Vector b)
+{
+    __m128 product = _mm_mul_ps(a, b);
+    __m128 sum = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+inline Vector Vector3Dot(Vector a, Vector b)
+{
+    __m128 product = _mm_mul_ps(a, b);
+    __m128 x = _mm_shuffle_ps(product, product, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 y = _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 z = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 2, 2, 2));
+    return _mm_add_ps(_mm_add_ps(x, y), z);
+}
+
+// w of the result is zero
+inline Vector Vector3Cross(Vector a, Vector b)
+{
+    __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 result = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+    return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+inline Mat4 MatrixTranspose(const Mat4& m)
+{
+    Mat4 result = m;
+    _MM_TRANSPOSE4_PS(result.r[0], result.r[1], result.r[2], result.r[3]);
+    return result;
+}
+
+#elif USING(SIMD_MATH_NEON)
+
+inline Vector VectorZero() { return vdupq_n_f32(0.0f); }
+
+inline Vector VectorSet(float x, float y, float z, float w)
+{
+    const float values[4] = { x, y, z, w };
+    return vld1q_f32(values);
+}
+
+inline Vector VectorReplicate(float value) { return vdupq_n_f32(value); }
+
+inline Vector VectorLoad3(const Vec3* source)
+{
+    float32x2_t xy = vld1_f32(&source->x);
+    float32x2_t z = vld1_lane_f32(&source->z, vdup_n_f32(0.0f), 0);
+    return vcombine_f32(xy, z);
+}
+
+inline Vector VectorLoad4(const Vec4* source) { return vld1q_f32(&source->x); }
+
+inline void VectorStore3(Vec3* destination, Vector v)
+{
+    vst1_f32(&destination->x, vget_low_f32(v));
+    vst1q_lane_f32(&destination->z, v, 2);
+}
+
+inline void VectorStore4(Vec4* destination, Vector v) { vst1q_f32(&destination->x, v); }
+
+inline float VectorGetX(Vector v) { return vgetq_lane_f32(v, 0); }
+inline float VectorGetY(Vector v) { return vgetq_lane_f32(v, 1); }
+inline float VectorGetZ(Vector v) { return vgetq_lane_f32(v, 2); }
+inline float VectorGetW(Vector v) { return vgetq_lane_f32(v, 3); }
+
+inline Vector VectorSplatX(Vector v) { return vdupq_laneq_f32(v, 0); }
+inline Vector VectorSplatY(Vector v) { return vdupq_laneq_f32(v, 1); }
+inline Vector VectorSplatZ(Vector v) { return vdupq_laneq_f32(v, 2); }
+inline Vector VectorSplatW(Vector v) { return vdupq_laneq_f32(v, 3); }
+
+inline Vector VectorSetW(Vector v, float w) { return vsetq_lane_f32(w, v, 3); }
+
+inline Vector VectorAdd(Vector a, Vector b) { return vaddq_f32(a, b); }
+inline Vector VectorSubtract(Vector a, Vector b) { return vsubq_f32(a, b); }
+inline Vector VectorMultiply(Vector a, Vector b) { return vmulq_f32(a, b); }
+inline Vector VectorDivide(Vector a, Vector b) { return vdivq_f32(a, b); }
+inline Vector VectorMultiplyAdd(Vector a, Vector b, Vector c) { return vfmaq_f32(c, a, b); }
+inline Vector VectorScale(Vector v, float scale) { return vmulq_n_f32(v, scale); }
+inline Vector VectorNegate(Vector v) { return vnegq_f32(v); }
+inline Vector VectorMin(Vector a, Vector b) { return vminq_f32(a, b); }
+inline Vector VectorMax(Vector a, Vector b) { return vmaxq_f32(a, b); }
+inline Vector VectorSqrt(Vector v) { return vsqrtq_f32(v); }
+
+inline Vector Vector4Dot(Vector a, Vector b) { return vdupq_n_f32(vaddvq_f32(vmulq_f32(a, b))); }
+
+inline Vector Vector3Dot(Vector a, Vector b)
+{
+    float32x4_t product = vsetq_lane_f32(0.0f, vmulq_f32(a, b), 3);
+    return vdupq_n_f32(vaddvq_f32(product));
+}
+
+inline Vector Vector3Cross(Vector a, Vector b)
+{
+    float ax = vgetq_lane_f32(a, 0), ay = vgetq_lane_f32(a, 1), az = vgetq_lane_f32(a, 2);
+    float bx = vgetq_lane_f32(b, 0), by = vgetq_lane_f32(b, 1), bz = vgetq_lane_f32(b, 2);
+    return VectorSet(ay * bz - az * by, az * bx - ax * bz, ax * by - ay * bx, 0.0f);
+}
+
+inline Mat4 MatrixTranspose(const Mat4& m)
+{
+    // Store the rows interleaved and load them back as columns
+    float values[16];
+    vst1q_f32(values + 0, m.r[0]);
+    vst1q_f32(values + 4, m.r[1]);
+    vst1q_f32(values + 8, m.r[2]);
+    vst1q_f32(values + 12, m.r[3]);
+
+    float32x4x4_t columns = vld4q_f32(values);
+    Mat4 result;
+    result.r[0] = columns.val[0];
+    result.r[1] = columns.val[1];
+    result.r[2] = columns.val[2];
+    result.r[3] = columns.val[3];
+    return result;
+}
+
+#else
+
+inline Vector VectorSet(float x, float y, float z, float w)
+{
+    Vector result = { { x, y, z, w } };
+    return result;
+}
+
+inline Vector VectorZero() { return VectorSet(0.0f, 0.0f, 0.0f, 0.0f); }
+inline Vector VectorReplicate(float value) { return VectorSet(value, value, value, value); }
+
+inline Vector VectorLoad3(const Vec3* source) { return VectorSet(source->x, source->y, source->z, 0.0f); }
+inline Vector VectorLoad4(const Vec4* source) { return VectorSet(source->x, source->y, source->z, source->w); }
+
+inline void VectorStore3(Vec3* destination, Vector v)
+{
+    destination->x = v.f[0];
+    destination->y = v.f[1];
+    destination->z = v.f[2];
+}
+
+inline void VectorStore4(Vec4* destination, Vector v)
+{
+    destination->x = v.f[0];
+    destination->y = v.f[1];
+    destination->z = v.f[2];
+    destination->w = v.f[3];
+}
+
+inline float VectorGetX(Vector v) { return v.f[0]; }
+inline float VectorGetY(Vector v) { return v.f[1]; }
+inline float VectorGetZ(Vector v) { return v.f[2]; }
+inline float VectorGetW(Vector v) { return v.f[3]; }
+
+inline Vector VectorSplatX(Vector v) { return VectorReplicate(v.f[0]); }
+inline Vector VectorSplatY(Vector v) { return VectorReplicate(v.f[1]); }
+inline Vector VectorSplatZ(Vector v) { return VectorReplicate(v.f[2]); }
+inline Vector VectorSplatW(Vector v) { return VectorReplicate(v.f[3]); }
+
+inline Vector VectorSetW(Vector v, float w)
+{
+    v.f[3] = w;
+    return v;
+}
+
+inline Vector VectorAdd(Vector a, Vector b) { return VectorSet(a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3]); }
+inline Vector VectorSubtract(Vector a, Vector b) { return VectorSet(a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3]); }
+inline Vector VectorMultiply(Vector a, Vector b) { return VectorSet(a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3]); }
+inline Vector VectorDivide(Vector a, Vector b) { return VectorSet(a.f[0] / b.f[0], a.f[1] / b.f[1], a.f[2] / b.f[2], a.f[3] / b.f[3]); }
+inline Vector VectorMultiplyAdd(Vector a, Vector b, Vector c) { return VectorAdd(VectorMultiply(a, b), c); }
+inline Vector VectorScale(Vector v, float scale) { return VectorSet(v.f[0] * scale, v.f[1] * scale, v.f[2] * scale, v.f[3] * scale); }
+inline Vector VectorNegate(Vector v) { return VectorSet(-v.f[0], -v.f[1], -v.f[2], -v.f[3]); }
+inline Vector VectorMin(Vector a, Vector b) { return VectorSet(fminf(a.f[0], b.f[0]), fminf(a.f[1], b.f[1]), fminf(a.f[2], b.f[2]), fminf(a.f[3], b.f[3])); }
+inline Vector VectorMax(Vector a, Vector b) { return VectorSet(fmaxf(a.f[0], b.f[0]), fmaxf(a.f[1], b.f[1]), fmaxf(a.f[2], b.f[2]), fmaxf(a.f[3], b.f[3])); }
+inline Vector VectorSqrt(Vector v) { return VectorSet(sqrtf(v.f[0]), sqrtf(v.f[1]), sqrtf(v.f[2]), sqrtf(v.f[3])); }
+
+inline Vector Vector4Dot(Vector a, Vector b) { return VectorReplicate(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2] + a.f[3] * b.f[3]); }
+inline Vector Vector3Dot(Vector a, Vector b) { return VectorReplicate(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2]); }
+
+inline Vector Vector3Cross(Vector a, Vector b)
+{
+    return VectorSet(a.f[1] * b.f[2] - a.f[2] * b.f[1],
+                     a.f[2] * b.f[0] - a.f[0] * b.f[2],
+                     a.f[0] * b.f[1] - a.f[1] * b.f[0],
+                     0.0f);
+}
+
+inline Mat4 MatrixTranspose(const Mat4& m)
+{
+    Mat4 result;
+    for (unsigned int row = 0; row < 4; row++)
+    {
+        for (unsigned int column = 0; column < 4; column++)
+            result.r[row].f[column] = m.r[column].f[row];
+    }
+    return result;
+}
+
+#endif
+
+// ======================================================================================
+// Vectors - built on the basics, so the same for every backend
+// ======================================================================================
+inline Vector Vector3LengthSq(Vector v) { return Vector3Dot(v, v); }
+inline Vector Vector3Length(Vector v) { return VectorSqrt(Vector3Dot(v, v)); }
+inline Vector Vector4Length(Vector v) { return VectorSqrt(Vector4Dot(v, v)); }
+
+// A zero length vector comes back as zero
+inline Vector Vector3Normalize(Vector v)
+{
+    Vector length = Vector3Length(v);
+    return (VectorGetX(length) > 0.0f) ? VectorDivide(v, length) : VectorZero();
+}
+
+inline Vector Vector4Normalize(Vector v)
+{
+    Vector length = Vector4Length(v);
+    return (VectorGetX(length) > 0.0f) ? VectorDivide(v, length) : VectorZero();
+}
+
+inline Vector VectorLerp(Vector a, Vector b, float t) { return VectorMultiplyAdd(VectorSubtract(b, a), VectorReplicate(t), a); }
+
+// ======================================================================================
+// Matrices
+// ======================================================================================
+inline Mat4 MatrixSet(float m00, float m01, float m02, float m03,
+                      float m10, float m11, float m12, float m13,
+                      float m20, float m21, float m22, float m23,
+                      float m30, float m31, float m32, float m33)
+{
+    Mat4 result;
+    result.r[0] = VectorSet(m00, m01, m02, m03);
+    result.r[1] = VectorSet(m10, m11, m12, m13);
+    result.r[2] = VectorSet(m20, m21, m22, m23);
+    result.r[3] = VectorSet(m30, m31, m32, m33);
+    return result;
+}
+
+inline Mat4 MatrixIdentity()
+{
+    return MatrixSet(1.0f, 0.0f, 0.0f, 0.0f,
+                     0.0f, 1.0f, 0.0f, 0.0f,
+                     0.0f, 0.0f, 1.0f, 0.0f,
+                     0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline Mat4 MatrixLoad(const Float4x4* source)
+{
+    Mat4 result;
+    for (unsigned int row = 0; row < 4; row++)
+        result.r[row] = VectorLoad4((const Vec4*)source->m[row]);
+    return result;
+}
+
+inline void MatrixStore(Float4x4* destination, const Mat4& m)
+{
+    for (unsigned int row = 0; row < 4; row++)
+        VectorStore4((Vec4*)destination->m[row], m.r[row]);
+}
+
+// v * m with v.w taken as is
+inline Vector Vector4Transform(Vector v, const Mat4& m)
+{
+    Vector result = VectorMultiply(VectorSplatW(v), m.r[3]);
+    result = VectorMultiplyAdd(VectorSplatZ(v), m.r[2], result);
+    result = VectorMultiplyAdd(VectorSplatY(v), m.r[1], result);
+    return VectorMultiplyAdd(VectorSplatX(v), m.r[0], result);
+}
+
+// A point - w is taken as one, and the result is divided through by its w
+inline Vector Vector3TransformCoord(Vector v, const Mat4& m)
+{
+    Vector result = VectorMultiplyAdd(VectorSplatZ(v), m.r[2], m.r[3]);
+    result = VectorMultiplyAdd(VectorSplatY(v), m.r[1], result);
+    result = VectorMultiplyAdd(VectorSplatX(v), m.r[0], result);
+    return VectorDivide(result, VectorSplatW(result));
+}
+
+// A direction - w is taken as zero, so translation doesn't apply
+inline Vector Vector3TransformNormal(Vector v, const Mat4& m)
+{
+    Vector result = VectorMultiply(VectorSplatZ(v), m.r[2]);
+    result = VectorMultiplyAdd(VectorSplatY(v), m.r[1], result);
+    return VectorMultiplyAdd(VectorSplatX(v), m.r[0], result);
+}
+
+// a then b - transforming by the result is transforming by a, then by b
+inline Mat4 MatrixMultiply(const Mat4& a, const Mat4& b)
+{
+    // Copied into locals so the compiler can keep b in registers
+    Mat4 rows = b;
+    Mat4 result;
+    result.r[0] = Vector4Transform(a.r[0], rows);
+    result.r[1] = Vector4Transform(a.r[1], rows);
+    result.r[2] = Vector4Transform(a.r[2], rows);
+    result.r[3] = Vector4Transform(a.r[3], rows);
+    return result;
+}
+
+inline Mat4 MatrixTranslation(float x, float y, float z)
+{
+    return MatrixSet(1.0f, 0.0f, 0.0f, 0.0f,
+                     0.0f, 1.0f, 0.0f, 0.0f,
+                     0.0f, 0.0f, 1.0f, 0.0f,
+                     x,    y,    z,    1.0f);
+}
+
+inline Mat4 MatrixScaling(float x, float y, float z)
+{
+    return MatrixSet(x,    0.0f, 0.0f, 0.0f,
+                     0.0f, y,    0.0f, 0.0f,
+                     0.0f, 0.0f, z,    0.0f,
+                     0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Mat4 MatrixRotationX(float angle);
+Mat4 MatrixRotationY(float angle);
+Mat4 MatrixRotationZ(float angle);
+
+// Roll about z, then pitch about x, then yaw about y - all in radians
+Mat4 MatrixRotationRollPitchYaw(float pitch, float yaw, float roll);
+Mat4 MatrixRotationQuaternion(Quat q);
+
+// Left handed view matrices - from eye looking at focus, or along direction
+Mat4 MatrixLookAtLH(Vector eye, Vector focus, Vector up);
+Mat4 MatrixLookToLH(Vector eye, Vector direction, Vector up);
+
+// General inverse. A singular matrix gives back identity, and a determinant of zero.
+Mat4 MatrixInverse(const Mat4& m, float* determinant = nullptr);
+
+// Inverse of a rotation and translation - a view matrix, say - without the general case's work
+Mat4 MatrixRigidInverse(const Mat4& m);
+
+// Left handed projection with depth going from zero at nearZ to one at farZ. farZ can be
+// INFINITY, for a far plane that never clips.
+Mat4 MatrixPerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ);
+
+// The same with depth reversed - one at nearZ and zero at farZ. Floats are densest near zero,
+// so this spreads depth precision far more evenly, most of all with farZ at INFINITY.
+Mat4 MatrixPerspectiveFovReversedLH(float fovY, float aspect, float nearZ, float farZ);
+
+// ======================================================================================
+// Quaternions
+// ======================================================================================
+inline Quat QuaternionIdentity() { return VectorSet(0.0f, 0.0f, 0.0f, 1.0f); }
+inline Quat QuaternionNormalize(Quat q) { return Vector4Normalize(q); }
+inline Quat QuaternionConjugate(Quat q) { return VectorMultiply(q, VectorSet(-1.0f, -1.0f, -1.0f, 1.0f)); }
+
+// a then b, the same order as MatrixMultiply
+Quat QuaternionMultiply(Quat a, Quat b);
+
+Quat QuaternionRotationAxis(Vector axis, float angle);
+Quat QuaternionRotationRollPitchYaw(float pitch, float yaw, float roll);
+
+// Shortest path, falling back to a normalized lerp when a and b are nearly the same
+Quat QuaternionSlerp(Quat a, Quat b, float t);
+
+inline Vector Vector3Rotate(Vector v, Quat q)
+{
+    // v + 2w(q x v) + q x (2(q x v)), which is q v q* without the full products
+    Vector t = Vector3Cross(q, v);
+    t = VectorAdd(t, t);
+    Vector result = VectorMultiplyAdd(VectorSplatW(q), t, v);
+    return VectorAdd(result, Vector3Cross(q, t));
+}
+
+// ======================================================================================
+// Frustums
+// ======================================================================================
+enum FrustumPlane
+{
+    FP_Left,
+    FP_Right,
+    FP_Bottom,
+    FP_Top,
+    FP_Near,
+    FP_Far,
+
+    FP_Count
+};
+
+// Normalized planes facing inwards - a point p is inside a plane when dot(plane, (p, 1)) >= 0.
+// A plane at infinity is stored as (0, 0, 0, 1), which everything is inside.
+struct Frustum
+{
+    Vector Planes[FP_Count];
+};
+
+// Planes straight out of a view-projection matrix (Gribb & Hartmann). reversedZ says which of
+// the depth planes is the near one.
+void FrustumFromMatrix(const Mat4& viewProjection, bool reversedZ, Frustum& frustum);
+
+inline bool FrustumIntersectsSphere(const Frustum& frustum, Vector center, float radius)
+{
+    Vector point = VectorSetW(center, 1.0f);
+    for (unsigned int plane = 0; plane < FP_Count; plane++)
+    {
+        if (VectorGetX(Vector4Dot(frustum.Planes[plane], point)) < -radius)
+            return false;
+    }
+    return true;
+}
+
+// ======================================================================================
+// Batches - whole arrays at once. Input and output may be the same array.
+// ======================================================================================
+
+// Points with w taken as one and no divide - for affine transforms
+void TransformPoints(const Mat4& m, const Vec3* input, Vec3* output, unsigned int count);
+
+void TransformVectors(const Mat4& m, const Vec4* input, Vec4* output, unsigned int count);
+
+// output[i] = a[i] * b[i]
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* output, unsigned int count);
+
+// output[i] = local[i] * parent - a set of children under one parent
+void MultiplyMatrices(const Mat4* local, const Mat4& parent, Mat4* output, unsigned int count);
+
+} // namespace Math
@@ -0,0 +1,314 @@
+///
+/// SimdMathBenchmark.cpp - Microbenchmarks for SimdMath.
+///
+
+#include "SimdMathBenchmark.h"
+#include "SimdMath.h"
+
+#include <chrono>
+#include <math.h>
+
+typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+const unsigned int kPointCount      = 1 << 16;
+const unsigned int kMatrixCount     = 1 << 12;
+const unsigned int kCameraCount     = 1 << 12;
+
+// Best of this many passes, so one slow pass doesn't skew the result
+const unsigned int kPassCount       = 8;
+
+static double SecondsSince(BenchmarkClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+}
+
+// Deterministic values in [-1, 1), so runs are comparable
+static float NextValue(unsigned int& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1 << 23) - 1.0f;
+}
+
+static void MaxDifference(const float* a, const float* b, unsigned int count, float& maxError)
+{
+    for (unsigned int index = 0; index < count; index++)
+    {
+        float error = fabsf(a[index] - b[index]);
+        if (error > maxError)
+            maxError = error;
+    }
+}
+
+// ======================================================================================
+// Scalar reference - the same math written out with plain floats
+// ======================================================================================
+static void ScalarMultiply(const Math::Float4x4& a, const Math::Float4x4& b, Math::Float4x4& result)
+{
+    for (unsigned int row = 0; row < 4; row++)
+    {
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            result.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column]
+                                  + a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column];
+        }
+    }
+}
+
+static void ScalarTransformPoints(const Math::Float4x4& m, const Math::Vec3* input, Math::Vec3* output, unsigned int count)
+{
+    for (unsigned int index = 0; index < count; index++)
+    {
+        Math::Vec3 point = input[index];
+        output[index].x = point.x * m.m[0][0] + point.y * m.m[1][0] + point.z * m.m[2][0] + m.m[3][0];
+        output[index].y = point.x * m.m[0][1] + point.y * m.m[1][1] + point.z * m.m[2][1] + m.m[3][1];
+        output[index].z = point.x * m.m[0][2] + point.y * m.m[1][2] + point.z * m.m[2][2] + m.m[3][2];
+    }
+}
+
+static void ScalarCross(const float* a, const float* b, float* result)
+{
+    result[0] = a[1] * b[2] - a[2] * b[1];
+    result[1] = a[2] * b[0] - a[0] * b[2];
+    result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void ScalarNormalize(float* v)
+{
+    float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    v[0] /= length;
+    v[1] /= length;
+    v[2] /= length;
+}
+
+// A point through m, divided through by w
+static void ScalarTransformCoord(const float* point, const Math::Float4x4& m, float* result)
+{
+    float w = point[0] * m.m[0][3] + point[1] * m.m[1][3] + point[2] * m.m[2][3] + m.m[3][3];
+    for (unsigned int column = 0; column < 3; column++)
+        result[column] = (point[0] * m.m[0][column] + point[1] * m.m[1][column] + point[2] * m.m[2][column] + m.m[3][column]) / w;
+}
+
+// Camera::Render's view matrix, step for step
+static void ScalarCameraView(const Math::Vec3& position, const Math::Vec3& rotation, Math::Float4x4& view)
+{
+    float sp = sinf(rotation.x), cp = cosf(rotation.x);
+    float sy = sinf(rotation.y), cy = cosf(rotation.y);
+    float sr = sinf(rotation.z), cr = cosf(rotation.z);
+
+    Math::Float4x4 rotationMatrix =
+    {{
+        { cr * cy + sr * sp * sy, sr * cp, sr * sp * cy - cr * sy, 0.0f },
+        { cr * sp * sy - sr * cy, cr * cp, sr * sy + cr * sp * cy, 0.0f },
+        { cp * sy,                -sp,     cp * cy,                0.0f },
+        { 0.0f,                   0.0f,    0.0f,                   1.0f },
+    }};
+
+    const float forward[3] = { 0.0f, 0.0f, 1.0f };
+    const float upward[3] = { 0.0f, 1.0f, 0.0f };
+    float lookAt[3];
+    float up[3];
+    ScalarTransformCoord(forward, rotationMatrix, lookAt);
+    ScalarTransformCoord(upward, rotationMatrix, up);
+
+    // Look at position + lookAt, so the direction is lookAt again
+    float axisZ[3] = { (position.x + lookAt[0]) - position.x, (position.y + lookAt[1]) - position.y, (position.z + lookAt[2]) - position.z };
+    ScalarNormalize(axisZ);
+    float axisX[3];
+    ScalarCross(up, axisZ, axisX);
+    ScalarNormalize(axisX);
+    float axisY[3];
+    ScalarCross(axisZ, axisX, axisY);
+
+    const float* axes[3] = { axisX, axisY, axisZ };
+    for (unsigned int column = 0; column < 3; column++)
+    {
+        const float* axis = axes[column];
+        view.m[0][column] = axis[0];
+        view.m[1][column] = axis[1];
+        view.m[2][column] = axis[2];
+        view.m[3][column] = -(axis[0] * position.x + axis[1] * position.y + axis[2] * position.z);
+    }
+
+    view.m[0][3] = 0.0f;
+    view.m[1][3] = 0.0f;
+    view.m[2][3] = 0.0f;
+    view.m[3][3] = 1.0f;
+}
+
+// Camera::Render's view matrix through SimdMath
+static Math::Mat4 SimdCameraView(const Math::Vec3& position, const Math::Vec3& rotation)
+{
+    Math::Mat4 rotationMatrix = Math::MatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+    Math::Vector lookAt = Math::Vector3TransformCoord(Math::VectorSet(0.0f, 0.0f, 1.0f, 0.0f), rotationMatrix);
+    Math::Vector up = Math::Vector3TransformCoord(Math::VectorSet(0.0f, 1.0f, 0.0f, 0.0f), rotationMatrix);
+    Math::Vector eye = Math::VectorLoad3(&position);
+
+    return Math::MatrixLookAtLH(eye, Math::VectorAdd(eye, lookAt), up);
+}
+
+// ======================================================================================
+// Benchmarks
+// ======================================================================================
+static SimdMathBenchmarkResult MeasureTransformPoints()
+{
+    unsigned int state = 1;
+    std::vector<Math::Vec3> input(kPointCount);
+    for (auto& point : input)
+    {
+        point.x = NextValue(state) * 100.0f;
+        point.y = NextValue(state) * 100.0f;
+        point.z = NextValue(state) * 100.0f;
+    }
+
+    Math::Mat4 matrix = Math::MatrixMultiply(Math::MatrixRotationRollPitchYaw(0.3f, 0.7f, 0.1f), Math::MatrixTranslation(5.0f, -2.0f, 9.0f));
+    Math::Float4x4 stored;
+    Math::MatrixStore(&stored, matrix);
+
+    std::vector<Math::Vec3> scalarOutput(kPointCount);
+    std::vector<Math::Vec3> simdOutput(kPointCount);
+
+    SimdMathBenchmarkResult result;
+    result.Name = "transform_points";
+    result.Count = kPointCount;
+    result.ScalarNanoseconds = 1e30;
+    result.SimdNanoseconds = 1e30;
+
+    for (unsigned int pass = 0; pass < kPassCount; pass++)
+    {
+        BenchmarkClock::time_point start = BenchmarkClock::now();
+        ScalarTransformPoints(stored, input.data(), scalarOutput.data(), kPointCount);
+        double scalar = SecondsSince(start) * 1e9 / kPointCount;
+
+        start = BenchmarkClock::now();
+        Math::TransformPoints(matrix, input.data(), simdOutput.data(), kPointCount);
+        double simd = SecondsSince(start) * 1e9 / kPointCount;
+
+        if (scalar < result.ScalarNanoseconds)
+            result.ScalarNanoseconds = scalar;
+        if (simd < result.SimdNanoseconds)
+            result.SimdNanoseconds = simd;
+    }
+
+    result.MaxError = 0.0f;
+    MaxDifference(&scalarOutput[0].x, &simdOutput[0].x, kPointCount * 3, result.MaxError);
+    return result;
+}
+
+static SimdMathBenchmarkResult MeasureMultiplyMatrices()
+{
+    unsigned int state = 2;
+    std::vector<Math::Mat4> a(kMatrixCount);
+    std::vector<Math::Mat4> b(kMatrixCount);
+    std::vector<Math::Float4x4> storedA(kMatrixCount);
+    std::vector<Math::Float4x4> storedB(kMatrixCount);
+
+    for (unsigned int index = 0; index < kMatrixCount; index++)
+    {
+        for (unsigned int row = 0; row < 4; row++)
+        {
+            for (unsigned int column = 0; column < 4; column++)
+            {
+                storedA[index].m[row][column] = NextValue(state);
+                storedB[index].m[row][column] = NextValue(state);
+            }
+        }
+        a[index] = Math::MatrixLoad(&storedA[index]);
+        b[index] = Math::MatrixLoad(&storedB[index]);
+    }
+
+    std::vector<Math::Float4x4> scalarOutput(kMatrixCount);
+    std::vector<Math::Mat4> simdOutput(kMatrixCount);
+
+    SimdMathBenchmarkResult result;
+    result.Name = "multiply_matrices";
+    result.Count = kMatrixCount;
+    result.ScalarNanoseconds = 1e30;
+    result.SimdNanoseconds = 1e30;
+
+    for (unsigned int pass = 0; pass < kPassCount; pass++)
+    {
+        BenchmarkClock::time_point start = BenchmarkClock::now();
+        for (unsigned int index = 0; index < kMatrixCount; index++)
+            ScalarMultiply(storedA[index], storedB[index], scalarOutput[index]);
+        double scalar = SecondsSince(start) * 1e9 / kMatrixCount;
+
+        start = BenchmarkClock::now();
+        Math::MultiplyMatrices(a.data(), b.data(), simdOutput.data(), kMatrixCount);
+        double simd = SecondsSince(start) * 1e9 / kMatrixCount;
+
+        if (scalar < result.ScalarNanoseconds)
+            result.ScalarNanoseconds = scalar;
+        if (simd < result.SimdNanoseconds)
+            result.SimdNanoseconds = simd;
+    }
+
+    result.MaxError = 0.0f;
+    for (unsigned int index = 0; index < kMatrixCount; index++)
+    {
+        Math::Float4x4 stored;
+        Math::MatrixStore(&stored, simdOutput[index]);
+        MaxDifference(&scalarOutput[index].m[0][0], &stored.m[0][0], 16, result.MaxError);
+    }
+    return result;
+}
+
+static SimdMathBenchmarkResult MeasureCameraView()
+{
+    unsigned int state = 3;
+    std::vector<Math::Vec3> positions(kCameraCount);
+    std::vector<Math::Vec3> rotations(kCameraCount);
+    for (unsigned int index = 0; index < kCameraCount; index++)
+    {
+        positions[index].x = NextValue(state) * 50.0f;
+        positions[index].y = NextValue(state) * 50.0f;
+        positions[index].z = NextValue(state) * 50.0f;
+
+        // Keep pitch off the poles, where up and forward line up
+        rotations[index].x = NextValue(state) * 1.2f;
+        rotations[index].y = NextValue(state) * Math::kPi;
+        rotations[index].z = NextValue(state) * 0.5f;
+    }
+
+    std::vector<Math::Float4x4> scalarOutput(kCameraCount);
+    std::vector<Math::Float4x4> simdOutput(kCameraCount);
+
+    SimdMathBenchmarkResult result;
+    result.Name = "camera_view";
+    result.Count = kCameraCount;
+    result.ScalarNanoseconds = 1e30;
+    result.SimdNanoseconds = 1e30;
+
+    for (unsigned int pass = 0; pass < kPassCount; pass++)
+    {
+        BenchmarkClock::time_point start = BenchmarkClock::now();
+        for (unsigned int index = 0; index < kCameraCount; index++)
+            ScalarCameraView(positions[index], rotations[index], scalarOutput[index]);
+        double scalar = SecondsSince(start) * 1e9 / kCameraCount;
+
+        start = BenchmarkClock::now();
+        for (unsigned int index = 0; index < kCameraCount; index++)
+            Math::MatrixStore(&simdOutput[index], SimdCameraView(positions[index], rotations[index]));
+        double simd = SecondsSince(start) * 1e9 / kCameraCount;
+
+        if (scalar < result.ScalarNanoseconds)
+            result.ScalarNanoseconds = scalar;
+        if (simd < result.SimdNanoseconds)
+            result.SimdNanoseconds = simd;
+    }
+
+    result.MaxError = 0.0f;
+    MaxDifference(&scalarOutput[0].m[0][0], &simdOutput[0].m[0][0], kCameraCount * 16, result.MaxError);
+    return result;
+}
+
+void RunSimdMathBenchmarks(std::vector<SimdMathBenchmarkResult>& results)
+{
+    SimdMathBenchmarkResult (*benchmarks[])() = { &MeasureTransformPoints, &MeasureMultiplyMatrices, &MeasureCameraView };
+
+    for (auto benchmark : benchmarks)
+    {
+        SimdMathBenchmarkResult result = benchmark();
+        result.Speedup = (result.SimdNanoseconds > 0.0) ? result.ScalarNanoseconds / result.SimdNanoseconds : 0.0;
+        results.push_back(result);
+    }
+}
@@ -0,0 +1,22 @@
+///
+/// SimdMathBenchmark.h - Microbenchmarks for SimdMath.
+/// Times the batch transforms, matrix products and the camera's view matrix build against
+/// plain float loops doing the same work, and checks the two agree. The benchmark runner
+/// reports the results; nothing here prints.
+///
+#pragma once
+
+#include <vector>
+
+struct SimdMathBenchmarkResult
+{
+    const char*     Name;
+    unsigned int    Count;                  // items per pass
+
+    double          ScalarNanoseconds;      // per item, plain float reference
+    double          SimdNanoseconds;        // per item, SimdMath with this build's backend
+    double          Speedup;                // scalar time over SIMD time
+    float           MaxError;               // largest difference between the two results
+};
+
+void RunSimdMathBenchmarks(std::vector<SimdMathBenchmarkResult>& results);
@@ -0,0 +1,30 @@
+///
+/// SimdMathDirectX.h - Moving SimdMath matrices to and from DirectXMath.
+/// Kept out of SimdMath.h so the math builds where DirectXMath doesn't.
+///
+#pragma once
+
+#include "utils\SimdMath.h"
+
+#include <DirectXMath.h>
+
+namespace Math
+{
+
+static_assert(sizeof(Float4x4) == sizeof(DirectX::XMFLOAT4X4), "Float4x4 must match XMFLOAT4X4");
+
+inline DirectX::XMMATRIX ToXMMatrix(const Mat4& m)
+{
+    Float4x4 stored;
+    MatrixStore(&stored, m);
+    return DirectX::XMLoadFloat4x4((const DirectX::XMFLOAT4X4*)&stored);
+}
+
+inline Mat4 FromXMMatrix(const DirectX::XMMATRIX& m)
+{
+    Float4x4 stored;
+    DirectX::XMStoreFloat4x4((DirectX::XMFLOAT4X4*)&stored, m);
+    return MatrixLoad(&stored);
+}
+
+} // namespace Math
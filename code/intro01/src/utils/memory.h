@@ -1,6 +1,9 @@
 #pragma once
 
-#ifdef _DEBUG
-#define DEBUG_NEW new(_NORMAL_BLOCK, __FILE__, __LINE__)
+#include "utils\MemoryTracker.h"
+
+// Records the file and line of every new in the files that include this - keep it last
+#if USING(TRACK_ALLOCATIONS)
+#define DEBUG_NEW new(__FILE__, __LINE__)
 #define new DEBUG_NEW
-#endif
\ No newline at end of file
+#endif
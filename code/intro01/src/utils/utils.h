@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+
 // A great way to fix the suckage of #if vs #ifdef vs #ifndef
 // If you end up using the macro USING on an undefined variable, you end
 // up with a compiler error:
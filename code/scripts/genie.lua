@@ -38,9 +38,9 @@ os.mkdir(PDB_DIR)
 configuration {"Debug", "x32"}
   defines { "WIN32", "_DEBUG", "_WINDOWS", "_UNICODE", "UNICODE", "%(PreprocessorDefinitions)" }
   libdirs { path.join(THIRD_PARTY_DIR, "assimp/lib/win32/Debug")}
-  links {"D3D11", "D3DCompiler"}
+  links {"D3D11", "D3DCompiler", "dxguid"}
   links {"assimp-vc140-mt","zlibstaticd"}
-  links {"kernel32","user32","gdi32","winspool","comdlg32","advapi32","shell32","ole32","oleaut32","uuid","odbc32","odbccp32", "winmm", "dxgi"}
+  links {"kernel32","user32","gdi32","winspool","comdlg32","advapi32","shell32","ole32","oleaut32","uuid","odbc32","odbccp32", "winmm", "dxgi", "windowscodecs"}
   flags {"ExtraWarnings"}
   -- To reproduce the linker bug reported in https://github.com/bkaradzic/GENie/issues/266
   -- comment out the two lines below.
@@ -54,9 +54,9 @@ configuration {"Debug", "x32"}
 configuration {"Debug", "x64"}
   defines { "WIN32", "_DEBUG", "_WINDOWS", "_UNICODE", "UNICODE", "%(PreprocessorDefinitions)" }
   libdirs { path.join(THIRD_PARTY_DIR, "assimp/lib/win64/Debug")}
-  links {"D3D11", "D3DCompiler"}
+  links {"D3D11", "D3DCompiler", "dxguid"}
   links {"assimp-vc140-mt","zlibstaticd"}
-  links {"kernel32","user32","gdi32","winspool","comdlg32","advapi32","shell32","ole32","oleaut32","uuid","odbc32","odbccp32", "winmm", "dxgi"}
+  links {"kernel32","user32","gdi32","winspool","comdlg32","advapi32","shell32","ole32","oleaut32","uuid","odbc32","odbccp32", "winmm", "dxgi", "windowscodecs"}
   flags {"ExtraWarnings"}
   -- To reproduce the linker bug reported in https://github.com/bkaradzic/GENie/issues/266
   -- comment out the two lines below.
@@ -71,9 +71,9 @@ configuration {"Debug", "x64"}
 configuration {"Release", "x32"}
   defines { "WIN32", "NDEBUG", "_WINDOWS", "_UNICODE", "UNICODE", "%(PreprocessorDefinitions)" }
   libdirs { path.join(THIRD_PARTY_DIR, "assimp/lib/win32/Release") }
-  links {"D3D11", "D3DCompiler"}
+  links {"D3D11", "D3DCompiler", "dxguid"}
   links {"assimp-vc140-mt","zlibstatic"}
-  links {"kernel32","user32","gdi32","winspool","comdlg32","advapi32","shell32","ole32","oleaut32","uuid","odbc32","odbccp32", "winmm", "dxgi"}
+  links {"kernel32","user32","gdi32","winspool","comdlg32","advapi32","shell32","ole32","oleaut32","uuid","odbc32","odbccp32", "winmm", "dxgi", "windowscodecs"}
   flags {"Optimize", "ExtraWarnings"}
   postbuildcommands { "xcopy ..\\..\\3rdparty\\assimp\\bin\\Release\\assimp-vc140-mt.dll $(TargetDir) /Y ",
                       "xcopy ..\\..\\..\\assets\\raw\\*.*  $(TargetDir)assets\\raw\\ /Y /E",
@@ -83,9 +83,9 @@ configuration {"Release", "x32"}
 configuration {"Release", "x64"}
   defines { "WIN32", "NDEBUG", "_WINDOWS", "_UNICODE", "UNICODE", "%(PreprocessorDefinitions)" }
   libdirs { path.join(THIRD_PARTY_DIR, "assimp/lib/win64/Release") }
-  links {"D3D11", "D3DCompiler"}
+  links {"D3D11", "D3DCompiler", "dxguid"}
   links {"assimp-vc140-mt","zlibstatic"}
-  links {"kernel32","user32","gdi32","winspool","comdlg32","advapi32","shell32","ole32","oleaut32","uuid","odbc32","odbccp32", "winmm", "dxgi"}
+  links {"kernel32","user32","gdi32","winspool","comdlg32","advapi32","shell32","ole32","oleaut32","uuid","odbc32","odbccp32", "winmm", "dxgi", "windowscodecs"}
   flags {"Optimize", "ExtraWarnings"}
   postbuildcommands { "xcopy ..\\..\\3rdparty\\assimp\\bin\\Release\\assimp-vc140-mt.dll $(TargetDir) /Y ",
                       "xcopy ..\\..\\..\\assets\\raw\\*.*  $(TargetDir)assets\\raw\\ /Y /E",
@@ -140,21 +140,83 @@ project "tutorial01"
 -- A stub project
 project "testbed"
   PROJ_DIR = path.join(WORKSPACE_DIR, "testbed")
+  INTRO01_DIR = path.join(WORKSPACE_DIR, "intro01")
   flags { "WinMain", "NoExceptions" }
 
   kind "WindowedApp"
   debugdir "$(TargetDir)"
 
   includedirs {
-    path.join(PROJ_DIR, "src")
+    path.join(PROJ_DIR, "src"),
+    path.join(INTRO01_DIR, "src")
   }
 
+  -- Frame telemetry is shared with intro01
   files {
     path.join(PROJ_DIR, "src/**.h"),
     path.join(PROJ_DIR, "src/**.cpp"),
-    path.join(PROJ_DIR, "src/testbed.rc")
+    path.join(PROJ_DIR, "src/testbed.rc"),
+    path.join(INTRO01_DIR, "src/utils/FrameTelemetry.h"),
+    path.join(INTRO01_DIR, "src/utils/FrameTelemetry.cpp"),
   }
 
   resoptions {
     "src/testbed.rc"
   }
+
+-- Headless benchmark runner - intro01's engine code, driven without a window
+project "benchrunner"
+  PROJ_DIR = path.join(WORKSPACE_DIR, "benchrunner")
+  INTRO01_DIR = path.join(WORKSPACE_DIR, "intro01")
+  flags { "NoExceptions" }
+
+  kind "ConsoleApp"
+  debugdir "$(TargetDir)"
+
+  -- The allocation counters are part of what it measures, Release included
+  defines { "TRACK_ALLOCATIONS=ON" }
+
+  includedirs {
+    path.join(PROJ_DIR, "src"),
+    path.join(INTRO01_DIR, "src"),
+    path.join(THIRD_PARTY_DIR, "assimp/include")
+  }
+
+  files {
+    path.join(PROJ_DIR, "src/**.h"),
+    path.join(PROJ_DIR, "src/**.cpp"),
+    path.join(INTRO01_DIR, "src/**.h"),
+    path.join(INTRO01_DIR, "src/**.cpp"),
+  }
+
+  -- Everything but the windowed entry point
+  excludes {
+    path.join(INTRO01_DIR, "src/Intro01.cpp"),
+  }
+
+-- Offline shader permutation compiler - builds the shader pack intro01 loads
+project "shadertool"
+  PROJ_DIR = path.join(WORKSPACE_DIR, "shadertool")
+  INTRO01_DIR = path.join(WORKSPACE_DIR, "intro01")
+  flags { "NoExceptions" }
+
+  kind "ConsoleApp"
+  debugdir "$(TargetDir)"
+
+  includedirs {
+    path.join(PROJ_DIR, "src"),
+    path.join(INTRO01_DIR, "src"),
+    path.join(THIRD_PARTY_DIR, "assimp/include")
+  }
+
+  files {
+    path.join(PROJ_DIR, "src/**.h"),
+    path.join(PROJ_DIR, "src/**.cpp"),
+    path.join(INTRO01_DIR, "src/**.h"),
+    path.join(INTRO01_DIR, "src/**.cpp"),
+  }
+
+  -- Everything but the windowed entry point
+  excludes {
+    path.join(INTRO01_DIR, "src/Intro01.cpp"),
+  }
@@ -0,0 +1,153 @@
+///
+/// main.cpp - Offline shader permutation compiler.
+/// Reads a manifest of shaders and the variants each one needs, compiles every variant on
+/// the job system's threads and packs the bytecode into a ShaderPack for AssetManager to
+/// load - so nothing has to be compiled when the game starts.
+///
+/// Usage: shadertool <manifest> <output pack> [--cache dir] [--threads N] [--debug] [--cpu]
+///
+/// --cpu builds the pack with CpuShaderCompiler instead of D3D, for CpuShaderExecutor to run.
+///
+/// The manifest format is described in ShaderPermutation.h. Every compiled variant also goes
+/// into the shader cache, so running it again only compiles what's changed.
+///
+
+#include "stdafx.h"
+
+#include "Graphics\CpuShaderCompiler.h"
+#include "Graphics\D3DShaderCompiler.h"
+#include "Graphics\ShaderPermutation.h"
+#include "utils\JobSystem.h"
+
+#include <d3dcompiler.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+struct ToolOptions
+{
+    std::string     Manifest;
+    std::string     Output;
+    std::string     CacheDirectory;
+    unsigned int    Threads;
+    bool            Debug;
+    bool            Cpu;
+};
+
+static void PrintUsage()
+{
+    fprintf(stderr, "usage: shadertool <manifest> <output pack> [--cache dir] [--threads N] [--debug] [--cpu]\n");
+}
+
+static bool ParseArguments(int argc, char* argv[], ToolOptions& options)
+{
+    options.CacheDirectory = "shadercache";
+    options.Threads = 0;
+    options.Debug = false;
+    options.Cpu = false;
+
+    for (int index = 1; index < argc; index++)
+    {
+        const char* argument = argv[index];
+        const char* value = (index + 1 < argc) ? argv[index + 1] : nullptr;
+
+        if (strcmp(argument, "--debug") == 0)
+        {
+            options.Debug = true;
+            continue;
+        }
+
+        if (strcmp(argument, "--cpu") == 0)
+        {
+            options.Cpu = true;
+            continue;
+        }
+
+        if (strncmp(argument, "--", 2) != 0)
+        {
+            if (options.Manifest.empty())
+                options.Manifest = argument;
+            else if (options.Output.empty())
+                options.Output = argument;
+            else
+                return false;
+            continue;
+        }
+
+        if (value == nullptr)
+            return false;
+        index++;
+
+        if (strcmp(argument, "--cache") == 0)
+            options.CacheDirectory = value;
+        else if (strcmp(argument, "--threads") == 0)
+            options.Threads = (unsigned int)atoi(value);
+        else
+            return false;
+    }
+
+    return !options.Manifest.empty() && !options.Output.empty();
+}
+
+int main(int argc, char* argv[])
+{
+    ToolOptions options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    // Release bytecode unless asked - the pack is what ships
+    unsigned int flags = D3DCOMPILE_ENABLE_STRICTNESS;
+    if (options.Debug)
+        flags |= D3DCOMPILE_DEBUG;
+
+    D3DShaderCompiler d3dCompiler;
+    CpuShaderCompiler cpuCompiler;
+    IShaderCompiler* compiler = &d3dCompiler;
+    if (options.Cpu)
+    {
+        // The CPU compiler has no flags, and its name keeps its entries apart in the cache
+        compiler = &cpuCompiler;
+        flags = 0;
+    }
+
+    ShaderPackBuilder builder(compiler, options.CacheDirectory.c_str(), flags);
+
+    std::string errors;
+    if (!builder.LoadManifest(options.Manifest.c_str(), errors))
+    {
+        fprintf(stderr, "%s", errors.c_str());
+        return 1;
+    }
+
+    JobSystem jobs;
+    jobs.Initialize(options.Threads);
+
+    auto start = std::chrono::steady_clock::now();
+    ShaderPackBuilder::Result result = builder.Build(&jobs, errors);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned int threads = jobs.GetThreadCount();
+    jobs.Shutdown();
+
+    printf("shadertool: %u variants on %u threads in %.2fs - %u from the cache, %u failed\n",
+           result.Variants, threads, seconds, result.CacheHits, result.Failures);
+
+    if (result.Failures > 0)
+    {
+        fprintf(stderr, "%s", errors.c_str());
+        return 1;
+    }
+
+    if (!builder.Write(options.Output.c_str()))
+    {
+        fprintf(stderr, "shadertool: couldn't write %s\n", options.Output.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "GameLoop.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <timeapi.h>
+#else
+#include <thread>
+#endif
+
+const double kMaxSleepEstimate = 0.004;
+
+GameLoop::GameLoop(double fixedStep)
+    : mFixedStep(fixedStep)
+    , mMaxFrameTime(0.25)
+    , mTargetFrameTime(0.0)
+    , mSpinThreshold(0.0005)
+    , mSleepEstimate(0.001)
+    , mAccumulator(0.0)
+    , mSimulationTime(0.0)
+    , mFrameTime(0.0)
+    , mStepsThisFrame(0)
+    , mFrameCount(0)
+    , mTimerPeriodSet(false)
+{
+}
+
+GameLoop::~GameLoop()
+{
+#if defined(_WIN32)
+    if (mTimerPeriodSet)
+        timeEndPeriod(1);
+#endif
+}
+
+void GameLoop::SetTargetFrameRate(double framesPerSecond)
+{
+    mTargetFrameTime = (framesPerSecond > 0.0) ? 1.0 / framesPerSecond : 0.0;
+
+#if defined(_WIN32)
+    // Sleep(1) rounds up to the scheduler tick, which defaults to 15.6ms
+    if ((mTargetFrameTime > 0.0) && !mTimerPeriodSet)
+        mTimerPeriodSet = (timeBeginPeriod(1) == TIMERR_NOERROR);
+#endif
+}
+
+void GameLoop::Start()
+{
+    mPreviousFrame = Clock::now();
+    mFrameStart = mPreviousFrame;
+    mAccumulator = 0.0;
+    mSimulationTime = 0.0;
+    mFrameCount = 0;
+}
+
+void GameLoop::BeginFrame()
+{
+    mFrameStart = Clock::now();
+    mFrameTime = Seconds(mFrameStart - mPreviousFrame);
+    mPreviousFrame = mFrameStart;
+
+    double elapsed = mFrameTime;
+    if (elapsed > mMaxFrameTime)
+        elapsed = mMaxFrameTime;
+
+    mAccumulator += elapsed;
+    mStepsThisFrame = 0;
+}
+
+bool GameLoop::Step()
+{
+    if (mAccumulator < mFixedStep)
+        return false;
+
+    mAccumulator -= mFixedStep;
+    mSimulationTime += mFixedStep;
+    mStepsThisFrame++;
+    return true;
+}
+
+void GameLoop::EndFrame()
+{
+    mFrameCount++;
+
+    if (mTargetFrameTime <= 0.0)
+        return;
+
+    Clock::time_point deadline = mFrameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(mTargetFrameTime));
+    WaitUntil(deadline);
+}
+
+void GameLoop::WaitUntil(Clock::time_point deadline)
+{
+    // Sleep while there's comfortably more than one sleep left
+    for (;;)
+    {
+        Clock::time_point now = Clock::now();
+        double remaining = Seconds(deadline - now);
+        if (remaining <= mSpinThreshold + mSleepEstimate)
+            break;
+
+#if defined(_WIN32)
+        Sleep(1);
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+
+        // Track what a sleep actually costs - quick to learn about slow ones, slow to
+        // forget them. Capped so one preempted sleep doesn't turn into spinning forever.
+        double slept = Seconds(Clock::now() - now);
+        double rate = (slept > mSleepEstimate) ? 0.5 : 0.05;
+        mSleepEstimate += (slept - mSleepEstimate) * rate;
+        if (mSleepEstimate > kMaxSleepEstimate)
+            mSleepEstimate = kMaxSleepEstimate;
+    }
+
+    // Then spin for the last stretch
+    while (Clock::now() < deadline)
+    {
+#if defined(_WIN32)
+        YieldProcessor();
+#endif
+    }
+}
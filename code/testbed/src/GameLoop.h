@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+
+// Fixed timestep game loop.
+//
+// Real time is accumulated each frame and the simulation is advanced in fixed steps,
+// so it behaves the same whatever the frame rate. Whatever is left over in the
+// accumulator becomes the interpolation factor for rendering between the last two
+// simulation states. Frames can be paced to a target rate: the loop sleeps for the
+// coarse part of the wait and spins for the last stretch, since the OS scheduler
+// can't be trusted to wake us up on time.
+//
+//     loop.Start();
+//     while (running)
+//     {
+//         loop.BeginFrame();
+//         while (loop.Step())
+//             Update(loop.GetFixedStep());
+//         Render(loop.GetAlpha());
+//         loop.EndFrame();
+//     }
+class GameLoop
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    GameLoop(double fixedStep = 1.0 / 60.0);
+    ~GameLoop();
+
+    // Zero leaves pacing to vsync or to whatever the frame costs
+    void SetTargetFrameRate(double framesPerSecond);
+
+    // Wall time beyond this is dropped, so a breakpoint or a hitch doesn't
+    // turn into hundreds of catch-up steps
+    void SetMaxFrameTime(double seconds) { mMaxFrameTime = seconds; }
+
+    // How close to the deadline we stop sleeping and start spinning
+    void SetSpinThreshold(double seconds) { mSpinThreshold = seconds; }
+
+    void Start();
+
+    // Measures the time since the last frame and adds it to the accumulator
+    void BeginFrame();
+
+    // True while there's a whole step left in the accumulator. Consumes it.
+    bool Step();
+
+    // Waits out the rest of the frame if there's a target rate
+    void EndFrame();
+
+    double GetFixedStep() const { return mFixedStep; }
+
+    // How far we are between the previous simulation state and the current one, [0, 1)
+    float GetAlpha() const { return (float)(mAccumulator / mFixedStep); }
+
+    double GetSimulationTime() const { return mSimulationTime; }
+    double GetFrameTime() const { return mFrameTime; }              // wall time of the last frame
+    unsigned int GetStepsThisFrame() const { return mStepsThisFrame; }
+    unsigned long long GetFrameCount() const { return mFrameCount; }
+
+private:
+    void WaitUntil(Clock::time_point deadline);
+
+    static double Seconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+private:
+    double              mFixedStep;
+    double              mMaxFrameTime;
+    double              mTargetFrameTime;
+    double              mSpinThreshold;
+
+    // Running estimate of how long a one millisecond sleep really takes
+    double              mSleepEstimate;
+
+    Clock::time_point   mPreviousFrame;
+    Clock::time_point   mFrameStart;
+    double              mAccumulator;
+    double              mSimulationTime;
+    double              mFrameTime;
+
+    unsigned int        mStepsThisFrame;
+    unsigned long long  mFrameCount;
+    bool                mTimerPeriodSet;
+};
@@ -12,6 +12,8 @@
 #include <string>
 
 #include "utils.h"
+#include "GameLoop.h"
+#include "utils\FrameTelemetry.h"
 #include "Resource.h"
 
 using namespace DirectX;
@@ -25,6 +27,17 @@ HWND gWindowHandle          = 0;
 
 const BOOL gEnableVSync    = FALSE;
 
+// Simulation rate, and the frame rate we pace to when vsync is off
+const double gSimulationRate    = 60.0;
+const double gTargetFrameRate   = 120.0;
+
+// Per stage frame times, written out when the loop exits
+FrameTelemetry              gTelemetry;
+unsigned int                gUpdateStage    = gTelemetry.AddStage("update");
+unsigned int                gRenderStage    = gTelemetry.AddStage("render");
+unsigned int                gPresentStage   = gTelemetry.AddStage("present");
+unsigned int                gPaceStage      = gTelemetry.AddStage("pace");
+
 // Direct3D device and swap chain.
 ID3D11Device*               gD3DDevice             = nullptr;
 ID3D11DeviceContext*        gD3DDeviceContext      = nullptr;
@@ -73,6 +86,10 @@ XMMATRIX gWorldMatrix;
 XMMATRIX gViewMatrix;
 XMMATRIX gProjectionMatrix;
 
+// Simulation state - the last two steps, so rendering can interpolate between them
+float gPreviousAngle = 0.0f;
+float gAngle         = 0.0f;
+
 // Vertex data for a colored cube.
 struct VertexNormalUV
 {
@@ -121,7 +138,7 @@ void Clear(const FLOAT clearColor[4], FLOAT clearDepth, UINT8 clearStencil);
 int Run();
 bool GenerateContent();
 void Update(float deltaTime);
-void Render();
+void Render(float alpha);
 void Present(bool vSync);
 void Cleanup();
 
@@ -633,19 +650,22 @@ void Update(float deltaTime)
     gD3DDeviceContext->UpdateSubresource(gD3DConstantBuffers[CB_Frame], 0, nullptr, &gViewMatrix, 0, 0);
 
 
-    static float angle = 0.0f;
-    angle += 90.0f * deltaTime;
-    XMVECTOR rotationAxis = XMVectorSet( 0, 1, 1, 0 );
-
-    gWorldMatrix = XMMatrixRotationAxis(rotationAxis, XMConvertToRadians(angle) );
-    gD3DDeviceContext->UpdateSubresource(gD3DConstantBuffers[CB_Object], 0, nullptr, &gWorldMatrix, 0, 0);
+    gPreviousAngle = gAngle;
+    gAngle += 90.0f * deltaTime;
 }
 
-void Render()
+void Render(float alpha)
 {
     assert(gD3DDevice);
     assert(gD3DDeviceContext);
 
+    // Blend the last two simulation steps so motion stays smooth between them
+    float angle = gPreviousAngle + (gAngle - gPreviousAngle) * alpha;
+    XMVECTOR rotationAxis = XMVectorSet( 0, 1, 1, 0 );
+
+    gWorldMatrix = XMMatrixRotationAxis(rotationAxis, XMConvertToRadians(angle) );
+    gD3DDeviceContext->UpdateSubresource(gD3DConstantBuffers[CB_Object], 0, nullptr, &gWorldMatrix, 0, 0);
+
     Clear(Colors::CornflowerBlue, 1.0f, 0);
 
     const UINT vertexStride = sizeof(VertexNormalUV);
@@ -668,8 +688,6 @@ void Render()
     gD3DDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
     gD3DDeviceContext->DrawIndexed(_countof(gIndicies), 0, 0);
-
-    Present(gEnableVSync);
 }
 
 void Cleanup()
@@ -697,9 +715,13 @@ int Run()
 {
     MSG msg = {0};
 
-    static DWORD previousTime = timeGetTime();
-    static const float targetFramerate = 30.0f;
-    static const float maxTimeStep = 1.0f / targetFramerate;
+    GameLoop loop(1.0 / gSimulationRate);
+
+    // With vsync on, Present does the pacing
+    loop.SetTargetFrameRate(gEnableVSync ? 0.0 : gTargetFrameRate);
+    loop.Start();
+
+    GameLoop::Clock::time_point lastTitleUpdate = GameLoop::Clock::now();
 
     while (msg.message != WM_QUIT)
     {
@@ -710,19 +732,47 @@ int Run()
         }
         else
         {
-            DWORD currentTime = timeGetTime();
-            float deltaTime = (currentTime - previousTime) / 1000.0f;
-            previousTime = currentTime;
+            gTelemetry.BeginFrame();
+            loop.BeginFrame();
 
-            // Cap the delta time to the max time step (useful if your
-            // debugging and you don't want the deltaTime value to explode.
-            deltaTime = std::min<float>(deltaTime, maxTimeStep);
+            {
+                FrameTelemetry::ScopedSample sample(gTelemetry, gUpdateStage);
+                while (loop.Step())
+                    Update((float)loop.GetFixedStep());
+            }
+
+            {
+                FrameTelemetry::ScopedSample sample(gTelemetry, gRenderStage);
+                Render(loop.GetAlpha());
+            }
+
+            {
+                FrameTelemetry::ScopedSample sample(gTelemetry, gPresentStage);
+                Present(gEnableVSync);
+            }
 
-            Update(deltaTime);
-            Render();
+            {
+                FrameTelemetry::ScopedSample sample(gTelemetry, gPaceStage);
+                loop.EndFrame();
+            }
+
+            // Tail latency over the recent frames, where we can see it
+            GameLoop::Clock::time_point now = GameLoop::Clock::now();
+            if (now - lastTitleUpdate > std::chrono::seconds(1))
+            {
+                FrameTelemetry::Stats frame = gTelemetry.GetRecentStats(FrameTelemetry::kFrameStage);
+
+                wchar_t title[256];
+                swprintf_s(title, L"%s - frame p50 %.2fms p99 %.2fms max %.2fms", gWindowName, frame.P50, frame.P99, frame.Max);
+                SetWindowTextW(gWindowHandle, title);
+                lastTitleUpdate = now;
+            }
         }
     }
 
+    gTelemetry.WriteCsv("testbed_telemetry.csv");
+    gTelemetry.WriteJson("testbed_telemetry.json");
+
     return static_cast<int>(msg.wParam);
 }
 
@@ -105,7 +105,7 @@ HRESULT ShaderManager::LoadVSFromFile(LPCWSTR filename, const char* mainfunction
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(VertexNormalUV,Position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
         { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(VertexNormalUV,Normal), D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(VertexNormalUV,TexCoord), D3D11_INPUT_PER_VERTEX_DATA, 0 }
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(VertexNormalUV,TexCoord), D3D11_INPUT_PER_VERTEX_DATA, 0 }
     };
 
     const char* vertexShaderProfile = CurrentlySupportedShader(ShaderType::Vertex);